@@ -1,19 +1,28 @@
 
 
+#include <future>
 #include <ranges>
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
+#include <imgui_internal.h>
 #include <imgui_impl_vulkan.h>
 
 #include <spdlog/spdlog.h>
 
 #include <device.hpp>
+#include <profiling/profiler.hpp>
 #include <queue.hpp>
 
 #include "application.hpp"
 #include "device_manager.hpp"
 #include "ui/device_discovery_window.hpp"
+#include "ui/feature_list_window.hpp"
+#include "ui/frame_viewer_window.hpp"
+#include "ui/gev_device_control_window.hpp"
+#include "ui/profiler_window.hpp"
+#include "ui/recorder_window.hpp"
+#include "util.hpp"
 #include "vk_utils.hpp"
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -65,10 +74,39 @@ inline constexpr auto application_info =
         .setEngineVersion(VK_MAKE_API_VERSION(0, 1, 0, 0))
         .setApiVersion(VK_API_VERSION_1_4);
 
+inline constexpr uint32_t initial_discovery_timeout_ms = 200;
+
+// Upper bound on swapchain images; the viewer keeps one staging slot each.
+inline constexpr uint32_t max_frames_in_flight = 8;
+inline constexpr uint32_t viewer_frame_size = 1024;
+
 } // namespace
 
-application::application() {
-  init_window();
+application::application()
+    : jobs_({.on_start = [](uint32_t worker) {
+        engine::profiling::profiler::get().set_thread_name("worker " +
+                                                           std::to_string(worker));
+      }}) {
+  // Opening the SL library shares nothing with the Vulkan/GLFW bring-up, so
+  // run it alongside. The table starts from the cached device list and the
+  // first discovery pass refreshes it in the background.
+  device_manager_ready_ = std::async(std::launch::async, [this] {
+    auto phase = startup_.measure("sl library + device cache");
+    auto manager = std::make_unique<device_manager>(event_bus_, jobs_);
+    manager->start_discovery(initial_discovery_timeout_ms);
+    return manager;
+  });
+
+  init_glfw();
+  {
+    // The instance only needs the GLFW extension list, not the window.
+    auto instance_ready = std::async(std::launch::async, [this] {
+      auto phase = startup_.measure("vulkan instance");
+      init_instance();
+    });
+    init_window();
+    instance_ready.get();
+  }
   init_vk();
   create_swapchain();
   init_imgui();
@@ -89,11 +127,17 @@ void application::glfw_error_callback(int error, const char *description) {
   spdlog::error("GLFW Error {}: {}", error, description);
 }
 
-void application::init_window() {
+void application::init_glfw() {
+  auto phase = startup_.measure("glfw init");
+
   glfwSetErrorCallback(glfw_error_callback);
 
   if (!glfwInit())
     throw std::runtime_error("glfwInit failed");
+}
+
+void application::init_window() {
+  auto phase = startup_.measure("window");
 
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -103,7 +147,7 @@ void application::init_window() {
     throw std::runtime_error("glfwCreateWindow failed");
 }
 
-void application::init_vk() {
+void application::init_instance() {
   VULKAN_HPP_DEFAULT_DISPATCHER.init();
 
   uint32_t     glfw_ext_count = 0;
@@ -140,15 +184,32 @@ void application::init_vk() {
                   vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance)
               .setPfnUserCallback(debug_utils_messenger_callback));
 #endif
-  surface_ = std::make_shared<engine::surface>(window_, instance_);
+}
 
-  gpus_ = engine::instance::enumerate_gpus(instance_);
+void application::init_vk() {
+  // Surface creation and GPU enumeration both only need the instance.
+  auto surface_ready = std::async(std::launch::async, [this] {
+    auto phase = startup_.measure("surface");
+    surface_ = std::make_shared<engine::surface>(window_, instance_);
+  });
+
+  {
+    auto phase = startup_.measure("gpu enumeration");
+    gpus_ = engine::instance::enumerate_gpus(instance_);
+  }
 
   auto gpu_expected = vk_utils::pick_discrete_gpu(gpus_);
   if (!gpu_expected)
     throw std::runtime_error(gpu_expected.error());
   selected_gpu_ = *gpu_expected;
 
+  // Read the pipeline cache blob while the device is created.
+  auto cache_blob = std::async(std::launch::async, [this] {
+    auto phase = startup_.measure("pipeline cache read");
+    return engine::pipeline_cache::load_blob(*selected_gpu_,
+                                             util::cache_directory());
+  });
+
   auto fam_exp = vk_utils::pick_queue_families(*selected_gpu_);
   if (!fam_exp)
     throw std::runtime_error(fam_exp.error());
@@ -165,6 +226,7 @@ void application::init_vk() {
   }
 
   engine::feature_chain feats;
+  feats.get<vk::PhysicalDeviceVulkan12Features>().setTimelineSemaphore(true);
   feats.get<vk::PhysicalDeviceVulkan13Features>()
       .setDynamicRendering(true)
       .setSynchronization2(true);
@@ -173,13 +235,28 @@ void application::init_vk() {
       .setQueueCreateInfos(qcis)
       .setPEnabledExtensionNames(device_extensions);
 
-  engine::device_bundle device_bundle =
-      engine::device::create(selected_gpu_, feats, device_extensions);
+  {
+    auto phase = startup_.measure("device");
+
+    engine::device_bundle device_bundle =
+        engine::device::create(selected_gpu_, feats, device_extensions);
 
-  device_ = std::move(device_bundle.dev);
-  graphics_queue_ = std::move(device_bundle.queues[0]);
+    device_ = std::move(device_bundle.dev);
+    graphics_queue_ = std::move(device_bundle.queues[0]);
 
-  VULKAN_HPP_DEFAULT_DISPATCHER.init(device_->handle());
+    VULKAN_HPP_DEFAULT_DISPATCHER.init(device_->handle());
+  }
+
+  gpu_profiler_ = std::make_unique<engine::profiling::gpu_profiler>(
+      device_, graphics_queue_->queue_family_index(), "gpu graphics",
+      max_frames_in_flight);
+
+  {
+    const auto blob = cache_blob.get();
+    spdlog::info("Pipeline cache: {} bytes loaded", blob.size());
+    pipeline_cache_ = std::make_unique<engine::pipeline_cache>(
+        device_, util::cache_directory(), blob);
+  }
 
   std::array<vk::DescriptorPoolSize, 1> pool_sizes = {{vk::DescriptorPoolSize(
       vk::DescriptorType::eCombinedImageSampler,
@@ -189,10 +266,14 @@ void application::init_vk() {
       vk::DescriptorPoolCreateInfo()
           .setPoolSizes(pool_sizes)
           .setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
-          .setMaxSets(1));
+          .setMaxSets(IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE));
+
+  surface_ready.get();
 }
 
 void application::create_swapchain() {
+  auto phase = startup_.measure("swapchain");
+
   vk::Format requested_formats[] = {
       vk::Format::eB8G8R8A8Unorm, vk::Format::eR8G8B8A8Unorm,
       vk::Format::eB8G8R8Unorm, vk::Format::eR8G8B8Unorm};
@@ -246,6 +327,8 @@ void application::create_swapchain() {
 }
 
 void application::init_imgui() {
+  auto phase = startup_.measure("imgui");
+
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGui::StyleColorsDark();
@@ -268,6 +351,7 @@ void application::init_imgui() {
   init_info.QueueFamily = graphics_queue_->queue_family_index();
   init_info.Queue = graphics_queue_->handle();
   init_info.DescriptorPool = *descriptor_pool_;
+  init_info.PipelineCache = pipeline_cache_->handle();
   init_info.Subpass = 0;
   init_info.MinImageCount = swapchain_->min_image_count();
   init_info.ImageCount = swapchain_->images().size();
@@ -310,13 +394,14 @@ void application::create_frames() {
 
     f.image_available = device_->handle().createSemaphoreUnique({});
     f.render_finished = device_->handle().createSemaphoreUnique({});
-    f.in_flight = device_->handle().createFenceUnique(
-        {vk::FenceCreateFlagBits::eSignaled});
+    f.timeline_value = 0;
   }
 }
 
 void application::recreate_swapchain() {
-  device_->handle().waitIdle();
+  graphics_queue_->wait_idle();
+  if (pending_present_.valid())
+    pending_present_.get();
 
   frames_.clear();
   swapchain_views_.clear();
@@ -329,9 +414,36 @@ void application::recreate_swapchain() {
   ImGui_ImplVulkan_SetMinImageCount(swapchain_->min_image_count());
 }
 
+void application::build_default_layout(ImGuiID dockspace_id, ImVec2 size) {
+  // Only runs when imgui.ini has no layout yet; user changes persist after.
+  ImGui::DockBuilderAddNode(dockspace_id, ImGuiDockNodeFlags_DockSpace);
+  ImGui::DockBuilderSetNodeSize(dockspace_id, size);
+
+  ImGuiID left = 0, centre = 0, right = 0;
+  ImGui::DockBuilderSplitNode(dockspace_id, ImGuiDir_Right, 0.3f, &right,
+                              &centre);
+  ImGui::DockBuilderSplitNode(centre, ImGuiDir_Left, 0.35f, &left, &centre);
+  ImGui::DockBuilderDockWindow(device_discovery_window::window_name, left);
+  ImGui::DockBuilderDockWindow(feature_list_window::window_name, left);
+  ImGui::DockBuilderDockWindow(frame_viewer_window::window_name, centre);
+  ImGui::DockBuilderDockWindow(gev_device_control_window::window_name, right);
+  ImGui::DockBuilderDockWindow(profiler_window::window_name, right);
+  ImGui::DockBuilderDockWindow(recorder_window::window_name, right);
+  ImGui::DockBuilderFinish(dockspace_id);
+}
+
 void application::record(frame &f, uint32_t img_idx) {
+  ENGINE_PROFILE_SCOPE("record");
+
   f.cmd.reset({});
   f.cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  gpu_profiler_->begin_frame(f.cmd, cur_frame_);
+  const auto frame_region = gpu_profiler_->begin_region(f.cmd, "frame");
+
+  {
+    ENGINE_PROFILE_GPU_SCOPE(*gpu_profiler_, f.cmd, "upload");
+    live_view_->record_upload(f.cmd, cur_frame_);
+  }
 
   vk::ImageMemoryBarrier2 pre{};
   pre.setSrcStageMask(vk::PipelineStageFlagBits2::eNone)
@@ -358,7 +470,10 @@ void application::record(frame &f, uint32_t img_idx) {
                            .setLayerCount(1)
                            .setColorAttachments(color));
 
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), f.cmd);
+  {
+    ENGINE_PROFILE_GPU_SCOPE(*gpu_profiler_, f.cmd, "imgui");
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), f.cmd);
+  }
   f.cmd.endRendering();
 
   vk::ImageMemoryBarrier2 post{};
@@ -372,23 +487,64 @@ void application::record(frame &f, uint32_t img_idx) {
       .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
   f.cmd.pipelineBarrier2(vk::DependencyInfo{}.setImageMemoryBarriers(post));
 
+  gpu_profiler_->end_region(f.cmd, frame_region);
   f.cmd.end();
 }
 
 void application::run() {
   bool rebuild_swapchain = false;
 
-  device_manager          device_manager(event_bus_);
-  device_discovery_window device_discovery_window(device_manager);
+  device_manager_ = device_manager_ready_.get();
+  live_view_ = std::make_unique<live_view>(device_, viewer_frame_size,
+                                           viewer_frame_size,
+                                           max_frames_in_flight, jobs_);
+  // The first open session with a frame is shown; with none, the view
+  // falls back to the synthetic source. Sessions close on this thread,
+  // between updates, and the view holds no frame past one.
+  live_view_->set_device_source([this]() -> processing::frame_ref {
+    for (const auto &session : device_manager_->sessions())
+      if (auto frame = session->latest())
+        return frame;
+    return {};
+  });
+
+  // Device operations run on its I/O threads and complete on this one;
+  // declared before the windows whose callbacks it holds.
+  async::context async_context;
+
+  device_discovery_window   device_discovery_window(*device_manager_);
+  frame_viewer_window       frame_viewer_window(*live_view_, jobs_);
+  gev_device_control_window device_control_window(*device_manager_,
+                                                  async_context.ops());
+  feature_list_window       feature_list_window;
+  profiler_window           profiler_window;
+  recorder_window           recorder_window(*device_manager_);
+
+  engine::profiling::profiler::get().set_thread_name("ui");
+
+  startup_.log();
 
   while (!glfwWindowShouldClose(window_)) {
+    ENGINE_PROFILE_SCOPE("frame");
+
     glfwPollEvents();
 
-    ImGui_ImplVulkan_NewFrame();
+    {
+      ENGINE_PROFILE_SCOPE("device operations");
+      async_context.ops().drain();
+    }
+
+    {
+      // The backend may upload its font atlas on the graphics queue here.
+      auto queue_lock = graphics_queue_->lock_handle();
+      ImGui_ImplVulkan_NewFrame();
+    }
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
     {
+      ENGINE_PROFILE_SCOPE("build ui");
+
       ImGuiViewport *viewport = ImGui::GetMainViewport();
       ImGui::SetNextWindowPos(viewport->Pos);
       ImGui::SetNextWindowSize(viewport->Size);
@@ -410,15 +566,36 @@ void application::run() {
 
       // DockSpace
       ImGuiID dockspace_id = ImGui::GetID("MyDockSpace");
+      if (!ImGui::DockBuilderGetNode(dockspace_id))
+        build_default_layout(dockspace_id, viewport->Size);
       ImGui::DockSpace(dockspace_id, ImVec2(0.0f, 0.0f),
                        ImGuiDockNodeFlags_None);
 
       device_discovery_window.render();
+      frame_viewer_window.render();
+      device_control_window.render();
+#ifdef APP_HAS_SOCKET_DRIVER
+      feature_list_window.set_features(device_control_window.node_map(),
+                                       device_control_window.poller());
+#endif
+      feature_list_window.render();
+      profiler_window.render();
+      recorder_window.render();
 
       ImGui::End();
     }
 
-    ImGui::Render();
+    {
+      ENGINE_PROFILE_SCOPE("imgui render");
+      ImGui::Render();
+    }
+
+    // The previous present has normally long been handed to the driver by the
+    // submit thread; collect its result without blocking the frame on it.
+    if (pending_present_.valid()) {
+      if (pending_present_.get() != vk::Result::eSuccess)
+        rebuild_swapchain = true;
+    }
 
     if (rebuild_swapchain) {
       recreate_swapchain();
@@ -426,7 +603,13 @@ void application::run() {
     }
 
     frame &f = frames_[cur_frame_];
-    device_->handle().waitForFences(*f.in_flight, VK_TRUE, UINT64_MAX);
+    {
+      ENGINE_PROFILE_SCOPE("wait frame");
+      if (auto waited = graphics_queue_->wait(f.timeline_value,
+                                              std::chrono::nanoseconds::max());
+          !waited)
+        throw std::runtime_error(vk::to_string(waited.error()));
+    }
 
     auto acq = swapchain_->acquire_image(*f.image_available,
                                          std::chrono::milliseconds(500));
@@ -436,30 +619,37 @@ void application::run() {
     }
 
     const uint32_t img_idx = acq->image_index;
-    device_->handle().resetFences(*f.in_flight);
 
+    live_view_->update(cur_frame_);
     record(f, img_idx);
 
-    vk::PipelineStageFlags wait =
-        vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    vk::SubmitInfo submit(*f.image_available, wait, f.cmd, *f.render_finished);
-    graphics_queue_->handle().submit(submit, *f.in_flight);
+    f.timeline_value = graphics_queue_->submit(
+        {.wait_semaphores = {vk::SemaphoreSubmitInfo()
+                                 .setSemaphore(*f.image_available)
+                                 .setStageMask(vk::PipelineStageFlagBits2::
+                                                   eColorAttachmentOutput)},
+         .command_buffers = {vk::CommandBufferSubmitInfo().setCommandBuffer(
+             f.cmd)},
+         .signal_semaphores = {
+             vk::SemaphoreSubmitInfo()
+                 .setSemaphore(*f.render_finished)
+                 .setStageMask(vk::PipelineStageFlagBits2::eAllCommands)}});
 
     ImGuiIO &io = ImGui::GetIO();
     if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
       ImGui::UpdatePlatformWindows();
+      // Secondary viewports submit and present on the raw queue.
+      auto queue_lock = graphics_queue_->lock_handle();
       ImGui::RenderPlatformWindowsDefault(nullptr, nullptr);
     }
 
-    auto present_res = swapchain_->present(img_idx, *f.render_finished,
-                                           graphics_queue_->handle());
-    if (!present_res) {
-      rebuild_swapchain = true;
-      continue;
-    }
+    pending_present_ =
+        swapchain_->present(img_idx, *f.render_finished, *graphics_queue_);
 
     cur_frame_ = (cur_frame_ + 1) % frames_.size();
   }
 
-  device_->handle().waitIdle();
+  graphics_queue_->wait_idle();
+  if (pending_present_.valid())
+    pending_present_.get();
 }
\ No newline at end of file
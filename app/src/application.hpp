@@ -1,23 +1,32 @@
 #pragma once
 
+#include <future> /* std::future for pending presents */
 #include <memory> /* std::shared_ptr for vk objects */
 
 #include <glfw/glfw3.h>
+#include <imgui.h>
 
 #include <device.hpp>
 #include <gpu.hpp>
 #include <instance.hpp>
+#include <jobs/job_system.hpp>
+#include <pipeline_cache.hpp>
+#include <profiling/gpu_profiler.hpp>
+#include <queue.hpp>
 #include <swapchain/surface.hpp>
 #include <swapchain/swapchain.hpp>
 
+#include "device_manager.hpp"
+#include "display/live_view.hpp"
 #include "event_bus.hpp"
+#include "startup_report.hpp"
 
 struct frame {
   vk::UniqueCommandPool command_pool;
   vk::CommandBuffer     cmd;
   vk::UniqueSemaphore   image_available;
   vk::UniqueSemaphore   render_finished;
-  vk::UniqueFence       in_flight;
+  uint64_t              timeline_value = 0; // graphics queue timeline
 };
 
 class application {
@@ -28,12 +37,21 @@ public:
   void run();
 
 private:
+  // The one set of workers for display correction, recorder and history
+  // compression, playback decoding and exports. First, so it outlives
+  // everything that forks onto it.
+  engine::jobs::job_system jobs_;
+
   GLFWwindow                               *window_{nullptr};
   std::shared_ptr<engine::instance>         instance_;
   std::vector<std::shared_ptr<engine::gpu>> gpus_;
   std::shared_ptr<engine::gpu>              selected_gpu_;
 
-  std::shared_ptr<engine::device> device_;
+  std::shared_ptr<engine::device>         device_;
+  std::unique_ptr<engine::pipeline_cache> pipeline_cache_;
+
+  std::unique_ptr<engine::profiling::gpu_profiler> gpu_profiler_;
+  std::unique_ptr<live_view>                       live_view_;
 
   std::shared_ptr<engine::queue> graphics_queue_;
   std::shared_ptr<engine::queue> compute_queue_;
@@ -46,23 +64,31 @@ private:
   std::vector<frame>                 frames_;
   vk::Extent2D                       swapchain_extent_;
   uint32_t                           cur_frame_ = 0;
+  std::future<vk::Result>            pending_present_;
 
   event_bus           event_bus_;
   subscription_handle device_open_subscription_;
 
+  startup_report                               startup_;
+  std::future<std::unique_ptr<device_manager>> device_manager_ready_;
+  std::unique_ptr<device_manager>              device_manager_;
+
 #ifdef APP_USE_VULKAN_DEBUG_UTILS
   vk::UniqueDebugUtilsMessengerEXT debug_utils_messenger_;
 #endif
 
   static void glfw_error_callback(int error, const char *description);
 
+  void init_glfw();
   void init_window();
+  void init_instance();
   void init_vk();
   void create_swapchain();
   void init_imgui();
   void create_swapchain_views();
   void create_frames();
   void recreate_swapchain();
+  void build_default_layout(ImGuiID dockspace_id, ImVec2 size);
   void record(frame &f, uint32_t img_idx);
 
   vk::SurfaceFormatKHR
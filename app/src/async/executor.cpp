@@ -0,0 +1,109 @@
+#include "executor.hpp"
+
+#include <algorithm>
+
+#include <profiling/profiler.hpp>
+
+namespace async {
+
+io_executor::io_executor(uint32_t threads) {
+  threads_.reserve(std::max(threads, 1u));
+  for (uint32_t i = 0; i < std::max(threads, 1u); ++i)
+    threads_.emplace_back([this, i] {
+      engine::profiling::profiler::get().set_thread_name("io " +
+                                                         std::to_string(i));
+      worker_loop();
+    });
+}
+
+io_executor::~io_executor() {
+  {
+    std::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (auto &t : threads_)
+    t.join();
+}
+
+void io_executor::post(std::coroutine_handle<> h) {
+  {
+    std::scoped_lock lock(mutex_);
+    queue_.push_back(h);
+  }
+  ready_.notify_one();
+}
+
+void io_executor::worker_loop() {
+  while (true) {
+    std::coroutine_handle<> h;
+    {
+      std::unique_lock lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (queue_.empty())
+        return; // Stopping and nothing left to run.
+      h = queue_.front();
+      queue_.pop_front();
+    }
+    h.resume();
+  }
+}
+
+ui_dispatcher::~ui_dispatcher() {
+  for (auto h : pending_)
+    h.destroy();
+}
+
+void ui_dispatcher::post(std::coroutine_handle<> h) {
+  std::scoped_lock lock(mutex_);
+  pending_.push_back(h);
+}
+
+void ui_dispatcher::drain() {
+  {
+    std::scoped_lock lock(mutex_);
+    running_.swap(pending_);
+  }
+  // Continuations may post again; those run next frame.
+  for (auto h : running_)
+    h.resume();
+  running_.clear();
+}
+
+void operations::cancel(operation_id id) {
+  if (auto it = entries_.find(id); it != entries_.end())
+    it->second.stop.request_stop();
+}
+
+void operations::cancel_all() {
+  for (auto &[id, e] : entries_)
+    e.stop.request_stop();
+}
+
+void operations::drain() {
+  const auto now = clock::now();
+  for (auto &[id, e] : entries_)
+    if (now >= e.deadline && !e.stop.stop_requested()) {
+      e.timed_out = true;
+      e.stop.request_stop();
+    }
+
+  ui_.drain();
+}
+
+std::error_code operations::finish(operation_id id) {
+  auto it = entries_.find(id);
+  if (it == entries_.end())
+    return {};
+
+  std::error_code err;
+  if (it->second.timed_out)
+    err = std::make_error_code(std::errc::timed_out);
+  else if (it->second.stop.stop_requested())
+    err = std::make_error_code(std::errc::operation_canceled);
+
+  entries_.erase(it);
+  return err;
+}
+
+} // namespace async
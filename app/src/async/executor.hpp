@@ -0,0 +1,178 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <mutex>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "task.hpp"
+
+namespace async {
+
+// A few threads for blocking device I/O. A coroutine moves onto one with
+// co_await io.schedule(); blocking calls after that point do not hold up
+// the UI. Work queued when the executor is destroyed still runs.
+class io_executor {
+public:
+  explicit io_executor(uint32_t threads = 4);
+  ~io_executor();
+
+  io_executor(const io_executor &) = delete;
+  io_executor &operator=(const io_executor &) = delete;
+
+  auto schedule() noexcept {
+    struct awaiter {
+      io_executor &executor;
+      bool         await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) { executor.post(h); }
+      void await_resume() const noexcept {}
+    };
+    return awaiter{*this};
+  }
+
+private:
+  void post(std::coroutine_handle<> h);
+  void worker_loop();
+
+  std::mutex                          mutex_;
+  std::condition_variable             ready_;
+  std::deque<std::coroutine_handle<>> queue_;
+  bool                                stopping_ = false;
+  std::vector<std::thread>            threads_;
+};
+
+// Continuations for the UI thread, resumed by drain() once per frame.
+// Only top-level drivers (see operations) should await schedule(): any
+// still queued at destruction are destroyed rather than resumed.
+class ui_dispatcher {
+public:
+  ui_dispatcher() = default;
+  ~ui_dispatcher();
+
+  ui_dispatcher(const ui_dispatcher &) = delete;
+  ui_dispatcher &operator=(const ui_dispatcher &) = delete;
+
+  auto schedule() noexcept {
+    struct awaiter {
+      ui_dispatcher &dispatcher;
+      bool           await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) { dispatcher.post(h); }
+      void await_resume() const noexcept {}
+    };
+    return awaiter{*this};
+  }
+
+  void drain();
+
+private:
+  void post(std::coroutine_handle<> h);
+
+  std::mutex                           mutex_;
+  std::vector<std::coroutine_handle<>> pending_;
+  std::vector<std::coroutine_handle<>> running_; // drain()'s swap buffer
+};
+
+using operation_id = uint64_t;
+
+/*========================================================================================
+ *  operations
+ *  -----------------------------------------------------------------------
+ *  •  Runs device operations (coroutines taking a std::stop_token) on the
+ *     I/O executor and delivers each result to a callback on the UI
+ *     thread. Any number can be in flight, across any number of devices.
+ *  •  cancel() and the per-operation timeout request a stop; operations
+ *     check it between round trips. The callback then receives
+ *     operation_canceled or timed_out, whatever the operation returned.
+ *  •  UI thread only, apart from the coroutines themselves.
+ *=======================================================================================*/
+class operations {
+public:
+  operations(io_executor &io, ui_dispatcher &ui) : io_(io), ui_(ui) {}
+
+  operations(const operations &) = delete;
+  operations &operator=(const operations &) = delete;
+
+  // make(stop) returns task<std::expected<U, std::error_code>>;
+  // on_done(std::expected<U, std::error_code>) runs on the UI thread.
+  template <typename Make, typename Done>
+  operation_id spawn(Make &&make, std::chrono::milliseconds timeout,
+                     Done &&on_done) {
+    const operation_id id = next_id_++;
+    auto &e = entries_[id];
+    e.deadline = clock::now() + timeout;
+
+    run(id, std::forward<Make>(make)(e.stop.get_token()),
+        std::forward<Done>(on_done));
+    return id;
+  }
+
+  void cancel(operation_id id);
+  void cancel_all();
+
+  // UI thread, once per frame: expires timeouts, then runs completions.
+  void   drain();
+  size_t pending() const noexcept { return entries_.size(); }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct entry {
+    std::stop_source  stop;
+    clock::time_point deadline;
+    bool              timed_out = false;
+  };
+
+  template <typename R, typename Done>
+  detached run(operation_id id, task<R> op, Done on_done) {
+    co_await io_.schedule();
+    R result = co_await std::move(op);
+    co_await ui_.schedule();
+
+    if (auto err = finish(id))
+      result = std::unexpected(err);
+    on_done(std::move(result));
+  }
+
+  // Forgets the operation; returns the error that overrides its result.
+  std::error_code finish(operation_id id);
+
+  io_executor   &io_;
+  ui_dispatcher &ui_;
+
+  operation_id                            next_id_ = 1;
+  std::unordered_map<operation_id, entry> entries_;
+};
+
+// The UI's async machinery, torn down in the one safe order: cancel
+// everything, let the I/O threads finish what they are running (results go
+// to the UI queue), then drop the undelivered results.
+class context {
+public:
+  explicit context(uint32_t io_threads = 4) : io_(io_threads) {}
+  ~context() { ops_.cancel_all(); }
+
+  operations &ops() noexcept { return ops_; }
+
+private:
+  ui_dispatcher ui_;
+  operations    ops_{io_, ui_}; // Binds io_ before it is built; unused until then.
+  io_executor   io_;
+};
+
+// For operations: fails with operation_canceled once stop is requested.
+inline std::expected<void, std::error_code>
+check_stop(const std::stop_token &stop) {
+  if (stop.stop_requested())
+    return std::unexpected(std::make_error_code(std::errc::operation_canceled));
+  return {};
+}
+
+} // namespace async
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace async {
+
+/*========================================================================================
+ *  task<T>
+ *  -----------------------------------------------------------------------
+ *  •  Lazily started coroutine producing a T. Starts when awaited and
+ *     resumes its awaiter when it finishes (symmetric transfer, so long
+ *     chains do not grow the stack).
+ *  •  Device operations return task<std::expected<U, std::error_code>>;
+ *     exceptions escaping a task are rethrown in the awaiter.
+ *  •  Which thread a task runs on is decided by what it awaits, e.g.
+ *     io_executor::schedule() or ui_dispatcher::schedule().
+ *=======================================================================================*/
+template <typename T> class [[nodiscard]] task {
+public:
+  struct promise_type {
+    std::optional<T>        value;
+    std::exception_ptr      error;
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    task get_return_object() noexcept {
+      return task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+        return h.promise().continuation;
+      }
+      void await_resume() noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    template <typename U> void return_value(U &&v) {
+      value.emplace(std::forward<U>(v));
+    }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+  };
+
+  task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task &operator=(task &&other) noexcept {
+    if (this != &other) {
+      if (handle_)
+        handle_.destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  ~task() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+  T await_resume() {
+    auto &p = handle_.promise();
+    if (p.error)
+      std::rethrow_exception(p.error);
+    return std::move(*p.value);
+  }
+
+private:
+  explicit task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Fire-and-forget coroutine: starts immediately and frees itself when done.
+// Only for top-level drivers that catch everything themselves.
+struct detached {
+  struct promise_type {
+    detached            get_return_object() noexcept { return {}; }
+    std::suspend_never  initial_suspend() noexcept { return {}; }
+    std::suspend_never  final_suspend() noexcept { return {}; }
+    void                return_void() noexcept {}
+    void                unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+} // namespace async
@@ -0,0 +1,200 @@
+#include "device_control.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <string_view>
+#include <vector>
+
+#include "async/executor.hpp"
+
+namespace device_control {
+
+namespace {
+
+// Memory is read in pieces of this size so a cancelled download stops
+// within one piece.
+constexpr size_t xml_piece_size = 16 * 1024;
+
+// Registers per sweep piece, between stop checks.
+constexpr uint32_t sweep_piece_registers = 4096;
+
+// Largest description we are prepared to download.
+constexpr size_t max_xml_size = 16 * 1024 * 1024;
+
+std::error_code invalid_url() {
+  return std::make_error_code(std::errc::invalid_argument);
+}
+
+} // namespace
+
+async::task<result<std::vector<uint32_t>>>
+read_registers(registers_ptr registers, std::vector<uint32_t> addresses,
+               std::stop_token stop) {
+  if (auto r = async::check_stop(stop); !r)
+    co_return std::unexpected(r.error());
+  co_return registers->read(addresses);
+}
+
+async::task<result<void>>
+write_registers(registers_ptr                              registers,
+                std::vector<std::pair<uint32_t, uint32_t>> writes,
+                std::stop_token                            stop) {
+  if (auto r = async::check_stop(stop); !r)
+    co_return r;
+  co_return registers->write(writes);
+}
+
+async::task<result<void>> execute_command(registers_ptr registers,
+                                          uint32_t address, std::stop_token stop) {
+  return write_registers(std::move(registers), {{address, 1}}, std::move(stop));
+}
+
+async::task<result<std::vector<std::optional<uint32_t>>>>
+sweep(registers_ptr registers, uint32_t first, uint32_t count,
+      std::stop_token stop) {
+  std::vector<std::optional<uint32_t>> values;
+  values.reserve(count);
+
+  for (uint32_t done = 0; done < count;) {
+    if (auto r = async::check_stop(stop); !r)
+      co_return std::unexpected(r.error());
+
+    const uint32_t piece = std::min(sweep_piece_registers, count - done);
+    auto           part = registers->sweep(first + done * 4, piece);
+    if (!part)
+      co_return std::unexpected(part.error());
+    values.insert(values.end(), part->begin(), part->end());
+    done += piece;
+  }
+  co_return values;
+}
+
+async::task<result<std::string>> read_genicam_xml(registers_ptr   registers,
+                                                  std::stop_token stop) {
+  auto &client = registers->client();
+
+  std::string url(gev::reg::url_size, '\0');
+  if (auto r = client.read_memory(gev::reg::first_url,
+                                   std::as_writable_bytes(std::span(url)));
+      !r)
+    co_return std::unexpected(r.error());
+  url.resize(url.find('\0') == std::string::npos ? url.size() : url.find('\0'));
+
+  // Local:<file name>;<hex address>;<hex length>[?SchemaVersion=...]
+  std::string_view rest(url);
+  if (!rest.starts_with("Local:") && !rest.starts_with("local:"))
+    co_return std::unexpected(std::make_error_code(std::errc::not_supported));
+  rest.remove_prefix(6);
+
+  const size_t first = rest.find(';');
+  const size_t second = rest.find(';', first + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos)
+    co_return std::unexpected(invalid_url());
+
+  const auto file_name = rest.substr(0, first);
+  const auto address_text = rest.substr(first + 1, second - first - 1);
+  auto       length_text = rest.substr(second + 1);
+  length_text = length_text.substr(0, length_text.find('?'));
+
+  if (file_name.ends_with(".zip") || file_name.ends_with(".ZIP"))
+    co_return std::unexpected(std::make_error_code(std::errc::not_supported));
+
+  uint32_t address = 0;
+  size_t   length = 0;
+  if (std::from_chars(address_text.data(),
+                      address_text.data() + address_text.size(), address, 16)
+              .ec != std::errc{} ||
+      std::from_chars(length_text.data(),
+                      length_text.data() + length_text.size(), length, 16)
+              .ec != std::errc{} ||
+      length == 0 || length > max_xml_size)
+    co_return std::unexpected(invalid_url());
+
+  std::string xml(length, '\0');
+  for (size_t offset = 0; offset < length; offset += xml_piece_size) {
+    if (auto r = async::check_stop(stop); !r)
+      co_return std::unexpected(r.error());
+
+    const size_t piece = std::min(xml_piece_size, length - offset);
+    if (auto r = client.read_memory(
+            address + static_cast<uint32_t>(offset),
+            std::as_writable_bytes(std::span(xml).subspan(offset, piece)));
+        !r)
+      co_return std::unexpected(r.error());
+  }
+
+  // Descriptions are often padded to a multiple of four with NULs.
+  xml.resize(std::min(xml.size(), xml.find('\0')));
+  co_return xml;
+}
+
+async::task<result<loaded_node_map>>
+load_node_map(registers_ptr registers, std::filesystem::path xml_file,
+              std::filesystem::path cache_dir, std::stop_token stop) {
+  std::string xml;
+  if (xml_file.empty()) {
+    if (!registers)
+      co_return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    auto downloaded = co_await read_genicam_xml(registers, stop);
+    if (!downloaded)
+      co_return std::unexpected(downloaded.error());
+    xml = std::move(*downloaded);
+  }
+  if (auto r = async::check_stop(stop); !r)
+    co_return std::unexpected(r.error());
+
+  const auto start = std::chrono::steady_clock::now();
+  auto map = xml_file.empty()
+                 ? gev::node_map::load_or_compile(std::move(xml), cache_dir)
+                 : gev::node_map::load_or_compile_file(xml_file, cache_dir);
+  if (!map)
+    co_return std::unexpected(map.error());
+
+  loaded_node_map loaded;
+  loaded.map = std::make_shared<const gev::node_map>(std::move(*map));
+  loaded.compile_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  if (registers)
+    loaded.policies = apply_policies(*registers, *loaded.map);
+  co_return loaded;
+}
+
+size_t apply_policies(gev::register_cache &registers, const gev::node_map &map) {
+  size_t count = 0;
+  for (const gev::node &n : map.nodes()) {
+    switch (n.kind) {
+    case gev::node_kind::int_reg:
+    case gev::node_kind::masked_int_reg:
+    case gev::node_kind::float_reg:
+    case gev::node_kind::register_:
+      break;
+    default:
+      continue;
+    }
+    // Computed addresses are only known once the referenced node is read.
+    // Only what the cache serves gets a policy, as feature_poller decides
+    // it: values of up to 8 bytes. Strings and larger blocks go through
+    // READMEM, and a policy per word of them would only fill its map.
+    if (n.address_ref != gev::no_node || n.length == 0 || n.length > 8 ||
+        n.address + n.length > 0x1'0000'0000ull)
+      continue;
+
+    auto policy = gev::cache_policy::volatile_;
+    if (n.polling_ms == 0 && n.invalidators.count == 0 &&
+        n.access != gev::access_mode::wo) {
+      if (n.cache == gev::cachable::write_through)
+        policy = gev::cache_policy::write_through;
+      else if (n.cache == gev::cachable::write_around)
+        policy = gev::cache_policy::cached;
+    }
+
+    const auto first = static_cast<uint32_t>(n.address) & ~3u;
+    for (uint64_t a = first; a < n.address + n.length; a += 4, ++count)
+      registers.set_policy(static_cast<uint32_t>(a), policy);
+  }
+  return count;
+}
+
+} // namespace device_control
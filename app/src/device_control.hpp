@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <gev/node_map.hpp>
+#include <gev/register_cache.hpp>
+
+#include "async/task.hpp"
+
+// Device control operations as coroutines for async::operations. Each one
+// expects to run on the I/O executor and checks its stop token between
+// batches of GVCP commands; a batch already on the wire is bounded by the
+// client's own timeout and retries.
+namespace device_control {
+
+template <typename T> using result = std::expected<T, std::error_code>;
+
+using registers_ptr = std::shared_ptr<gev::register_cache>;
+using node_map_ptr = std::shared_ptr<const gev::node_map>;
+
+// Registers go out in as few commands as possible and, where their cache
+// policy allows, are answered from the cache.
+async::task<result<std::vector<uint32_t>>>
+read_registers(registers_ptr registers, std::vector<uint32_t> addresses,
+               std::stop_token stop);
+
+async::task<result<void>>
+write_registers(registers_ptr                              registers,
+                std::vector<std::pair<uint32_t, uint32_t>> writes,
+                std::stop_token                            stop);
+
+// Writes 1 to a command register (AcquisitionStart, TriggerSoftware, ...).
+async::task<result<void>> execute_command(registers_ptr registers,
+                                          uint32_t address, std::stop_token stop);
+
+// Reads count consecutive registers from first; see register_cache::sweep.
+async::task<result<std::vector<std::optional<uint32_t>>>>
+sweep(registers_ptr registers, uint32_t first, uint32_t count,
+      std::stop_token stop);
+
+// Follows the first URL register to the GenICam description in device
+// memory. Only uncompressed "Local:" descriptions are supported.
+async::task<result<std::string>> read_genicam_xml(registers_ptr   registers,
+                                                  std::stop_token stop);
+
+struct loaded_node_map {
+  node_map_ptr map;
+  double       compile_ms = 0; // Parse or cache mapping; not the download.
+  size_t       policies = 0;   // Registers given a policy by apply_policies.
+};
+
+// Compiles xml_file, or the device's own description if it is empty,
+// through the node map cache in cache_dir; vendor descriptions take long
+// enough to parse that only the first connect should pay for it. With
+// registers, also applies the map's cache policies to them.
+async::task<result<loaded_node_map>>
+load_node_map(registers_ptr registers, std::filesystem::path xml_file,
+              std::filesystem::path cache_dir, std::stop_token stop);
+
+// Sets the cache policy of every register of up to 8 bytes the map
+// describes from its <Cachable>. Polled registers and ones with
+// invalidators stay volatile: only writes reported to
+// feature_poller::written() drop their cached values. Returns the number
+// of registers set.
+size_t apply_policies(gev::register_cache &registers, const gev::node_map &map);
+
+} // namespace device_control
@@ -1,97 +1,773 @@
 #include "device_manager.hpp"
 
-std::expected<device_session, sl_error>
-device_session::create(sl_device *device, uint32_t num_framebuffers,
-                       uint32_t framebuffer_size) {
-  sl_error          err;
-  sl_device_handle *device_handle = nullptr;
-  sl_stream        *stream = nullptr;
-
-  if (err = sl_device_open(device, &device_handle)) {
-    return std::unexpected(err);
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <ctime>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include <jobs/bands.hpp>
+#include <processing/correction.hpp>
+#include <profiling/profiler.hpp>
+
+#include "placement.hpp"
+#include "util.hpp"
+
+#ifdef APP_HAS_SOCKET_DRIVER
+#include <gev/network_interface.hpp>
+#endif
+
+std::string to_string(const session_error &error) {
+  if (const auto *sl = std::get_if<sl_error>(&error))
+    return sl_error_to_string(*sl);
+  return std::get<std::error_code>(error).message();
+}
+
+std::expected<std::unique_ptr<device_session>, session_error>
+device_session::create(const discovered_device &device,
+                       const session_options   &options) {
+  std::unique_ptr<device_session> session(new device_session(device, options));
+  session->place(options);
+
+  std::expected<void, session_error> opened;
+  switch (options.driver) {
+  case stream_driver::filter:
+    opened = session->open_filter();
+    break;
+  case stream_driver::socket:
+#ifdef APP_HAS_SOCKET_DRIVER
+    opened = session->open_socket(options);
+#else
+    opened = std::unexpected(
+        std::make_error_code(std::errc::function_not_supported));
+#endif
+    break;
   }
 
-  std::vector<uint16_t> framebuffer_data(num_framebuffers * framebuffer_size,
-                                         0);
+  if (!opened)
+    return std::unexpected(opened.error());
+  return session;
+}
+
+device_session::device_session(const discovered_device &device,
+                               const session_options   &options)
+    : device_(device), driver_(options.driver),
+      framebuffer_count_(options.framebuffer_count),
+      framebuffer_pixels_(options.framebuffer_pixels),
+      frame_data_(std::make_unique_for_overwrite<uint16_t[]>(
+          size_t{options.framebuffer_count} * options.framebuffer_pixels)),
+      jobs_(options.jobs) {}
+
+void device_session::place(const session_options &options) {
+  numa_node_ = options.placement.numa_node;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // The NIC that receives the stream is the one the kernel would route
+  // the device's address through.
+  if (!numa_node_ &&
+      device_.descriptor.device_interface == SL_DEVICE_INTERFACE_GEV) {
+    const gev::endpoint control{
+        device_.descriptor.gev_descriptor.device_ip_address, gev::gvcp_port};
+    if (auto local = gev::udp_socket::local_address_for(control))
+      numa_node_ = placement::numa_node_for_address(*local);
+  }
+#endif
+
+  realtime_priority_ = options.placement.realtime_priority;
+
+  if (!options.placement.cpus.empty())
+    cpus_ = options.placement.cpus;
+  else if (numa_node_)
+    cpus_ = placement::cpus_of_node(*numa_node_);
+
+  placement::first_touch(
+      std::as_writable_bytes(std::span(
+          frame_data_.get(), size_t{framebuffer_count_} * framebuffer_pixels_)),
+      cpus_);
+
+  spdlog::info("Session for {}: NUMA node {}, {} CPU(s) for acquisition",
+               util::format_ip_address(
+                   device_.descriptor.gev_descriptor.device_ip_address),
+               numa_node_ ? std::to_string(*numa_node_) : "unknown",
+               cpus_.empty() ? "all" : std::to_string(cpus_.size()));
+}
+
+std::expected<void, session_error>
+device_session::open_filter() {
+  // Known only from GVCP or the cache; the SL library has no handle yet.
+  if (!device_.device)
+    return std::unexpected(std::make_error_code(std::errc::no_such_device));
+
+  sl_error err;
+
+  if (err = sl_device_open(device_.device, &device_handle_)) {
+    return std::unexpected(err);
+  }
 
   std::vector<sl_framebuffer_descriptor> framebuffer_descriptors;
-  framebuffer_descriptors.reserve(num_framebuffers);
+  framebuffer_descriptors.reserve(framebuffer_count_);
 
-  for (uint32_t i = 0; i < num_framebuffers; ++i) {
+  for (uint32_t i = 0; i < framebuffer_count_; ++i) {
     framebuffer_descriptors.push_back(sl_framebuffer_descriptor{
-        .data = framebuffer_data.data() + framebuffer_size * i,
-        .size = framebuffer_size});
+        .data = framebuffer(i).data(), .size = framebuffer_pixels_});
   }
 
   sl_gev_stream_config stream_config = {
-      .framebuffer_count = num_framebuffers,
+      .framebuffer_count = framebuffer_count_,
       .framebuffer_descs = framebuffer_descriptors.data(),
       .driver_type = SL_GEV_DRIVER_TYPE_FILTER,
   };
 
-  if (err = sl_gev_stream_create(device_handle, &stream_config, &stream)) {
-    sl_device_close(device_handle);
+  if (err = sl_gev_stream_create(device_handle_, &stream_config, &stream_)) {
     return std::unexpected(err);
   }
 
-  return device_session(device_handle, stream, std::move(framebuffer_data));
+  return {};
 }
 
-device_session::device_session(sl_device_handle *handle, sl_stream *stream,
-                               std::vector<uint16_t> &&frame_data)
-    : frame_data_(std::move(frame_data)), device_handle_(handle),
-      stream_(stream) {}
+#ifdef APP_HAS_SOCKET_DRIVER
+std::expected<void, session_error>
+device_session::open_socket(const session_options &options) {
+  if (device_.descriptor.device_interface != SL_DEVICE_INTERFACE_GEV)
+    return std::unexpected(std::make_error_code(std::errc::not_supported));
+  if (!jobs_)
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+  const gev::endpoint control_endpoint{
+      device_.descriptor.gev_descriptor.device_ip_address, gev::gvcp_port};
+
+  auto control = gev::gvcp_client::connect(control_endpoint, options.control);
+  if (!control)
+    return std::unexpected(control.error());
+  control_ = std::move(*control);
+  registers_ = std::make_shared<gev::register_cache>(control_);
+
+  // The device keeps control for as long as it hears from us at least
+  // once per heartbeat timeout (3 s by default).
+  if (auto r = control_->take_control(std::chrono::milliseconds(1000)); !r)
+    return std::unexpected(r.error());
+
+  // Stream at whatever packet size the device is set up for; the receiver
+  // derives packet offsets from it.
+  auto packet_size =
+      control_->read_register(gev::reg::stream_channel_packet_size);
+  if (!packet_size)
+    return std::unexpected(packet_size.error());
+
+  std::vector<std::span<std::byte>> framebuffers;
+  framebuffers.reserve(framebuffer_count_);
+  for (uint32_t i = 0; i < framebuffer_count_; ++i)
+    framebuffers.push_back(std::as_writable_bytes(framebuffer(i)));
+
+  auto receiver = gev::stream_receiver::create(
+      options.receiver, framebuffers, *packet_size & gev::reg::packet_size_mask,
+      [this](const gev::received_frame &frame) { on_frame(frame); },
+      [this](uint16_t block_id, uint32_t first, uint32_t last) {
+        control_->request_resend(block_id, first, last);
+      });
+  if (!receiver)
+    return std::unexpected(receiver.error());
+  receiver_ = std::move(*receiver);
+  pool_ = std::make_unique<processing::frame_pool>(
+      framebuffer_count_, [this](uint32_t slot) { receiver_->release(slot); });
+
+  // Every frame in the pipeline holds a framebuffer, and so do latest_ and
+  // the one being received; the receiver needs the rest to keep going.
+  pipeline_ = std::make_unique<processing::pipeline<live_frame>>(
+      *jobs_, std::clamp(options.pipeline_depth, 1u, std::max(framebuffer_count_, 3u) - 2),
+      engine::jobs::priority::high);
+  pipeline_->add_stage("correct", processing::stage_mode::parallel,
+                       [this](live_frame &f) { correct(f); });
+  pipeline_->add_stage("stats", processing::stage_mode::parallel, [this](live_frame &f) {
+    stats_.frames.fetch_add(1, std::memory_order_relaxed);
+    stats_.bytes.fetch_add(f.bytes, std::memory_order_relaxed);
+    if (!f.ref.metadata().complete)
+      stats_.frames_incomplete.fetch_add(1, std::memory_order_relaxed);
+  });
+  // In order, so that latest() never goes back to an older frame. The one
+  // replaced goes back to the ring once nobody else holds it, outside the
+  // lock.
+  pipeline_->add_stage("display", processing::stage_mode::ordered, [this](live_frame &f) {
+    processing::frame_ref previous = f.ref;
+    std::lock_guard       lock(latest_mutex_);
+    latest_.swap(previous);
+  });
+  // The recorder and the history keep frames for longer than the ring
+  // could hold them, so they take their one copy into memory of their own
+  // straight from the pooled buffer, one frame at a time and in order.
+  pipeline_->add_stage("record", processing::stage_mode::ordered, [this](live_frame &f) {
+    const auto                &metadata = f.ref.metadata();
+    const recording::frame_info info{
+        .frame_id = metadata.frame_id,
+        .device_timestamp = metadata.device_timestamp,
+        .width = metadata.width,
+        .height = metadata.height,
+        .pixel_format = metadata.pixel_format,
+        .complete = metadata.complete,
+    };
+    const auto bytes = std::as_bytes(f.ref.pixels());
+    if (auto recorder = recorder_.load(std::memory_order_acquire))
+      recorder->push(info, bytes);
+    if (auto history = history_.load(std::memory_order_acquire))
+      history->push(info, bytes);
+    // The slot is reused; its buffer must not wait for the next frame.
+    f.ref.reset();
+  });
+
+  auto local_address = gev::udp_socket::local_address_for(control_endpoint);
+  if (!local_address)
+    return std::unexpected(local_address.error());
+
+  const std::pair<uint32_t, uint32_t> stream_channel[] = {
+      {gev::reg::stream_channel_destination, *local_address},
+      {gev::reg::stream_channel_port, receiver_->local_endpoint().port},
+  };
+  if (auto r = control_->write_registers(stream_channel); !r)
+    return std::unexpected(r.error());
+
+  receive_thread_ = std::jthread([this](std::stop_token stop) {
+    engine::profiling::profiler::get().set_thread_name(
+        "acquisition " + util::format_ip_address(
+                             device_.descriptor.gev_descriptor.device_ip_address));
+    placement::pin_current_thread(cpus_);
+    if (realtime_priority_)
+      placement::set_realtime_priority(*realtime_priority_);
+    if (auto err = receiver_->run(stop))
+      spdlog::error("GVSP receive failed: {}", err.message());
+  });
+
+  spdlog::info("Socket stream driver receiving on port {} (SO_RCVBUF {} KiB, "
+               "packet size {})",
+               receiver_->local_endpoint().port,
+               receiver_->socket_buffer() / 1024,
+               *packet_size & gev::reg::packet_size_mask);
+  return {};
+}
+
+void device_session::on_frame(const gev::received_frame &frame) {
+  const size_t pixels = std::min(framebuffer_pixels_, frame.size / 2);
+  processing::frame_ref ref = pool_->publish(
+      frame.slot,
+      {
+          // Block ids are 16-bit and wrap within minutes at full rate;
+          // recordings and the viewer need ids that keep rising.
+          .frame_id = frame_counter_.count(frame.block_id),
+          .device_timestamp = frame.timestamp,
+          .received_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             frame.completed.time_since_epoch())
+                             .count(),
+          .width = frame.width,
+          .height = frame.height,
+          .pixel_format = frame.pixel_format,
+          .complete = frame.complete(),
+      },
+      framebuffer(frame.slot).first(pixels));
+
+  // Everything else runs on the job system. A full pipeline drops the
+  // frame, and its buffer goes straight back to the receiver.
+  const bool queued = pipeline_->try_push([&](live_frame &f) {
+    f.ref = std::move(ref);
+    f.pixels = framebuffer(frame.slot).first(pixels);
+    f.bytes = frame.size;
+  });
+  if (!queued)
+    stats_.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+void device_session::correct(live_frame &f) {
+  const auto maps = correction_.load(std::memory_order_acquire);
+  if (!maps)
+    return;
+  const auto  &metadata = f.ref.metadata();
+  const size_t width = metadata.width;
+  const size_t pixels = width * metadata.height;
+  if (maps->dark.size() != pixels || f.pixels.size() < pixels)
+    return;
+
+  ENGINE_PROFILE_SCOPE("correct");
+  // Nothing but the pipeline sees the frame before the display stage, so
+  // it is corrected in its acquisition buffer.
+  jobs_->parallel_for(0, metadata.height, engine::jobs::band_rows(width),
+                      [&](size_t begin, size_t end) {
+                        const size_t offset = begin * width, n = (end - begin) * width;
+                        const auto   view = f.pixels.subspan(offset, n);
+                        processing::offset_gain_correct(
+                            view, std::span(maps->dark).subspan(offset, n),
+                            std::span(maps->gain).subspan(offset, n), view);
+                      },
+                      engine::jobs::priority::high);
+}
+
+void device_session::set_correction(std::span<const uint16_t> dark,
+                                    std::span<const float>    gain) {
+  assert(dark.size() == gain.size());
+  if (dark.empty()) {
+    correction_.store(nullptr, std::memory_order_release);
+    return;
+  }
+  correction_.store(std::make_shared<const correction_maps>(correction_maps{
+                        .dark = {dark.begin(), dark.end()},
+                        .gain = {gain.begin(), gain.end()},
+                    }),
+                    std::memory_order_release);
+}
+
+processing::pipeline_stats device_session::pipeline_stats() const {
+#ifdef APP_HAS_SOCKET_DRIVER
+  if (pipeline_)
+    return pipeline_->stats();
+#endif
+  return {};
+}
+
+processing::frame_ref device_session::latest() const {
+#ifdef APP_HAS_SOCKET_DRIVER
+  std::lock_guard lock(latest_mutex_);
+  return latest_;
+#else
+  return {};
+#endif
+}
+
+std::expected<std::shared_ptr<recording::recorder>, std::error_code>
+device_session::start_recording(recording::recorder_options options) {
+  if (driver_ != stream_driver::socket)
+    return std::unexpected(
+        std::make_error_code(std::errc::operation_not_supported));
+
+  if (!options.jobs)
+    options.jobs = jobs_;
+  auto recorder = recording::recorder::create(std::move(options));
+  if (!recorder)
+    return std::unexpected(recorder.error());
+
+  std::shared_ptr<recording::recorder> started = std::move(*recorder);
+  if (auto previous = recorder_.exchange(started, std::memory_order_acq_rel))
+    previous->finish();
+  spdlog::info("Recording to {} ({}{}{})", started->path().string(),
+               started->backend() == recording::write_backend::io_uring
+                   ? "io_uring"
+                   : "thread pool",
+               started->direct() ? ", O_DIRECT" : "",
+               started->compressing() ? ", compressed" : "");
+  return started;
+}
+
+std::shared_ptr<recording::recorder> device_session::stop_recording() {
+  auto recorder = recorder_.exchange(nullptr, std::memory_order_acq_rel);
+  if (recorder) {
+    // finish() waits out a push() the acquisition thread may be in, so
+    // the recorder is idle once it returns, whoever drops it last.
+    recorder->finish();
+    const auto stats = recorder->stats();
+    spdlog::info("Recorded {} frames ({:.1f} MB, ratio {:.2f}, {} dropped) to {}",
+                 stats.frames, stats.bytes / 1e6, stats.compression_ratio,
+                 stats.dropped, recorder->path().string());
+  }
+  return recorder;
+}
+
+std::expected<std::shared_ptr<recording::history>, std::error_code>
+device_session::enable_history(recording::history_options options,
+                               std::filesystem::path      directory) {
+  if (driver_ != stream_driver::socket)
+    return std::unexpected(
+        std::make_error_code(std::errc::operation_not_supported));
+
+  if (!options.jobs)
+    options.jobs = jobs_;
+  auto history = recording::history::create(options);
+  if (!history)
+    return std::unexpected(history.error());
+
+  std::shared_ptr<recording::history> enabled = std::move(*history);
+  history_directory_ = std::move(directory);
+  history_.store(enabled, std::memory_order_release);
+  spdlog::info("Keeping {:.1f} s / {} MB of history for {}{}",
+               options.max_seconds, options.max_bytes >> 20,
+               util::format_ip_address(device_.ip_address()),
+               options.compress ? ", compressed" : "");
+  return enabled;
+}
+
+void device_session::disable_history() {
+  // Cuts short a save still running; the file keeps what it got to.
+  history_.store(nullptr, std::memory_order_release);
+}
+
+std::error_code device_session::save_history() const {
+  auto history = history_.load(std::memory_order_acquire);
+  if (!history)
+    return std::make_error_code(std::errc::no_such_process);
+
+  std::error_code ec;
+  std::filesystem::create_directories(history_directory_, ec);
+  if (ec)
+    return ec;
+  return history->save(recording_path(history_directory_, device_, "_history"));
+}
 
 device_session::~device_session() {
+#ifdef APP_HAS_SOCKET_DRIVER
+  receive_thread_ = {};
+  // Frames still in the pipeline go to the recorder before it finishes.
+  if (pipeline_)
+    pipeline_->drain();
+#endif
+  stop_recording();
+  disable_history();
+#ifdef APP_HAS_SOCKET_DRIVER
+  if (control_) {
+    // Stop the device streaming into a port nobody reads any more.
+    (void)control_->write_register(gev::reg::stream_channel_port, 0);
+    control_->release_control();
+  }
+#endif
   if (stream_)
     sl_stream_destroy(stream_);
   if (device_handle_)
     sl_device_close(device_handle_);
 }
 
-device_manager::device_manager(event_bus &event_bus) : event_bus_(event_bus) {
+namespace {
+
+// Upper bound on devices returned by one SL enumeration.
+constexpr uint32_t max_enumerated_devices = 256;
+
+constexpr const char *cache_header = "# device cache v1";
+
+// Cache fields are tab-separated; keep device strings on one field.
+std::string sanitise(std::string_view text) {
+  std::string out(text.substr(0, text.find('\0')));
+  std::ranges::replace_if(
+      out, [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+  return out;
+}
+
+std::vector<std::string_view> split(std::string_view line, char separator) {
+  std::vector<std::string_view> fields;
+  for (size_t pos = 0;;) {
+    const size_t end = line.find(separator, pos);
+    fields.push_back(line.substr(pos, end - pos));
+    if (end == std::string_view::npos)
+      return fields;
+    pos = end + 1;
+  }
+}
+
+std::optional<uint32_t> parse_ip_address(std::string_view text) {
+  uint32_t   ip = 0;
+  const auto octets = split(text, '.');
+  if (octets.size() != 4)
+    return std::nullopt;
+  for (auto octet : octets) {
+    unsigned value = 0;
+    auto [end, ec] =
+        std::from_chars(octet.data(), octet.data() + octet.size(), value);
+    if (ec != std::errc{} || end != octet.data() + octet.size() || value > 255)
+      return std::nullopt;
+    ip = ip << 8 | value;
+  }
+  return ip;
+}
+
+discovered_device gev_device(uint32_t ip) {
+  discovered_device d;
+  d.descriptor.device_interface = SL_DEVICE_INTERFACE_GEV;
+  d.descriptor.gev_descriptor.device_ip_address = ip;
+  return d;
+}
+
+} // namespace
+
+std::filesystem::path recording_path(const std::filesystem::path &directory,
+                                     const discovered_device     &device,
+                                     std::string_view             suffix) {
+  const std::time_t now = std::time(nullptr);
+  std::tm           local{};
+  localtime_r(&now, &local);
+  char stamp[32];
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+  std::string name = device.serial.empty()
+                         ? util::format_ip_address(device.ip_address())
+                         : device.serial;
+  std::ranges::replace(name, '.', '-');
+  return directory / (name + "_" + stamp + std::string(suffix) + ".vkrec");
+}
+
+bool same_device(const discovered_device &a,
+                 const discovered_device &b) noexcept {
+  if (a.device && a.device == b.device)
+    return true;
+  return a.descriptor.device_interface == SL_DEVICE_INTERFACE_GEV &&
+         b.descriptor.device_interface == SL_DEVICE_INTERFACE_GEV &&
+         a.ip_address() == b.ip_address();
+}
+
+device_manager::device_manager(event_bus &event_bus, engine::jobs::job_system &jobs)
+    : event_bus_(event_bus), jobs_(jobs),
+      cache_path_(util::cache_directory() / "devices.tsv") {
   sl_library_open();
+  load_cache();
 }
 
-device_manager::~device_manager() { sl_library_close(); }
+device_manager::~device_manager() {
+  discovery_thread_ = {};
+  close_all();
+  sl_library_close();
+}
 
-std::expected<void, sl_error>
-device_manager::discover_devices(uint32_t discovery_timeout) noexcept {
-  uint32_t device_count;
-  sl_error err =
-      sl_enumerate_devices(&device_count, discovery_timeout, nullptr);
+void device_manager::start_discovery(uint32_t timeout_ms) {
+  if (discovering_.exchange(true))
+    return;
 
-  std::vector<sl_device *> devices(device_count);
-  err = sl_enumerate_devices(&device_count, discovery_timeout, devices.data());
+  // The previous pass has finished (discovering_ was false); reap it.
+  discovery_thread_ = std::jthread([this, timeout_ms] {
+    discovery_pass(timeout_ms);
+    save_cache();
+    discovering_ = false;
+  });
+}
 
-  if (err != SL_ERROR_SUCCESS)
-    return std::unexpected(err);
+std::vector<discovered_device> device_manager::discovered_devices() {
+  auto [devices, lock] = devices_.lock();
+  return devices;
+}
 
-  discovered_devices_.resize(device_count);
-  for (uint32_t i = 0; i < device_count; ++i) {
-    auto &discovered_device = discovered_devices_[i];
-    discovered_device.device = devices[i];
+std::string device_manager::last_discovery_error() {
+  auto [error, lock] = discovery_error_.lock();
+  return error;
+}
 
-    err = sl_device_descriptor_get(discovered_device.device,
-                                   &discovered_device.descriptor);
-    if (err != SL_ERROR_SUCCESS)
-      return std::unexpected(err);
+void device_manager::discovery_pass(uint32_t timeout_ms) {
+  {
+    auto [error, lock] = discovery_error_.lock();
+    error.clear();
+  }
+  {
+    auto [devices, lock] = devices_.lock();
+    for (auto &d : devices)
+      d.stale = true;
   }
 
-  return {};
+  // Workers join when the vector goes out of scope.
+  std::vector<std::jthread> workers;
+  workers.emplace_back([this, timeout_ms] { enumerate_sl_devices(timeout_ms); });
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Known devices are asked directly as well, which also reaches devices
+  // behind a router or on loopback, where broadcasts do not go.
+  std::vector<gev::endpoint> known;
+  for (const auto &d : discovered_devices())
+    if (d.descriptor.device_interface == SL_DEVICE_INTERFACE_GEV)
+      known.push_back({d.ip_address(), gev::gvcp_port});
+
+  for (const auto &nic : gev::ipv4_interfaces()) {
+    if (nic.loopback)
+      continue;
+    std::vector<gev::endpoint> targets{{nic.broadcast, gev::gvcp_port}};
+    std::erase_if(known, [&](const gev::endpoint &e) {
+      if (!nic.contains(e.address))
+        return false;
+      targets.push_back(e);
+      return true;
+    });
+    workers.emplace_back([this, local = gev::endpoint{nic.address, 0},
+                          targets = std::move(targets), timeout_ms] {
+      discover_gvcp(local, targets, timeout_ms);
+    });
+  }
+
+  if (!known.empty())
+    workers.emplace_back([this, known = std::move(known), timeout_ms] {
+      discover_gvcp({}, known, timeout_ms);
+    });
+#endif
+}
+
+void device_manager::enumerate_sl_devices(uint32_t timeout_ms) {
+  // One call with a generous array rather than a count query followed by
+  // a second, equally long, enumeration. As with the Vulkan enumerators,
+  // device_count is the array capacity going in and the number found
+  // coming out.
+  std::vector<sl_device *> devices(max_enumerated_devices);
+  uint32_t                 device_count = max_enumerated_devices;
+
+  sl_error err = sl_enumerate_devices(&device_count, timeout_ms, devices.data());
+  if (err != SL_ERROR_SUCCESS) {
+    auto [error, lock] = discovery_error_.lock();
+    error = sl_error_to_string(err);
+    return;
+  }
+
+  devices.resize(std::min(device_count, max_enumerated_devices));
+  for (sl_device *device : devices) {
+    discovered_device found;
+    found.device = device;
+    err = sl_device_descriptor_get(device, &found.descriptor);
+    if (err != SL_ERROR_SUCCESS) {
+      spdlog::warn("Skipping device without descriptor: {}",
+                   sl_error_to_string(err));
+      continue;
+    }
+    merge(found);
+  }
 }
 
-const std::vector<discovered_device> &
-device_manager::get_discovered_devices() const noexcept {
-  return discovered_devices_;
+#ifdef APP_HAS_SOCKET_DRIVER
+void device_manager::discover_gvcp(gev::endpoint              local,
+                                   std::vector<gev::endpoint> targets,
+                                   uint32_t                   timeout_ms) {
+  auto result = gev::gvcp_client::discover(
+      targets, std::chrono::milliseconds(timeout_ms), local,
+      [this](const gev::discovered_device &answer) {
+        auto found = gev_device(answer.info.ip ? answer.info.ip
+                                               : answer.control.address);
+        found.mac = answer.info.mac;
+        found.model = sanitise({answer.info.model, sizeof(answer.info.model)});
+        found.serial = sanitise({answer.info.serial, sizeof(answer.info.serial)});
+        found.user_name =
+            sanitise({answer.info.user_name, sizeof(answer.info.user_name)});
+        merge(found);
+      });
+
+  if (!result)
+    spdlog::warn("GVCP discovery from {} failed: {}",
+                 util::format_ip_address(local.address),
+                 result.error().message());
 }
+#endif
 
-std::expected<void, sl_error>
-device_manager::open_device(sl_device *device) noexcept {
-  if (opened_device_)
-    sl_device_close(opened_device_);
+void device_manager::merge(const discovered_device &found) {
+  auto [devices, lock] = devices_.lock();
 
-  sl_error err = sl_device_open(device, &opened_device_);
-  if (err)
-    return std::unexpected(err);
+  auto it = std::ranges::find_if(
+      devices, [&](const auto &d) { return same_device(d, found); });
+  if (it == devices.end()) {
+    devices.push_back(found);
+    return;
+  }
+
+  // Each source knows different things; keep what the other one found.
+  auto &d = *it;
+  if (found.device) {
+    d.device = found.device;
+    d.descriptor = found.descriptor;
+  }
+  if (found.mac)
+    d.mac = found.mac;
+  if (!found.model.empty())
+    d.model = found.model;
+  if (!found.serial.empty())
+    d.serial = found.serial;
+  if (!found.user_name.empty())
+    d.user_name = found.user_name;
+  d.stale = false;
+}
+
+void device_manager::load_cache() {
+  std::ifstream file(cache_path_);
+  std::string   line;
+  if (!std::getline(file, line) || line != cache_header)
+    return;
+
+  auto [devices, lock] = devices_.lock();
+  while (std::getline(file, line)) {
+    // gev <ip> <mac> <model> <serial> <user name>
+    const auto fields = split(line, '\t');
+    if (fields.size() != 6 || fields[0] != "gev")
+      continue;
+
+    const auto ip = parse_ip_address(fields[1]);
+    if (!ip)
+      continue;
+
+    auto d = gev_device(*ip);
+    std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(),
+                    d.mac, 16);
+    d.model = fields[3];
+    d.serial = fields[4];
+    d.user_name = fields[5];
+    d.stale = true;
+    devices.push_back(std::move(d));
+  }
+
+  spdlog::info("Loaded {} cached device(s) from {}", devices.size(),
+               cache_path_.string());
+}
+
+void device_manager::save_cache() {
+  const auto devices = discovered_devices();
+
+  std::error_code ec;
+  std::filesystem::create_directories(cache_path_.parent_path(), ec);
+  if (ec)
+    return;
+
+  auto tmp = cache_path_;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::trunc);
+    file << cache_header << '\n';
+    for (const auto &d : devices) {
+      // Devices that did not answer this pass are dropped from the cache.
+      if (d.stale || d.descriptor.device_interface != SL_DEVICE_INTERFACE_GEV)
+        continue;
+      file << "gev\t" << util::format_ip_address(d.ip_address()) << '\t'
+           << std::hex << d.mac << std::dec << '\t' << d.model << '\t'
+           << d.serial << '\t' << d.user_name << '\n';
+    }
+    if (!file)
+      return;
+  }
+
+  std::filesystem::rename(tmp, cache_path_, ec);
+}
+
+std::expected<device_session *, session_error>
+device_manager::open_device(const discovered_device &device,
+                            const session_options   &options) {
+  if (find_session(device))
+    return std::unexpected(
+        std::make_error_code(std::errc::device_or_resource_busy));
+
+  session_options with_jobs = options;
+  if (!with_jobs.jobs)
+    with_jobs.jobs = &jobs_;
+  auto session = device_session::create(device, with_jobs);
+  if (!session)
+    return std::unexpected(session.error());
+
+  return sessions_.emplace_back(std::move(*session)).get();
+}
+
+void device_manager::close_device(const device_session *session) {
+  std::erase_if(sessions_, [session](const auto &s) { return s.get() == session; });
+}
+
+void device_manager::close_all() noexcept { sessions_.clear(); }
+
+device_session *
+device_manager::find_session(const discovered_device &device) const noexcept {
+  auto it = std::ranges::find_if(sessions_, [&](const auto &s) {
+    return same_device(s->device(), device);
+  });
+  return it != sessions_.end() ? it->get() : nullptr;
+}
+
+aggregate_stats device_manager::aggregate() const noexcept {
+  aggregate_stats total{.sessions = sessions_.size()};
+  for (const auto &session : sessions_) {
+    const auto &stats = session->stats();
+    total.frames += stats.frames.load(std::memory_order_relaxed);
+    total.frames_incomplete +=
+        stats.frames_incomplete.load(std::memory_order_relaxed);
+    total.frames_dropped += stats.frames_dropped.load(std::memory_order_relaxed);
+    total.bytes += stats.bytes.load(std::memory_order_relaxed);
+  }
+  return total;
 }
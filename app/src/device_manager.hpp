@@ -1,48 +1,365 @@
 #pragma once
 
 #include <event_bus.hpp>
+#include <jobs/job_system.hpp>
+#include <processing/frame_pool.hpp>
+#include <processing/pipeline.hpp>
+#include <recording/history.hpp>
+#include <recording/recorder.hpp>
+#include <utility/mutex_protected.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <variant>
 #include <vector>
 
 #include <expected>
 #include <sl/sl_device.h>
 
+#ifdef APP_HAS_SOCKET_DRIVER
+#include <gev/gvcp_client.hpp>
+#include <gev/register_cache.hpp>
+#include <gev/stream_receiver.hpp>
+#endif
+
 struct discovered_device {
-  sl_device           *device;
-  sl_device_descriptor descriptor;
+  // Null until the SL library has enumerated the device; the filter driver
+  // needs it, the socket driver does not.
+  sl_device           *device = nullptr;
+  sl_device_descriptor descriptor{};
+
+  // From the GVCP discovery answer or the device cache; empty if only the
+  // SL library has seen the device.
+  uint64_t    mac = 0;
+  std::string model;
+  std::string serial;
+  std::string user_name;
+
+  // Not seen by the latest discovery pass (yet): loaded from the cache or
+  // left over from an earlier pass.
+  bool stale = false;
+
+  uint32_t ip_address() const noexcept {
+    return descriptor.gev_descriptor.device_ip_address;
+  }
+};
+
+// Whether a and b describe the same physical device.
+bool same_device(const discovered_device &a, const discovered_device &b) noexcept;
+
+// Where a recording of the device goes:
+// <directory>/<serial, or IP address>_<YYYYMMDD-HHMMSS><suffix>.vkrec, in
+// local time.
+std::filesystem::path recording_path(const std::filesystem::path &directory,
+                                     const discovered_device     &device,
+                                     std::string_view             suffix = {});
+
+enum class stream_driver {
+  filter, // Vendor kernel filter driver (SL_GEV_DRIVER_TYPE_FILTER).
+  socket, // In-tree user-space receiver; needs no driver install.
+};
+
+// Errors come from the SL library or, for the socket driver, from the
+// socket/GVCP layer.
+using session_error = std::variant<sl_error, std::error_code>;
+
+std::string to_string(const session_error &error);
+
+// Where a session's acquisition thread runs, how it is scheduled and where
+// its buffers live.
+struct placement_options {
+  // CPUs for the acquisition thread. Empty: the CPUs of the session's NUMA
+  // node, if one is known.
+  std::vector<int> cpus;
+  // NUMA node for buffers and thread; nullopt uses the node of the NIC that
+  // receives the stream.
+  std::optional<int> numa_node;
+  // SCHED_FIFO priority (1-99) for the acquisition thread; nullopt keeps
+  // the default scheduler. Needs CAP_SYS_NICE or RLIMIT_RTPRIO.
+  std::optional<int> realtime_priority;
+};
+
+struct session_options {
+  stream_driver     driver = stream_driver::filter;
+  uint32_t          framebuffer_count = 8;
+  uint32_t          framebuffer_pixels = 4096 * 4096;
+  placement_options placement{};
+  // Frames between the receiver and the recorder at once. Each holds a
+  // framebuffer, so at most framebuffer_count - 2 are taken.
+  uint32_t pipeline_depth = 4;
+  // Workers that run the socket driver's frame pipeline and that recording
+  // and history compression fork onto. device_manager fills in its own;
+  // the socket driver fails to open without one.
+  engine::jobs::job_system *jobs = nullptr;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  gev::receiver_options     receiver{};
+  gev::gvcp_client::options control{};
+#endif
+};
+
+// Counters written by a session's frame pipeline.
+struct session_stats {
+  std::atomic<uint64_t> frames{0};
+  std::atomic<uint64_t> frames_incomplete{0};
+  std::atomic<uint64_t> bytes{0};
+  // Received while every pipeline slot was taken, so never shown or
+  // recorded.
+  std::atomic<uint64_t> frames_dropped{0};
 };
 
+/*========================================================================================
+ *  device_session
+ *  -----------------------------------------------------------------------
+ *  •  One open detector: its stream, framebuffer ring, acquisition thread
+ *     and statistics. Sessions share nothing, so several run side by side.
+ *  •  Buffers are first-touched on the session's NUMA node and the
+ *     acquisition thread is pinned there, keeping each stream next to the
+ *     NIC that receives it.
+ *  •  Received frames live in a frame_pool over the ring. The session
+ *     holds only the newest; any consumer that wants it shares that
+ *     reference, and a frame's buffer goes back to the ring when its last
+ *     holder lets go.
+ *  •  The acquisition thread only publishes each frame into a
+ *     processing::pipeline on the job system: correct (several frames at
+ *     once), stats, display (latest()), then record (recorder and
+ *     history), the last two in frame order. A frame that finds the
+ *     pipeline full is dropped there rather than stalling the receiver.
+ *=======================================================================================*/
 class device_session {
 public:
-  static std::expected<device_session, sl_error>
-  create(sl_device *device, uint32_t num_framebuffers,
-         uint32_t framebuffer_size);
+  static std::expected<std::unique_ptr<device_session>, session_error>
+  create(const discovered_device &device, const session_options &options);
 
   ~device_session();
 
+  device_session(const device_session &) = delete;
+  device_session &operator=(const device_session &) = delete;
+
+  const discovered_device &device() const noexcept { return device_; }
+  stream_driver            driver() const noexcept { return driver_; }
+  const session_stats     &stats() const noexcept { return stats_; }
+
+  // NUMA node the session was placed on, if any.
+  std::optional<int> numa_node() const noexcept { return numa_node_; }
+
+  // The newest frame to leave correction, shared with every other
+  // consumer; empty before the first and for the filter driver. Its buffer is not reused while the
+  // reference is held, so compare metadata().frame_id to skip a frame
+  // already seen rather than holding on to it. Drop it before the session
+  // closes.
+  processing::frame_ref latest() const;
+
+  // Offset/gain correction for the socket driver's frames, applied in
+  // place before they are shown, recorded or kept in the history. Maps of
+  // width * height pixels; frames of another size pass through, as they
+  // all do with empty maps. Any thread.
+  void set_correction(std::span<const uint16_t> dark, std::span<const float> gain);
+
+  // Per-stage timings of the frame pipeline; empty for the filter driver.
+  processing::pipeline_stats pipeline_stats() const;
+
+  // Writes every frame the session receives to options.path until
+  // stop_recording(), replacing any recording in progress. The filter
+  // driver does not hand frames to the application, so it cannot record.
+  std::expected<std::shared_ptr<recording::recorder>, std::error_code>
+  start_recording(recording::recorder_options options);
+  // Finishes the recording in progress, if any, and returns it for its
+  // final statistics.
+  std::shared_ptr<recording::recorder> stop_recording();
+  std::shared_ptr<recording::recorder> recording() const noexcept {
+    return recorder_.load(std::memory_order_acquire);
+  }
+
+  // Keeps the newest frames in memory, within options' bounds, until
+  // disable_history(), so that save_history() can write out what came
+  // before a trigger. Socket driver only, like recording. UI thread.
+  std::expected<std::shared_ptr<recording::history>, std::error_code>
+  enable_history(recording::history_options options,
+                 std::filesystem::path      directory);
+  void disable_history();
+  std::shared_ptr<recording::history> history() const noexcept {
+    return history_.load(std::memory_order_acquire);
+  }
+  // Starts saving the history to recording_path(directory, device,
+  // "_history") in the background; no_such_process if it is not enabled.
+  std::error_code save_history() const;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Null for the filter driver.
+  const gev::receiver_stats *receiver_stats() const noexcept {
+    return receiver_ ? &receiver_->stats() : nullptr;
+  }
+
+  // GVCP control channel; null for the filter driver. Shared so that
+  // operations still in flight keep it alive after the session closes.
+  std::shared_ptr<gev::gvcp_client> control() const noexcept { return control_; }
+
+  // Batched, cached register access over control(); null alongside it.
+  std::shared_ptr<gev::register_cache> registers() const noexcept {
+    return registers_;
+  }
+#endif
+
 private:
-  device_session(sl_device_handle *handle, sl_stream *stream,
-                 std::vector<uint16_t> &&frame_data);
-                 
-  std::vector<uint16_t> frame_data_;
-  sl_device            *device_;
-  sl_device_handle     *device_handle_;
-  sl_stream            *stream_;
+  device_session(const discovered_device &device,
+                 const session_options   &options);
+
+  std::span<uint16_t> framebuffer(uint32_t slot) const noexcept {
+    return {frame_data_.get() + size_t{slot} * framebuffer_pixels_,
+            framebuffer_pixels_};
+  }
+
+  void place(const session_options &options);
+
+  std::expected<void, session_error> open_filter();
+#ifdef APP_HAS_SOCKET_DRIVER
+  std::expected<void, session_error> open_socket(const session_options &options);
+  void on_frame(const gev::received_frame &frame);
+#endif
+
+  // A received frame on its way through pipeline_.
+  struct live_frame {
+    processing::frame_ref ref;
+    std::span<uint16_t>   pixels; // ref's, writable until the display stage.
+    size_t                bytes = 0; // As received.
+  };
+
+  struct correction_maps {
+    std::vector<uint16_t> dark;
+    std::vector<float>    gain;
+  };
+
+  void correct(live_frame &frame);
+
+  discovered_device device_;
+  stream_driver     driver_;
+
+  // Framebuffer ring, left uninitialised until place() first-touches it.
+  uint32_t                    framebuffer_count_;
+  size_t                      framebuffer_pixels_;
+  std::unique_ptr<uint16_t[]> frame_data_;
+
+  std::optional<int> numa_node_;
+  std::vector<int>   cpus_; // Acquisition thread affinity; empty: unpinned.
+  std::optional<int> realtime_priority_;
+
+  engine::jobs::job_system *jobs_;
+
+  session_stats stats_;
+
+  // Fed from the acquisition thread; swapped from the UI thread.
+  std::atomic<std::shared_ptr<recording::recorder>> recorder_;
+  std::atomic<std::shared_ptr<recording::history>>  history_;
+  std::filesystem::path                             history_directory_;
+
+  std::atomic<std::shared_ptr<const correction_maps>> correction_;
+
+  // Filter driver.
+  sl_device_handle *device_handle_ = nullptr;
+  sl_stream        *stream_ = nullptr;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Socket driver. The receive thread is declared last so it stops before
+  // the receiver and control channel it uses are destroyed.
+  std::shared_ptr<gev::gvcp_client>     control_;
+  std::shared_ptr<gev::register_cache>  registers_;
+  std::unique_ptr<gev::stream_receiver> receiver_;
+  gev::block_counter                    frame_counter_; // Acquisition thread.
+  // Returns buffers to receiver_, so it goes first; latest_ and the
+  // frames in pipeline_ before it.
+  std::unique_ptr<processing::frame_pool>           pool_;
+  mutable std::mutex                                latest_mutex_;
+  processing::frame_ref                             latest_;
+  std::unique_ptr<processing::pipeline<live_frame>> pipeline_;
+  std::jthread                                      receive_thread_;
+#endif
+};
+
+// Sum of every open session's counters, for the aggregate throughput view.
+struct aggregate_stats {
+  size_t   sessions = 0;
+  uint64_t frames = 0;
+  uint64_t frames_incomplete = 0;
+  uint64_t frames_dropped = 0;
+  uint64_t bytes = 0;
 };
 
+/*========================================================================================
+ *  device_manager
+ *  -----------------------------------------------------------------------
+ *  •  Discovery runs on a background thread: the SL library enumeration
+ *     and a GVCP broadcast per network interface run in parallel, and each
+ *     answer is merged into the device list as it arrives.
+ *  •  The list is persisted to the cache directory after every pass and
+ *     loaded at construction, so the device table is populated before the
+ *     first pass completes.
+ *  •  Any number of sessions can be open at once, one per device.
+ *  •  Sessions compress recordings and history on the job system the
+ *     manager is given, unless their options name another.
+ *=======================================================================================*/
 class device_manager {
 public:
-  device_manager(event_bus &);
+  // jobs must outlive the manager.
+  device_manager(event_bus &, engine::jobs::job_system &jobs);
   ~device_manager();
 
-  std::expected<void, sl_error> discover_devices(uint32_t timeout_ms) noexcept;
-  const std::vector<discovered_device> &get_discovered_devices() const noexcept;
+  // Starts a discovery pass unless one is already running.
+  void start_discovery(uint32_t timeout_ms);
+  bool discovering() const noexcept { return discovering_; }
+
+  // Snapshot of the device list; cheap enough to take every frame.
+  std::vector<discovered_device> discovered_devices();
+  std::string                    last_discovery_error();
+
+  // Opens a session alongside any already open. A device can only be open
+  // once; opening it again fails with device_or_resource_busy.
+  std::expected<device_session *, session_error>
+  open_device(const discovered_device &device, const session_options &options);
+
+  void close_device(const device_session *session);
+  void close_all() noexcept;
+
+  // Null if the device has no open session.
+  device_session *find_session(const discovered_device &device) const noexcept;
 
-  std::expected<void, sl_error> open_device(sl_device *device) noexcept;
+  const std::vector<std::unique_ptr<device_session>> &
+  sessions() const noexcept {
+    return sessions_;
+  }
+
+  aggregate_stats aggregate() const noexcept;
 
 private:
-  event_bus                     &event_bus_;
-  std::vector<discovered_device> discovered_devices_;
+  void discovery_pass(uint32_t timeout_ms);
+  void enumerate_sl_devices(uint32_t timeout_ms);
+#ifdef APP_HAS_SOCKET_DRIVER
+  void discover_gvcp(gev::endpoint local, std::vector<gev::endpoint> targets,
+                     uint32_t timeout_ms);
+#endif
+  void merge(const discovered_device &found);
+
+  void load_cache();
+  void save_cache();
+
+  event_bus                &event_bus_;
+  engine::jobs::job_system &jobs_;
+  std::filesystem::path     cache_path_;
 
-  sl_device_handle *opened_device_;
-};
\ No newline at end of file
+  mutex_protected<std::vector<discovered_device>> devices_;
+  mutex_protected<std::string>                    discovery_error_;
+  std::atomic<bool>                               discovering_{false};
+
+  std::vector<std::unique_ptr<device_session>> sessions_;
+
+  std::jthread discovery_thread_;
+};
@@ -0,0 +1,129 @@
+#include "frame_texture.hpp"
+
+#include <imgui_impl_vulkan.h>
+
+#include <profiling/profiler.hpp>
+
+#include "vk_utils.hpp"
+
+namespace {
+
+constexpr vk::Format texture_format = vk::Format::eR8G8B8A8Unorm;
+
+} // namespace
+
+frame_texture::frame_texture(std::shared_ptr<engine::device> dev,
+                             vk::Extent2D extent, uint32_t staging_slots)
+    : device_(std::move(dev)), extent_(extent) {
+  const vk::Device d = device_->handle();
+
+  image_ = d.createImageUnique(
+      vk::ImageCreateInfo()
+          .setImageType(vk::ImageType::e2D)
+          .setFormat(texture_format)
+          .setExtent({extent_.width, extent_.height, 1})
+          .setMipLevels(1)
+          .setArrayLayers(1)
+          .setSamples(vk::SampleCountFlagBits::e1)
+          .setTiling(vk::ImageTiling::eOptimal)
+          .setUsage(vk::ImageUsageFlagBits::eTransferDst |
+                    vk::ImageUsageFlagBits::eSampled |
+                    vk::ImageUsageFlagBits::eTransferSrc)
+          .setInitialLayout(vk::ImageLayout::eUndefined));
+  image_memory_ = vk_utils::allocate_and_bind(
+      *device_, *image_, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  view_ = d.createImageViewUnique(
+      vk::ImageViewCreateInfo()
+          .setImage(*image_)
+          .setViewType(vk::ImageViewType::e2D)
+          .setFormat(texture_format)
+          .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}));
+
+  // Nearest filtering: operators zoom in to look at individual pixels.
+  sampler_ = d.createSamplerUnique(
+      vk::SamplerCreateInfo()
+          .setMagFilter(vk::Filter::eNearest)
+          .setMinFilter(vk::Filter::eLinear)
+          .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+          .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+          .setAddressModeW(vk::SamplerAddressMode::eClampToEdge));
+
+  const vk::DeviceSize staging_size =
+      vk::DeviceSize{extent_.width} * extent_.height * sizeof(uint32_t);
+
+  staging_.resize(staging_slots);
+  for (auto &s : staging_) {
+    s.buffer = d.createBufferUnique(
+        vk::BufferCreateInfo()
+            .setSize(staging_size)
+            .setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+            .setSharingMode(vk::SharingMode::eExclusive));
+    s.memory = vk_utils::allocate_and_bind(
+        *device_, *s.buffer,
+        vk::MemoryPropertyFlagBits::eHostVisible |
+            vk::MemoryPropertyFlagBits::eHostCoherent);
+    s.mapped = static_cast<uint32_t *>(d.mapMemory(*s.memory, 0, staging_size));
+  }
+}
+
+frame_texture::~frame_texture() {
+  if (imgui_set_)
+    ImGui_ImplVulkan_RemoveTexture(imgui_set_);
+}
+
+std::span<uint32_t> frame_texture::staging(uint32_t slot) noexcept {
+  return {staging_[slot % staging_.size()].mapped,
+          size_t{extent_.width} * extent_.height};
+}
+
+void frame_texture::record_upload(vk::CommandBuffer cmd, uint32_t slot) {
+  ENGINE_PROFILE_SCOPE("record upload");
+
+  const vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1,
+                                        0, 1};
+
+  // The previous frame may still be sampling the image.
+  auto to_transfer =
+      vk::ImageMemoryBarrier2()
+          .setSrcStageMask(vk::PipelineStageFlagBits2::eFragmentShader)
+          .setSrcAccessMask(vk::AccessFlagBits2::eShaderSampledRead)
+          .setDstStageMask(vk::PipelineStageFlagBits2::eCopy)
+          .setDstAccessMask(vk::AccessFlagBits2::eTransferWrite)
+          .setOldLayout(layout_initialised_
+                            ? vk::ImageLayout::eShaderReadOnlyOptimal
+                            : vk::ImageLayout::eUndefined)
+          .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+          .setImage(*image_)
+          .setSubresourceRange(range);
+  cmd.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(to_transfer));
+
+  const auto region =
+      vk::BufferImageCopy()
+          .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+          .setImageExtent({extent_.width, extent_.height, 1});
+  cmd.copyBufferToImage(*staging_[slot % staging_.size()].buffer, *image_,
+                        vk::ImageLayout::eTransferDstOptimal, region);
+
+  auto to_sampled =
+      vk::ImageMemoryBarrier2()
+          .setSrcStageMask(vk::PipelineStageFlagBits2::eCopy)
+          .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+          .setDstStageMask(vk::PipelineStageFlagBits2::eFragmentShader)
+          .setDstAccessMask(vk::AccessFlagBits2::eShaderSampledRead)
+          .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+          .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+          .setImage(*image_)
+          .setSubresourceRange(range);
+  cmd.pipelineBarrier2(vk::DependencyInfo().setImageMemoryBarriers(to_sampled));
+
+  layout_initialised_ = true;
+}
+
+ImTextureID frame_texture::imgui_texture() {
+  if (!imgui_set_)
+    imgui_set_ = ImGui_ImplVulkan_AddTexture(
+        *sampler_, *view_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  return reinterpret_cast<ImTextureID>(imgui_set_);
+}
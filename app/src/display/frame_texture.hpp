@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <imgui.h>
+#include <vulkan/vulkan.hpp>
+
+#include <device.hpp>
+
+// An RGBA8 image that the CPU display path writes into through per-slot
+// host-visible staging buffers, sampled by ImGui. A slot's staging buffer may
+// only be written once the GPU work that last uploaded from it has finished.
+class frame_texture {
+public:
+  frame_texture(std::shared_ptr<engine::device> dev, vk::Extent2D extent,
+                uint32_t staging_slots);
+  ~frame_texture();
+
+  frame_texture(const frame_texture &) = delete;
+  frame_texture &operator=(const frame_texture &) = delete;
+
+  vk::Extent2D extent() const noexcept { return extent_; }
+  vk::Image    image() const noexcept { return *image_; }
+
+  // Persistently mapped staging memory for slot, width * height pixels.
+  std::span<uint32_t> staging(uint32_t slot) noexcept;
+
+  // Copies slot's staging buffer into the image and leaves the image ready
+  // for sampling in fragment shaders.
+  void record_upload(vk::CommandBuffer cmd, uint32_t slot);
+
+  // Registers the texture with the ImGui Vulkan backend on first use.
+  ImTextureID imgui_texture();
+
+private:
+  struct staging_buffer {
+    vk::UniqueBuffer       buffer;
+    vk::UniqueDeviceMemory memory;
+    uint32_t              *mapped = nullptr;
+  };
+
+  std::shared_ptr<engine::device> device_;
+  vk::Extent2D                    extent_;
+
+  vk::UniqueImage        image_;
+  vk::UniqueDeviceMemory image_memory_;
+  vk::UniqueImageView    view_;
+  vk::UniqueSampler      sampler_;
+  bool                   layout_initialised_ = false;
+
+  std::vector<staging_buffer> staging_;
+  VkDescriptorSet             imgui_set_ = VK_NULL_HANDLE;
+};
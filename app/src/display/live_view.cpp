@@ -0,0 +1,132 @@
+#include "live_view.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <profiling/profiler.hpp>
+
+namespace {
+
+// Copies a width x height frame into a view-sized one, top-left aligned,
+// cropping or zero-padding as needed.
+void fit(std::span<const uint16_t> in, uint32_t width, uint32_t height,
+         std::span<uint16_t> out, uint32_t out_width, uint32_t out_height) {
+  const uint32_t rows = std::min<uint32_t>(
+      std::min(height, out_height),
+      width ? static_cast<uint32_t>(in.size() / width) : 0);
+  const uint32_t columns = std::min(width, out_width);
+  for (uint32_t y = 0; y < rows; ++y) {
+    uint16_t *row = out.data() + size_t{y} * out_width;
+    std::memcpy(row, in.data() + size_t{y} * width, columns * sizeof(uint16_t));
+    std::fill(row + columns, row + out_width, uint16_t{0});
+  }
+  std::fill(out.begin() + size_t{rows} * out_width, out.end(), uint16_t{0});
+}
+
+} // namespace
+
+live_view::live_view(std::shared_ptr<engine::device> dev, uint32_t width,
+                     uint32_t height, uint32_t slots,
+                     engine::jobs::job_system &jobs)
+    : source_(width, height), processor_(width, height, &jobs),
+      texture_(std::move(dev), {width, height}, slots), shown_(slots),
+      raw_(source_.pixel_count()) {
+  set_correction();
+  processor_.set_window({.low = 0, .high = 40000});
+}
+
+void live_view::update(uint32_t slot) {
+  if (!playback_ && device_source_) {
+    if (const processing::frame_ref frame = device_source_()) {
+      show_device_frame(frame, slot);
+      return;
+    }
+  }
+
+  shown_[slot].reset();
+  if (device_frames_) {
+    device_frames_ = false;
+    set_correction();
+  }
+
+  if (playback_) {
+    std::span<const uint16_t> pixels;
+    {
+      ENGINE_PROFILE_SCOPE("playback");
+      frame_index_ = playback_->advance();
+      pixels = playback_->frame(frame_index_);
+    }
+
+    const auto &entry = playback_->entry(frame_index_);
+    if (entry.width == source_.width() && entry.height == source_.height() &&
+        pixels.size() >= raw_.size()) {
+      // Straight from the mapping; no copy.
+      processor_.process(pixels.first(raw_.size()), texture_.staging(slot));
+      return;
+    }
+    fit(pixels, entry.width, entry.height, raw_, source_.width(),
+        source_.height());
+  } else {
+    ENGINE_PROFILE_SCOPE("acquire");
+    frame_index_ = live_index_;
+    source_.fill(live_index_++, raw_);
+  }
+
+  processor_.process(raw_, texture_.staging(slot));
+}
+
+void live_view::show_device_frame(const processing::frame_ref &frame,
+                                  uint32_t                     slot) {
+  if (!device_frames_) {
+    device_frames_ = true;
+    set_correction();
+  }
+
+  const auto &metadata = frame.metadata();
+  frame_index_ = metadata.frame_id;
+
+  // A device slower than the display hands out the same frame again, and
+  // the slot may hold it already, mapped with the same window.
+  const auto window = processor_.window();
+  auto      &shown = shown_[slot];
+  if (shown && shown->frame_id == metadata.frame_id &&
+      shown->window.low == window.low && shown->window.high == window.high)
+    return;
+  shown = shown_frame{.frame_id = metadata.frame_id, .window = window};
+
+  const auto pixels = frame.pixels();
+  if (metadata.width == source_.width() && metadata.height == source_.height() &&
+      pixels.size() >= raw_.size()) {
+    // Straight from the acquisition buffer; no copy.
+    processor_.process(pixels.first(raw_.size()), texture_.staging(slot));
+    return;
+  }
+  fit(pixels, metadata.width, metadata.height, raw_, source_.width(),
+      source_.height());
+  processor_.process(raw_, texture_.staging(slot));
+}
+
+void live_view::set_playback(std::unique_ptr<recording::playback> playback) {
+  playback_ = std::move(playback);
+  set_correction();
+}
+
+void live_view::set_device_source(std::function<processing::frame_ref()> latest) {
+  device_source_ = std::move(latest);
+  // Another source's ids say nothing about what the slots hold.
+  for (auto &shown : shown_)
+    shown.reset();
+}
+
+void live_view::set_correction() {
+  // The synthetic source's dark and gain maps mean nothing for a recording
+  // or a device.
+  if (playback_ || device_frames_)
+    processor_.set_correction({}, {});
+  else
+    processor_.set_correction(source_.dark_map(), source_.gain_map());
+}
+
+void live_view::record_upload(vk::CommandBuffer cmd, uint32_t slot) {
+  texture_.record_upload(cmd, slot);
+}
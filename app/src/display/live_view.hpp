@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <device.hpp>
+#include <jobs/job_system.hpp>
+
+#include "display/frame_texture.hpp"
+#include "processing/frame_pool.hpp"
+#include "processing/frame_processor.hpp"
+#include "processing/synthetic_source.hpp"
+#include "recording/playback.hpp"
+
+// The acquisition -> correction -> display chain shared by the windowed and
+// headless front ends. update() runs the CPU stages into a staging slot and
+// record_upload() records the transfer to the texture the viewer samples.
+// Frames come from a recording while one is set with set_playback(), else
+// from a device while set_device_source() has one, else from the synthetic
+// source. Correction runs across the application's job system, which must
+// outlive the view.
+class live_view {
+public:
+  live_view(std::shared_ptr<engine::device> dev, uint32_t width,
+            uint32_t height, uint32_t slots, engine::jobs::job_system &jobs);
+
+  // The slot's previous upload must have completed on the GPU.
+  void update(uint32_t slot);
+  void record_upload(vk::CommandBuffer cmd, uint32_t slot);
+
+  uint64_t frame_index() const noexcept { return frame_index_; }
+
+  // Shows a recording instead of the live source; null goes back to live.
+  // Recordings are shown uncorrected, top-left aligned if their frame size
+  // differs from the view's.
+  void                 set_playback(std::unique_ptr<recording::playback> playback);
+  recording::playback *playback() noexcept { return playback_.get(); }
+
+  // Shows the frame latest returns, such as device_session::latest(), on
+  // every update it returns one. Device frames are read in place, without
+  // a copy, and each is processed once however many updates show it. No
+  // reference is held past update(), so a session may close between two.
+  // Device frames are shown as the session's pipeline corrected them.
+  void set_device_source(std::function<processing::frame_ref()> latest);
+
+  // The raw frame last processed, when it came from the live source or a
+  // device, or had to be fitted to the view; a recording shown straight
+  // from its mapping is read from the recording instead.
+  std::span<const uint16_t> raw_frame() const noexcept {
+    // The view does not correct device frames again, so their corrected()
+    // is a copy of them.
+    return device_frames_ ? processor_.corrected() : raw_;
+  }
+
+  frame_texture               &texture() noexcept { return texture_; }
+  processing::frame_processor &processor() noexcept { return processor_; }
+
+private:
+  // A device frame a staging slot holds, and the window it was mapped
+  // with.
+  struct shown_frame {
+    uint64_t                 frame_id = 0;
+    processing::window_level window;
+  };
+
+  void show_device_frame(const processing::frame_ref &frame, uint32_t slot);
+  void set_correction();
+
+  processing::synthetic_source source_;
+  processing::frame_processor  processor_;
+  frame_texture                texture_;
+
+  std::unique_ptr<recording::playback> playback_;
+
+  std::function<processing::frame_ref()>  device_source_;
+  bool                                    device_frames_ = false;
+  std::vector<std::optional<shown_frame>> shown_; // Per staging slot.
+
+  std::vector<uint16_t> raw_;
+  uint64_t              frame_index_ = 0;
+  uint64_t              live_index_ = 0;
+};
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <any>
+#include <atomic>
 #include <functional>
+#include <mutex>
+#include <shared_mutex>
 #include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 #include "events.hpp"
-#include <shared_mutex>
 
 class subscription_handle {
 public:
@@ -0,0 +1,534 @@
+#include "headless_application.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+#include <imgui.h>
+#include <imgui_impl_vulkan.h>
+
+#include <spdlog/spdlog.h>
+
+#include <profiling/profiler.hpp>
+
+#include "ui/frame_viewer_window.hpp"
+#include "vk_utils.hpp"
+
+namespace {
+
+constexpr vk::Format target_format = vk::Format::eR8G8B8A8Unorm;
+constexpr uint32_t   frames_in_flight = 2;
+
+inline constexpr auto application_info =
+    vk::ApplicationInfo{}
+        .setPApplicationName("VK Application (headless)")
+        .setApplicationVersion(VK_MAKE_API_VERSION(0, 1, 0, 0))
+        .setPEngineName("VK Engine")
+        .setEngineVersion(VK_MAKE_API_VERSION(0, 1, 0, 0))
+        .setApiVersion(VK_API_VERSION_1_3);
+
+uint32_t parse_u32(std::string_view flag, std::string_view value) {
+  uint32_t out = 0;
+  auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(),
+                                   out);
+  if (ec != std::errc{} || ptr != value.data() + value.size() || out == 0)
+    throw std::invalid_argument(
+        std::format("{} expects a positive integer, got '{}'", flag, value));
+  return out;
+}
+
+// WxH[+HEADER]: frame size and the bytes before the first frame.
+recording::raw_layout parse_raw_layout(std::string_view flag,
+                                       std::string_view value) {
+  const auto error = [&] {
+    return std::invalid_argument(
+        std::format("{} expects WIDTHxHEIGHT[+HEADER], got '{}'", flag, value));
+  };
+  recording::raw_layout layout;
+  const char *p = value.data();
+  const char *end = value.data() + value.size();
+  auto        r = std::from_chars(p, end, layout.width);
+  if (r.ec != std::errc{} || r.ptr == end || *r.ptr != 'x')
+    throw error();
+  r = std::from_chars(r.ptr + 1, end, layout.height);
+  if (r.ec != std::errc{})
+    throw error();
+  if (r.ptr != end) {
+    if (*r.ptr != '+')
+      throw error();
+    r = std::from_chars(r.ptr + 1, end, layout.header_bytes);
+    if (r.ec != std::errc{} || r.ptr != end)
+      throw error();
+  }
+  if (layout.width == 0 || layout.height == 0)
+    throw error();
+  return layout;
+}
+
+void check_vk_result(VkResult err) {
+  if (err != VK_SUCCESS)
+    throw std::runtime_error("VkError");
+}
+
+} // namespace
+
+std::optional<headless_options>
+headless_options::parse(std::span<const std::string_view> args) {
+  if (std::ranges::find(args, "--headless") == args.end())
+    return std::nullopt;
+
+  headless_options opts;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto flag = args[i];
+    if (flag == "--headless")
+      continue;
+
+    if (i + 1 >= args.size())
+      throw std::invalid_argument(std::format("{} expects a value", flag));
+    const auto value = args[++i];
+
+    if (flag == "--frames")
+      opts.frames = parse_u32(flag, value);
+    else if (flag == "--frame-width")
+      opts.frame_width = parse_u32(flag, value);
+    else if (flag == "--frame-height")
+      opts.frame_height = parse_u32(flag, value);
+    else if (flag == "--width")
+      opts.target_width = parse_u32(flag, value);
+    else if (flag == "--height")
+      opts.target_height = parse_u32(flag, value);
+    else if (flag == "--dump")
+      opts.dump_image = value;
+    else if (flag == "--timings")
+      opts.timings = value;
+    else if (flag == "--trace")
+      opts.trace = value;
+    else if (flag == "--playback")
+      opts.playback = value;
+    else if (flag == "--raw")
+      opts.raw = parse_raw_layout(flag, value);
+    else
+      throw std::invalid_argument(std::format("unknown option '{}'", flag));
+  }
+
+  return opts;
+}
+
+headless_application::headless_application(headless_options options)
+    : options_(std::move(options)),
+      jobs_({.on_start = [](uint32_t worker) {
+        engine::profiling::profiler::get().set_thread_name("worker " +
+                                                           std::to_string(worker));
+      }}) {
+  init_vk();
+  create_target();
+  create_frames();
+  init_imgui();
+
+  std::unique_ptr<recording::playback> playback;
+  if (!options_.playback.empty()) {
+    auto opened =
+        recording::playback::open(options_.playback,
+                                  {.jobs = &jobs_, .raw = options_.raw});
+    if (!opened)
+      throw std::runtime_error(std::format("Cannot play {}: {}",
+                                           options_.playback.string(),
+                                           opened.error().message()));
+    playback = std::move(*opened);
+    if (playback->frame_count() != 0) {
+      options_.frame_width = playback->entry(0).width;
+      options_.frame_height = playback->entry(0).height;
+    }
+    playback->set_rate(0.0);
+    playback->set_playing(true);
+  }
+
+  live_view_ = std::make_unique<live_view>(device_, options_.frame_width,
+                                           options_.frame_height,
+                                           frames_in_flight, jobs_);
+  if (playback)
+    live_view_->set_playback(std::move(playback));
+}
+
+headless_application::~headless_application() {
+  if (graphics_queue_)
+    graphics_queue_->wait_idle();
+
+  // The live view owns an ImGui texture, so it must go before the backend.
+  live_view_.reset();
+
+  if (imgui_initialised_) {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui::DestroyContext();
+  }
+}
+
+void headless_application::init_vk() {
+  VULKAN_HPP_DEFAULT_DISPATCHER.init();
+
+  // No surface extensions at all: this must work without a display server.
+  std::vector<const char *> instance_extensions{
+      VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME};
+  std::vector<const char *> layers;
+#ifdef APP_USE_VULKAN_DEBUG_UTILS
+  instance_extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+  layers.push_back("VK_LAYER_KHRONOS_validation");
+#endif
+
+  instance_ = std::make_shared<engine::instance>(engine::instance(
+      {}, std::span<vk::ValidationFeatureDisableEXT>{}, instance_extensions,
+      layers, {}, application_info));
+
+  VULKAN_HPP_DEFAULT_DISPATCHER.init(instance_->handle());
+
+  auto gpus = engine::instance::enumerate_gpus(instance_);
+  auto gpu_expected = vk_utils::pick_any_gpu(gpus);
+  if (!gpu_expected)
+    throw std::runtime_error(gpu_expected.error());
+  selected_gpu_ = *gpu_expected;
+
+  const auto &props = selected_gpu_->properties.properties;
+  if (props.apiVersion < VK_API_VERSION_1_3)
+    throw std::runtime_error(
+        std::format("{} only supports Vulkan {}.{}; 1.3 is required",
+                    props.deviceName.data(),
+                    VK_API_VERSION_MAJOR(props.apiVersion),
+                    VK_API_VERSION_MINOR(props.apiVersion)));
+  spdlog::info("Headless on {}", props.deviceName.data());
+
+  const uint32_t graphics = *vk_utils::first_graphics_queue(*selected_gpu_);
+  constexpr float prio = 1.0f;
+  const auto      qci = vk::DeviceQueueCreateInfo()
+                       .setQueueFamilyIndex(graphics)
+                       .setQueuePriorities(prio);
+
+  // Everything used here is core in 1.3, so no device extensions either.
+  engine::feature_chain feats;
+  feats.get<vk::PhysicalDeviceVulkan12Features>().setTimelineSemaphore(true);
+  feats.get<vk::PhysicalDeviceVulkan13Features>()
+      .setDynamicRendering(true)
+      .setSynchronization2(true);
+  feats.get<vk::DeviceCreateInfo>().setQueueCreateInfos(qci);
+  if (props.apiVersion < VK_API_VERSION_1_4)
+    feats.unlink<vk::PhysicalDeviceVulkan14Features>();
+
+  auto bundle = engine::device::create(selected_gpu_, feats);
+  device_ = std::move(bundle.dev);
+  graphics_queue_ = std::move(bundle.queues[0]);
+
+  VULKAN_HPP_DEFAULT_DISPATCHER.init(device_->handle());
+
+  std::array<vk::DescriptorPoolSize, 1> pool_sizes = {{vk::DescriptorPoolSize(
+      vk::DescriptorType::eCombinedImageSampler,
+      IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE)}};
+
+  descriptor_pool_ = device_->handle().createDescriptorPoolUnique(
+      vk::DescriptorPoolCreateInfo()
+          .setPoolSizes(pool_sizes)
+          .setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+          .setMaxSets(IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE));
+
+  gpu_profiler_ = std::make_unique<engine::profiling::gpu_profiler>(
+      device_, graphics, "gpu graphics");
+}
+
+void headless_application::init_imgui() {
+  IMGUI_CHECKVERSION();
+  ImGui::CreateContext();
+  ImGui::StyleColorsDark();
+
+  ImGuiIO &io = ImGui::GetIO();
+  io.IniFilename = nullptr; // Runs must not depend on a user's layout.
+  io.DisplaySize = ImVec2(static_cast<float>(options_.target_width),
+                          static_cast<float>(options_.target_height));
+
+  ImGui_ImplVulkan_InitInfo init_info = {};
+  init_info.PipelineRenderingCreateInfo =
+      vk::PipelineRenderingCreateInfo().setColorAttachmentFormats(
+          target_format);
+  init_info.UseDynamicRendering = true;
+  init_info.Instance = instance_->handle();
+  init_info.PhysicalDevice = selected_gpu_->handle();
+  init_info.Device = device_->handle();
+  init_info.QueueFamily = graphics_queue_->queue_family_index();
+  init_info.Queue = graphics_queue_->handle();
+  init_info.DescriptorPool = *descriptor_pool_;
+  init_info.MinImageCount = frames_in_flight;
+  init_info.ImageCount = frames_in_flight;
+  init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+  init_info.CheckVkResultFn = check_vk_result;
+
+  if (!ImGui_ImplVulkan_Init(&init_info))
+    throw std::runtime_error("Failed to init ImGui with Vulkan");
+  imgui_initialised_ = true;
+}
+
+void headless_application::create_target() {
+  const vk::Device d = device_->handle();
+
+  target_ = d.createImageUnique(
+      vk::ImageCreateInfo()
+          .setImageType(vk::ImageType::e2D)
+          .setFormat(target_format)
+          .setExtent({options_.target_width, options_.target_height, 1})
+          .setMipLevels(1)
+          .setArrayLayers(1)
+          .setSamples(vk::SampleCountFlagBits::e1)
+          .setTiling(vk::ImageTiling::eOptimal)
+          .setUsage(vk::ImageUsageFlagBits::eColorAttachment |
+                    vk::ImageUsageFlagBits::eTransferSrc));
+  target_memory_ = vk_utils::allocate_and_bind(
+      *device_, *target_, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  target_view_ = d.createImageViewUnique(
+      vk::ImageViewCreateInfo()
+          .setImage(*target_)
+          .setViewType(vk::ImageViewType::e2D)
+          .setFormat(target_format)
+          .setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}));
+
+  readback_ = d.createBufferUnique(
+      vk::BufferCreateInfo()
+          .setSize(vk::DeviceSize{options_.target_width} *
+                   options_.target_height * 4)
+          .setUsage(vk::BufferUsageFlagBits::eTransferDst));
+  readback_memory_ = vk_utils::allocate_and_bind(
+      *device_, *readback_,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+void headless_application::create_frames() {
+  frames_.resize(frames_in_flight);
+  for (auto &f : frames_) {
+    f.command_pool = device_->handle().createCommandPoolUnique(
+        {vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+         graphics_queue_->queue_family_index()});
+    f.cmd = device_->handle()
+                .allocateCommandBuffers(
+                    {*f.command_pool, vk::CommandBufferLevel::ePrimary, 1})
+                .front();
+  }
+}
+
+void headless_application::record(offscreen_frame &f, uint32_t slot,
+                                  bool readback) {
+  ENGINE_PROFILE_SCOPE("record");
+
+  f.cmd.reset({});
+  f.cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  gpu_profiler_->begin_frame(f.cmd, slot);
+  const auto frame_region = gpu_profiler_->begin_region(f.cmd, "frame");
+
+  {
+    ENGINE_PROFILE_GPU_SCOPE(*gpu_profiler_, f.cmd, "upload");
+    live_view_->record_upload(f.cmd, slot);
+  }
+
+  const vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1,
+                                        0, 1};
+  // Frames share one target; order this frame's writes after the previous
+  // frame's writes and readback.
+  auto pre =
+      vk::ImageMemoryBarrier2()
+          .setSrcStageMask(vk::PipelineStageFlagBits2::eColorAttachmentOutput |
+                           vk::PipelineStageFlagBits2::eCopy)
+          .setSrcAccessMask(vk::AccessFlagBits2::eColorAttachmentWrite |
+                            vk::AccessFlagBits2::eTransferRead)
+          .setDstStageMask(vk::PipelineStageFlagBits2::eColorAttachmentOutput)
+          .setDstAccessMask(vk::AccessFlagBits2::eColorAttachmentWrite)
+          .setOldLayout(vk::ImageLayout::eUndefined)
+          .setNewLayout(vk::ImageLayout::eColorAttachmentOptimal)
+          .setImage(*target_)
+          .setSubresourceRange(range);
+  f.cmd.pipelineBarrier2(vk::DependencyInfo{}.setImageMemoryBarriers(pre));
+
+  const vk::Extent2D extent{options_.target_width, options_.target_height};
+  const auto         color =
+      vk::RenderingAttachmentInfo{}
+          .setImageView(*target_view_)
+          .setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+          .setLoadOp(vk::AttachmentLoadOp::eClear)
+          .setStoreOp(vk::AttachmentStoreOp::eStore)
+          .setClearValue(
+              vk::ClearColorValue(std::array<float, 4>{0.1f, 0.1f, 0.1f, 1.f}));
+
+  f.cmd.beginRendering(vk::RenderingInfo{}
+                           .setRenderArea({{0, 0}, extent})
+                           .setLayerCount(1)
+                           .setColorAttachments(color));
+  {
+    ENGINE_PROFILE_GPU_SCOPE(*gpu_profiler_, f.cmd, "imgui");
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), f.cmd);
+  }
+  f.cmd.endRendering();
+
+  if (readback) {
+    auto to_src =
+        vk::ImageMemoryBarrier2()
+            .setSrcStageMask(vk::PipelineStageFlagBits2::eColorAttachmentOutput)
+            .setSrcAccessMask(vk::AccessFlagBits2::eColorAttachmentWrite)
+            .setDstStageMask(vk::PipelineStageFlagBits2::eCopy)
+            .setDstAccessMask(vk::AccessFlagBits2::eTransferRead)
+            .setOldLayout(vk::ImageLayout::eColorAttachmentOptimal)
+            .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+            .setImage(*target_)
+            .setSubresourceRange(range);
+    f.cmd.pipelineBarrier2(vk::DependencyInfo{}.setImageMemoryBarriers(to_src));
+
+    f.cmd.copyImageToBuffer(
+        *target_, vk::ImageLayout::eTransferSrcOptimal, *readback_,
+        vk::BufferImageCopy()
+            .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+            .setImageExtent({extent.width, extent.height, 1}));
+
+    auto host_read = vk::BufferMemoryBarrier2()
+                         .setSrcStageMask(vk::PipelineStageFlagBits2::eCopy)
+                         .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+                         .setDstStageMask(vk::PipelineStageFlagBits2::eHost)
+                         .setDstAccessMask(vk::AccessFlagBits2::eHostRead)
+                         .setBuffer(*readback_)
+                         .setSize(vk::WholeSize);
+    f.cmd.pipelineBarrier2(
+        vk::DependencyInfo{}.setBufferMemoryBarriers(host_read));
+  }
+
+  gpu_profiler_->end_region(f.cmd, frame_region);
+  f.cmd.end();
+}
+
+int headless_application::run() {
+  auto &prof = engine::profiling::profiler::get();
+  prof.set_enabled(true);
+  prof.set_thread_name("headless");
+
+  frame_viewer_window viewer(*live_view_);
+  const bool          readback_last = !options_.dump_image.empty();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < options_.frames; ++i) {
+    // Between frames, so that draining is not timed as part of one.
+    prof.collect(events_);
+    ENGINE_PROFILE_SCOPE("frame");
+
+    const uint32_t   slot = i % frames_in_flight;
+    offscreen_frame &f = frames_[slot];
+    {
+      ENGINE_PROFILE_SCOPE("wait frame");
+      if (auto waited = graphics_queue_->wait(f.timeline_value,
+                                              std::chrono::nanoseconds::max());
+          !waited) {
+        spdlog::error("Frame wait failed: {}", vk::to_string(waited.error()));
+        return 1;
+      }
+    }
+
+    live_view_->update(slot);
+
+    {
+      auto queue_lock = graphics_queue_->lock_handle();
+      ImGui_ImplVulkan_NewFrame();
+    }
+    ImGui::GetIO().DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+    {
+      ENGINE_PROFILE_SCOPE("build ui");
+      ImGui::SetNextWindowPos({0, 0});
+      ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+      viewer.render();
+    }
+    ImGui::Render();
+
+    record(f, slot, readback_last && i + 1 == options_.frames);
+
+    f.timeline_value = graphics_queue_->submit(
+        {.command_buffers = {
+             vk::CommandBufferSubmitInfo().setCommandBuffer(f.cmd)}});
+  }
+  graphics_queue_->wait_idle();
+  gpu_profiler_->resolve_all();
+
+  write_outputs(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+  return 0;
+}
+
+void headless_application::write_outputs(double wall_seconds) {
+  auto &prof = engine::profiling::profiler::get();
+
+  prof.collect(events_);
+  const auto tracks = prof.tracks();
+
+  std::map<std::string, std::vector<double>> durations_ms;
+  for (const auto &e : events_) {
+    // GPU and CPU scopes can share a name; keep them apart.
+    const auto key = std::format("{}/{}", tracks[e.track].name, e.name);
+    durations_ms[key].push_back((e.end_ns - e.start_ns) / 1e6);
+  }
+
+  auto percentile = [](std::vector<double> &v, double p) {
+    const auto idx = static_cast<size_t>(p * static_cast<double>(v.size() - 1));
+    std::ranges::nth_element(v, v.begin() + idx);
+    return v[idx];
+  };
+
+  spdlog::info("{} frames in {:.2f} s ({:.1f} frames/s)", options_.frames,
+               wall_seconds, options_.frames / wall_seconds);
+
+  std::string json = std::format(
+      "{{\"frames\":{},\"wall_seconds\":{:.6f},\"frames_per_second\":{:.3f},"
+      "\"scopes\":{{",
+      options_.frames, wall_seconds, options_.frames / wall_seconds);
+  bool first = true;
+  for (auto &[name, d] : durations_ms) {
+    double total = 0, max = 0;
+    for (double v : d) {
+      total += v;
+      max = std::max(max, v);
+    }
+    const double mean = total / d.size();
+    const double p50 = percentile(d, 0.50);
+    const double p99 = percentile(d, 0.99);
+
+    spdlog::info("  {:<32} n={:<6} mean {:>8.3f} ms  p50 {:>8.3f}  p99 "
+                 "{:>8.3f}  max {:>8.3f}",
+                 name, d.size(), mean, p50, p99, max);
+    json += std::format("{}\"{}\":{{\"count\":{},\"mean_ms\":{:.6f},"
+                        "\"p50_ms\":{:.6f},\"p99_ms\":{:.6f},\"max_ms\":{:.6f}}}",
+                        first ? "" : ",", name, d.size(), mean, p50, p99, max);
+    first = false;
+  }
+  json += "}}\n";
+
+  if (!options_.timings.empty()) {
+    std::ofstream(options_.timings) << json;
+    spdlog::info("Timings written to {}", options_.timings.string());
+  }
+
+  if (!options_.trace.empty()) {
+    std::ofstream file(options_.trace);
+    engine::profiling::write_chrome_trace(file, events_, tracks);
+    spdlog::info("Trace written to {}", options_.trace.string());
+  }
+
+  if (!options_.dump_image.empty()) {
+    const auto  size = vk::DeviceSize{options_.target_width} *
+                      options_.target_height * 4;
+    const auto *rgba = static_cast<const uint8_t *>(
+        device_->handle().mapMemory(*readback_memory_, 0, size));
+
+    std::ofstream file(options_.dump_image, std::ios::binary);
+    file << std::format("P6\n{} {}\n255\n", options_.target_width,
+                        options_.target_height);
+    for (size_t p = 0; p < size; p += 4)
+      file.write(reinterpret_cast<const char *>(rgba + p), 3);
+
+    device_->handle().unmapMemory(*readback_memory_);
+    spdlog::info("Last frame written to {}", options_.dump_image.string());
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <device.hpp>
+#include <gpu.hpp>
+#include <instance.hpp>
+#include <jobs/job_system.hpp>
+#include <profiling/gpu_profiler.hpp>
+#include <profiling/profiler.hpp>
+#include <queue.hpp>
+
+#include "display/live_view.hpp"
+
+struct headless_options {
+  uint32_t frames = 600;
+  uint32_t frame_width = 1024; // Synthetic detector frame size.
+  uint32_t frame_height = 1024;
+  uint32_t target_width = 1280; // Offscreen render target size.
+  uint32_t target_height = 720;
+
+  std::filesystem::path dump_image; // PPM of the last rendered frame.
+  std::filesystem::path timings;    // JSON per-scope timing summary.
+  std::filesystem::path trace;      // Chrome trace of the whole run.
+  // Recording or TIFF stack to play, every frame in turn, instead of the
+  // synthetic source; the frame size follows the recording.
+  std::filesystem::path playback;
+  // Plays it as a raw dump of 16-bit frames instead (--raw WxH[+HEADER]).
+  std::optional<recording::raw_layout> raw;
+
+  // Parses --headless style arguments; returns nullopt if --headless is not
+  // among them. Throws std::invalid_argument on malformed options.
+  static std::optional<headless_options>
+  parse(std::span<const std::string_view> args);
+};
+
+// Runs the same acquisition -> correction -> display path as the windowed
+// application, but against an instance and device created without any
+// surface extensions, rendering the UI into an offscreen image. Works on
+// software implementations such as lavapipe, so it can run on CI machines
+// without a display.
+class headless_application {
+public:
+  explicit headless_application(headless_options options);
+  ~headless_application();
+
+  headless_application(const headless_application &) = delete;
+  headless_application &operator=(const headless_application &) = delete;
+
+  // Returns the process exit code.
+  int run();
+
+private:
+  struct offscreen_frame {
+    vk::UniqueCommandPool command_pool;
+    vk::CommandBuffer     cmd;
+    uint64_t              timeline_value = 0;
+  };
+
+  void init_vk();
+  void init_imgui();
+  void create_target();
+  void create_frames();
+  void record(offscreen_frame &f, uint32_t slot, bool readback);
+  void write_outputs(double wall_seconds);
+
+  headless_options options_;
+
+  // Shared by the live view's correction and playback decoding; before
+  // them, so it outlives both.
+  engine::jobs::job_system jobs_;
+
+  std::shared_ptr<engine::instance> instance_;
+  std::shared_ptr<engine::gpu>      selected_gpu_;
+  std::shared_ptr<engine::device>   device_;
+  std::shared_ptr<engine::queue>    graphics_queue_;
+  vk::UniqueDescriptorPool          descriptor_pool_;
+
+  vk::UniqueImage        target_;
+  vk::UniqueDeviceMemory target_memory_;
+  vk::UniqueImageView    target_view_;
+  vk::UniqueBuffer       readback_;
+  vk::UniqueDeviceMemory readback_memory_;
+
+  std::vector<offscreen_frame>                     frames_;
+  std::unique_ptr<engine::profiling::gpu_profiler> gpu_profiler_;
+  std::unique_ptr<live_view>                       live_view_;
+
+  // Scopes collected so far. Drained every frame: the per-thread rings
+  // hold only profiler::ring_capacity events each and drop the rest.
+  std::vector<engine::profiling::scope_event> events_;
+
+  bool imgui_initialised_ = false;
+};
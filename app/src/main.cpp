@@ -1,9 +1,35 @@
+#include <exception>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
 #include "application.hpp"
+#include "headless_application.hpp"
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  std::optional<headless_options> headless;
+  try {
+    headless = headless_options::parse(args);
+  } catch (const std::invalid_argument &e) {
+    spdlog::error("{}", e.what());
+    spdlog::info("usage: app [--headless [--frames N] [--frame-width W] "
+                 "[--frame-height H] [--width W] [--height H] [--dump out.ppm] "
+                 "[--timings out.json] [--trace trace.json] "
+                 "[--playback recording.vkrec|stack.tif] [--raw WxH[+HEADER]]]");
+    return 2;
+  }
+
+  if (headless) {
+    headless_application app(std::move(*headless));
+    return app.run();
+  }
+
+  application app;
 
-int main() {
-    application app;
+  app.run();
 
-    app.run();
-    
-    return 0;
- }
\ No newline at end of file
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "placement.hpp"
+
+#include <charconv>   /* std::from_chars */
+#include <cstring>    /* std::memset, std::strerror */
+#include <filesystem> /* sysfs paths */
+#include <fstream>    /* sysfs reads */
+#include <string>     /* sysfs lines */
+#include <thread>     /* first-touch thread */
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <ifaddrs.h>    /* getifaddrs */
+#include <netinet/in.h> /* sockaddr_in */
+#include <pthread.h>    /* affinity, SCHED_FIFO */
+#include <sched.h>      /* cpu_set_t */
+#endif
+
+namespace placement {
+
+std::optional<std::vector<int>> parse_cpu_list(std::string_view list) {
+  const auto number = [](std::string_view text) -> std::optional<int> {
+    int  value = 0;
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size() || value < 0)
+      return std::nullopt;
+    return value;
+  };
+
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+    list.remove_suffix(1);
+
+  std::vector<int> cpus;
+  while (!list.empty()) {
+    const size_t           comma = list.find(',');
+    const std::string_view range = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+
+    const size_t dash = range.find('-');
+    const auto   first = number(range.substr(0, dash));
+    const auto   last = dash == std::string_view::npos
+                            ? first
+                            : number(range.substr(dash + 1));
+    if (!first || !last || *last < *first)
+      return std::nullopt;
+    for (int cpu = *first; cpu <= *last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+#ifdef __linux__
+
+std::optional<int> numa_node_for_address(uint32_t local_address) {
+  ifaddrs *addresses = nullptr;
+  if (getifaddrs(&addresses) != 0)
+    return std::nullopt;
+
+  std::optional<int> node;
+  for (ifaddrs *a = addresses; a; a = a->ifa_next) {
+    if (!a->ifa_addr || a->ifa_addr->sa_family != AF_INET)
+      continue;
+
+    const auto *in = reinterpret_cast<const sockaddr_in *>(a->ifa_addr);
+    if (ntohl(in->sin_addr.s_addr) != local_address)
+      continue;
+
+    // Only PCI devices have a node; virtual interfaces have no device link.
+    std::ifstream file(std::filesystem::path("/sys/class/net") / a->ifa_name /
+                       "device" / "numa_node");
+    int           value = -1;
+    if (file >> value && value >= 0)
+      node = value;
+    break;
+  }
+
+  freeifaddrs(addresses);
+  return node;
+}
+
+std::vector<int> cpus_of_node(int node) {
+  std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+  std::string   list;
+  if (!std::getline(file, list))
+    return {};
+  return parse_cpu_list(list).value_or(std::vector<int>{});
+}
+
+bool pin_current_thread(std::span<const int> cpus) {
+  if (cpus.empty())
+    return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+
+  if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    spdlog::warn("Could not pin thread to {} CPU(s): {}", cpus.size(),
+                 std::strerror(err));
+    return false;
+  }
+  return true;
+}
+
+bool set_realtime_priority(int priority) {
+  const sched_param param{.sched_priority = priority};
+  if (const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+    spdlog::warn("Could not switch thread to SCHED_FIFO priority {}: {}",
+                 priority, std::strerror(err));
+    return false;
+  }
+  return true;
+}
+
+#else
+
+std::optional<int> numa_node_for_address(uint32_t) { return std::nullopt; }
+
+std::vector<int> cpus_of_node(int) { return {}; }
+
+bool pin_current_thread(std::span<const int>) { return false; }
+
+bool set_realtime_priority(int) { return false; }
+
+#endif
+
+void first_touch(std::span<std::byte> memory, std::span<const int> cpus) {
+  if (cpus.empty()) {
+    std::memset(memory.data(), 0, memory.size());
+    return;
+  }
+
+  std::jthread([memory, cpus] {
+    pin_current_thread(cpus);
+    std::memset(memory.data(), 0, memory.size());
+  });
+}
+
+} // namespace placement
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>     /* std::byte */
+#include <cstdint>     /* uint32_t */
+#include <optional>    /* node lookups that may fail */
+#include <span>        /* memory and CPU lists */
+#include <string_view> /* CPU list syntax */
+#include <vector>      /* CPU lists */
+
+// Thread and memory placement for acquisition sessions. Linux only; on other
+// platforms every query comes back empty and every action is a no-op.
+//
+// Buffers are placed by first touch: they are allocated without being
+// initialised and then zeroed from a thread running on the target CPUs, so
+// the kernel backs them with pages from that node. No libnuma needed.
+namespace placement {
+
+// NUMA node of the network interface that owns local_address (host byte
+// order), or nullopt if unknown (loopback, virtual NICs, non-NUMA systems).
+std::optional<int> numa_node_for_address(uint32_t local_address);
+
+// Parses a Linux CPU list such as "2-3,6"; nullopt if malformed. Available
+// on every platform so options can be validated anywhere.
+std::optional<std::vector<int>> parse_cpu_list(std::string_view list);
+
+// CPUs of a NUMA node; empty if the node does not exist.
+std::vector<int> cpus_of_node(int node);
+
+// Restricts the calling thread to cpus. Returns false (and leaves the
+// affinity alone) if cpus is empty or the call fails.
+bool pin_current_thread(std::span<const int> cpus);
+
+// Switches the calling thread to SCHED_FIFO at priority (1-99). Needs
+// CAP_SYS_NICE or an RLIMIT_RTPRIO allowance; returns false (and logs) if
+// refused, leaving the thread as it was.
+bool set_realtime_priority(int priority);
+
+// Zeroes memory from a short-lived thread pinned to cpus, so its pages are
+// allocated on their node. With no cpus it simply zeroes on this thread.
+void first_touch(std::span<std::byte> memory, std::span<const int> cpus);
+
+} // namespace placement
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm> /* std::clamp */
+#include <array>     /* std::array for the display LUT */
+#include <cassert>   /* assert */
+#include <cstdint>   /* uint16_t, uint32_t */
+#include <span>      /* std::span */
+
+namespace processing {
+
+// Number of distinct 16-bit input values, i.e. the size of a display LUT.
+inline constexpr size_t lut_size = size_t{1} << 16;
+
+using display_lut = std::array<uint32_t, lut_size>;
+
+struct window_level {
+  uint16_t low = 0;
+  uint16_t high = 0xFFFF;
+};
+
+// Offset/gain (dark/flat) correction: out = clamp((raw - dark) * gain).
+// All spans must have the same length; out may alias raw.
+inline void offset_gain_correct(std::span<const uint16_t> raw,
+                                std::span<const uint16_t> dark,
+                                std::span<const float>    gain,
+                                std::span<uint16_t>       out) noexcept {
+  assert(raw.size() == dark.size() && raw.size() == gain.size() &&
+         raw.size() == out.size());
+
+  for (size_t i = 0; i < raw.size(); ++i) {
+    const float v =
+        (static_cast<float>(raw[i]) - static_cast<float>(dark[i])) * gain[i];
+    out[i] = static_cast<uint16_t>(std::clamp(v, 0.0f, 65535.0f) + 0.5f);
+  }
+}
+
+// Builds a 16-bit -> RGBA8 grey lookup for the given window. Rebuilding is
+// cheap next to a frame, so do it whenever the window changes.
+inline void build_display_lut(window_level wl, display_lut &lut) noexcept {
+  const float low = wl.low;
+  const float range = std::max(1.0f, static_cast<float>(wl.high) - low);
+
+  for (size_t i = 0; i < lut_size; ++i) {
+    const float    t = std::clamp((static_cast<float>(i) - low) / range, 0.0f,
+                                  1.0f);
+    const uint32_t g = static_cast<uint32_t>(t * 255.0f + 0.5f);
+    lut[i] = 0xFF000000u | (g << 16) | (g << 8) | g;
+  }
+}
+
+inline void apply_display_lut(std::span<const uint16_t> in,
+                              const display_lut        &lut,
+                              std::span<uint32_t>       out) noexcept {
+  assert(in.size() == out.size());
+
+  for (size_t i = 0; i < in.size(); ++i)
+    out[i] = lut[in[i]];
+}
+
+} // namespace processing
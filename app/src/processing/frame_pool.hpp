@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>     /* reference counts */
+#include <cassert>    /* assert */
+#include <cstdint>    /* uint32_t, uint64_t */
+#include <functional> /* recycle callback */
+#include <memory>     /* std::unique_ptr for records */
+#include <mutex>      /* handle table lock */
+#include <optional>   /* acquire() */
+#include <span>       /* pixels */
+#include <utility>    /* std::exchange, std::swap */
+
+#include <utility/slot_map.hpp>
+
+namespace processing {
+
+struct frame_metadata {
+  uint64_t frame_id = 0;
+  uint64_t device_timestamp = 0;
+  int64_t  received_ns = 0; // steady_clock, when the frame was completed.
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t pixel_format = 0;
+  bool     complete = true;
+};
+
+// Names a frame without keeping it alive. frame_pool::acquire() turns it
+// into a frame_ref while someone still holds the frame, and fails once its
+// buffer has gone back to the acquisition free list.
+using frame_handle = slot_id;
+
+class frame_pool;
+
+// One counted reference to a pooled frame. Copies share the frame; the
+// last one to go returns its buffer. Must not outlive the pool.
+class frame_ref {
+public:
+  frame_ref() noexcept = default;
+  frame_ref(const frame_ref &other) noexcept;
+  frame_ref(frame_ref &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)), handle_(other.handle_) {}
+  frame_ref &operator=(frame_ref other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~frame_ref() { reset(); }
+
+  void reset() noexcept;
+  void swap(frame_ref &other) noexcept {
+    std::swap(pool_, other.pool_);
+    std::swap(handle_, other.handle_);
+  }
+
+  explicit operator bool() const noexcept { return pool_ != nullptr; }
+
+  frame_handle              handle() const noexcept { return handle_; }
+  const frame_metadata     &metadata() const noexcept;
+  std::span<const uint16_t> pixels() const noexcept;
+
+private:
+  friend class frame_pool;
+
+  frame_ref(frame_pool *pool, frame_handle handle) noexcept
+      : pool_(pool), handle_(handle) {}
+
+  frame_pool  *pool_ = nullptr;
+  frame_handle handle_{0, 0};
+};
+
+/*========================================================================================
+ *  frame_pool
+ *  -----------------------------------------------------------------------
+ *  •  The one owner of received frames: the acquisition thread publishes
+ *     each filled buffer with its metadata into the session's frame
+ *     pipeline. The session keeps a frame_ref to the newest, and the live
+ *     view shares it for one update, reading the pixels in place.
+ *  •  The recorder and the history keep frames for longer than the ring
+ *     holds them, so they copy each frame once from the pooled buffer, in
+ *     the pipeline's record stage, rather than holding a reference.
+ *  •  Frames are addressed by slot_map handles, so a handle kept past the
+ *     frame's life is detected rather than reading the buffer's next
+ *     frame.
+ *  •  Copying and dropping a reference is one atomic add; only the last
+ *     drop takes the lock, to retire the handle before recycle(buffer)
+ *     hands the buffer back to the receiver.
+ *  •  A consumer that holds frames holds acquisition buffers: keep a few,
+ *     briefly, or the receiver runs out and drops frames.
+ *=======================================================================================*/
+class frame_pool {
+public:
+  // buffers: the size of the acquisition ring. recycle runs on whichever
+  // thread drops a frame's last reference.
+  frame_pool(uint32_t buffers, std::function<void(uint32_t buffer)> recycle)
+      : records_(std::make_unique<record[]>(buffers)), capacity_(buffers),
+        recycle_(std::move(recycle)) {}
+
+  ~frame_pool() { assert(handles_.empty() && "frame_ref outlived its pool"); }
+
+  frame_pool(const frame_pool &) = delete;
+  frame_pool &operator=(const frame_pool &) = delete;
+
+  // Acquisition thread: hands the filled buffer to the pool and returns
+  // its first reference. pixels must stay valid until recycle(buffer), and
+  // the buffer must not be published again before then.
+  frame_ref publish(uint32_t buffer, const frame_metadata &metadata,
+                    std::span<const uint16_t> pixels) {
+    std::lock_guard lock(mutex_);
+    const frame_handle handle = handles_.emplace(buffer);
+    // Every index in use holds a distinct buffer, and freed indices are
+    // reused first, so indices stay below the ring size.
+    assert(handle.index() < capacity_);
+    record &r = records_[handle.index()];
+    r.metadata = metadata;
+    r.pixels = pixels;
+    r.refs.store(1, std::memory_order_relaxed);
+    return frame_ref(this, handle);
+  }
+
+  // A new reference to the frame handle names, or nullopt if its buffer
+  // has already been returned.
+  std::optional<frame_ref> acquire(frame_handle handle) {
+    std::lock_guard lock(mutex_);
+    if (!handles_.get(handle))
+      return std::nullopt;
+    // A count of zero is a frame on its way back: its last holder is
+    // waiting for this lock to retire the handle.
+    auto    &refs = records_[handle.index()].refs;
+    uint32_t count = refs.load(std::memory_order_relaxed);
+    do {
+      if (count == 0)
+        return std::nullopt;
+    } while (!refs.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+    return frame_ref(this, handle);
+  }
+
+  uint32_t capacity() const noexcept { return capacity_; }
+
+  // Frames published and not yet returned.
+  size_t live() const {
+    std::lock_guard lock(mutex_);
+    return handles_.size();
+  }
+
+private:
+  friend class frame_ref;
+
+  struct record {
+    std::atomic<uint32_t>     refs{0};
+    frame_metadata            metadata;
+    std::span<const uint16_t> pixels;
+  };
+
+  // A holder already has a reference, so the frame cannot go meanwhile.
+  void retain(frame_handle handle) noexcept {
+    records_[handle.index()].refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release(frame_handle handle) noexcept {
+    // acq_rel: every holder's reads of the buffer happen before it is
+    // recycled and refilled.
+    if (records_[handle.index()].refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+      return;
+    std::optional<uint32_t> buffer;
+    {
+      std::lock_guard lock(mutex_);
+      buffer = handles_.remove(handle);
+    }
+    assert(buffer);
+    recycle_(*buffer);
+  }
+
+  std::unique_ptr<record[]>            records_; // By handle index.
+  uint32_t                             capacity_;
+  std::function<void(uint32_t buffer)> recycle_;
+
+  mutable std::mutex mutex_;
+  slot_map<uint32_t> handles_; // Live frames, to their buffer.
+};
+
+inline frame_ref::frame_ref(const frame_ref &other) noexcept
+    : pool_(other.pool_), handle_(other.handle_) {
+  if (pool_)
+    pool_->retain(handle_);
+}
+
+inline void frame_ref::reset() noexcept {
+  if (auto *pool = std::exchange(pool_, nullptr))
+    pool->release(handle_);
+}
+
+inline const frame_metadata &frame_ref::metadata() const noexcept {
+  return pool_->records_[handle_.index()].metadata;
+}
+
+inline std::span<const uint16_t> frame_ref::pixels() const noexcept {
+  return pool_->records_[handle_.index()].pixels;
+}
+
+} // namespace processing
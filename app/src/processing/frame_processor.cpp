@@ -0,0 +1,74 @@
+#include "frame_processor.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <jobs/bands.hpp>
+#include <profiling/profiler.hpp>
+
+namespace processing {
+
+frame_processor::frame_processor(uint32_t width, uint32_t height,
+                                 engine::jobs::job_system *jobs)
+    : width_(width), height_(height), jobs_(jobs), corrected_(pixel_count()),
+      lut_(std::make_unique<display_lut>()) {
+  build_display_lut(window_, *lut_);
+}
+
+void frame_processor::set_correction(std::span<const uint16_t> dark,
+                                     std::span<const float>    gain) {
+  assert(dark.empty() || dark.size() == pixel_count());
+  assert(gain.empty() || gain.size() == pixel_count());
+
+  dark_.assign(dark.begin(), dark.end());
+  gain_.assign(gain.begin(), gain.end());
+}
+
+void frame_processor::set_window(window_level wl) {
+  if (wl.low == window_.low && wl.high == window_.high)
+    return;
+
+  window_ = wl;
+  build_display_lut(window_, *lut_);
+}
+
+void frame_processor::process(std::span<const uint16_t> raw,
+                              std::span<uint32_t>       display_rgba) {
+  assert(raw.size() == pixel_count() && display_rgba.size() == pixel_count());
+
+  if (!jobs_) {
+    process_range(raw, display_rgba, 0, pixel_count());
+    return;
+  }
+
+  // Whole rows per band, so each worker's writes stay in its own lines.
+  jobs_->parallel_for(0, height_, engine::jobs::band_rows(width_),
+                      [&](size_t first_row, size_t end_row) {
+                        process_range(raw, display_rgba, first_row * width_,
+                                      end_row * width_);
+                      });
+}
+
+void frame_processor::process_range(std::span<const uint16_t> raw,
+                                    std::span<uint32_t> display_rgba,
+                                    size_t begin, size_t end) {
+  const size_t n = end - begin;
+  const auto   corrected = std::span(corrected_).subspan(begin, n);
+
+  {
+    ENGINE_PROFILE_SCOPE("correct");
+    if (dark_.empty() || gain_.empty())
+      std::ranges::copy(raw.subspan(begin, n), corrected.begin());
+    else
+      offset_gain_correct(raw.subspan(begin, n),
+                          std::span(dark_).subspan(begin, n),
+                          std::span(gain_).subspan(begin, n), corrected);
+  }
+
+  {
+    ENGINE_PROFILE_SCOPE("display map");
+    apply_display_lut(corrected, *lut_, display_rgba.subspan(begin, n));
+  }
+}
+
+} // namespace processing
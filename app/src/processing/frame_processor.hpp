@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+
+#include "correction.hpp"
+
+namespace processing {
+
+// CPU half of the display path: offset/gain correction followed by the
+// window/level mapping to RGBA8. With a job system, both stages run per
+// band of rows across its workers.
+class frame_processor {
+public:
+  frame_processor(uint32_t width, uint32_t height,
+                  engine::jobs::job_system *jobs = nullptr);
+
+  uint32_t width() const noexcept { return width_; }
+  uint32_t height() const noexcept { return height_; }
+  size_t   pixel_count() const noexcept { return size_t{width_} * height_; }
+
+  // Empty maps disable correction (frames pass through unchanged).
+  void set_correction(std::span<const uint16_t> dark,
+                      std::span<const float>    gain);
+
+  window_level window() const noexcept { return window_; }
+  void         set_window(window_level wl);
+
+  // Corrects raw into corrected() and maps it into display_rgba.
+  void process(std::span<const uint16_t> raw, std::span<uint32_t> display_rgba);
+
+  std::span<const uint16_t> corrected() const noexcept { return corrected_; }
+
+private:
+  void process_range(std::span<const uint16_t> raw,
+                     std::span<uint32_t> display_rgba, size_t begin,
+                     size_t end);
+
+  uint32_t                  width_;
+  uint32_t                  height_;
+  engine::jobs::job_system *jobs_;
+
+  std::vector<uint16_t> dark_;
+  std::vector<float>    gain_;
+  std::vector<uint16_t> corrected_;
+
+  window_level                 window_;
+  std::unique_ptr<display_lut> lut_;
+};
+
+} // namespace processing
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>  /* std::max */
+#include <atomic>     /* counters */
+#include <chrono>     /* stage timings */
+#include <cstdint>    /* uint32_t, uint64_t */
+#include <deque>      /* serial stage queues */
+#include <functional> /* stage functions */
+#include <memory>     /* std::unique_ptr for stages */
+#include <mutex>      /* stage and slot locks */
+#include <semaphore>  /* free slots */
+#include <string>     /* stage names */
+#include <utility>    /* std::forward */
+#include <vector>     /* stages, slots */
+
+#include <gev/latency_histogram.hpp>
+#include <jobs/job_system.hpp>
+
+namespace processing {
+
+enum class stage_mode : uint8_t {
+  parallel, // Any number of frames at once, in any order.
+  serial,   // One frame at a time, in the order frames reach the stage.
+  ordered,  // One frame at a time, in the order they were pushed.
+};
+
+struct stage_stats {
+  std::string name;
+  stage_mode  mode = stage_mode::parallel;
+  uint64_t    frames = 0;
+  // Time in the stage's function, and time waiting for a serial or
+  // ordered stage to take the frame. The maxima of a parallel stage can
+  // miss a sample recorded at the same moment as a longer one.
+  gev::latency_histogram::snapshot service;
+  gev::latency_histogram::snapshot wait;
+  // Service time over wall time since the first push: the average number
+  // of frames in the stage. A serial stage near 1 is the bottleneck; a
+  // parallel one near the worker count is.
+  double   occupancy = 0.0;
+  uint32_t queued = 0; // Waiting to enter, now.
+  uint32_t max_queued = 0;
+};
+
+struct pipeline_stats {
+  std::vector<stage_stats>         stages;
+  gev::latency_histogram::snapshot latency; // From push to the last stage.
+  uint64_t                         frames = 0;
+  uint32_t                         in_flight = 0;
+  double                           seconds = 0.0;
+};
+
+/*========================================================================================
+ *  pipeline<Frame>
+ *  -----------------------------------------------------------------------
+ *  •  Frames pass through a fixed list of stages, each run as jobs on a
+ *     engine::jobs::job_system, so several frames are in different stages
+ *     at once and parallel stages work on several frames at once.
+ *  •  At most in_flight frames are between push() and the end of the last
+ *     stage, which bounds every queue between stages; push() blocks and
+ *     try_push() fails while all are taken.
+ *  •  Frame objects are kept and reused from one push to the next, so
+ *     buffers in them are allocated once.
+ *  •  Stage functions must not throw. One that blocks (on a disk, say)
+ *     holds a worker while it does.
+ *=======================================================================================*/
+template <typename Frame> class pipeline {
+public:
+  pipeline(engine::jobs::job_system &jobs, uint32_t in_flight,
+           engine::jobs::priority priority = engine::jobs::priority::normal)
+      : group_(jobs), priority_(priority),
+        slots_(std::max(in_flight, 1u)), free_count_(std::max(in_flight, 1u)) {
+    free_.reserve(slots_.size());
+    for (uint32_t s = static_cast<uint32_t>(slots_.size()); s-- > 0;)
+      free_.push_back(s);
+  }
+
+  ~pipeline() { drain(); }
+
+  pipeline(const pipeline &) = delete;
+  pipeline &operator=(const pipeline &) = delete;
+
+  // Appends a stage running fn(Frame &). Only before the first push.
+  template <typename F> void add_stage(std::string name, stage_mode mode, F &&fn) {
+    auto s = std::make_unique<stage>();
+    s->name = std::move(name);
+    s->mode = mode;
+    s->fn = std::forward<F>(fn);
+    if (mode == stage_mode::ordered)
+      s->pending.assign(slots_.size(), no_slot);
+    stages_.push_back(std::move(s));
+  }
+
+  // Takes a free frame, lets fill(Frame &) set it up and sends it down the
+  // pipeline. Blocks while in_flight frames are in it, so call it from
+  // outside the job system: an acquisition or reader thread.
+  template <typename F> void push(F &&fill) {
+    free_count_.acquire();
+    start(std::forward<F>(fill));
+  }
+
+  // As push(), but returns false at once, without calling fill, if every
+  // frame is in flight.
+  template <typename F> bool try_push(F &&fill) {
+    if (!free_count_.try_acquire())
+      return false;
+    start(std::forward<F>(fill));
+    return true;
+  }
+
+  // Returns once every frame pushed so far has left the last stage.
+  void drain() { group_.wait(); }
+
+  [[nodiscard]] pipeline_stats stats() const {
+    pipeline_stats out;
+    const auto     first = first_push_ns_.load(std::memory_order_relaxed);
+    const auto     wall_ns = first ? now_ns() - first : 0;
+    out.seconds = wall_ns / 1e9;
+    out.frames = frames_.load(std::memory_order_relaxed);
+    out.latency = latency_.read();
+    out.in_flight = in_flight_.load(std::memory_order_relaxed);
+    for (const auto &s : stages_) {
+      stage_stats st;
+      st.name = s->name;
+      st.mode = s->mode;
+      st.service = s->service.read();
+      st.wait = s->wait.read();
+      st.frames = st.service.count;
+      st.occupancy = wall_ns ? static_cast<double>(st.service.total.count()) / wall_ns : 0.0;
+      st.queued = s->queued.load(std::memory_order_relaxed);
+      st.max_queued = s->max_queued.load(std::memory_order_relaxed);
+      out.stages.push_back(std::move(st));
+    }
+    return out;
+  }
+
+private:
+  static constexpr uint32_t no_slot = UINT32_MAX;
+
+  struct slot {
+    Frame    frame{};
+    uint64_t sequence = 0;
+    uint64_t pushed_ns = 0;
+    uint64_t arrived_ns = 0; // At the stage it is in or waiting for.
+  };
+
+  struct stage {
+    std::string                  name;
+    stage_mode                   mode = stage_mode::parallel;
+    std::function<void(Frame &)> fn;
+
+    // Serial and ordered stages: whether a frame holds the stage, and the
+    // frames waiting for it. Ordered stages keep those by sequence; only
+    // frames from next_sequence on can be waiting, and at most one per
+    // slot, so sequence % slots is a free index.
+    std::mutex            mutex;
+    bool                  busy = false;
+    std::deque<uint32_t>  queue;
+    std::vector<uint32_t> pending;
+    uint64_t              next_sequence = 0;
+
+    gev::latency_histogram service;
+    gev::latency_histogram wait;
+    std::atomic<uint32_t>  queued{0};
+    std::atomic<uint32_t>  max_queued{0};
+  };
+
+  static uint64_t now_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+  }
+
+  template <typename F> void start(F &&fill) {
+    uint32_t s;
+    {
+      std::lock_guard lock(free_mutex_);
+      s = free_.back();
+      free_.pop_back();
+    }
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+
+    slot &sl = slots_[s];
+    fill(sl.frame);
+    sl.sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+    sl.pushed_ns = now_ns();
+    uint64_t unset = 0;
+    first_push_ns_.compare_exchange_strong(unset, sl.pushed_ns, std::memory_order_relaxed);
+
+    group_.run([this, s] { advance(s, 0, false); }, {.priority = priority_});
+  }
+
+  // Runs slot s through the stages from k on. entered: s was handed
+  // stage k by the frame before it and already holds it.
+  void advance(uint32_t s, size_t k, bool entered) {
+    slot &sl = slots_[s];
+    for (; k < stages_.size(); ++k, entered = false) {
+      stage &st = *stages_[k];
+      if (!entered)
+        sl.arrived_ns = now_ns();
+
+      if (st.mode == stage_mode::parallel) {
+        execute(st, sl);
+        continue;
+      }
+
+      if (!entered) {
+        std::lock_guard lock(st.mutex);
+        const bool turn = st.mode == stage_mode::serial || sl.sequence == st.next_sequence;
+        if (st.busy || !turn) {
+          if (st.mode == stage_mode::serial)
+            st.queue.push_back(s);
+          else
+            st.pending[sl.sequence % slots_.size()] = s;
+          const uint32_t queued = st.queued.fetch_add(1, std::memory_order_relaxed) + 1;
+          if (queued > st.max_queued.load(std::memory_order_relaxed))
+            st.max_queued.store(queued, std::memory_order_relaxed);
+          // Whoever leaves the stage next picks this frame up.
+          return;
+        }
+        st.busy = true;
+      }
+
+      execute(st, sl);
+
+      uint32_t next = no_slot;
+      {
+        std::lock_guard lock(st.mutex);
+        if (st.mode == stage_mode::serial) {
+          if (!st.queue.empty()) {
+            next = st.queue.front();
+            st.queue.pop_front();
+          }
+        } else {
+          ++st.next_sequence;
+          auto &waiting = st.pending[st.next_sequence % slots_.size()];
+          std::swap(next, waiting);
+        }
+        if (next == no_slot)
+          st.busy = false;
+      }
+      if (next != no_slot) {
+        st.queued.fetch_sub(1, std::memory_order_relaxed);
+        // The stage passes straight to the waiting frame, on another job,
+        // while this one goes on to the next stage.
+        group_.run([this, next, k] { advance(next, k, true); }, {.priority = priority_});
+      }
+    }
+    finish(s);
+  }
+
+  void execute(stage &st, slot &sl) {
+    const uint64_t begun = now_ns();
+    st.wait.record(std::chrono::nanoseconds(begun - sl.arrived_ns));
+    st.fn(sl.frame);
+    st.service.record(std::chrono::nanoseconds(now_ns() - begun));
+  }
+
+  void finish(uint32_t s) {
+    latency_.record(std::chrono::nanoseconds(now_ns() - slots_[s].pushed_ns));
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    {
+      std::lock_guard lock(free_mutex_);
+      free_.push_back(s);
+    }
+    free_count_.release();
+  }
+
+  engine::jobs::task_group group_;
+  engine::jobs::priority   priority_;
+
+  std::vector<std::unique_ptr<stage>> stages_;
+
+  std::vector<slot>         slots_;
+  std::mutex                free_mutex_;
+  std::vector<uint32_t>     free_;
+  std::counting_semaphore<> free_count_;
+  std::atomic<uint64_t>     next_sequence_{0};
+
+  gev::latency_histogram latency_;
+  std::atomic<uint64_t>  frames_{0};
+  std::atomic<uint32_t>  in_flight_{0};
+  std::atomic<uint64_t>  first_push_ns_{0};
+};
+
+} // namespace processing
@@ -0,0 +1,69 @@
+#include "synthetic_source.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace processing {
+
+namespace {
+
+uint64_t xorshift(uint64_t &state) noexcept {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+} // namespace
+
+synthetic_source::synthetic_source(uint32_t width, uint32_t height,
+                                   uint64_t seed)
+    : width_(width), height_(height), rng_state_(seed | 1),
+      dark_(pixel_count()), gain_(pixel_count()) {
+  const float cx = width_ * 0.5f;
+  const float cy = height_ * 0.5f;
+  const float r2 = cx * cx + cy * cy;
+
+  for (uint32_t y = 0; y < height_; ++y) {
+    for (uint32_t x = 0; x < width_; ++x) {
+      const size_t i = size_t{y} * width_ + x;
+
+      // Column fixed-pattern offset plus per-pixel jitter.
+      dark_[i] = static_cast<uint16_t>(800 + (x % 32) * 4 +
+                                       (xorshift(rng_state_) & 0x3F));
+
+      // Radial fall-off of detector response; gain is its inverse.
+      const float dx = x - cx, dy = y - cy;
+      const float response = 1.0f - 0.35f * (dx * dx + dy * dy) / r2;
+      gain_[i] = 1.0f / response;
+    }
+  }
+}
+
+void synthetic_source::fill(uint64_t frame_index, std::span<uint16_t> out) {
+  assert(out.size() == pixel_count());
+
+  // A disc phantom orbiting the centre, one revolution every 240 frames.
+  const float angle = static_cast<float>(frame_index % 240) / 240.0f * 6.2832f;
+  const float px = width_ * (0.5f + 0.25f * std::cos(angle));
+  const float py = height_ * (0.5f + 0.25f * std::sin(angle));
+  const float radius2 =
+      std::pow(static_cast<float>(std::min(width_, height_)) * 0.12f, 2.0f);
+
+  for (uint32_t y = 0; y < height_; ++y) {
+    for (uint32_t x = 0; x < width_; ++x) {
+      const size_t i = size_t{y} * width_ + x;
+
+      const float dx = x - px, dy = y - py;
+      const float signal = (dx * dx + dy * dy < radius2) ? 9000.0f : 30000.0f;
+      const float noise =
+          static_cast<float>(xorshift(rng_state_) & 0xFF) - 128.0f;
+
+      const float raw = signal / gain_[i] + dark_[i] + noise;
+      out[i] = static_cast<uint16_t>(std::clamp(raw, 0.0f, 65535.0f));
+    }
+  }
+}
+
+} // namespace processing
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace processing {
+
+// Generates 16-bit detector-like frames: a moving phantom under a vignetted
+// gain pattern, plus a fixed-pattern dark offset and noise. The matching
+// dark and gain maps are exposed so correction can undo them.
+class synthetic_source {
+public:
+  synthetic_source(uint32_t width, uint32_t height, uint64_t seed = 1);
+
+  uint32_t width() const noexcept { return width_; }
+  uint32_t height() const noexcept { return height_; }
+  size_t   pixel_count() const noexcept { return size_t{width_} * height_; }
+
+  // Fills out (pixel_count() values) with frame number frame_index.
+  void fill(uint64_t frame_index, std::span<uint16_t> out);
+
+  std::span<const uint16_t> dark_map() const noexcept { return dark_; }
+  std::span<const float>    gain_map() const noexcept { return gain_; }
+
+private:
+  uint32_t              width_;
+  uint32_t              height_;
+  uint64_t              rng_state_;
+  std::vector<uint16_t> dark_;
+  std::vector<float>    gain_;
+};
+
+} // namespace processing
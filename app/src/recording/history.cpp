@@ -0,0 +1,400 @@
+#include "history.hpp"
+
+#include "tile_codec.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <profiling/profiler.hpp>
+#include <spdlog/spdlog.h>
+
+namespace recording {
+
+namespace {
+
+constexpr uint64_t align_up(uint64_t n) noexcept {
+  return (n + block_size - 1) / block_size * block_size;
+}
+
+std::error_code last_error() noexcept {
+  return {errno, std::system_category()};
+}
+
+// Pre-faulted and page-aligned, like the recorder's staging ring: nothing
+// faults on the acquisition thread, and O_DIRECT writes straight from it.
+std::byte *map_ring(size_t bytes) noexcept {
+  void *ring = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  return ring == MAP_FAILED ? nullptr : static_cast<std::byte *>(ring);
+}
+
+// At most this much is written at once, so a save hands memory back to
+// the ring as it goes rather than at the end.
+constexpr size_t max_write_bytes = size_t{16} << 20;
+
+} // namespace
+
+std::expected<std::unique_ptr<history>, std::error_code>
+history::create(history_options options) {
+  if (options.max_bytes < block_size || options.max_seconds <= 0 ||
+      (options.compress &&
+       (options.intake_bytes < block_size || options.intake_frames == 0)))
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+  std::unique_ptr<history> h(new history(std::move(options)));
+  if (auto ec = h->reserve())
+    return std::unexpected(ec);
+  return h;
+}
+
+history::history(history_options options) : options_(std::move(options)) {}
+
+history::~history() {
+  if (compressor_.joinable()) {
+    compressor_.request_stop();
+    intake_pushed_.fetch_add(1, std::memory_order_release);
+    intake_pushed_.notify_all();
+    compressor_.join();
+  }
+  writer_ = {}; // An unfinished save keeps what it wrote, header and index.
+  if (ring_)
+    ::munmap(ring_, ring_bytes_);
+  if (intake_)
+    ::munmap(intake_, intake_bytes_);
+}
+
+std::error_code history::reserve() {
+  ring_bytes_ = align_up(options_.max_bytes);
+  if (!(ring_ = map_ring(ring_bytes_))) {
+    ring_bytes_ = 0;
+    return last_error();
+  }
+
+  if (options_.compress) {
+    intake_bytes_ = align_up(options_.intake_bytes);
+    if (!(intake_ = map_ring(intake_bytes_))) {
+      intake_bytes_ = 0;
+      return last_error();
+    }
+    slots_ = std::make_unique<intake_slot[]>(options_.intake_frames);
+    codec_ = std::make_unique<tile_codec>();
+    compressor_ = std::jthread([this](std::stop_token stop) {
+      engine::profiling::profiler::get().set_thread_name("history compress");
+      compress_loop(stop);
+    });
+  }
+  return {};
+}
+
+bool history::push(const frame_info                &info,
+                   std::span<const std::byte> pixels) noexcept {
+  const auto received = clock::now();
+  if (pixels.empty() || pixels.size() > UINT32_MAX) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (!options_.compress) {
+    const auto size = static_cast<uint32_t>(pixels.size());
+    if (append(info, received, pixels, size, false))
+      return true;
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Into the intake, as the recorder stages frames; the compressor takes
+  // them in order and hands the memory back in order.
+  const uint64_t length = align_up(pixels.size());
+  uint64_t       begin = intake_ring_head_;
+  if (begin % intake_bytes_ + length > intake_bytes_)
+    begin += intake_bytes_ - begin % intake_bytes_; // Frames never wrap.
+
+  intake_slot &s = slots_[intake_head_ % options_.intake_frames];
+  if (length > intake_bytes_ || s.full.load(std::memory_order_acquire) ||
+      begin + length >
+          intake_released_.load(std::memory_order_acquire) + intake_bytes_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  std::memcpy(intake_ + begin % intake_bytes_, pixels.data(), pixels.size());
+  s.info = info;
+  s.received = received;
+  s.ring_begin = begin;
+  s.ring_end = begin + length;
+  s.bytes = static_cast<uint32_t>(pixels.size());
+  s.full.store(true, std::memory_order_release);
+
+  intake_ring_head_ = begin + length;
+  ++intake_head_;
+  intake_pushed_.fetch_add(1, std::memory_order_release);
+  intake_pushed_.notify_one();
+  return true;
+}
+
+bool history::append(const frame_info &info, clock::time_point received,
+                     std::span<const std::byte> data, uint32_t raw_bytes,
+                     bool compressed) {
+  const uint64_t length = align_up(data.size());
+  if (length > ring_bytes_)
+    return false;
+
+  // Room first, under the lock; the copy then runs without it, into space
+  // no one else reads until the entry is published below.
+  uint64_t begin = 0;
+  {
+    std::lock_guard lock(mutex_);
+    begin = head_;
+    if (begin % ring_bytes_ + length > ring_bytes_)
+      begin += ring_bytes_ - begin % ring_bytes_;
+    while (!entries_.empty() &&
+           begin + length > entries_.front().ring_begin + ring_bytes_) {
+      if (pinned(first_sequence_))
+        return false; // A save has yet to write it.
+      evict_front();
+    }
+    head_ = begin + length;
+  }
+
+  std::memcpy(ring_ + begin % ring_bytes_, data.data(), data.size());
+
+  std::lock_guard lock(mutex_);
+  entries_.push_back({
+      .info = info,
+      .received = received,
+      .ring_begin = begin,
+      .ring_end = begin + length,
+      .bytes = static_cast<uint32_t>(data.size()),
+      .raw_bytes = raw_bytes,
+      .compressed = compressed,
+  });
+  held_bytes_ += data.size();
+  held_raw_bytes_ += raw_bytes;
+
+  const auto oldest = received - std::chrono::duration_cast<clock::duration>(
+                                     std::chrono::duration<double>(
+                                         options_.max_seconds));
+  while (entries_.size() > 1 && entries_.front().received < oldest &&
+         !pinned(first_sequence_))
+    evict_front();
+  return true;
+}
+
+void history::evict_front() {
+  held_bytes_ -= entries_.front().bytes;
+  held_raw_bytes_ -= entries_.front().raw_bytes;
+  entries_.pop_front();
+  ++first_sequence_;
+}
+
+void history::compress_loop(std::stop_token stop) {
+  uint64_t tail = 0;
+  for (;;) {
+    const uint64_t seen = intake_pushed_.load(std::memory_order_acquire);
+    intake_slot   &s = slots_[tail % options_.intake_frames];
+    if (!s.full.load(std::memory_order_acquire)) {
+      if (stop.stop_requested())
+        return;
+      intake_pushed_.wait(seen, std::memory_order_acquire);
+      continue;
+    }
+
+    const std::byte *pixels = intake_ + s.ring_begin % intake_bytes_;
+    const uint32_t   width = s.info.width;
+    const uint32_t   height = s.info.height;
+    std::span<const std::byte> stored(pixels, s.bytes);
+    bool                       compressed = false;
+    if (size_t{width} * height * 2 == s.bytes) {
+      ENGINE_PROFILE_SCOPE("history compress");
+      encoded_.resize(codec_->max_encoded_size(width, height));
+      const size_t size = codec_->encode(
+          {reinterpret_cast<const uint16_t *>(pixels), size_t{width} * height},
+          width, height, encoded_,
+          jobs_for{options_.jobs, engine::jobs::priority::high});
+      if (size < s.bytes) {
+        stored = std::span<const std::byte>(encoded_).first(size);
+        compressed = true;
+      }
+    }
+    if (!append(s.info, s.received, stored, s.bytes, compressed))
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+
+    intake_released_.store(s.ring_end, std::memory_order_release);
+    s.full.store(false, std::memory_order_release);
+    ++tail;
+  }
+}
+
+std::error_code history::save(const std::filesystem::path &path, bool direct) {
+  std::lock_guard lock(mutex_);
+  if (save_stats_.saving)
+    return std::make_error_code(std::errc::device_or_resource_busy);
+  if (entries_.empty())
+    return std::make_error_code(std::errc::no_message_available);
+
+  save_next_ = first_sequence_;
+  save_end_ = first_sequence_ + entries_.size();
+  save_stats_.saving = true;
+  save_stats_.save_frames = entries_.size();
+  save_stats_.saved_frames = 0;
+  save_stats_.save_writes = 0;
+  save_stats_.save_path = path;
+  save_stats_.save_error.clear();
+
+  // The last save has finished, so this join does not wait.
+  writer_ = std::jthread([this, path, direct](std::stop_token stop) {
+    engine::profiling::profiler::get().set_thread_name("history save");
+    write(path, direct, stop);
+  });
+  return {};
+}
+
+void history::write(std::filesystem::path path, bool direct,
+                    std::stop_token stop) {
+  std::error_code ec;
+  std::vector<index_entry> index;
+  uint64_t                 offset = block_size;
+
+  clock::time_point first_received;
+  int64_t           started_ns = 0;
+  {
+    std::lock_guard lock(mutex_);
+    first_received = entries_[save_next_ - first_sequence_].received;
+    // When the first frame arrived, on the system clock.
+    started_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch() -
+                     (clock::now() - first_received))
+                     .count();
+  }
+
+  std::unique_ptr<std::byte, decltype(&std::free)> header_block(
+      static_cast<std::byte *>(std::aligned_alloc(block_size, block_size)),
+      &std::free);
+  int fd = -1;
+  if (!header_block) {
+    ec = std::make_error_code(std::errc::not_enough_memory);
+  } else {
+    const file_header header = make_file_header(0, 0, started_ns);
+    std::memset(header_block.get(), 0, block_size);
+    std::memcpy(header_block.get(), &header, sizeof(header));
+    if (auto opened = create_data_file(path, header_block.get(), direct))
+      fd = *opened;
+    else
+      ec = opened.error();
+  }
+
+  while (!ec && !stop.stop_requested()) {
+    // The next run of frames that lie back to back in the ring goes out
+    // in one write; they lie back to back in the file too.
+    uint64_t ring_begin = 0;
+    uint64_t ring_end = 0;
+    size_t   count = 0;
+    {
+      std::lock_guard lock(mutex_);
+      for (uint64_t s = save_next_; s < save_end_; ++s) {
+        const entry &e = entries_[s - first_sequence_];
+        if (count &&
+            (e.ring_begin != ring_end || e.ring_begin % ring_bytes_ == 0 ||
+             e.ring_end - ring_begin > max_write_bytes))
+          break;
+        if (!count)
+          ring_begin = e.ring_begin;
+        ring_end = e.ring_end;
+        index.push_back({
+            .frame_id = e.info.frame_id,
+            .device_timestamp = e.info.device_timestamp,
+            .received_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               e.received - first_received)
+                               .count(),
+            .offset = offset + (e.ring_begin - ring_begin),
+            .bytes = e.bytes,
+            .width = e.info.width,
+            .height = e.info.height,
+            .pixel_format = e.info.pixel_format,
+            .flags = (e.info.complete ? 0u : uint32_t{frame_incomplete}) |
+                     (e.compressed ? uint32_t{frame_compressed} : 0u),
+            .reserved = 0,
+        });
+        ++count;
+      }
+    }
+    if (!count)
+      break;
+
+    // The frames are pinned, so the ring under them stays put unlocked.
+    const std::byte *data = ring_ + ring_begin % ring_bytes_;
+    const uint64_t   length = ring_end - ring_begin;
+    for (uint64_t written = 0; written < length;) {
+      const ssize_t n = ::pwrite(fd, data + written, length - written,
+                                 static_cast<off_t>(offset + written));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        ec = n < 0 ? last_error() : std::make_error_code(std::errc::io_error);
+        break;
+      }
+      written += static_cast<uint64_t>(n);
+    }
+    if (ec) {
+      index.resize(index.size() - count);
+      break;
+    }
+    offset += length;
+
+    std::lock_guard lock(mutex_);
+    save_next_ += count;
+    save_stats_.saved_frames += count;
+    ++save_stats_.save_writes;
+  }
+
+  if (fd >= 0) {
+    const file_header header = make_file_header(index.size(), offset, started_ns);
+    std::memcpy(header_block.get(), &header, sizeof(header));
+    if ((::pwrite(fd, header_block.get(), block_size, 0) !=
+             static_cast<ssize_t>(block_size) ||
+         ::fdatasync(fd) != 0) &&
+        !ec)
+      ec = last_error();
+    ::close(fd);
+    if (auto index_ec = write_index(path, index); index_ec && !ec)
+      ec = index_ec;
+  }
+
+  if (ec)
+    spdlog::error("Saving history to {} failed: {}", path.string(), ec.message());
+  else
+    spdlog::info("Saved {} frames of history to {}", index.size(), path.string());
+
+  std::lock_guard lock(mutex_);
+  save_next_ = save_end_ = 0; // Nothing pinned any more.
+  save_stats_.saving = false;
+  save_stats_.save_error = ec;
+}
+
+history_stats history::stats() const {
+  history_stats s;
+  {
+    std::lock_guard lock(mutex_);
+    s = save_stats_;
+    s.frames = entries_.size();
+    s.bytes = held_bytes_;
+    s.raw_bytes = held_raw_bytes_;
+    if (!entries_.empty())
+      s.seconds = std::chrono::duration<double>(entries_.back().received -
+                                                entries_.front().received)
+                      .count();
+  }
+  s.memory_bytes = ring_bytes_ + intake_bytes_;
+  s.dropped = dropped_.load(std::memory_order_relaxed);
+  if (s.bytes > 0)
+    s.compression_ratio = static_cast<double>(s.raw_bytes) / s.bytes;
+  return s;
+}
+
+} // namespace recording
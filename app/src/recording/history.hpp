@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "recording/recorder.hpp"
+
+namespace engine::jobs {
+class job_system;
+}
+
+namespace recording {
+
+class tile_codec;
+
+struct history_options {
+  // What is kept: the newest frames within both bounds. The memory is
+  // reserved up front and never grows.
+  size_t max_bytes = size_t{1} << 30;
+  double max_seconds = 10.0;
+  // Keep frames compressed so that the same memory covers more time.
+  // Compression runs across jobs at high priority (null: on one thread of
+  // its own), off the acquisition thread; frames wait for it in
+  // intake_bytes of their own.
+  bool                      compress = false;
+  engine::jobs::job_system *jobs = nullptr;
+  size_t                    intake_bytes = size_t{256} << 20;
+  uint32_t                  intake_frames = 64;
+};
+
+struct history_stats {
+  uint64_t frames = 0;       // Held now.
+  uint64_t bytes = 0;        // Held now, as stored.
+  uint64_t raw_bytes = 0;    // Pixel bytes of the frames held.
+  double   seconds = 0.0;    // From the oldest frame held to the newest.
+  uint64_t memory_bytes = 0; // Reserved, intake included; never changes.
+  // Frames not kept: the intake was full, or a save still needed the
+  // memory they would have gone in.
+  uint64_t dropped = 0;
+  double   compression_ratio = 1.0;
+
+  // The save in progress, or the last one.
+  bool                  saving = false;
+  uint64_t              save_frames = 0;
+  uint64_t              saved_frames = 0;
+  uint64_t              save_writes = 0; // Frames back to back go as one.
+  std::filesystem::path save_path;
+  std::error_code       save_error;
+};
+
+/*========================================================================================
+ *  history
+ *  -----------------------------------------------------------------------
+ *  •  The last few seconds of a stream, kept in memory so that a trigger
+ *     can save what happened before it: frames go into a fixed ring, and
+ *     the oldest leave once the ring is full or they are older than the
+ *     time bound.
+ *  •  save() writes what is held at that moment to a recording on a
+ *     thread of its own; push() keeps going meanwhile. Frames waiting to
+ *     be written are not overwritten, so a save slower than the stream
+ *     costs new frames, not the ones being saved.
+ *  •  push() runs on the acquisition thread and never waits on the disk
+ *     or the compressor.
+ *=======================================================================================*/
+class history {
+public:
+  static std::expected<std::unique_ptr<history>, std::error_code>
+  create(history_options options);
+
+  ~history();
+
+  history(const history &) = delete;
+  history &operator=(const history &) = delete;
+
+  // Acquisition thread only. Returns false if the frame was not kept.
+  bool push(const frame_info &info, std::span<const std::byte> pixels) noexcept;
+
+  // Starts writing the frames held now to path. Fails with
+  // device_or_resource_busy while a save is still running.
+  std::error_code save(const std::filesystem::path &path, bool direct = true);
+
+  history_stats          stats() const;
+  const history_options &options() const noexcept { return options_; }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct entry {
+    frame_info        info;
+    clock::time_point received;
+    uint64_t          ring_begin = 0; // Positions in the ring, counted
+    uint64_t          ring_end = 0;   // from its start.
+    uint32_t          bytes = 0;      // Stored.
+    uint32_t          raw_bytes = 0;
+    bool              compressed = false;
+  };
+
+  // A frame waiting in the intake for the compressor.
+  struct intake_slot {
+    std::atomic<bool> full{false};
+    frame_info        info;
+    clock::time_point received;
+    uint64_t          ring_begin = 0;
+    uint64_t          ring_end = 0;
+    uint32_t          bytes = 0;
+  };
+
+  explicit history(history_options options);
+
+  std::error_code reserve();
+
+  // Adds a frame to the ring, evicting what it must; false if a save
+  // holds the memory it needs. Called by one thread: push(), or the
+  // compressor when compressing.
+  bool append(const frame_info &info, clock::time_point received,
+              std::span<const std::byte> data, uint32_t raw_bytes,
+              bool compressed);
+  void evict_front();
+  bool pinned(uint64_t sequence) const noexcept {
+    return sequence >= save_next_ && sequence < save_end_;
+  }
+
+  void compress_loop(std::stop_token stop);
+  void write(std::filesystem::path path, bool direct, std::stop_token stop);
+
+  history_options options_;
+
+  std::byte *ring_ = nullptr;
+  size_t     ring_bytes_ = 0;
+
+  mutable std::mutex mutex_;
+  std::deque<entry>  entries_; // Oldest first.
+  uint64_t           first_sequence_ = 0; // Of entries_.front().
+  uint64_t           head_ = 0;           // Where the next frame goes.
+  uint64_t           held_bytes_ = 0;
+  uint64_t           held_raw_bytes_ = 0;
+  // Frames [save_next_, save_end_) are still to be written by a save.
+  uint64_t           save_next_ = 0;
+  uint64_t           save_end_ = 0;
+  history_stats      save_stats_; // The save fields only.
+
+  std::atomic<uint64_t> dropped_{0};
+
+  // Compression: push() copies frames into the intake, the compressor
+  // thread encodes them across the job system into the ring.
+  std::byte                     *intake_ = nullptr;
+  size_t                         intake_bytes_ = 0;
+  std::unique_ptr<intake_slot[]> slots_;
+  uint64_t                       intake_head_ = 0;   // push() only.
+  uint64_t                       intake_ring_head_ = 0;
+  std::atomic<uint64_t>          intake_released_{0};
+  std::atomic<uint64_t>          intake_pushed_{0};
+  std::unique_ptr<tile_codec>    codec_;
+  std::vector<std::byte>         encoded_;
+
+  std::jthread compressor_;
+  std::jthread writer_; // Last: stop before the state they use.
+};
+
+} // namespace recording
@@ -0,0 +1,324 @@
+#include "playback.hpp"
+
+#include "tile_codec.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace recording {
+
+namespace {
+
+std::error_code last_error() noexcept {
+  return {errno, std::system_category()};
+}
+
+std::error_code invalid_file() noexcept {
+  return std::make_error_code(std::errc::illegal_byte_sequence);
+}
+
+// Set on imported frames that have to be decoded. Playback's own; never
+// written to a recording's index.
+constexpr uint32_t frame_converted = 1u << 31;
+
+// What imported frames are decoded to: 16-bit grayscale.
+constexpr uint32_t pixel_format_mono16 = 0x01100007; // PFNC Mono16.
+
+} // namespace
+
+std::expected<std::unique_ptr<playback>, std::error_code>
+playback::open(const std::filesystem::path &path) {
+  return open(path, options{});
+}
+
+std::expected<std::unique_ptr<playback>, std::error_code>
+playback::open(const std::filesystem::path &path, options options) {
+  std::unique_ptr<playback> p(new playback(path, options));
+  if (auto ec = p->map())
+    return std::unexpected(ec);
+  std::error_code ec;
+  if (options.raw)
+    ec = p->load_raw(*options.raw);
+  else if (p->size_ >= sizeof(file_magic) &&
+           std::memcmp(p->data_, file_magic, sizeof(file_magic)) == 0)
+    ec = p->load_index();
+  else
+    ec = p->load_tiff();
+  if (ec)
+    return std::unexpected(ec);
+  p->rate_ = p->recorded_rate_ > 0 ? p->recorded_rate_ : 30.0;
+  return p;
+}
+
+playback::playback(std::filesystem::path path, options options)
+    : path_(std::move(path)), options_(options) {}
+
+playback::~playback() {
+  if (data_)
+    ::munmap(const_cast<std::byte *>(data_), size_);
+}
+
+std::error_code playback::map() {
+  const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return last_error();
+
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    const auto ec = last_error();
+    ::close(fd);
+    return ec;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ == 0) {
+    ::close(fd);
+    return invalid_file();
+  }
+
+  void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  const auto ec = data == MAP_FAILED ? last_error() : std::error_code{};
+  ::close(fd); // The mapping keeps the file open.
+  if (ec)
+    return ec;
+  data_ = static_cast<const std::byte *>(data);
+
+  // Readahead around each fault is the kernel's guess; prefetch() says
+  // exactly which frames come next instead.
+  ::madvise(data, size_, MADV_RANDOM);
+  return {};
+}
+
+std::error_code playback::load_index() {
+  if (size_ < block_size)
+    return invalid_file();
+  file_header file;
+  std::memcpy(&file, data_, sizeof(file));
+  if (std::memcmp(file.magic, file_magic, sizeof(file_magic)) != 0 ||
+      file.version != file_version || file.header_bytes != block_size)
+    return invalid_file();
+
+  auto index_path = path_;
+  index_path += ".idx";
+  std::ifstream in(index_path, std::ios::binary);
+  if (!in)
+    return std::make_error_code(std::errc::no_such_file_or_directory);
+
+  index_header header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 ||
+      header.version != file_version || header.entry_bytes != sizeof(index_entry))
+    return invalid_file();
+
+  // Every frame is at least a block, which bounds what a corrupt count
+  // can make us allocate.
+  index_.resize(std::min<uint64_t>(header.frame_count, size_ / block_size));
+  in.read(reinterpret_cast<char *>(index_.data()),
+          static_cast<std::streamsize>(index_.size() * sizeof(index_entry)));
+  index_.resize(static_cast<size_t>(in.gcount()) / sizeof(index_entry));
+
+  // A recording cut short can index frames that never reached the file.
+  std::erase_if(index_, [&](const index_entry &e) {
+    return e.offset < block_size || e.offset % block_size != 0 ||
+           e.offset > size_ || e.bytes > size_ - e.offset;
+  });
+
+  if (index_.size() > 1) {
+    const double seconds =
+        (index_.back().received_ns - index_.front().received_ns) / 1e9;
+    if (seconds > 0)
+      recorded_rate_ = (index_.size() - 1) / seconds;
+  }
+  return {};
+}
+
+std::error_code playback::load_tiff() {
+  // Only the directories are read: a page or so each.
+  static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  auto pages = parse_tiff({data_, size_}, [this](uint64_t offset) {
+    if (offset < size_)
+      ::madvise(const_cast<std::byte *>(data_) + (offset - offset % page), page,
+                MADV_WILLNEED);
+  });
+  if (!pages)
+    return pages.error();
+  pages_ = std::move(*pages);
+  index_pages();
+  return {};
+}
+
+std::error_code playback::load_raw(const raw_layout &layout) {
+  const uint64_t pixel_bytes = uint64_t{layout.width} * layout.height * 2;
+  const uint64_t stride = layout.frame_bytes ? layout.frame_bytes : pixel_bytes;
+  if (pixel_bytes == 0 || stride < pixel_bytes || layout.header_bytes > size_)
+    return std::make_error_code(std::errc::invalid_argument);
+
+  const uint64_t count =
+      size_ - layout.header_bytes < pixel_bytes
+          ? 0
+          : (size_ - layout.header_bytes - pixel_bytes) / stride + 1;
+  pages_.resize(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    tiff_page &page = pages_[i];
+    page.width = layout.width;
+    page.height = layout.height;
+    page.big_endian = layout.big_endian;
+    page.rows_per_strip = layout.height;
+    page.strip_offsets = {layout.header_bytes + i * stride};
+    page.strip_bytes = {pixel_bytes};
+  }
+  index_pages();
+  return {};
+}
+
+void playback::index_pages() {
+  index_.resize(pages_.size());
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    const tiff_page &page = pages_[i];
+    index_entry     &e = index_[i];
+    e = {};
+    e.frame_id = i;
+    e.width = page.width;
+    e.height = page.height;
+    e.pixel_format = pixel_format_mono16;
+    if (page.direct()) {
+      e.offset = page.strip_offsets[0];
+      e.bytes = page.width * page.height * 2;
+      continue;
+    }
+    // The span of its strips, for prefetching.
+    uint64_t begin = UINT64_MAX, end = 0;
+    for (size_t s = 0; s < page.strip_offsets.size(); ++s) {
+      begin = std::min(begin, page.strip_offsets[s]);
+      end = std::max(end, page.strip_offsets[s] + page.strip_bytes[s]);
+    }
+    e.offset = begin;
+    e.bytes = static_cast<uint32_t>(std::min<uint64_t>(end - begin, UINT32_MAX));
+    e.flags = frame_converted;
+  }
+}
+
+std::span<const uint16_t> playback::frame(size_t frame) {
+  if (index_.empty())
+    return {};
+  frame = std::min(frame, index_.size() - 1);
+  prefetch(frame);
+  const index_entry &e = index_[frame];
+  if (e.flags & (frame_compressed | frame_converted)) {
+    // A paused frame is drawn again every update; decode it once.
+    if (frame == decoded_frame_)
+      return decoded_;
+    decoded_frame_ = SIZE_MAX;
+    const auto pixels = decode(frame);
+    if (!pixels.empty())
+      decoded_frame_ = frame;
+    return pixels;
+  }
+  return {reinterpret_cast<const uint16_t *>(data_ + e.offset), e.bytes / 2};
+}
+
+std::span<const uint16_t> playback::decode(size_t frame) {
+  const index_entry &e = index_[frame];
+  const auto started = clock::now();
+  decoded_.resize(size_t{e.width} * e.height);
+
+  if (e.flags & frame_converted) {
+    if (!decode_page({data_, size_}, pages_[frame], decoded_, options_.jobs,
+                     options_.priority))
+      return {};
+  } else {
+    const std::span<const std::byte> in(data_ + e.offset, e.bytes);
+    const auto header = tile_codec::header(in);
+    if (!header || header->width != e.width || header->height != e.height ||
+        !tile_codec::decode(in, decoded_,
+                            jobs_for{options_.jobs, options_.priority}))
+      return {};
+  }
+
+  decode_seconds_ += std::chrono::duration<double>(clock::now() - started).count();
+  decoded_bytes_ += decoded_.size() * sizeof(uint16_t);
+  return decoded_;
+}
+
+void playback::prefetch(size_t frame) {
+  // The frame itself is included: with MADV_RANDOM, touching it page by
+  // page would read it a page at a time.
+  size_t begin = index_[frame].offset;
+  size_t end = begin + index_[frame].bytes;
+  size_t budget = options_.prefetch_bytes;
+  if (rate_ >= 0) {
+    for (size_t f = frame + 1; f < index_.size() && budget >= index_[f].bytes; ++f) {
+      budget -= index_[f].bytes;
+      end = std::max<size_t>(end, index_[f].offset + index_[f].bytes);
+    }
+  } else {
+    for (size_t f = frame; f-- > 0 && budget >= index_[f].bytes;) {
+      budget -= index_[f].bytes;
+      begin = std::min<size_t>(begin, index_[f].offset);
+    }
+  }
+
+  // The whole window is asked for again as it moves, not just the frames
+  // new to it: the kernel may have skipped part of the last request under
+  // memory pressure, and pages it already holds cost only a lookup.
+  if (begin == prefetched_begin_ && end == prefetched_end_)
+    return; // Paused: the same frame drawn again.
+  prefetched_begin_ = begin;
+  prefetched_end_ = end;
+
+  static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  begin -= begin % page;
+  ::madvise(const_cast<std::byte *>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+void playback::seek(size_t frame) noexcept {
+  position_ = index_.empty() ? 0 : std::min(frame, index_.size() - 1);
+  fraction_ = 0.0;
+}
+
+void playback::set_playing(bool playing) noexcept {
+  playing_ = playing;
+  fraction_ = 0.0;
+  last_advance_ = clock::now();
+}
+
+void playback::set_rate(double frames_per_second) noexcept {
+  rate_ = frames_per_second;
+  fraction_ = 0.0;
+}
+
+size_t playback::advance(clock::time_point now) noexcept {
+  const auto elapsed = std::chrono::duration<double>(now - last_advance_).count();
+  last_advance_ = now;
+  if (!playing_ || index_.empty())
+    return position_;
+
+  int64_t step = 1;
+  if (rate_ != 0.0) {
+    fraction_ += elapsed * rate_;
+    step = static_cast<int64_t>(std::trunc(fraction_));
+    fraction_ -= static_cast<double>(step);
+  }
+
+  const auto count = static_cast<int64_t>(index_.size());
+  int64_t    next = static_cast<int64_t>(position_) + step;
+  if (next < 0 || next >= count) {
+    if (loop_) {
+      next = (next % count + count) % count;
+    } else {
+      next = std::clamp<int64_t>(next, 0, count - 1);
+      playing_ = false;
+    }
+  }
+  position_ = static_cast<size_t>(next);
+  return position_;
+}
+
+} // namespace recording
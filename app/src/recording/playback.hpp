@@ -0,0 +1,149 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include "recording/recorder.hpp"
+#include "recording/tiff_reader.hpp"
+
+namespace recording {
+
+// A headerless dump of 16-bit frames, which says nothing about itself.
+struct raw_layout {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint64_t header_bytes = 0; // Skipped at the start of the file.
+  uint64_t frame_bytes = 0;  // From one frame to the next; 0: width * height * 2.
+  bool     big_endian = false;
+};
+
+/*========================================================================================
+ *  playback
+ *  -----------------------------------------------------------------------
+ *  •  A recording mapped read-only into memory: a frame is a pointer into
+ *     the mapping, found by index, so a seek costs the same anywhere in
+ *     the file and nothing is copied or read up front. Pages come from
+ *     and go back to the page cache; the process holds no copy of its own.
+ *  •  The kernel's readahead is turned off for the mapping (it guesses
+ *     wrong for scrubbing) and replaced by madvise(MADV_WILLNEED) on the
+ *     frames just ahead of the playhead, in whichever direction it moves.
+ *  •  Compressed frames are decoded into a buffer of the playback's own,
+ *     their tiles spread over the job system the playback is given.
+ *  •  Imported datasets play the same way: a TIFF stack (or BigTIFF, or
+ *     an ImageJ stack past 4 GiB) has its directory chain walked at open
+ *     to index its pages, and a raw dump is indexed from its layout;
+ *     no pixel data is read up front. Pages stored as 16-bit
+ *     little-endian rows are used straight from the mapping; any other
+ *     is decoded when asked for, its strips or rows spread over the
+ *     same job system as compressed frames.
+ *  •  A playhead for review: play, pause, seek, a rate in frames/s, or
+ *     every frame as fast as they are drawn.
+ *=======================================================================================*/
+class playback {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct options {
+    // How far ahead of the playhead to ask the kernel to read.
+    size_t prefetch_bytes = size_t{128} << 20;
+    // Workers decoding compressed and converted frames, and the priority
+    // they do it at; null decodes on the thread asking for the frame.
+    engine::jobs::job_system *jobs = nullptr;
+    engine::jobs::priority    priority = engine::jobs::priority::normal;
+    // Opens the file as a raw dump of this layout rather than by what it
+    // starts with: a recording, or a TIFF file.
+    std::optional<raw_layout> raw{};
+  };
+
+  static std::expected<std::unique_ptr<playback>, std::error_code>
+  open(const std::filesystem::path &path);
+  static std::expected<std::unique_ptr<playback>, std::error_code>
+  open(const std::filesystem::path &path, options options);
+
+  ~playback();
+
+  playback(const playback &) = delete;
+  playback &operator=(const playback &) = delete;
+
+  const std::filesystem::path &path() const noexcept { return path_; }
+  // The layout the file was opened as, if it was opened as a raw dump.
+  const std::optional<raw_layout> &layout() const noexcept { return options_.raw; }
+  size_t frame_count() const noexcept { return index_.size(); }
+  const index_entry &entry(size_t frame) const noexcept { return index_[frame]; }
+  // Recorded frames per second, from the receive timestamps.
+  double recorded_rate() const noexcept { return recorded_rate_; }
+
+  // The pixels of a frame, straight from the mapping, or decoded if it
+  // was compressed or imported in another form (valid until the next
+  // call); prefetches beyond it in the direction of play. Empty if a
+  // frame fails to decode.
+  std::span<const uint16_t> frame(size_t frame);
+
+  // Pixel bytes decoded per second, over every frame decoded so far.
+  double decode_gigabytes_per_second() const noexcept {
+    return decode_seconds_ > 0 ? decoded_bytes_ / 1e9 / decode_seconds_ : 0.0;
+  }
+
+  size_t position() const noexcept { return position_; }
+  void   seek(size_t frame) noexcept;
+
+  bool playing() const noexcept { return playing_; }
+  void set_playing(bool playing) noexcept;
+
+  // Frames per second, negative to play backwards; 0 steps one frame per
+  // advance(), for playing every frame as fast as they can be shown.
+  double rate() const noexcept { return rate_; }
+  void   set_rate(double frames_per_second) noexcept;
+
+  bool loop() const noexcept { return loop_; }
+  void set_loop(bool loop) noexcept { loop_ = loop; }
+
+  // Moves the playhead for the time since the last call and returns it.
+  size_t advance(clock::time_point now = clock::now()) noexcept;
+
+private:
+  playback(std::filesystem::path path, options options);
+
+  std::error_code map();
+  std::error_code load_index();
+  std::error_code load_tiff();
+  std::error_code load_raw(const raw_layout &layout);
+  void            index_pages();
+  void            prefetch(size_t frame);
+  std::span<const uint16_t> decode(size_t frame);
+
+  std::filesystem::path    path_;
+  options                  options_;
+  const std::byte         *data_ = nullptr;
+  size_t                   size_ = 0;
+  std::vector<index_entry> index_;
+  std::vector<tiff_page>   pages_; // Per frame, for imported files only.
+  double                   recorded_rate_ = 0.0;
+
+  size_t            position_ = 0;
+  double            fraction_ = 0.0; // Of a frame, carried between advances.
+  bool              playing_ = false;
+  bool              loop_ = true;
+  double            rate_ = 0.0;
+  clock::time_point last_advance_{};
+
+  // The range last handed to MADV_WILLNEED, so that a paused frame drawn
+  // again does not ask again.
+  size_t prefetched_begin_ = 0;
+  size_t prefetched_end_ = 0;
+
+  std::vector<uint16_t> decoded_;
+  size_t                decoded_frame_ = SIZE_MAX;
+  double                decode_seconds_ = 0.0;
+  uint64_t              decoded_bytes_ = 0;
+};
+
+} // namespace recording
@@ -0,0 +1,706 @@
+#include "recorder.hpp"
+
+#include "tile_codec.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <profiling/profiler.hpp>
+#include <spdlog/spdlog.h>
+
+namespace recording {
+
+namespace {
+
+constexpr uint64_t align_up(uint64_t n) noexcept {
+  return (n + block_size - 1) / block_size * block_size;
+}
+
+std::error_code last_error() noexcept {
+  return {errno, std::system_category()};
+}
+
+} // namespace
+
+file_header make_file_header(uint64_t frame_count, uint64_t data_bytes,
+                             int64_t started_ns) noexcept {
+  file_header header{};
+  std::memcpy(header.magic, file_magic, sizeof(file_magic));
+  header.version = file_version;
+  header.header_bytes = block_size;
+  header.frame_count = frame_count;
+  header.data_bytes = data_bytes;
+  header.started_ns = started_ns;
+  return header;
+}
+
+std::expected<int, std::error_code>
+create_data_file(const std::filesystem::path &path, const std::byte *header_block,
+                 bool &direct) {
+  // The header block doubles as the O_DIRECT probe: some file systems
+  // accept the flag at open() and only refuse the first write.
+  for (bool try_direct : {direct, false}) {
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC |
+                      (try_direct ? O_DIRECT : 0);
+    const int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0 && !(try_direct && errno == EINVAL))
+      return std::unexpected(last_error());
+    if (fd >= 0 && ::pwrite(fd, header_block, block_size, 0) ==
+                       static_cast<ssize_t>(block_size)) {
+      direct = try_direct;
+      return fd;
+    }
+    const auto ec = last_error();
+    if (fd >= 0)
+      ::close(fd);
+    if (!try_direct || ec != std::errc::invalid_argument)
+      return std::unexpected(ec);
+  }
+  return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+}
+
+std::error_code write_index(const std::filesystem::path    &data_path,
+                            std::span<const index_entry> entries) {
+  auto index_path = data_path;
+  index_path += ".idx";
+  std::ofstream index(index_path, std::ios::binary | std::ios::trunc);
+  index_header header{};
+  std::memcpy(header.magic, index_magic, sizeof(index_magic));
+  header.version = file_version;
+  header.entry_bytes = sizeof(index_entry);
+  header.frame_count = entries.size();
+  index.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  index.write(reinterpret_cast<const char *>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(index_entry)));
+  return index ? std::error_code{} : std::make_error_code(std::errc::io_error);
+}
+
+/*========================================================================================
+ *  io_ring
+ *  -----------------------------------------------------------------------
+ *  •  The part of io_uring the recorder needs, on the raw system calls:
+ *     queue writes, submit them, reap their completions. Never holds more
+ *     than `entries` writes in flight, so the submission queue cannot
+ *     overflow and the completion queue (twice its size) cannot either.
+ *  •  Used from the one writer thread only.
+ *=======================================================================================*/
+class io_ring {
+public:
+  static std::expected<std::unique_ptr<io_ring>, std::error_code>
+  create(uint32_t entries) {
+    std::unique_ptr<io_ring> ring(new io_ring);
+
+    io_uring_params params{};
+    ring->fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (ring->fd_ < 0)
+      return std::unexpected(last_error());
+
+    ring->sq_bytes_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_bytes_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+      ring->sq_bytes_ = ring->cq_bytes_ = std::max(ring->sq_bytes_, ring->cq_bytes_);
+
+    ring->sq_ = ::mmap(nullptr, ring->sq_bytes_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_SQ_RING);
+    if (ring->sq_ == MAP_FAILED)
+      return std::unexpected(last_error());
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      ring->cq_ = ring->sq_;
+    } else {
+      ring->cq_ = ::mmap(nullptr, ring->cq_bytes_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_CQ_RING);
+      if (ring->cq_ == MAP_FAILED)
+        return std::unexpected(last_error());
+    }
+
+    ring->sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, ring->sqes_bytes_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+      return std::unexpected(last_error());
+    ring->sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    auto *sq = static_cast<std::byte *>(ring->sq_);
+    auto *cq = static_cast<std::byte *>(ring->cq_);
+    ring->sq_tail_ = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+    ring->sq_mask_ = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+    ring->sq_array_ = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+    ring->cq_head_ = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+    ring->cq_tail_ = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+    ring->cq_mask_ = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+    ring->cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return ring;
+  }
+
+  ~io_ring() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_bytes_);
+    if (cq_ && cq_ != MAP_FAILED && cq_ != sq_)
+      ::munmap(cq_, cq_bytes_);
+    if (sq_ && sq_ != MAP_FAILED)
+      ::munmap(sq_, sq_bytes_);
+    if (fd_ >= 0)
+      ::close(fd_); // Waits for anything still in flight.
+  }
+
+  io_ring(const io_ring &) = delete;
+  io_ring &operator=(const io_ring &) = delete;
+
+  // Queues a write; the next enter() submits it.
+  void write(int fd, const void *data, uint32_t length, uint64_t offset,
+             uint64_t user_data) noexcept {
+    const uint32_t tail = *sq_tail_;
+    const uint32_t index = tail & sq_mask_;
+    io_uring_sqe  &sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<uint64_t>(data);
+    sqe.len = length;
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++pending_;
+  }
+
+  // Submits the queued writes and waits for min_complete completions.
+  std::error_code enter(uint32_t min_complete) noexcept {
+    for (;;) {
+      const long submitted =
+          ::syscall(__NR_io_uring_enter, fd_, pending_, min_complete,
+                    min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+      if (submitted >= 0) {
+        pending_ -= static_cast<uint32_t>(submitted);
+        if (pending_ == 0)
+          return {};
+        continue; // Rare: the kernel took only part of the queue.
+      }
+      if (errno != EINTR)
+        return last_error();
+    }
+  }
+
+  // Calls f(user_data, result) for every completion reaped.
+  template <typename F> void for_each_completion(F &&f) {
+    uint32_t       head = *cq_head_;
+    const uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+      f(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+private:
+  io_ring() = default;
+
+  int           fd_ = -1;
+  void         *sq_ = nullptr;
+  void         *cq_ = nullptr;
+  size_t        sq_bytes_ = 0;
+  size_t        cq_bytes_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t        sqes_bytes_ = 0;
+
+  uint32_t     *sq_tail_ = nullptr;
+  uint32_t      sq_mask_ = 0;
+  uint32_t     *sq_array_ = nullptr;
+  uint32_t     *cq_head_ = nullptr;
+  uint32_t     *cq_tail_ = nullptr;
+  uint32_t      cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  uint32_t      pending_ = 0;
+};
+
+std::expected<std::unique_ptr<recorder>, std::error_code>
+recorder::create(recorder_options options) {
+  if (options.path.empty() || options.staging_frames == 0 ||
+      options.queue_depth == 0 || options.staging_bytes < block_size)
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+  std::unique_ptr<recorder> r(new recorder(std::move(options)));
+  if (auto ec = r->open())
+    return std::unexpected(ec);
+  if (auto ec = r->start_writers())
+    return std::unexpected(ec);
+  r->accepting_.store(true);
+  return r;
+}
+
+recorder::recorder(recorder_options options) : options_(std::move(options)) {}
+
+recorder::~recorder() {
+  (void)finish(); // Errors were logged as they happened.
+  if (staging_)
+    ::munmap(staging_, ring_bytes_);
+}
+
+std::error_code recorder::open() {
+  // Pre-faulted, so the acquisition thread never takes a page fault in
+  // push(); page-aligned, as O_DIRECT wants.
+  ring_bytes_ = align_up(options_.staging_bytes);
+  void *staging = ::mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (staging == MAP_FAILED) {
+    ring_bytes_ = 0;
+    return last_error();
+  }
+  staging_ = static_cast<std::byte *>(staging);
+  slots_ = std::make_unique<slot[]>(options_.staging_frames);
+
+  started_ = clock::now();
+  window_start_ = started_;
+  started_system_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+  const file_header header = make_file_header(0, 0, started_system_ns_);
+  std::memset(staging_, 0, block_size);
+  std::memcpy(staging_, &header, sizeof(header));
+
+  direct_ = options_.direct;
+  auto fd = create_data_file(options_.path, staging_, direct_);
+  if (!fd)
+    return fd.error();
+  fd_ = *fd;
+
+  if (options_.direct && !direct_)
+    spdlog::warn("{} does not support O_DIRECT; recording through the page "
+                 "cache", options_.path.parent_path().string());
+  if (auto ec = preallocate(block_size + options_.preallocate_bytes)) {
+    ::close(fd_);
+    fd_ = -1;
+    return ec;
+  }
+  return {};
+}
+
+std::error_code recorder::start_writers() {
+  if (options_.compress) {
+    codec_ = std::make_unique<tile_codec>();
+    compressor_ = std::jthread([this](std::stop_token stop) {
+      engine::profiling::profiler::get().set_thread_name("recorder compress");
+      compress_loop(stop);
+    });
+  }
+
+  if (!options_.force_thread_pool) {
+    if (auto ring = io_ring::create(options_.queue_depth)) {
+      ring_ = std::move(*ring);
+      backend_ = write_backend::io_uring;
+      writers_.emplace_back([this](std::stop_token stop) {
+        engine::profiling::profiler::get().set_thread_name("recorder");
+        uring_loop(stop);
+      });
+      return {};
+    } else {
+      spdlog::info("io_uring unavailable ({}); recording from a thread pool",
+                   ring.error().message());
+    }
+  }
+
+  backend_ = write_backend::thread_pool;
+  for (uint32_t i = 0; i < options_.queue_depth; ++i)
+    writers_.emplace_back([this, i](std::stop_token stop) {
+      engine::profiling::profiler::get().set_thread_name("recorder " +
+                                                         std::to_string(i));
+      pool_loop(stop);
+    });
+  return {};
+}
+
+bool recorder::push(const frame_info                &info,
+                    std::span<const std::byte> pixels) noexcept {
+  // finish() waits for pushing_ to drop to zero once accepting_ is clear;
+  // both are sequentially consistent so that one of the two sees the other.
+  pushing_.fetch_add(1);
+  if (!accepting_.load()) {
+    pushing_.fetch_sub(1);
+    return false;
+  }
+
+  const uint64_t length = align_up(pixels.size());
+  uint64_t       begin = ring_head_;
+  if (begin % ring_bytes_ + length > ring_bytes_)
+    begin += ring_bytes_ - begin % ring_bytes_; // Frames never wrap.
+
+  slot &s = slots_[head_ % options_.staging_frames];
+  for (;;) {
+    const uint64_t freed = freed_.load(std::memory_order_acquire);
+    if (pixels.empty() || length > ring_bytes_) {
+      // Can never fit: dropped even when waiting.
+    } else if (s.state.load(std::memory_order_acquire) == slot_free &&
+               begin + length <=
+                   ring_released_.load(std::memory_order_acquire) + ring_bytes_) {
+      break;
+    } else if (options_.wait_when_full && accepting_.load()) {
+      freed_.wait(freed, std::memory_order_acquire);
+      continue;
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    pushing_.fetch_sub(1);
+    return false;
+  }
+
+  std::memcpy(ring_at(begin), pixels.data(), pixels.size());
+  s.info = info;
+  s.bytes = static_cast<uint32_t>(pixels.size());
+  s.raw_bytes = s.bytes;
+  s.compressed = false;
+  s.ring_begin = begin;
+  s.ring_end = begin + length;
+  s.received = clock::now();
+  s.state.store(options_.compress ? slot_copied : slot_filled,
+                std::memory_order_release);
+
+  ring_head_ = begin + length;
+  ++head_;
+  const uint32_t staged = staged_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (staged > staged_peak_.load(std::memory_order_relaxed))
+    staged_peak_.store(staged, std::memory_order_relaxed);
+
+  wakeups_.fetch_add(1, std::memory_order_release);
+  wakeups_.notify_one();
+  pushing_.fetch_sub(1);
+  return true;
+}
+
+bool recorder::claim(uint32_t &index, uint64_t &offset, uint32_t &length) {
+  std::lock_guard lock(claim_mutex_);
+
+  index = static_cast<uint32_t>(tail_ % options_.staging_frames);
+  slot &s = slots_[index];
+  if (s.state.load(std::memory_order_acquire) != slot_filled)
+    return false;
+
+  length = static_cast<uint32_t>(align_up(s.bytes));
+  offset = next_offset_;
+  if (auto ec = preallocate(offset + length)) {
+    fail(ec);
+    return false;
+  }
+  next_offset_ += length;
+
+  index_.push_back({
+      .frame_id = s.info.frame_id,
+      .device_timestamp = s.info.device_timestamp,
+      .received_ns = s.info.received_ns >= 0
+                         ? s.info.received_ns
+                         : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               s.received - started_)
+                               .count(),
+      .offset = offset,
+      .bytes = s.bytes,
+      .width = s.info.width,
+      .height = s.info.height,
+      .pixel_format = s.info.pixel_format,
+      .flags = (s.info.complete ? 0u : uint32_t{frame_incomplete}) |
+               (s.compressed ? uint32_t{frame_compressed} : 0u),
+      .reserved = 0,
+  });
+
+  s.state.store(slot_writing, std::memory_order_relaxed);
+  s.submitted = clock::now();
+  ++tail_;
+  return true;
+}
+
+void recorder::complete(uint32_t index, int64_t result) {
+  slot      &s = slots_[index];
+  const auto now = clock::now();
+  const auto latency = now - s.submitted;
+
+  if (result < 0)
+    fail({static_cast<int>(-result), std::system_category()});
+  else if (static_cast<uint64_t>(result) < align_up(s.bytes))
+    fail(std::make_error_code(std::errc::io_error)); // Short write: disk full.
+  else {
+    std::lock_guard lock(stats_mutex_);
+    ++stats_.frames;
+    stats_.bytes += s.bytes;
+    stats_.raw_bytes += s.raw_bytes;
+    stats_.last_write_latency = latency;
+    stats_.worst_write_latency = std::max<std::chrono::nanoseconds>(
+        stats_.worst_write_latency, latency);
+
+    window_bytes_ += s.bytes;
+    if (const auto elapsed = now - window_start_;
+        elapsed >= std::chrono::seconds(1)) {
+      stats_.megabytes_per_second =
+          window_bytes_ / 1e6 / std::chrono::duration<double>(elapsed).count();
+      window_start_ = now;
+      window_bytes_ = 0;
+    }
+  }
+
+  // Staging memory is a ring, so it goes back in the order it was taken,
+  // whatever order the writes finished in.
+  std::lock_guard lock(claim_mutex_);
+  s.state.store(slot_done, std::memory_order_relaxed);
+  for (; released_ < tail_; ++released_) {
+    slot &r = slots_[released_ % options_.staging_frames];
+    if (r.state.load(std::memory_order_relaxed) != slot_done)
+      break;
+    ring_released_.store(r.ring_end, std::memory_order_release);
+    r.state.store(slot_free, std::memory_order_release);
+    staged_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  if (options_.wait_when_full) {
+    freed_.fetch_add(1, std::memory_order_release);
+    freed_.notify_all();
+  }
+}
+
+void recorder::fail(std::error_code error) {
+  accepting_.store(false);
+  freed_.fetch_add(1, std::memory_order_release);
+  freed_.notify_all();
+  std::lock_guard lock(stats_mutex_);
+  if (!error_) {
+    error_ = error;
+    spdlog::error("Recording to {} stopped: {}", options_.path.string(),
+                  error.message());
+  }
+}
+
+std::error_code recorder::preallocate(uint64_t end) {
+  if (end <= allocated_)
+    return {};
+
+  const uint64_t length =
+      std::max(end - allocated_, align_up(options_.preallocate_bytes));
+  if (::fallocate(fd_, 0, static_cast<off_t>(allocated_),
+                  static_cast<off_t>(length)) != 0) {
+    if (errno != EOPNOTSUPP)
+      return last_error();
+    // No preallocation on this file system; writes allocate as they go.
+    allocated_ = UINT64_MAX;
+    return {};
+  }
+  allocated_ += length;
+  return {};
+}
+
+void recorder::wait_for_frames(const std::stop_token     &stop,
+                               std::atomic<uint64_t> &counter, uint64_t seen) {
+  if (!stop.stop_requested())
+    counter.wait(seen, std::memory_order_acquire);
+}
+
+void recorder::compress_loop(std::stop_token stop) {
+  for (;;) {
+    const uint64_t seen = wakeups_.load(std::memory_order_acquire);
+
+    // Frames are compressed in the order they were pushed, which is the
+    // order claim() takes them in.
+    slot &s = slots_[compress_tail_ % options_.staging_frames];
+    if (s.state.load(std::memory_order_acquire) != slot_copied) {
+      if (stop.stop_requested())
+        return; // finish() stops pushes first, so nothing is left behind.
+      wait_for_frames(stop, wakeups_, seen);
+      continue;
+    }
+
+    compress(s);
+    s.state.store(slot_filled, std::memory_order_release);
+    ++compress_tail_;
+    compressed_.fetch_add(1, std::memory_order_release);
+    compressed_.notify_one();
+  }
+}
+
+void recorder::compress(slot &s) {
+  ENGINE_PROFILE_SCOPE("recorder compress");
+  const auto     started = clock::now();
+  const uint32_t width = s.info.width;
+  const uint32_t height = s.info.height;
+  if (size_t{width} * height * 2 != s.raw_bytes)
+    return; // Not 16-bit pixels; written as pushed.
+
+  encoded_.resize(codec_->max_encoded_size(width, height));
+  std::byte *staged = ring_at(s.ring_begin);
+  // Recording keeps pace with acquisition, ahead of anything interactive
+  // or in the background.
+  const size_t size = codec_->encode(
+      {reinterpret_cast<const uint16_t *>(staged), size_t{width} * height}, width,
+      height, encoded_, jobs_for{options_.jobs, engine::jobs::priority::high});
+
+  // The pixels are no longer needed: the encoding takes their place, and
+  // the write shrinks to it.
+  if (size < s.raw_bytes) {
+    std::memcpy(staged, encoded_.data(), size);
+    s.bytes = static_cast<uint32_t>(size);
+    s.compressed = true;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(clock::now() - started).count();
+  std::lock_guard lock(stats_mutex_);
+  encode_seconds_ += seconds;
+  encoded_bytes_ += s.raw_bytes;
+}
+
+void recorder::uring_loop(std::stop_token stop) {
+  uint32_t in_flight = 0;
+  for (;;) {
+    const uint64_t seen = ready().load(std::memory_order_acquire);
+
+    uint32_t index = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+    while (in_flight < options_.queue_depth && claim(index, offset, length)) {
+      ring_->write(fd_, ring_at(slots_[index].ring_begin), length, offset, index);
+      ++in_flight;
+    }
+
+    if (in_flight == 0) {
+      if (stop.stop_requested())
+        return;
+      wait_for_frames(stop, ready(), seen);
+      continue;
+    }
+
+    // Submit what was queued and sleep until a write finishes; frames that
+    // arrive meanwhile are picked up on the next pass.
+    if (auto ec = ring_->enter(1)) {
+      fail(ec);
+      return;
+    }
+    ring_->for_each_completion([&](uint64_t user_data, int32_t result) {
+      complete(static_cast<uint32_t>(user_data), result);
+      --in_flight;
+    });
+  }
+}
+
+void recorder::pool_loop(std::stop_token stop) {
+  for (;;) {
+    const uint64_t seen = ready().load(std::memory_order_acquire);
+
+    uint32_t index = 0;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+    if (!claim(index, offset, length)) {
+      if (stop.stop_requested())
+        return;
+      wait_for_frames(stop, ready(), seen);
+      continue;
+    }
+
+    const std::byte *data = ring_at(slots_[index].ring_begin);
+    int64_t          written = 0;
+    while (written >= 0 && written < int64_t{length}) {
+      const ssize_t n = ::pwrite(fd_, data + written, length - written,
+                                 static_cast<off_t>(offset + written));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        written = n < 0 ? -errno : written;
+        break;
+      }
+      written += n;
+    }
+    complete(index, written);
+  }
+}
+
+std::error_code recorder::finish() {
+  if (finished_)
+    return error();
+
+  accepting_.store(false);
+  freed_.fetch_add(1, std::memory_order_release);
+  freed_.notify_all(); // A push() waiting for space gives up.
+  while (pushing_.load() != 0)
+    std::this_thread::yield();
+
+  // The compressor and then the writers drain what is staged before they
+  // stop.
+  if (compressor_.joinable()) {
+    compressor_.request_stop();
+    wakeups_.fetch_add(1, std::memory_order_release);
+    wakeups_.notify_all();
+    compressor_.join();
+  }
+  for (auto &w : writers_)
+    w.request_stop();
+  ready().fetch_add(1, std::memory_order_release);
+  ready().notify_all();
+  writers_.clear();
+  ring_.reset();
+
+  const auto finished_at = clock::now();
+  {
+    std::lock_guard lock(stats_mutex_);
+    stats_.seconds = std::chrono::duration<double>(finished_at - started_).count();
+    finished_ = true;
+  }
+
+  if (fd_ < 0)
+    return error();
+
+  // Frames whose writes failed are left in the index; the header's frame
+  // count says how far the recording can be trusted.
+  const uint64_t frames = stats().frames;
+  std::error_code ec;
+  {
+    const file_header header =
+        make_file_header(frames, next_offset_, started_system_ns_);
+    std::memset(staging_, 0, block_size);
+    std::memcpy(staging_, &header, sizeof(header));
+    if (::pwrite(fd_, staging_, block_size, 0) !=
+            static_cast<ssize_t>(block_size) ||
+        ::ftruncate(fd_, static_cast<off_t>(next_offset_)) != 0 ||
+        ::fdatasync(fd_) != 0)
+      ec = last_error();
+  }
+  ::close(fd_);
+  fd_ = -1;
+
+  if (auto index_ec = write_index(options_.path, index_); index_ec && !ec)
+    ec = index_ec;
+
+  if (ec)
+    fail(ec);
+  return error();
+}
+
+recorder_stats recorder::stats() const {
+  recorder_stats s;
+  {
+    std::lock_guard lock(stats_mutex_);
+    s = stats_;
+    if (encode_seconds_ > 0)
+      s.encode_gigabytes_per_second = encoded_bytes_ / 1e9 / encode_seconds_;
+    if (!finished_)
+      s.seconds = std::chrono::duration<double>(clock::now() - started_).count();
+    // Nothing written for a while: the last window's rate no longer holds.
+    if (!finished_ && clock::now() - window_start_ > std::chrono::seconds(2))
+      s.megabytes_per_second = 0.0;
+  }
+  s.dropped = dropped_.load(std::memory_order_relaxed);
+  s.staged = staged_.load(std::memory_order_relaxed);
+  s.staged_peak = staged_peak_.load(std::memory_order_relaxed);
+  if (s.seconds > 0)
+    s.average_megabytes_per_second = s.bytes / 1e6 / s.seconds;
+  if (s.bytes > 0)
+    s.compression_ratio = static_cast<double>(s.raw_bytes) / s.bytes;
+  return s;
+}
+
+std::error_code recorder::error() const {
+  std::lock_guard lock(stats_mutex_);
+  return error_;
+}
+
+} // namespace recording
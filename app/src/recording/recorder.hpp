@@ -0,0 +1,301 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace engine::jobs {
+class job_system;
+}
+
+namespace recording {
+
+class io_ring;
+class tile_codec;
+
+// On-disk layout. The data file is a 4 KiB header followed by the frames,
+// each starting on a 4 KiB boundary and padded to the next one. The index
+// (<data file>.idx) is an index_header and one index_entry per frame, in
+// recording order, so any frame is one lookup away. A frame flagged
+// frame_compressed holds a tile_codec encoding of its pixels rather than
+// the pixels. Everything is little-endian.
+inline constexpr char     file_magic[8] = {'V', 'K', 'R', 'E', 'C', 0, 0, 1};
+inline constexpr char     index_magic[8] = {'V', 'K', 'I', 'D', 'X', 0, 0, 1};
+inline constexpr uint32_t file_version = 1;
+inline constexpr size_t   block_size = 4096; // O_DIRECT alignment.
+
+struct file_header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t header_bytes;
+  uint64_t frame_count; // Written at close; 0 if the recording was cut short.
+  uint64_t data_bytes;  // Header included; likewise.
+  int64_t  started_ns;  // system_clock time the recording began.
+};
+
+struct index_header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t entry_bytes;
+  uint64_t frame_count;
+};
+
+enum frame_flags : uint32_t {
+  frame_incomplete = 1u << 0, // Packets were still missing at delivery.
+  frame_compressed = 1u << 1, // Stored tile_codec-encoded.
+};
+
+struct index_entry {
+  uint64_t frame_id;
+  uint64_t device_timestamp; // Device ticks from the GVSP leader.
+  int64_t  received_ns;      // steady_clock, relative to the recording start.
+  uint64_t offset;           // Of the frame in the data file.
+  uint32_t bytes;            // Stored bytes; the rest of the block is padding.
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  uint32_t flags;
+  uint32_t reserved;
+};
+static_assert(sizeof(file_header) <= block_size);
+static_assert(sizeof(index_entry) == 56);
+
+// The header block of a data file.
+file_header make_file_header(uint64_t frame_count, uint64_t data_bytes,
+                             int64_t started_ns) noexcept;
+
+// Creates a data file and writes its header block from a block_size,
+// block-aligned buffer. Tries O_DIRECT first if asked, and reports in
+// direct whether it held. Returns the descriptor, open for writing.
+std::expected<int, std::error_code>
+create_data_file(const std::filesystem::path &path, const std::byte *header_block,
+                 bool &direct);
+
+// Writes <data file>.idx.
+std::error_code write_index(const std::filesystem::path    &data_path,
+                            std::span<const index_entry> entries);
+
+struct frame_info {
+  uint64_t frame_id = 0;
+  uint64_t device_timestamp = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t pixel_format = 0;
+  bool     complete = true;
+  // Into the recording, for frames copied from another one; -1 stamps
+  // them as they are pushed.
+  int64_t received_ns = -1;
+};
+
+struct recorder_options {
+  std::filesystem::path path;
+  // Memory frames wait in for the disk, and how many frames it holds at
+  // most. A frame arriving when either is used up is dropped, not waited
+  // for.
+  size_t   staging_bytes = size_t{256} << 20;
+  uint32_t staging_frames = 256;
+  // Writes in flight at once: the io_uring depth, or the fallback's threads.
+  uint32_t queue_depth = 8;
+  // The data file grows by this much at a time with fallocate.
+  uint64_t preallocate_bytes = uint64_t{1} << 30;
+  // Bypass the page cache; falls back to buffered writes where the file
+  // system refuses O_DIRECT.
+  bool direct = true;
+  // Use the thread pool even where io_uring is available.
+  bool force_thread_pool = false;
+  // push() waits for staging space instead of dropping the frame. For
+  // writing frames that are not arriving live, such as reprocessing a
+  // recording; never for acquisition.
+  bool wait_when_full = false;
+  // Compress frames losslessly before they are written, spreading each
+  // frame's tiles over jobs at high priority (null: on the compressing
+  // thread alone). Frames that do not shrink are written as they are.
+  bool                      compress = false;
+  engine::jobs::job_system *jobs = nullptr;
+};
+
+enum class write_backend { io_uring, thread_pool };
+
+struct recorder_stats {
+  uint64_t frames = 0;  // Written to disk.
+  uint64_t bytes = 0;      // Written, after compression.
+  uint64_t raw_bytes = 0;  // Pixel bytes of the frames written.
+  uint64_t dropped = 0; // Arrived while every staging buffer was busy.
+  uint32_t staged = 0;  // Waiting for or being written now.
+  uint32_t staged_peak = 0;
+  double   seconds = 0.0;
+  double   megabytes_per_second = 0.0; // Over the last second.
+  double   average_megabytes_per_second = 0.0;
+  std::chrono::nanoseconds worst_write_latency{0};
+  std::chrono::nanoseconds last_write_latency{0};
+  // raw_bytes / bytes, and the rate frames are compressed at; 1 and 0
+  // without compression.
+  double compression_ratio = 1.0;
+  double encode_gigabytes_per_second = 0.0;
+};
+
+/*========================================================================================
+ *  recorder
+ *  -----------------------------------------------------------------------
+ *  •  Writes every frame pushed to it to one preallocated file, at the
+ *     rate the disk sustains rather than the rate the page cache absorbs:
+ *     O_DIRECT writes from 4 KiB-aligned staging buffers, submitted
+ *     through io_uring, or through a small thread pool where io_uring is
+ *     unavailable.
+ *  •  push() runs on the acquisition thread and never waits: it copies
+ *     the frame into a free staging buffer, or counts a drop if the disk
+ *     has fallen that far behind. Acquisition keeps going either way.
+ *  •  The file grows in large fallocate steps so that writes do not
+ *     allocate blocks, and is truncated to the frames written at close.
+ *  •  Optionally compresses each staged frame, in order, on the job system
+ *     before it is written, trading cores for disk bandwidth; the encoded
+ *     frame replaces the pixels in its staging buffer.
+ *=======================================================================================*/
+class recorder {
+public:
+  static std::expected<std::unique_ptr<recorder>, std::error_code>
+  create(recorder_options options);
+
+  ~recorder();
+
+  recorder(const recorder &) = delete;
+  recorder &operator=(const recorder &) = delete;
+
+  // Acquisition thread only. Returns false if the frame was dropped, or
+  // with wait_when_full, only once the recording has stopped.
+  bool push(const frame_info &info, std::span<const std::byte> pixels) noexcept;
+
+  // Stops accepting frames, waits for the ones staged to reach the disk
+  // and writes the index. Called by the destructor if not before; safe
+  // against a push() still running on the acquisition thread.
+  std::error_code finish();
+
+  recorder_stats stats() const;
+  write_backend  backend() const noexcept { return backend_; }
+  bool           direct() const noexcept { return direct_; }
+  bool           compressing() const noexcept { return options_.compress; }
+  const std::filesystem::path &path() const noexcept { return options_.path; }
+
+  // First write error; the recording stops accepting frames after one.
+  std::error_code error() const;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  // A compressing recorder stages frames as slot_copied, and they become
+  // slot_filled once encoded; otherwise push() fills them directly.
+  enum slot_state : uint32_t {
+    slot_free,
+    slot_copied,
+    slot_filled,
+    slot_writing,
+    slot_done
+  };
+
+  // A staged frame: where it sits in the staging ring, and its metadata.
+  struct slot {
+    std::atomic<uint32_t> state{slot_free};
+    frame_info            info;
+    uint32_t              bytes = 0;     // To write, from ring_begin.
+    uint32_t              raw_bytes = 0; // Pushed.
+    bool                  compressed = false;
+    uint64_t              ring_begin = 0; // Positions in the staging ring,
+    uint64_t              ring_end = 0;   // counted from its start.
+    clock::time_point     received;
+    clock::time_point     submitted;
+  };
+
+  explicit recorder(recorder_options options);
+
+  std::error_code open();
+  std::error_code start_writers();
+
+  // Takes the oldest filled slot and gives it its place in the file and
+  // the index; false if none is filled.
+  bool claim(uint32_t &index, uint64_t &offset, uint32_t &length);
+  // Records a write's result and hands staging memory back in order.
+  void complete(uint32_t index, int64_t result);
+  void fail(std::error_code error);
+  std::error_code preallocate(uint64_t end);
+
+  std::byte *ring_at(uint64_t position) const noexcept {
+    return staging_ + position % ring_bytes_;
+  }
+
+  void uring_loop(std::stop_token stop);
+  void pool_loop(std::stop_token stop);
+  void compress_loop(std::stop_token stop);
+  void compress(slot &s);
+  // What writers wait on: pushes, or frames compressed when compressing.
+  std::atomic<uint64_t> &ready() noexcept {
+    return options_.compress ? compressed_ : wakeups_;
+  }
+  void wait_for_frames(const std::stop_token &stop, std::atomic<uint64_t> &counter,
+                       uint64_t seen);
+
+  recorder_options options_;
+  write_backend    backend_ = write_backend::thread_pool;
+  bool             direct_ = false;
+  int              fd_ = -1;
+
+  // Staging ring: frames are copied in back to back, each padded to a
+  // block, and the space is reused once the frames before it are written.
+  std::byte              *staging_ = nullptr;
+  size_t                  ring_bytes_ = 0;
+  std::unique_ptr<slot[]> slots_;
+  std::atomic<uint64_t>   ring_released_{0}; // Free up to here + ring_bytes_.
+  // Bumped as slots are freed and as the recording stops, for push() to
+  // wait on with wait_when_full.
+  std::atomic<uint64_t> freed_{0};
+
+  // Producer side: written by push() only.
+  uint64_t              head_ = 0;
+  uint64_t              ring_head_ = 0;
+  std::atomic<uint64_t> wakeups_{0}; // Bumped by push() and finish().
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool>     accepting_{false};
+  std::atomic<uint32_t> pushing_{0};
+
+  // Consumer side.
+  std::mutex            claim_mutex_;
+  uint64_t              tail_ = 0;     // Next slot to write.
+  uint64_t              released_ = 0; // Next slot to hand back.
+  uint64_t              next_offset_ = block_size;
+  uint64_t              allocated_ = 0;
+  std::vector<index_entry> index_;
+
+  // Compression stage: one thread takes copied slots in order and encodes
+  // each across the job system.
+  std::unique_ptr<tile_codec> codec_;
+  std::vector<std::byte>      encoded_;
+  uint64_t                    compress_tail_ = 0;
+  std::atomic<uint64_t>       compressed_{0}; // Bumped per frame.
+  double                      encode_seconds_ = 0.0; // stats_mutex_.
+  uint64_t                    encoded_bytes_ = 0;    // Likewise; raw.
+
+  mutable std::mutex    stats_mutex_;
+  recorder_stats        stats_;
+  std::atomic<uint32_t> staged_{0};
+  std::atomic<uint32_t> staged_peak_{0};
+  clock::time_point     started_;
+  int64_t               started_system_ns_ = 0;
+  clock::time_point     window_start_;
+  uint64_t              window_bytes_ = 0;
+  std::error_code       error_;
+  bool                  finished_ = false; // Under stats_mutex_ too.
+
+  std::unique_ptr<io_ring>  ring_;
+  std::jthread              compressor_;
+  std::vector<std::jthread> writers_; // Last: stop before the state they use.
+};
+
+} // namespace recording
@@ -0,0 +1,147 @@
+#include "tiff_export.hpp"
+
+#include "playback.hpp"
+
+#include <algorithm>
+
+#include <profiling/profiler.hpp>
+#include <spdlog/spdlog.h>
+
+namespace recording {
+
+namespace {
+
+// Classic TIFF offsets are 32-bit; the margin covers the directories.
+constexpr uint64_t classic_limit = (uint64_t{1} << 32) - (uint64_t{64} << 20);
+
+} // namespace
+
+std::unique_ptr<tiff_export>
+tiff_export::frame(std::filesystem::path path, tiff_options options,
+                   std::vector<uint16_t> pixels, uint32_t width,
+                   uint32_t height, engine::jobs::job_system *jobs) {
+  std::unique_ptr<tiff_export> e(new tiff_export(std::move(path), options, jobs));
+  e->pixels_ = std::move(pixels);
+  e->width_ = width;
+  e->height_ = height;
+  e->start();
+  return e;
+}
+
+std::unique_ptr<tiff_export>
+tiff_export::sequence(std::filesystem::path path, tiff_options options,
+                      const playback &source, size_t first, size_t count,
+                      engine::jobs::job_system *jobs) {
+  std::unique_ptr<tiff_export> e(new tiff_export(std::move(path), options, jobs));
+  e->source_ = source.path();
+  e->source_layout_ = source.layout();
+  e->first_ = first;
+  e->count_ = count;
+  e->start();
+  return e;
+}
+
+tiff_export::~tiff_export() {
+  thread_.request_stop();
+}
+
+void tiff_export::start() {
+  started_ = clock::now();
+  progress_.total = count_;
+  thread_ = std::jthread([this](std::stop_token stop) {
+    engine::profiling::profiler::get().set_thread_name("tiff export");
+    run(stop);
+  });
+}
+
+void tiff_export::run(std::stop_token stop) {
+  std::error_code ec = write(stop);
+  if (!ec && stop.stop_requested())
+    ec = std::make_error_code(std::errc::operation_canceled);
+
+  if (ec) {
+    std::error_code removed;
+    std::filesystem::remove(path_, removed);
+    if (ec != std::errc::operation_canceled)
+      spdlog::error("Export to {} failed: {}", path_.string(), ec.message());
+  }
+
+  std::lock_guard lock(mutex_);
+  progress_.seconds = std::chrono::duration<double>(clock::now() - started_).count();
+  progress_.done = true;
+  progress_.error = ec;
+  if (!ec)
+    spdlog::info("Exported {} frame(s) to {} ({:.1f} MB in {:.2f} s)",
+                 progress_.frames, path_.string(), progress_.bytes / 1e6,
+                 progress_.seconds);
+}
+
+std::error_code tiff_export::write(std::stop_token stop) {
+  // Opened here rather than by the caller: mapping and reading the index
+  // of a large recording is not for the UI thread.
+  std::unique_ptr<playback> source;
+  if (!source_.empty()) {
+    auto opened = playback::open(source_, {.jobs = jobs_,
+                                           .priority = engine::jobs::priority::low,
+                                           .raw = source_layout_});
+    if (!opened)
+      return opened.error();
+    source = std::move(*opened);
+    first_ = std::min(first_, source->frame_count());
+    count_ = std::min(count_, source->frame_count() - first_);
+    if (count_ == 0)
+      return std::make_error_code(std::errc::invalid_argument);
+
+    uint64_t raw = 0;
+    for (size_t i = first_; i < first_ + count_; ++i)
+      raw += uint64_t{source->entry(i).width} * source->entry(i).height * 2;
+    options_.bigtiff = options_.bigtiff || raw > classic_limit;
+
+    std::lock_guard lock(mutex_);
+    progress_.total = count_;
+  } else {
+    options_.bigtiff =
+        options_.bigtiff || uint64_t{width_} * height_ * 2 > classic_limit;
+  }
+
+  auto writer = tiff_writer::create(path_, options_);
+  if (!writer)
+    return writer.error();
+
+  for (size_t i = 0; i < count_ && !stop.stop_requested(); ++i) {
+    std::error_code ec;
+    if (source) {
+      ENGINE_PROFILE_SCOPE("export frame");
+      const auto &entry = source->entry(first_ + i);
+      const auto  pixels = source->frame(first_ + i);
+      if (pixels.size() < size_t{entry.width} * entry.height)
+        return std::make_error_code(std::errc::illegal_byte_sequence);
+      ec = (*writer)->write_page(pixels, entry.width, entry.height, jobs_,
+                                 engine::jobs::priority::low);
+    } else {
+      ENGINE_PROFILE_SCOPE("export frame");
+      ec = (*writer)->write_page(pixels_, width_, height_, jobs_,
+                                 engine::jobs::priority::low);
+    }
+    if (ec)
+      return ec;
+    advance((*writer)->bytes_written());
+  }
+  return (*writer)->close();
+}
+
+void tiff_export::advance(uint64_t bytes) {
+  std::lock_guard lock(mutex_);
+  ++progress_.frames;
+  progress_.bytes = bytes;
+}
+
+export_progress tiff_export::progress() const {
+  std::lock_guard lock(mutex_);
+  export_progress p = progress_;
+  if (!p.done)
+    p.seconds = std::chrono::duration<double>(clock::now() - started_).count();
+  return p;
+}
+
+} // namespace recording
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "recording/playback.hpp"
+#include "recording/tiff_writer.hpp"
+
+namespace recording {
+
+struct export_progress {
+  size_t          frames = 0; // Written so far.
+  size_t          total = 0;
+  uint64_t        bytes = 0;  // Of the file so far.
+  double          seconds = 0.0;
+  bool            done = false;
+  std::error_code error; // operation_canceled after cancel().
+};
+
+/*========================================================================================
+ *  tiff_export
+ *  -----------------------------------------------------------------------
+ *  •  Writes one frame, or a range of a recording, to a 16-bit TIFF on a
+ *     thread of its own, decoding and encoding each page's strips across
+ *     the job system at low priority, behind acquisition and display; the
+ *     caller only polls progress().
+ *  •  Recordings and imported datasets are read through playback, so
+ *     compressed or converted frames are decoded on the way. BigTIFF is used once the frames could take a
+ *     classic TIFF past 4 GiB, whatever the options say.
+ *  •  A cancelled or failed export removes its file.
+ *=======================================================================================*/
+class tiff_export {
+public:
+  // A frame the caller has copied out. jobs, which must outlive the
+  // export, may be null to do all the work on the export's thread.
+  static std::unique_ptr<tiff_export>
+  frame(std::filesystem::path path, tiff_options options,
+        std::vector<uint16_t> pixels, uint32_t width, uint32_t height,
+        engine::jobs::job_system *jobs = nullptr);
+
+  // Frames [first, first + count) of what source is playing, which the
+  // export opens again for itself.
+  static std::unique_ptr<tiff_export>
+  sequence(std::filesystem::path path, tiff_options options,
+           const playback &source, size_t first, size_t count,
+           engine::jobs::job_system *jobs = nullptr);
+
+  // Cancels an export still running and waits for it to stop.
+  ~tiff_export();
+
+  tiff_export(const tiff_export &) = delete;
+  tiff_export &operator=(const tiff_export &) = delete;
+
+  const std::filesystem::path &path() const noexcept { return path_; }
+
+  // Stops after the page being written; progress() then reports
+  // operation_canceled.
+  void            cancel() noexcept { thread_.request_stop(); }
+  export_progress progress() const;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  tiff_export(std::filesystem::path path, tiff_options options,
+              engine::jobs::job_system *jobs)
+      : path_(std::move(path)), options_(options), jobs_(jobs) {}
+
+  void start();
+  void run(std::stop_token stop);
+  std::error_code write(std::stop_token stop);
+  void            advance(uint64_t bytes);
+
+  std::filesystem::path     path_;
+  tiff_options              options_;
+  engine::jobs::job_system *jobs_;
+
+  // The source: a frame of our own, or a range of a recording.
+  std::vector<uint16_t> pixels_;
+  uint32_t              width_ = 0;
+  uint32_t              height_ = 0;
+  std::filesystem::path     source_;
+  std::optional<raw_layout> source_layout_;
+  size_t                first_ = 0;
+  size_t                count_ = 1;
+
+  mutable std::mutex mutex_;
+  export_progress    progress_;
+  clock::time_point  started_;
+
+  std::jthread thread_; // Last: stops before the state it uses.
+};
+
+} // namespace recording
@@ -0,0 +1,511 @@
+#include "tiff_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <unordered_set>
+
+#include <zlib.h>
+
+namespace recording {
+
+namespace {
+
+enum compression_code : uint16_t {
+  compression_none = 1,
+  compression_lzw = 5,
+  compression_deflate = 8,
+  compression_adobe_deflate = 32946,
+  compression_packbits = 32773,
+};
+
+enum tiff_tag : uint16_t {
+  tag_new_subfile_type = 254,
+  tag_subfile_type = 255,
+  tag_image_width = 256,
+  tag_image_length = 257,
+  tag_bits_per_sample = 258,
+  tag_compression = 259,
+  tag_image_description = 270,
+  tag_strip_offsets = 273,
+  tag_samples_per_pixel = 277,
+  tag_rows_per_strip = 278,
+  tag_strip_byte_counts = 279,
+  tag_predictor = 317,
+  tag_tile_width = 322,
+  tag_sample_format = 339,
+};
+
+std::error_code invalid_file() noexcept {
+  return std::make_error_code(std::errc::illegal_byte_sequence);
+}
+
+std::error_code unsupported() noexcept {
+  return std::make_error_code(std::errc::not_supported);
+}
+
+// Bounds-checked reads in the file's byte order.
+class file_reader {
+public:
+  file_reader(std::span<const std::byte> file, bool big_endian)
+      : file_(file), big_endian_(big_endian) {}
+
+  bool contains(uint64_t offset, uint64_t size) const noexcept {
+    return offset <= file_.size() && size <= file_.size() - offset;
+  }
+
+  // Callers check contains() first.
+  uint64_t read(uint64_t offset, size_t size) const noexcept {
+    uint64_t value = 0;
+    if (big_endian_) {
+      for (size_t i = 0; i < size; ++i)
+        value = value << 8 | std::to_integer<uint64_t>(file_[offset + i]);
+    } else {
+      for (size_t i = size; i-- > 0;)
+        value = value << 8 | std::to_integer<uint64_t>(file_[offset + i]);
+    }
+    return value;
+  }
+
+  std::span<const std::byte> file() const noexcept { return file_; }
+
+private:
+  std::span<const std::byte> file_;
+  bool                       big_endian_;
+};
+
+size_t type_size(uint16_t type) noexcept {
+  switch (type) {
+  case 1: case 2: case 6: case 7: return 1; // BYTE, ASCII, SBYTE, UNDEFINED
+  case 3: case 8: return 2;                 // SHORT, SSHORT
+  case 4: case 9: case 13: return 4;        // LONG, SLONG, IFD
+  case 16: case 17: case 18: return 8;      // LONG8, SLONG8, IFD8
+  default: return 0;                        // Nothing we read.
+  }
+}
+
+// One directory entry: its values are in the entry if they fit, else at
+// the offset the entry holds.
+struct directory_entry {
+  uint16_t tag = 0;
+  uint16_t type = 0;
+  uint64_t count = 0;
+  uint64_t values = 0; // File offset of the first value.
+};
+
+std::vector<uint64_t> read_values(const file_reader &r, const directory_entry &e) {
+  const size_t size = type_size(e.type);
+  if (size == 0 || e.count > r.file().size() || !r.contains(e.values, e.count * size))
+    return {};
+  std::vector<uint64_t> values(static_cast<size_t>(e.count));
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = r.read(e.values + i * size, size);
+  return values;
+}
+
+uint64_t read_value(const file_reader &r, const directory_entry &e,
+                    uint64_t fallback) {
+  const size_t size = type_size(e.type);
+  if (e.count == 0 || size == 0 || !r.contains(e.values, size))
+    return fallback;
+  return r.read(e.values, size);
+}
+
+// The image count from an ImageJ description ("ImageJ=...\nimages=N\n...").
+size_t imagej_images(const file_reader &r, const directory_entry &e) {
+  if (e.type != 2 || !r.contains(e.values, e.count))
+    return 0;
+  const std::string_view text(reinterpret_cast<const char *>(r.file().data() + e.values),
+                              static_cast<size_t>(e.count));
+  if (!text.starts_with("ImageJ="))
+    return 0;
+  const auto at = text.find("\nimages=");
+  if (at == std::string_view::npos)
+    return 0;
+  const auto digits = text.substr(at + 8);
+  size_t     images = 0;
+  std::from_chars(digits.data(), digits.data() + digits.size(), images);
+  return images;
+}
+
+size_t row_bytes(const tiff_page &page) noexcept {
+  return size_t{page.width} * (page.bits / 8);
+}
+
+// Rows of the file's samples to native 16-bit pixels, undoing horizontal
+// differencing on the way: it is modulo the sample size, so 8-bit rows
+// are summed as bytes before widening.
+void convert_rows(const std::byte *in, uint16_t *out, uint32_t rows,
+                  const tiff_page &page) {
+  const uint32_t width = page.width;
+  const bool     differenced = page.predictor == 2;
+  if (page.bits == 16 && !page.big_endian && !differenced) {
+    std::memcpy(out, in, size_t{rows} * width * 2);
+    return;
+  }
+  for (uint32_t y = 0; y < rows; ++y) {
+    const std::byte *row = in + size_t{y} * row_bytes(page);
+    uint16_t        *pixels = out + size_t{y} * width;
+    if (page.bits == 8) {
+      uint8_t sum = 0;
+      for (uint32_t x = 0; x < width; ++x) {
+        const auto v = std::to_integer<uint8_t>(row[x]);
+        sum = differenced ? static_cast<uint8_t>(sum + v) : v;
+        pixels[x] = sum;
+      }
+    } else {
+      uint16_t sum = 0;
+      for (uint32_t x = 0; x < width; ++x) {
+        uint16_t v;
+        std::memcpy(&v, row + size_t{x} * 2, 2);
+        if (page.big_endian)
+          v = std::byteswap(v);
+        sum = differenced ? static_cast<uint16_t>(sum + v) : v;
+        pixels[x] = sum;
+      }
+    }
+  }
+}
+
+bool inflate_strip(std::span<const std::byte> in, std::span<std::byte> out) {
+  z_stream z{};
+  if (inflateInit(&z) != Z_OK)
+    return false;
+  z.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(in.data()));
+  z.avail_in = static_cast<uInt>(in.size());
+  z.next_out = reinterpret_cast<Bytef *>(out.data());
+  z.avail_out = static_cast<uInt>(out.size());
+  const int result = inflate(&z, Z_FINISH);
+  inflateEnd(&z);
+  // Some writers pad strips, so a full buffer is enough.
+  return (result == Z_STREAM_END || result == Z_OK || result == Z_BUF_ERROR) &&
+         z.avail_out == 0;
+}
+
+bool unpack_bits(std::span<const std::byte> in, std::span<std::byte> out) {
+  size_t i = 0, o = 0;
+  while (i < in.size() && o < out.size()) {
+    const auto n = static_cast<int8_t>(in[i++]);
+    if (n >= 0) {
+      const size_t literal = std::min<size_t>(
+          {size_t(n) + 1, in.size() - i, out.size() - o});
+      std::memcpy(out.data() + o, in.data() + i, literal);
+      i += literal;
+      o += literal;
+    } else if (n != -128 && i < in.size()) {
+      const size_t run = std::min<size_t>(size_t(1 - n), out.size() - o);
+      std::memset(out.data() + o, std::to_integer<int>(in[i++]), run);
+      o += run;
+    }
+  }
+  return o == out.size();
+}
+
+// TIFF's LZW: MSB-first codes of 9 to 12 bits, widening one code early.
+// Every table string is a run of the output already written, so the
+// table holds positions in it rather than strings.
+bool lzw_decode(std::span<const std::byte> in, std::span<std::byte> out) {
+  constexpr uint32_t clear = 256, end_of_information = 257;
+  struct run {
+    uint32_t position, length;
+  };
+  std::vector<run> table(4096);
+
+  uint32_t next = 258, width = 9;
+  uint64_t bits = 0;
+  uint32_t bit_count = 0;
+  size_t   i = 0, o = 0;
+  run      previous{0, 0};
+  while (o < out.size()) {
+    while (bit_count < width && i < in.size()) {
+      bits = bits << 8 | std::to_integer<uint64_t>(in[i++]);
+      bit_count += 8;
+    }
+    if (bit_count < width)
+      break;
+    const auto code =
+        static_cast<uint32_t>(bits >> (bit_count - width)) & ((1u << width) - 1);
+    bit_count -= width;
+
+    if (code == end_of_information)
+      break;
+    if (code == clear) {
+      next = 258;
+      width = 9;
+      previous = {0, 0};
+      continue;
+    }
+
+    const auto position = static_cast<uint32_t>(o);
+    uint32_t   length;
+    if (code < 256) {
+      out[o] = std::byte(code);
+      length = 1;
+    } else if (code < next) {
+      length = std::min<uint32_t>(table[code].length,
+                                  static_cast<uint32_t>(out.size() - o));
+      std::memcpy(out.data() + o, out.data() + table[code].position, length);
+    } else if (code == next && previous.length) {
+      // The string being defined: the previous one and its first byte.
+      length = std::min<uint32_t>(previous.length + 1,
+                                  static_cast<uint32_t>(out.size() - o));
+      for (uint32_t k = 0; k < length; ++k)
+        out[o + k] = out[previous.position + k % previous.length];
+    } else {
+      return false;
+    }
+    o += length;
+
+    if (previous.length && next < table.size()) {
+      table[next++] = {previous.position, previous.length + 1};
+      if (next == (1u << width) - 1 && width < 12)
+        ++width;
+    }
+    previous = {position, length};
+  }
+  return o == out.size();
+}
+
+bool decompress(uint16_t compression, std::span<const std::byte> in,
+                std::span<std::byte> out) {
+  switch (compression) {
+  case compression_lzw: return lzw_decode(in, out);
+  case compression_deflate:
+  case compression_adobe_deflate: return inflate_strip(in, out);
+  case compression_packbits: return unpack_bits(in, out);
+  default: return false;
+  }
+}
+
+// Checks a page's fields and that its strips lie within the file.
+std::error_code validate(const tiff_page &page, uint64_t file_size) {
+  if (page.width == 0 || page.height == 0 || page.rows_per_strip == 0)
+    return invalid_file();
+  const size_t strips = (page.height + page.rows_per_strip - 1) / page.rows_per_strip;
+  if (page.strip_offsets.size() != strips || page.strip_bytes.size() != strips)
+    return invalid_file();
+  // No codec here expands a byte to more than a few thousand, which
+  // bounds what a corrupt size can make a decode allocate.
+  uint64_t stored = 0;
+  for (uint64_t bytes : page.strip_bytes)
+    stored += std::min<uint64_t>(bytes, file_size);
+  if (uint64_t{page.height} * row_bytes(page) > stored * 4096)
+    return invalid_file();
+  for (size_t s = 0; s < strips; ++s) {
+    const uint64_t rows =
+        std::min<uint64_t>(page.rows_per_strip, page.height - s * page.rows_per_strip);
+    if (page.strip_offsets[s] > file_size ||
+        page.strip_bytes[s] > file_size - page.strip_offsets[s])
+      return invalid_file();
+    if (page.compression == compression_none &&
+        page.strip_bytes[s] < rows * row_bytes(page))
+      return invalid_file();
+  }
+  return {};
+}
+
+} // namespace
+
+bool tiff_page::direct() const noexcept {
+  if (bits != 16 || big_endian || compression != compression_none ||
+      predictor != 1 || strip_offsets.empty() || strip_offsets[0] % 2 != 0)
+    return false;
+  const uint64_t strip_size = uint64_t{rows_per_strip} * width * 2;
+  for (size_t s = 1; s < strip_offsets.size(); ++s)
+    if (strip_offsets[s] != strip_offsets[0] + s * strip_size)
+      return false;
+  return true;
+}
+
+std::expected<std::vector<tiff_page>, std::error_code>
+parse_tiff(std::span<const std::byte> file,
+           const std::function<void(uint64_t)> &will_read) {
+  if (file.size() < 16)
+    return std::unexpected(invalid_file());
+  const bool big_endian = file[0] == std::byte{'M'} && file[1] == std::byte{'M'};
+  if (!big_endian && !(file[0] == std::byte{'I'} && file[1] == std::byte{'I'}))
+    return std::unexpected(invalid_file());
+  const file_reader r(file, big_endian);
+
+  const auto version = r.read(2, 2);
+  if (version != 42 && version != 43)
+    return std::unexpected(invalid_file());
+  const bool   big = version == 43;
+  const size_t offset_size = big ? 8 : 4;
+  const size_t count_size = big ? 8 : 2;
+  const size_t entry_size = big ? 20 : 12;
+
+  std::vector<tiff_page>       pages;
+  std::unordered_set<uint64_t> visited; // A directory chain may loop.
+  size_t                       imagej = 0;
+  uint64_t previous = 0, stride = 0, announced = 0;
+  for (uint64_t directory = r.read(big ? 8 : 4, offset_size); directory != 0;) {
+    if (!visited.insert(directory).second || !r.contains(directory, count_size))
+      return std::unexpected(invalid_file());
+
+    // Pages laid out alike put their directories a fixed stride apart.
+    // Once two strides agree, the directories ahead are announced in
+    // batches, so that a cold file is read ahead instead of faulted in
+    // one directory at a time.
+    constexpr uint64_t lookahead = 64;
+    if (will_read && directory > previous && directory - previous == stride &&
+        directory >= announced) {
+      for (uint64_t k = 1; k <= lookahead; ++k)
+        will_read(directory + k * stride);
+      announced = directory + lookahead / 2 * stride;
+    }
+    stride = directory > previous ? directory - previous : 0;
+    previous = directory;
+    const uint64_t count = r.read(directory, count_size);
+    const uint64_t first_entry = directory + count_size;
+    if (count > file.size() / entry_size ||
+        !r.contains(first_entry, count * entry_size + offset_size))
+      return std::unexpected(invalid_file());
+
+    tiff_page page;
+    uint16_t  samples = 1, sample_format = 1;
+    bool      reduced = false;
+    for (uint64_t k = 0; k < count; ++k) {
+      const uint64_t  at = first_entry + k * entry_size;
+      directory_entry e;
+      e.tag = static_cast<uint16_t>(r.read(at, 2));
+      e.type = static_cast<uint16_t>(r.read(at + 2, 2));
+      e.count = r.read(at + 4, offset_size);
+      e.values = at + 4 + offset_size;
+      if (e.count * type_size(e.type) > offset_size)
+        e.values = r.read(e.values, offset_size);
+
+      switch (e.tag) {
+      case tag_new_subfile_type: reduced = read_value(r, e, 0) & 1; break;
+      case tag_subfile_type: reduced = read_value(r, e, 1) == 2; break;
+      case tag_image_width: page.width = static_cast<uint32_t>(read_value(r, e, 0)); break;
+      case tag_image_length: page.height = static_cast<uint32_t>(read_value(r, e, 0)); break;
+      case tag_bits_per_sample: page.bits = static_cast<uint16_t>(read_value(r, e, 1)); break;
+      case tag_compression: page.compression = static_cast<uint16_t>(read_value(r, e, 1)); break;
+      case tag_image_description:
+        if (pages.empty())
+          imagej = imagej_images(r, e);
+        break;
+      case tag_strip_offsets: page.strip_offsets = read_values(r, e); break;
+      case tag_samples_per_pixel: samples = static_cast<uint16_t>(read_value(r, e, 1)); break;
+      case tag_rows_per_strip:
+        page.rows_per_strip = static_cast<uint32_t>(
+            std::min<uint64_t>(read_value(r, e, 0), UINT32_MAX));
+        break;
+      case tag_strip_byte_counts: page.strip_bytes = read_values(r, e); break;
+      case tag_predictor: page.predictor = static_cast<uint16_t>(read_value(r, e, 1)); break;
+      case tag_tile_width: return std::unexpected(unsupported());
+      case tag_sample_format: sample_format = static_cast<uint16_t>(read_value(r, e, 1)); break;
+      default: break;
+      }
+    }
+    directory = r.read(first_entry + count * entry_size, offset_size);
+
+    // Thumbnails and pyramid levels are not frames.
+    if (reduced)
+      continue;
+    page.big_endian = big_endian;
+    page.rows_per_strip = std::clamp(page.rows_per_strip ? page.rows_per_strip
+                                                         : page.height,
+                                     1u, std::max(page.height, 1u));
+    if (samples != 1 || sample_format != 1 || (page.bits != 8 && page.bits != 16) ||
+        (page.predictor != 1 && page.predictor != 2))
+      return std::unexpected(unsupported());
+    switch (page.compression) {
+    case compression_none:
+    case compression_lzw:
+    case compression_deflate:
+    case compression_adobe_deflate:
+    case compression_packbits: break;
+    default: return std::unexpected(unsupported());
+    }
+    if (auto ec = validate(page, file.size()))
+      return std::unexpected(ec);
+    pages.push_back(std::move(page));
+  }
+  if (pages.empty())
+    return std::unexpected(invalid_file());
+
+  // An ImageJ stack too big for its directories: the images follow the
+  // first one, uncompressed and back to back, as far as the file goes.
+  if (pages.size() == 1 && imagej > 1 &&
+      pages[0].compression == compression_none && pages[0].predictor == 1) {
+    const tiff_page first = pages[0];
+    const uint64_t  image_bytes = uint64_t{first.height} * row_bytes(first);
+    const uint64_t  start = first.strip_offsets[0];
+    bool            contiguous = true;
+    for (size_t s = 0; s < first.strip_offsets.size(); ++s)
+      contiguous = contiguous && first.strip_offsets[s] ==
+                                     start + s * first.rows_per_strip * row_bytes(first);
+    const uint64_t fits = (file.size() - start) / image_bytes;
+    if (contiguous && fits > 1) {
+      pages.clear();
+      for (uint64_t i = 0; i < std::min<uint64_t>(imagej, fits); ++i) {
+        tiff_page page = first;
+        page.rows_per_strip = first.height;
+        page.strip_offsets = {start + i * image_bytes};
+        page.strip_bytes = {image_bytes};
+        pages.push_back(std::move(page));
+      }
+    }
+  }
+  return pages;
+}
+
+bool decode_page(std::span<const std::byte> file, const tiff_page &page,
+                 std::span<uint16_t> out, engine::jobs::job_system *jobs,
+                 engine::jobs::priority priority) {
+  if (out.size() < size_t{page.width} * page.height)
+    return false;
+  const size_t line = row_bytes(page);
+
+  // Uncompressed rows convert independently, so they split finer than
+  // strips, which are often the whole image.
+  if (page.compression == compression_none) {
+    auto convert = [&](size_t begin, size_t end) {
+      for (size_t y = begin; y < end;) {
+        const size_t strip = y / page.rows_per_strip;
+        const size_t strip_end =
+            std::min<size_t>(end, (strip + 1) * size_t{page.rows_per_strip});
+        const size_t row_in_strip = y - strip * page.rows_per_strip;
+        convert_rows(file.data() + page.strip_offsets[strip] + row_in_strip * line,
+                     out.data() + y * page.width,
+                     static_cast<uint32_t>(strip_end - y), page);
+        y = strip_end;
+      }
+    };
+    if (jobs)
+      jobs->parallel_for(0, page.height, 64, convert, priority);
+    else
+      convert(0, page.height);
+    return true;
+  }
+
+  std::atomic<bool> ok{true};
+  auto decode = [&](size_t begin, size_t end) {
+    thread_local std::vector<std::byte> scratch;
+    for (size_t s = begin; s < end; ++s) {
+      const auto y0 = static_cast<uint32_t>(s * page.rows_per_strip);
+      const auto rows = std::min(page.rows_per_strip, page.height - y0);
+      scratch.resize(size_t{rows} * line);
+      if (!decompress(page.compression,
+                      file.subspan(page.strip_offsets[s], page.strip_bytes[s]),
+                      scratch)) {
+        ok.store(false, std::memory_order_relaxed);
+        continue;
+      }
+      convert_rows(scratch.data(), out.data() + size_t{y0} * page.width, rows, page);
+    }
+  };
+  if (jobs)
+    jobs->parallel_for(0, page.strip_offsets.size(), 1, decode, priority);
+  else
+    decode(0, page.strip_offsets.size());
+  return ok.load();
+}
+
+} // namespace recording
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+
+namespace recording {
+
+// Where one grayscale image lies in a mapped file, and how it is stored.
+// TIFF pages are parsed into these; a raw dump is described as pages of a
+// single uncompressed strip each.
+struct tiff_page {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint16_t bits = 16;       // 8 or 16 per sample; 8 is widened on decode.
+  uint16_t compression = 1; // TIFF codes: none, LZW, Deflate, PackBits.
+  uint16_t predictor = 1;   // 2: horizontal differencing.
+  bool     big_endian = false;
+  uint32_t rows_per_strip = 0;
+  std::vector<uint64_t> strip_offsets;
+  std::vector<uint64_t> strip_bytes;
+
+  // The pixels are 16-bit little-endian rows, back to back and aligned,
+  // so the page can be used straight from the mapping at strip_offsets[0].
+  bool direct() const noexcept;
+};
+
+// Walks a TIFF or BigTIFF file's directory chain and returns its
+// full-resolution pages, without touching any pixel data. Pages in a
+// form decode_page() cannot read fail the whole file with not_supported;
+// a malformed file fails with illegal_byte_sequence.
+//
+// ImageJ writes stacks past 4 GiB with a single directory and every
+// image back to back after it; those come back with one page per image.
+//
+// will_read, if set, is told the offsets of directories the walk expects
+// to reach, for a mapped file to read them ahead.
+std::expected<std::vector<tiff_page>, std::error_code>
+parse_tiff(std::span<const std::byte> file,
+           const std::function<void(uint64_t)> &will_read = {});
+
+// Decodes a page into width * height pixels, its strips (or, uncompressed,
+// its rows) spread across jobs at priority if there is a job system. False
+// if a strip fails to decompress.
+bool decode_page(std::span<const std::byte> file, const tiff_page &page,
+                 std::span<uint16_t> out, engine::jobs::job_system *jobs,
+                 engine::jobs::priority priority = engine::jobs::priority::normal);
+
+} // namespace recording
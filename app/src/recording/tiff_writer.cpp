@@ -0,0 +1,258 @@
+#include "tiff_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace recording {
+
+namespace {
+
+std::error_code last_error() noexcept {
+  return {errno, std::system_category()};
+}
+
+enum tiff_type : uint16_t { type_short = 3, type_long = 4, type_long8 = 16 };
+
+enum tiff_tag : uint16_t {
+  tag_image_width = 256,
+  tag_image_length = 257,
+  tag_bits_per_sample = 258,
+  tag_compression = 259,
+  tag_photometric = 262,
+  tag_strip_offsets = 273,
+  tag_samples_per_pixel = 277,
+  tag_rows_per_strip = 278,
+  tag_strip_byte_counts = 279,
+  tag_predictor = 317,
+  tag_sample_format = 339,
+};
+
+constexpr uint64_t classic_limit = uint64_t{1} << 32;
+
+// One directory entry before layout: a single value, or an array that
+// goes out of line when it does not fit in the entry.
+struct field {
+  uint16_t                     tag;
+  uint16_t                     type;
+  uint64_t                     value = 0;
+  std::span<const uint64_t>    values{};
+};
+
+// Zlib stream of the strip's rows after horizontal differencing: each
+// pixel minus its left neighbour, which is what Predictor 2 undoes.
+bool deflate_strip(const uint16_t *pixels, uint32_t width, uint32_t rows,
+                   int level, std::vector<std::byte> &out) {
+  thread_local std::vector<uint16_t> differenced;
+  differenced.resize(size_t{width} * rows);
+  for (uint32_t y = 0; y < rows; ++y) {
+    const uint16_t *in = pixels + size_t{y} * width;
+    uint16_t       *row = differenced.data() + size_t{y} * width;
+    row[0] = in[0];
+    for (uint32_t x = 1; x < width; ++x)
+      row[x] = static_cast<uint16_t>(in[x] - in[x - 1]);
+  }
+
+  const auto source_bytes = static_cast<uLong>(differenced.size() * 2);
+  uLongf     size = compressBound(source_bytes);
+  out.resize(size);
+  if (compress2(reinterpret_cast<Bytef *>(out.data()), &size,
+                reinterpret_cast<const Bytef *>(differenced.data()),
+                source_bytes, level) != Z_OK)
+    return false;
+  out.resize(size);
+  return true;
+}
+
+} // namespace
+
+std::expected<std::unique_ptr<tiff_writer>, std::error_code>
+tiff_writer::create(const std::filesystem::path &path, tiff_options options) {
+  std::unique_ptr<tiff_writer> w(new tiff_writer(options));
+  w->fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (w->fd_ < 0)
+    return std::unexpected(last_error());
+
+  // Header; its first-directory offset is patched by the first page.
+  std::byte header[16] = {};
+  std::memcpy(header, "II", 2);
+  if (options.bigtiff) {
+    const uint16_t fields[] = {43, 8, 0};
+    std::memcpy(header + 2, fields, sizeof(fields));
+    w->next_link_ = 8;
+  } else {
+    const uint16_t version = 42;
+    std::memcpy(header + 2, &version, sizeof(version));
+    w->next_link_ = 4;
+  }
+  if (auto ec = w->append(header, options.bigtiff ? 16 : 8))
+    return std::unexpected(ec);
+  return w;
+}
+
+tiff_writer::~tiff_writer() {
+  (void)close();
+}
+
+std::error_code tiff_writer::write_at(uint64_t offset, const void *data,
+                                      size_t size) {
+  const auto *bytes = static_cast<const std::byte *>(data);
+  for (size_t written = 0; written < size;) {
+    const ssize_t n = ::pwrite(fd_, bytes + written, size - written,
+                               static_cast<off_t>(offset + written));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return n < 0 ? last_error() : std::make_error_code(std::errc::io_error);
+    written += static_cast<size_t>(n);
+  }
+  return {};
+}
+
+std::error_code tiff_writer::append(const void *data, size_t size) {
+  if (auto ec = write_at(end_, data, size))
+    return ec;
+  end_ += size;
+  return {};
+}
+
+std::error_code tiff_writer::write_page(std::span<const uint16_t> pixels,
+                                        uint32_t width, uint32_t height,
+                                        engine::jobs::job_system *jobs,
+                                        engine::jobs::priority    priority) {
+  if (fd_ < 0)
+    return std::make_error_code(std::errc::bad_file_descriptor);
+  if (width == 0 || height == 0 || pixels.size() < size_t{width} * height)
+    return std::make_error_code(std::errc::invalid_argument);
+
+  const uint32_t rows_per_strip = std::clamp<uint32_t>(
+      options_.strip_bytes / (width * 2), 1, height);
+  const uint32_t strip_count = (height + rows_per_strip - 1) / rows_per_strip;
+  const bool     deflate = options_.compression == tiff_compression::deflate;
+
+  if (deflate) {
+    strips_.resize(strip_count);
+    std::atomic<bool> ok{true};
+    auto encode = [&](size_t begin, size_t end) {
+      for (size_t s = begin; s < end; ++s) {
+        const uint32_t y0 = static_cast<uint32_t>(s) * rows_per_strip;
+        if (!deflate_strip(pixels.data() + size_t{y0} * width, width,
+                           std::min(rows_per_strip, height - y0),
+                           options_.deflate_level, strips_[s]))
+          ok.store(false, std::memory_order_relaxed);
+      }
+    };
+    if (jobs)
+      jobs->parallel_for(0, strip_count, 1, encode, priority);
+    else
+      encode(0, strip_count);
+    if (!ok.load())
+      return std::make_error_code(std::errc::not_enough_memory);
+  }
+
+  // Strips, back to back from the current end.
+  std::vector<uint64_t> offsets(strip_count);
+  std::vector<uint64_t> counts(strip_count);
+  uint64_t              at = end_;
+  for (uint32_t s = 0; s < strip_count; ++s) {
+    const uint32_t y0 = s * rows_per_strip;
+    offsets[s] = at;
+    counts[s] = deflate ? strips_[s].size()
+                        : uint64_t{std::min(rows_per_strip, height - y0)} * width * 2;
+    at += counts[s];
+  }
+
+  const bool big = options_.bigtiff;
+  // The directory and its arrays, at most, follow the strips.
+  if (!big && at + 2 * 4 * uint64_t{strip_count} + 256 > classic_limit)
+    return std::make_error_code(std::errc::file_too_large);
+
+  if (deflate) {
+    for (const auto &strip : strips_)
+      if (auto ec = append(strip.data(), strip.size()))
+        return ec;
+  } else if (auto ec = append(pixels.data(), size_t{width} * height * 2)) {
+    return ec; // Uncompressed strips are the rows themselves, in order.
+  }
+
+  const uint16_t offset_type = big ? type_long8 : type_long;
+  const field    fields[] = {
+      {tag_image_width, type_long, width},
+      {tag_image_length, type_long, height},
+      {tag_bits_per_sample, type_short, 16},
+      {tag_compression, type_short, static_cast<uint16_t>(options_.compression)},
+      {tag_photometric, type_short, 1}, // BlackIsZero.
+      {tag_strip_offsets, offset_type, 0, offsets},
+      {tag_samples_per_pixel, type_short, 1},
+      {tag_rows_per_strip, type_long, rows_per_strip},
+      {tag_strip_byte_counts, offset_type, 0, counts},
+      {tag_predictor, type_short, deflate ? 2u : 1u},
+      {tag_sample_format, type_short, 1}, // Unsigned integers.
+  };
+
+  // Out-of-line arrays first, then the directory, word-aligned.
+  const size_t value_bytes = big ? 8 : 4;
+  const size_t count_bytes = big ? 8 : 2;
+  std::vector<std::byte> block;
+  auto put = [&](uint64_t value, size_t size) {
+    const size_t position = block.size();
+    block.resize(position + size);
+    std::memcpy(block.data() + position, &value, size); // Little-endian host.
+  };
+  if (end_ % 2)
+    put(0, 1);
+  const uint64_t          block_start = end_;
+  std::vector<uint64_t>   array_offsets(std::size(fields));
+  for (size_t f = 0; f < std::size(fields); ++f) {
+    if (fields[f].values.size() <= 1)
+      continue;
+    array_offsets[f] = block_start + block.size();
+    for (uint64_t v : fields[f].values)
+      put(v, value_bytes);
+  }
+
+  const uint64_t directory = block_start + block.size();
+  put(std::size(fields), count_bytes);
+  for (size_t f = 0; f < std::size(fields); ++f) {
+    const field &e = fields[f];
+    const bool   array = e.values.size() > 1;
+    put(e.tag, 2);
+    put(e.type, 2);
+    put(array ? e.values.size() : 1, value_bytes);
+    const uint64_t value = array              ? array_offsets[f]
+                           : e.values.empty() ? e.value
+                                              : e.values[0];
+    // A SHORT sits in the low bytes of the value field.
+    put(value, value_bytes);
+  }
+  const uint64_t link = block_start + block.size();
+  put(0, value_bytes); // No next directory yet.
+
+  if (auto ec = append(block.data(), block.size()))
+    return ec;
+
+  const size_t link_bytes = big ? 8 : 4;
+  if (auto ec = write_at(next_link_, &directory, link_bytes))
+    return ec;
+  next_link_ = link;
+  ++pages_;
+  return {};
+}
+
+std::error_code tiff_writer::close() {
+  if (fd_ < 0)
+    return {};
+  std::error_code ec;
+  if (::fdatasync(fd_) != 0)
+    ec = last_error();
+  ::close(fd_);
+  fd_ = -1;
+  return ec;
+}
+
+} // namespace recording
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+
+namespace recording {
+
+enum class tiff_compression : uint16_t {
+  none = 1,
+  deflate = 8, // zlib, after horizontal differencing (Predictor 2).
+};
+
+struct tiff_options {
+  tiff_compression compression = tiff_compression::none;
+  int              deflate_level = 1; // Speed over size; 1-9.
+  // 64-bit offsets, for files past classic TIFF's 4 GiB. Older readers
+  // cannot open them, so they are only written when asked for.
+  bool bigtiff = false;
+  // Uncompressed bytes per strip. Strips are the unit of parallel
+  // encoding, so a frame should have a few per core.
+  uint32_t strip_bytes = 256 * 1024;
+};
+
+/*========================================================================================
+ *  tiff_writer
+ *  -----------------------------------------------------------------------
+ *  •  Writes 16-bit grayscale frames as the pages of one little-endian
+ *     TIFF or BigTIFF file: each page's strips, then its directory, which
+ *     the previous page's directory is patched to point at.
+ *  •  With compression, a page's strips are encoded in parallel across a
+ *     job system, then written in order.
+ *=======================================================================================*/
+class tiff_writer {
+public:
+  static std::expected<std::unique_ptr<tiff_writer>, std::error_code>
+  create(const std::filesystem::path &path, tiff_options options);
+
+  ~tiff_writer();
+
+  tiff_writer(const tiff_writer &) = delete;
+  tiff_writer &operator=(const tiff_writer &) = delete;
+
+  // Appends a width x height page, its strips encoded across jobs at
+  // priority, or on the calling thread if jobs is null. A classic TIFF
+  // fails with file_too_large once the page would take it past 4 GiB.
+  std::error_code
+  write_page(std::span<const uint16_t> pixels, uint32_t width, uint32_t height,
+             engine::jobs::job_system *jobs,
+             engine::jobs::priority    priority = engine::jobs::priority::normal);
+
+  // Flushes to disk; called by the destructor if not before.
+  std::error_code close();
+
+  uint64_t bytes_written() const noexcept { return end_; }
+  uint32_t pages() const noexcept { return pages_; }
+
+private:
+  tiff_writer(tiff_options options) : options_(options) {}
+
+  std::error_code write_at(uint64_t offset, const void *data, size_t size);
+  std::error_code append(const void *data, size_t size);
+
+  tiff_options options_;
+  int          fd_ = -1;
+  uint64_t     end_ = 0;
+  uint32_t     pages_ = 0;
+  // Where the last directory's next-directory offset is, to patch.
+  uint64_t next_link_ = 0;
+
+  std::vector<std::vector<std::byte>> strips_; // Encoded, reused per page.
+};
+
+} // namespace recording
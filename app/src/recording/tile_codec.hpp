@@ -0,0 +1,492 @@
+#pragma once
+
+#include <algorithm> /* std::min, std::max */
+#include <atomic>    /* decode() result across threads */
+#include <bit>       /* std::bit_width */
+#include <cassert>   /* assert */
+#include <cstddef>   /* std::byte */
+#include <cstdint>   /* uint16_t, uint32_t */
+#include <cstring>   /* std::memcpy, std::memmove */
+#include <optional>  /* std::optional */
+#include <span>      /* std::span */
+#include <vector>    /* per-tile sizes */
+
+#if defined(__SSE2__)
+#include <emmintrin.h> /* bit-plane pack and unpack */
+#endif
+
+#include <jobs/job_system.hpp>
+
+// Lossless compression of 16-bit frames for recordings.
+//
+// A frame is cut into tiles that are coded on their own, so that they
+// encode and decode in parallel and any one of them can be decoded
+// without the rest. Within a tile each pixel is predicted from its
+// neighbours (left, up, or the LOCO-I median of left, up and up-left,
+// whichever suits the tile best), and the zigzagged residuals are packed
+// 32 at a time as bit planes: a width byte, then one 32-bit word per bit
+// of the widest residual. Detector noise leaves a few low bits per pixel,
+// so most blocks shrink to a fraction of their 64 raw bytes; tiles that do
+// not shrink are stored as they are.
+//
+// Encoded frame: encoded_frame_header, uint32_t end offset of each tile
+// (from the first tile), then the tiles. Little-endian throughout.
+
+namespace recording {
+
+inline constexpr char tile_codec_magic[4] = {'V', 'K', 'T', '1'};
+
+struct encoded_frame_header {
+  char     magic[4];
+  uint32_t width;
+  uint32_t height;
+  uint16_t tile_width;
+  uint16_t tile_height;
+  uint32_t tile_count;
+};
+
+enum class tile_predictor : uint8_t { left, up, median, stored };
+
+// Runs body(begin, end) over [0, count); by default on the calling thread.
+struct serial_for {
+  template <typename F> void operator()(size_t count, F &&body) const {
+    body(size_t{0}, count);
+  }
+};
+
+// The same across a job system's workers at one priority, or on the
+// calling thread if there is none.
+struct jobs_for {
+  engine::jobs::job_system *jobs = nullptr;
+  engine::jobs::priority    priority = engine::jobs::priority::normal;
+
+  template <typename F> void operator()(size_t count, F &&body) const {
+    if (jobs)
+      jobs->parallel_for(0, count, 1, body, priority);
+    else
+      body(size_t{0}, count);
+  }
+};
+
+namespace tile_codec_detail {
+
+inline constexpr uint32_t block = 32; // Residuals per bit-plane block.
+inline constexpr size_t   max_tile_pixels = 128 * 128;
+
+inline uint16_t zigzag(uint16_t r) noexcept {
+  return static_cast<uint16_t>((r << 1) ^ (static_cast<int16_t>(r) >> 15));
+}
+
+inline uint16_t unzigzag(uint16_t z) noexcept {
+  return static_cast<uint16_t>((z >> 1) ^ (0u - (z & 1u)));
+}
+
+inline uint16_t median(uint16_t a, uint16_t b, uint16_t c) noexcept {
+  const uint16_t lo = std::min(a, b);
+  const uint16_t hi = std::max(a, b);
+  return c >= hi ? lo : c <= lo ? hi : static_cast<uint16_t>(a + b - c);
+}
+
+inline uint16_t residual(tile_predictor p, const uint16_t *cur,
+                         const uint16_t *up, uint32_t x) noexcept {
+  const uint16_t pred = p == tile_predictor::left ? cur[x - 1]
+                        : p == tile_predictor::up ? up[x]
+                                                  : median(cur[x - 1], up[x], up[x - 1]);
+  return zigzag(static_cast<uint16_t>(cur[x] - pred));
+}
+
+#if defined(__SSE2__)
+// residual() for the 8 pixels from x.
+inline __m128i residual8(tile_predictor p, const uint16_t *cur,
+                         const uint16_t *up, uint32_t x) noexcept {
+  auto load = [](const uint16_t *q) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+  };
+  const __m128i c = load(cur + x);
+  const __m128i left = load(cur + x - 1);
+
+  __m128i pred;
+  if (p == tile_predictor::left) {
+    pred = left;
+  } else if (p == tile_predictor::up) {
+    pred = load(up + x);
+  } else {
+    // SSE2 compares and min/max are signed: flip the top bit to order
+    // unsigned values.
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i a = _mm_xor_si128(left, flip);
+    const __m128i b = _mm_xor_si128(load(up + x), flip);
+    const __m128i ul = _mm_xor_si128(load(up + x - 1), flip);
+    const __m128i lo = _mm_min_epi16(a, b);
+    const __m128i hi = _mm_max_epi16(a, b);
+    const __m128i above = _mm_andnot_si128(_mm_cmplt_epi16(ul, hi),
+                                           _mm_set1_epi16(-1)); // ul >= hi
+    const __m128i below = _mm_andnot_si128(
+        above, _mm_andnot_si128(_mm_cmpgt_epi16(ul, lo),
+                                _mm_set1_epi16(-1))); // ul <= lo
+    const __m128i between = _mm_andnot_si128(_mm_or_si128(above, below),
+                                             _mm_set1_epi16(-1));
+    const __m128i planar = _mm_sub_epi16(_mm_add_epi16(a, b), ul);
+    pred = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(above, _mm_xor_si128(lo, flip)),
+                     _mm_and_si128(below, _mm_xor_si128(hi, flip))),
+        _mm_and_si128(between, _mm_xor_si128(planar, flip)));
+  }
+
+  const __m128i r = _mm_sub_epi16(c, pred);
+  return _mm_xor_si128(_mm_slli_epi16(r, 1), _mm_srai_epi16(r, 15));
+}
+#endif
+
+// Zigzagged residuals of one tile row; up is null on the tile's first row,
+// which is always predicted from the left.
+inline void residual_row(tile_predictor p, const uint16_t *cur,
+                         const uint16_t *up, uint32_t n, uint16_t *out) noexcept {
+  if (!up)
+    p = tile_predictor::left;
+  out[0] = zigzag(static_cast<uint16_t>(cur[0] - (up ? up[0] : 0)));
+
+  uint32_t x = 1;
+#if defined(__SSE2__)
+  for (; x + 8 <= n; x += 8)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+                     residual8(p, cur, up, x));
+#endif
+  for (; x < n; ++x)
+    out[x] = residual(p, cur, up, x);
+}
+
+// Inverse of residual_row: rebuilds cur from the residuals.
+inline void restore_row(tile_predictor p, uint16_t *cur, const uint16_t *up,
+                        uint32_t n, const uint16_t *in) noexcept {
+  if (!up) {
+    cur[0] = unzigzag(in[0]);
+    for (uint32_t x = 1; x < n; ++x)
+      cur[x] = static_cast<uint16_t>(cur[x - 1] + unzigzag(in[x]));
+    return;
+  }
+
+  cur[0] = static_cast<uint16_t>(up[0] + unzigzag(in[0]));
+  switch (p) {
+  case tile_predictor::left:
+    for (uint32_t x = 1; x < n; ++x)
+      cur[x] = static_cast<uint16_t>(cur[x - 1] + unzigzag(in[x]));
+    break;
+  case tile_predictor::up:
+    for (uint32_t x = 1; x < n; ++x)
+      cur[x] = static_cast<uint16_t>(up[x] + unzigzag(in[x]));
+    break;
+  default:
+    for (uint32_t x = 1; x < n; ++x)
+      cur[x] = static_cast<uint16_t>(median(cur[x - 1], up[x], up[x - 1]) +
+                                     unzigzag(in[x]));
+    break;
+  }
+}
+
+// Bit k of each of the 32 values, value i in bit i.
+inline uint32_t pack_plane(const uint16_t *v, uint32_t k) noexcept {
+#if defined(__SSE2__)
+  // Shift bit k up to each lane's sign bit, narrow with signed saturation
+  // (which keeps the sign) and collect the signs.
+  const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(15 - k));
+  auto          signs = [&](const uint16_t *p) {
+    const __m128i a = _mm_sll_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), shift);
+    const __m128i b = _mm_sll_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8)), shift);
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(a, b)));
+  };
+  return signs(v) | signs(v + 16) << 16;
+#else
+  uint32_t plane = 0;
+  for (uint32_t i = 0; i < block; ++i)
+    plane |= uint32_t{(v[i] >> k) & 1u} << i;
+  return plane;
+#endif
+}
+
+// ORs bit k of each of the 32 values in from plane.
+inline void unpack_plane(uint32_t plane, uint32_t k, uint16_t *v) noexcept {
+#if defined(__SSE2__)
+  const __m128i lane_bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m128i bit = _mm_set1_epi16(static_cast<short>(1u << k));
+  for (uint32_t g = 0; g < block / 8; ++g) {
+    const __m128i m =
+        _mm_set1_epi16(static_cast<short>((plane >> (8 * g)) & 0xFFu));
+    const __m128i set = _mm_cmpeq_epi16(_mm_and_si128(m, lane_bits), lane_bits);
+    auto *p = reinterpret_cast<__m128i *>(v + 8 * g);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), _mm_and_si128(set, bit)));
+  }
+#else
+  for (uint32_t i = 0; i < block; ++i)
+    v[i] |= static_cast<uint16_t>(((plane >> i) & 1u) << k);
+#endif
+}
+
+inline size_t tile_bound(size_t pixels) noexcept {
+  const size_t blocks = (pixels + block - 1) / block;
+  return 1 + std::max(blocks * (1 + 4 * 16), pixels * 2);
+}
+
+// Encodes the tile at (x0, y0) into out (tile_bound bytes); returns its size.
+inline size_t encode_tile(const uint16_t *frame, uint32_t stride, uint32_t x0,
+                          uint32_t y0, uint32_t w, uint32_t h,
+                          std::byte *out) noexcept {
+  assert(size_t{w} * h <= max_tile_pixels);
+  alignas(16) uint16_t residuals[max_tile_pixels + block];
+  alignas(16) uint16_t row[3][128];
+
+  auto at = [&](uint32_t y) { return frame + size_t{y0 + y} * stride + x0; };
+
+  // The predictor with the smallest residuals over every fourth row.
+  tile_predictor best = tile_predictor::left;
+  {
+    uint64_t cost[3] = {};
+    for (uint32_t y = h > 1 ? 1 : 0; y < h; y += 4)
+      for (uint32_t p = 0; p < 3; ++p) {
+        residual_row(static_cast<tile_predictor>(p), at(y),
+                     y ? at(y - 1) : nullptr, w, row[p]);
+        uint64_t sum = 0;
+        for (uint32_t x = 0; x < w; ++x)
+          sum += row[p][x];
+        cost[p] += sum;
+      }
+    for (uint32_t p = 1; p < 3; ++p)
+      if (cost[p] < cost[static_cast<uint32_t>(best)])
+        best = static_cast<tile_predictor>(p);
+  }
+
+  const size_t pixels = size_t{w} * h;
+  for (uint32_t y = 0; y < h; ++y)
+    residual_row(best, at(y), y ? at(y - 1) : nullptr, w,
+                 residuals + size_t{y} * w);
+  std::fill(residuals + pixels, residuals + pixels + block, uint16_t{0});
+
+  std::byte *o = out;
+  *o++ = static_cast<std::byte>(best);
+  for (size_t i = 0; i < pixels; i += block) {
+    const uint16_t *v = residuals + i;
+    uint16_t        any = 0;
+    for (uint32_t j = 0; j < block; ++j)
+      any |= v[j];
+    const auto width = static_cast<uint32_t>(std::bit_width(any));
+    *o++ = static_cast<std::byte>(width);
+    for (uint32_t k = 0; k < width; ++k) {
+      const uint32_t plane = pack_plane(v, k);
+      std::memcpy(o, &plane, sizeof(plane));
+      o += sizeof(plane);
+    }
+  }
+
+  // Incompressible (noise at full scale): store the pixels.
+  if (static_cast<size_t>(o - out) > 1 + pixels * 2) {
+    o = out;
+    *o++ = static_cast<std::byte>(tile_predictor::stored);
+    for (uint32_t y = 0; y < h; ++y) {
+      std::memcpy(o, at(y), size_t{w} * 2);
+      o += size_t{w} * 2;
+    }
+  }
+  return static_cast<size_t>(o - out);
+}
+
+// Decodes a tile into the frame; false if the data is malformed.
+inline bool decode_tile(std::span<const std::byte> in, uint16_t *frame,
+                        uint32_t stride, uint32_t x0, uint32_t y0, uint32_t w,
+                        uint32_t h) noexcept {
+  if (in.empty() || size_t{w} * h > max_tile_pixels)
+    return false;
+  alignas(16) uint16_t residuals[max_tile_pixels + block];
+
+  auto at = [&](uint32_t y) { return frame + size_t{y0 + y} * stride + x0; };
+
+  const auto   predictor = static_cast<tile_predictor>(in[0]);
+  const size_t pixels = size_t{w} * h;
+  size_t       pos = 1;
+
+  if (predictor == tile_predictor::stored) {
+    if (in.size() != 1 + pixels * 2)
+      return false;
+    for (uint32_t y = 0; y < h; ++y)
+      std::memcpy(at(y), in.data() + 1 + size_t{y} * w * 2, size_t{w} * 2);
+    return true;
+  }
+  if (predictor > tile_predictor::median)
+    return false;
+
+  for (size_t i = 0; i < pixels; i += block) {
+    if (pos >= in.size())
+      return false;
+    const auto width = static_cast<uint32_t>(in[pos++]);
+    if (width > 16 || in.size() - pos < size_t{width} * 4)
+      return false;
+    uint16_t *v = residuals + i;
+    std::fill(v, v + block, uint16_t{0});
+    for (uint32_t k = 0; k < width; ++k) {
+      uint32_t plane;
+      std::memcpy(&plane, in.data() + pos, sizeof(plane));
+      pos += sizeof(plane);
+      unpack_plane(plane, k, v);
+    }
+  }
+  if (pos != in.size())
+    return false;
+
+  for (uint32_t y = 0; y < h; ++y)
+    restore_row(predictor, at(y), y ? at(y - 1) : nullptr, w,
+                residuals + size_t{y} * w);
+  return true;
+}
+
+} // namespace tile_codec_detail
+
+/*========================================================================================
+ *  tile_codec
+ *  -----------------------------------------------------------------------
+ *  •  encode() and decode() take a parallel_for, called as
+ *     parallel_for(count, body) with body(begin, end) over tile indices;
+ *     jobs_for runs them on a job system.
+ *  •  Tiles are at most 128 x 128 pixels; the tile coders keep their
+ *     scratch on the stack, so any thread can run them.
+ *=======================================================================================*/
+class tile_codec {
+public:
+  explicit tile_codec(uint32_t tile_width = 128, uint32_t tile_height = 64)
+      : tile_width_(std::clamp<uint32_t>(tile_width, 1, 128)),
+        tile_height_(std::clamp<uint32_t>(tile_height, 1, 128)) {}
+
+  uint32_t tile_width() const noexcept { return tile_width_; }
+  uint32_t tile_height() const noexcept { return tile_height_; }
+
+  // Room encode() needs for a frame of this size.
+  size_t max_encoded_size(uint32_t width, uint32_t height) const noexcept {
+    const size_t tiles = tile_count(width, height);
+    return sizeof(encoded_frame_header) + tiles * sizeof(uint32_t) +
+           tiles * tile_codec_detail::tile_bound(size_t{tile_width_} * tile_height_);
+  }
+
+  // Encodes a width x height frame into out (max_encoded_size bytes);
+  // returns the encoded size.
+  template <typename ParallelFor = serial_for>
+  size_t encode(std::span<const uint16_t> pixels, uint32_t width,
+                uint32_t height, std::span<std::byte> out,
+                ParallelFor &&parallel_for = {}) {
+    assert(pixels.size() >= size_t{width} * height);
+    assert(out.size() >= max_encoded_size(width, height));
+
+    const uint32_t tiles_x = (width + tile_width_ - 1) / tile_width_;
+    const auto     tiles = static_cast<uint32_t>(tile_count(width, height));
+    const size_t   bound =
+        tile_codec_detail::tile_bound(size_t{tile_width_} * tile_height_);
+    std::byte *const first =
+        out.data() + sizeof(encoded_frame_header) + size_t{tiles} * 4;
+
+    // Each tile codes into its own bound-sized slot; the slots are then
+    // closed up in place, moving every tile towards the front.
+    sizes_.resize(tiles);
+    parallel_for(size_t{tiles}, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; ++t) {
+        const uint32_t x0 = static_cast<uint32_t>(t % tiles_x) * tile_width_;
+        const uint32_t y0 = static_cast<uint32_t>(t / tiles_x) * tile_height_;
+        sizes_[t] = tile_codec_detail::encode_tile(
+            pixels.data(), width, x0, y0, std::min(tile_width_, width - x0),
+            std::min(tile_height_, height - y0), first + t * bound);
+      }
+    });
+
+    size_t end = 0;
+    for (uint32_t t = 0; t < tiles; ++t) {
+      std::memmove(first + end, first + t * bound, sizes_[t]);
+      end += sizes_[t];
+      const auto offset = static_cast<uint32_t>(end);
+      std::memcpy(out.data() + sizeof(encoded_frame_header) + size_t{t} * 4,
+                  &offset, sizeof(offset));
+    }
+
+    encoded_frame_header h{};
+    std::memcpy(h.magic, tile_codec_magic, sizeof(h.magic));
+    h.width = width;
+    h.height = height;
+    h.tile_width = static_cast<uint16_t>(tile_width_);
+    h.tile_height = static_cast<uint16_t>(tile_height_);
+    h.tile_count = tiles;
+    std::memcpy(out.data(), &h, sizeof(h));
+    return static_cast<size_t>(first - out.data()) + end;
+  }
+
+  // The header of an encoded frame, if in holds a well-formed one.
+  static std::optional<encoded_frame_header>
+  header(std::span<const std::byte> in) noexcept {
+    encoded_frame_header h;
+    if (in.size() < sizeof(h))
+      return std::nullopt;
+    std::memcpy(&h, in.data(), sizeof(h));
+    if (std::memcmp(h.magic, tile_codec_magic, sizeof(h.magic)) != 0 ||
+        h.tile_width == 0 || h.tile_width > 128 || h.tile_height == 0 ||
+        h.tile_height > 128 ||
+        h.tile_count != tile_count(h.width, h.height, h.tile_width, h.tile_height) ||
+        in.size() - sizeof(h) < size_t{h.tile_count} * 4)
+      return std::nullopt;
+    return h;
+  }
+
+  // Decodes a whole frame into out (width * height pixels); false if the
+  // data is malformed.
+  template <typename ParallelFor = serial_for>
+  static bool decode(std::span<const std::byte> in, std::span<uint16_t> out,
+                     ParallelFor &&parallel_for = {}) {
+    const auto h = header(in);
+    if (!h || out.size() < size_t{h->width} * h->height)
+      return false;
+
+    std::atomic<bool> ok{true};
+    parallel_for(size_t{h->tile_count}, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; ++t)
+        if (!decode_tile(in, *h, static_cast<uint32_t>(t), out))
+          ok.store(false, std::memory_order_relaxed);
+    });
+    return ok.load();
+  }
+
+  // Decodes one tile, in place in the width * height frame out, without
+  // touching the others.
+  static bool decode_tile(std::span<const std::byte> in,
+                          const encoded_frame_header &h, uint32_t tile,
+                          std::span<uint16_t> out) noexcept {
+    if (tile >= h.tile_count)
+      return false;
+    const std::byte *offsets = in.data() + sizeof(h);
+    const size_t     first = sizeof(h) + size_t{h.tile_count} * 4;
+    uint32_t         begin = 0;
+    uint32_t         end = 0;
+    if (tile)
+      std::memcpy(&begin, offsets + size_t{tile - 1} * 4, 4);
+    std::memcpy(&end, offsets + size_t{tile} * 4, 4);
+    if (begin > end || end > in.size() - first)
+      return false;
+
+    const uint32_t tiles_x = (h.width + h.tile_width - 1) / h.tile_width;
+    const uint32_t x0 = tile % tiles_x * h.tile_width;
+    const uint32_t y0 = tile / tiles_x * h.tile_height;
+    return tile_codec_detail::decode_tile(
+        in.subspan(first + begin, end - begin), out.data(), h.width, x0, y0,
+        std::min<uint32_t>(h.tile_width, h.width - x0),
+        std::min<uint32_t>(h.tile_height, h.height - y0));
+  }
+
+private:
+  static size_t tile_count(uint32_t width, uint32_t height, uint32_t tw,
+                           uint32_t th) noexcept {
+    return size_t{(width + tw - 1) / tw} * ((height + th - 1) / th);
+  }
+  size_t tile_count(uint32_t width, uint32_t height) const noexcept {
+    return tile_count(width, height, tile_width_, tile_height_);
+  }
+
+  uint32_t            tile_width_;
+  uint32_t            tile_height_;
+  std::vector<size_t> sizes_;
+};
+
+} // namespace recording
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+// Collects wall-clock timings of startup phases, which may run on different
+// threads, and logs them as one report once the application is ready.
+class startup_report {
+public:
+  using clock = std::chrono::steady_clock;
+
+  class phase {
+  public:
+    phase(startup_report &report, std::string name)
+        : report_(&report), name_(std::move(name)), start_(clock::now()) {}
+
+    phase(const phase &) = delete;
+    phase &operator=(const phase &) = delete;
+
+    ~phase() { report_->record(std::move(name_), start_, clock::now()); }
+
+  private:
+    startup_report   *report_;
+    std::string       name_;
+    clock::time_point start_;
+  };
+
+  startup_report()
+      : origin_(clock::now()), threads_{std::this_thread::get_id()} {}
+
+  [[nodiscard]]
+  phase measure(std::string name) {
+    return phase(*this, std::move(name));
+  }
+
+  void log() const {
+    using ms = std::chrono::duration<double, std::milli>;
+
+    std::scoped_lock lock(mutex_);
+    spdlog::info("Startup report ({} phases, ready after {:.1f} ms):",
+                 entries_.size(), ms(clock::now() - origin_).count());
+    for (const auto &e : entries_)
+      spdlog::info("  {:<28} {:>8.1f} -> {:>8.1f} ms  ({:>7.1f} ms, thread {})",
+                   e.name, ms(e.start - origin_).count(),
+                   ms(e.end - origin_).count(), ms(e.end - e.start).count(),
+                   e.thread);
+  }
+
+private:
+  struct entry {
+    std::string       name;
+    clock::time_point start;
+    clock::time_point end;
+    size_t            thread;
+  };
+
+  void record(std::string name, clock::time_point start,
+              clock::time_point end) {
+    std::scoped_lock lock(mutex_);
+
+    // Threads are numbered in order of first appearance; 0 is the thread that
+    // created the report.
+    auto it = std::ranges::find(threads_, std::this_thread::get_id());
+    if (it == threads_.end())
+      it = threads_.insert(it, std::this_thread::get_id());
+
+    entries_.push_back({std::move(name), start, end,
+                        static_cast<size_t>(it - threads_.begin())});
+  }
+
+  clock::time_point            origin_;
+  mutable std::mutex           mutex_;
+  std::vector<std::thread::id> threads_;
+  std::vector<entry>           entries_;
+};
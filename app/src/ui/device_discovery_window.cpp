@@ -4,20 +4,27 @@
 #include <imgui.h>
 #include <imgui_stdlib.h>
 
+#include <placement.hpp>
 #include <util.hpp>
 
 device_discovery_window::device_discovery_window(device_manager &device_manager)
     : device_manager_(device_manager) {}
 
 void device_discovery_window::render() {
-  if (ImGui::Begin("Device Discovery")) {
-    if (ImGui::Button("Discover Devices")) {
-      discovery_error_message_.clear();
-      selected_device_idx_ = std::nullopt;
-
-      auto result = device_manager_.discover_devices(discovery_timeout_ms_);
-      if (!result)
-        discovery_error_message_ = sl_error_to_string(result.error());
+  if (ImGui::Begin(window_name)) {
+    // Devices are only ever appended, so a selected index stays valid while
+    // discovery runs.
+    const auto devices = device_manager_.discovered_devices();
+    const bool discovering = device_manager_.discovering();
+
+    if (discovering)
+      ImGui::BeginDisabled();
+    if (ImGui::Button("Discover Devices"))
+      device_manager_.start_discovery(discovery_timeout_ms_);
+    if (discovering) {
+      ImGui::EndDisabled();
+      ImGui::SameLine();
+      ImGui::TextUnformatted("Discovering...");
     }
 
     ImGui::SameLine();
@@ -28,6 +35,8 @@ void device_discovery_window::render() {
     ImGui::PopItemWidth();
     ImGui::Separator();
 
+    if (!discovering)
+      discovery_error_message_ = device_manager_.last_discovery_error();
     if (!discovery_error_message_.empty()) {
       ImVec4 error_color = ImVec4(1.0f, 0.2f, 0.2f, 1.0f);
       ImGui::TextColored(error_color, "Discovery Error: %s",
@@ -35,16 +44,17 @@ void device_discovery_window::render() {
       ImGui::Separator();
     }
 
-    if (ImGui::BeginTable("Devices", 2,
+    if (ImGui::BeginTable("Devices", 4,
                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
                               ImGuiTableFlags_SizingFixedFit)) {
       ImGui::TableSetupColumn("Interface");
       ImGui::TableSetupColumn("ID");
+      ImGui::TableSetupColumn("Model");
+      ImGui::TableSetupColumn("Serial");
       ImGui::TableHeadersRow();
 
-      const auto &discovered_devices = device_manager_.get_discovered_devices();
-      for (int i = 0; i < discovered_devices.size(); ++i) {
-        const auto &discovered_device = discovered_devices[i];
+      for (uint32_t i = 0; i < devices.size(); ++i) {
+        const auto &discovered_device = devices[i];
 
         ImGui::TableNextRow();
         ImGui::TableNextColumn();
@@ -60,29 +70,228 @@ void device_discovery_window::render() {
           break;
         }
 
-        const bool is_selected = (i == *selected_device_idx_);
+        const bool is_selected = (selected_device_idx_ == i);
         if (ImGui::Selectable(interface_text, is_selected,
                               ImGuiSelectableFlags_SpanAllColumns)) {
           selected_device_idx_ = i;
         }
 
-        ImGui::TableNextColumn();
-        ImGui::TextUnformatted(id_text.c_str());
+        // Not answered (yet): shown from the cache or an earlier pass.
+        const ImVec4 stale_color = ImVec4(0.5f, 0.5f, 0.5f, 1.0f);
+        const auto   cell = [&](const std::string &text) {
+          ImGui::TableNextColumn();
+          if (discovered_device.stale)
+            ImGui::TextColored(stale_color, "%s", text.c_str());
+          else
+            ImGui::TextUnformatted(text.c_str());
+        };
+        cell(id_text);
+        cell(discovered_device.model);
+        cell(discovered_device.serial);
       }
       ImGui::EndTable();
     }
 
     ImGui::Separator();
 
+    const char *driver_names[] = {"Filter driver", "Socket (user space)"};
+    int         driver = static_cast<int>(driver_);
+    ImGui::PushItemWidth(180.0f);
+    if (ImGui::Combo("Stream Driver", &driver, driver_names,
+                     IM_ARRAYSIZE(driver_names)))
+      driver_ = static_cast<stream_driver>(driver);
+    ImGui::PopItemWidth();
+
+    ImGui::PushItemWidth(120.0f);
+    ImGui::InputText("Acquisition CPUs (e.g. 2-3,6)", &cpu_list_);
+    ImGui::InputInt("NUMA Node (-1: NIC node)", &numa_node_);
+    ImGui::Checkbox("Real-time (SCHED_FIFO)", &realtime_);
+    if (realtime_) {
+      ImGui::SameLine();
+      if (ImGui::InputInt("Priority", &realtime_priority_))
+        realtime_priority_ = std::clamp(realtime_priority_, 1, 99);
+    }
+#ifdef APP_HAS_SOCKET_DRIVER
+    if (driver_ == stream_driver::socket &&
+        ImGui::InputInt("Control reads in flight", &control_reads_in_flight_))
+      control_reads_in_flight_ = std::clamp(control_reads_in_flight_, 1, 64);
+#endif
+    ImGui::PopItemWidth();
+
     if (selected_device_idx_) {
-      if (ImGui::Button("Connect")) {
-        const auto &devices = device_manager_.get_discovered_devices();
-        if (*selected_device_idx_ < devices.size()) {
-          const auto &selected_device = devices[*selected_device_idx_];
+      if (*selected_device_idx_ < devices.size()) {
+        const auto &selected_device = devices[*selected_device_idx_];
+
+        if (auto *session = device_manager_.find_session(selected_device)) {
+          if (ImGui::Button("Disconnect"))
+            device_manager_.close_device(session);
+        } else if (ImGui::Button("Connect")) {
+          connect_error_message_.clear();
+
+          session_options options{.driver = driver_};
+          if (numa_node_ >= 0)
+            options.placement.numa_node = numa_node_;
+          if (realtime_)
+            options.placement.realtime_priority = realtime_priority_;
+#ifdef APP_HAS_SOCKET_DRIVER
+          options.control.max_outstanding =
+              static_cast<uint32_t>(control_reads_in_flight_);
+#endif
+
+          if (auto cpus = placement::parse_cpu_list(cpu_list_)) {
+            options.placement.cpus = std::move(*cpus);
+
+            auto result = device_manager_.open_device(selected_device, options);
+            if (!result)
+              connect_error_message_ = to_string(result.error());
+          } else {
+            connect_error_message_ = "Invalid CPU list: " + cpu_list_;
+          }
         }
       }
     }
+
+    if (!connect_error_message_.empty()) {
+      ImVec4 error_color = ImVec4(1.0f, 0.2f, 0.2f, 1.0f);
+      ImGui::TextColored(error_color, "Connect Error: %s",
+                         connect_error_message_.c_str());
+    }
+
+    render_sessions();
   }
 
   ImGui::End();
-}
\ No newline at end of file
+}
+void device_discovery_window::render_sessions() {
+  const auto &sessions = device_manager_.sessions();
+  if (sessions.empty())
+    return;
+
+  // Rates are averaged over half a second so the figures stay readable.
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_sample_ >= std::chrono::milliseconds(500)) {
+    const double seconds =
+        std::chrono::duration<double>(now - last_sample_).count();
+
+    std::unordered_map<const device_session *, session_rate> rates;
+    for (const auto &session : sessions) {
+      const uint64_t frames = session->stats().frames;
+      const uint64_t bytes = session->stats().bytes;
+
+      session_rate rate{.frames = frames, .bytes = bytes};
+      if (auto it = rates_.find(session.get()); it != rates_.end()) {
+        rate.frames_per_second = (frames - it->second.frames) / seconds;
+        rate.bytes_per_second = (bytes - it->second.bytes) / seconds;
+      }
+      rates.emplace(session.get(), rate);
+    }
+    rates_ = std::move(rates);
+    last_sample_ = now;
+  }
+
+  ImGui::Separator();
+  if (!ImGui::BeginTable("Sessions", 6,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_SizingFixedFit))
+    return;
+
+  ImGui::TableSetupColumn("Device");
+  ImGui::TableSetupColumn("Driver");
+  ImGui::TableSetupColumn("NUMA");
+  ImGui::TableSetupColumn("Frames");
+  ImGui::TableSetupColumn("FPS");
+  ImGui::TableSetupColumn("MB/s");
+  ImGui::TableHeadersRow();
+
+  double total_fps = 0.0;
+  double total_bytes_per_second = 0.0;
+
+  for (const auto &session : sessions) {
+    const auto &descriptor = session->device().descriptor;
+    const auto  it = rates_.find(session.get());
+    const auto  rate = it != rates_.end() ? it->second : session_rate{};
+
+    total_fps += rate.frames_per_second;
+    total_bytes_per_second += rate.bytes_per_second;
+
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(
+        util::format_ip_address(descriptor.gev_descriptor.device_ip_address)
+            .c_str());
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(
+        session->driver() == stream_driver::socket ? "Socket" : "Filter");
+    ImGui::TableNextColumn();
+    if (auto node = session->numa_node())
+      ImGui::Text("%d", *node);
+    else
+      ImGui::TextUnformatted("-");
+    ImGui::TableNextColumn();
+    ImGui::Text("%llu (%llu incomplete, %llu dropped)",
+                static_cast<unsigned long long>(session->stats().frames),
+                static_cast<unsigned long long>(
+                    session->stats().frames_incomplete),
+                static_cast<unsigned long long>(session->stats().frames_dropped));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", rate.frames_per_second);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.1f", rate.bytes_per_second / 1e6);
+  }
+
+  const auto total = device_manager_.aggregate();
+
+  ImGui::TableNextRow();
+  ImGui::TableNextColumn();
+  ImGui::Text("Total (%zu)", total.sessions);
+  ImGui::TableNextColumn();
+  ImGui::TableNextColumn();
+  ImGui::TableNextColumn();
+  ImGui::Text("%llu (%llu incomplete, %llu dropped)",
+              static_cast<unsigned long long>(total.frames),
+              static_cast<unsigned long long>(total.frames_incomplete),
+              static_cast<unsigned long long>(total.frames_dropped));
+  ImGui::TableNextColumn();
+  ImGui::Text("%.1f", total_fps);
+  ImGui::TableNextColumn();
+  ImGui::Text("%.1f", total_bytes_per_second / 1e6);
+
+  ImGui::EndTable();
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  for (const auto &session : sessions) {
+    const auto *stats = session->receiver_stats();
+    if (!stats)
+      continue;
+
+    const auto wakeup = stats->wakeup_latency.read();
+    const auto us = [](std::chrono::nanoseconds d) {
+      return static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    };
+
+    ImGui::Text("%s: packets %llu, resent %llu, lost %llu, kernel drops %llu",
+                util::format_ip_address(
+                    session->device().descriptor.gev_descriptor.device_ip_address)
+                    .c_str(),
+                static_cast<unsigned long long>(stats->packets),
+                static_cast<unsigned long long>(stats->packets_requested),
+                static_cast<unsigned long long>(stats->packets_lost),
+                static_cast<unsigned long long>(stats->kernel_drops));
+    ImGui::Text("  wake-up latency: p50 <= %lld us, p99 <= %lld us, "
+                "p99.9 <= %lld us, max %lld us",
+                us(wakeup.quantile(0.5)), us(wakeup.quantile(0.99)),
+                us(wakeup.quantile(0.999)), us(wakeup.max));
+
+    const auto pipeline = session->pipeline_stats();
+    ImGui::Text("  pipeline: %u in flight, latency p99 <= %lld us",
+                pipeline.in_flight, us(pipeline.latency.quantile(0.99)));
+    for (const auto &stage : pipeline.stages)
+      ImGui::Text("    %-8s p99 <= %lld us, waited p99 <= %lld us, "
+                  "occupancy %.2f, queued max %u",
+                  stage.name.c_str(), us(stage.service.quantile(0.99)),
+                  us(stage.wait.quantile(0.99)), stage.occupancy,
+                  stage.max_queued);
+  }
+#endif
+}
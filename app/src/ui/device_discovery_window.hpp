@@ -1,20 +1,45 @@
 #pragma once
 
+#include <chrono>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 #include <device_manager.hpp>
 
 class device_discovery_window {
 public:
+  static constexpr const char *window_name = "Device Discovery";
+
   device_discovery_window(device_manager &);
 
   void render();
 
 private:
-  device_manager device_manager_;
+  struct session_rate {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    double   frames_per_second = 0.0;
+    double   bytes_per_second = 0.0;
+  };
+
+  void render_sessions();
+
+  device_manager &device_manager_;
 
   uint32_t                discovery_timeout_ms_ = 200;
   std::string             discovery_error_message_;
   std::optional<uint32_t> selected_device_idx_ = std::nullopt;
-};
\ No newline at end of file
+
+  stream_driver driver_ = stream_driver::filter;
+  std::string   connect_error_message_;
+  std::string   cpu_list_;
+  int           numa_node_ = -1;
+  bool          realtime_ = false;
+  int           realtime_priority_ = 50;
+  // More than one only for devices known to queue GVCP commands.
+  int control_reads_in_flight_ = 1;
+
+  std::chrono::steady_clock::time_point                    last_sample_{};
+  std::unordered_map<const device_session *, session_rate> rates_;
+};
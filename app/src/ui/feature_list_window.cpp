@@ -0,0 +1,292 @@
+#include "feature_list_window.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+
+#include <imgui.h>
+
+namespace {
+
+#ifdef APP_HAS_SOCKET_DRIVER
+// Categories nest a handful of levels; the limit only guards against
+// descriptions whose categories refer back to themselves.
+constexpr int max_depth = 16;
+
+std::string_view kind_name(gev::node_kind kind) {
+  switch (kind) {
+  case gev::node_kind::category: return "Category";
+  case gev::node_kind::integer: return "Integer";
+  case gev::node_kind::float_: return "Float";
+  case gev::node_kind::boolean: return "Boolean";
+  case gev::node_kind::enumeration: return "Enumeration";
+  case gev::node_kind::enum_entry: return "EnumEntry";
+  case gev::node_kind::command: return "Command";
+  case gev::node_kind::string: return "String";
+  case gev::node_kind::int_reg: return "IntReg";
+  case gev::node_kind::masked_int_reg: return "MaskedIntReg";
+  case gev::node_kind::float_reg: return "FloatReg";
+  case gev::node_kind::string_reg: return "StringReg";
+  case gev::node_kind::register_: return "Register";
+  case gev::node_kind::struct_reg: return "StructReg";
+  case gev::node_kind::converter: return "Converter";
+  case gev::node_kind::int_converter: return "IntConverter";
+  case gev::node_kind::swiss_knife: return "SwissKnife";
+  case gev::node_kind::int_swiss_knife: return "IntSwissKnife";
+  case gev::node_kind::port: return "Port";
+  default: return "Node";
+  }
+}
+
+// A polled value as the feature shows it. Converter and SwissKnife
+// formulas are not evaluated, so those show the register's raw value.
+std::string format_value(const gev::node_map &map, gev::node_index feature,
+                         gev::node_index reg, const gev::feature_value &value) {
+  const gev::node &f = map[feature];
+  const gev::node &r = map[reg];
+
+  if (f.kind == gev::node_kind::enumeration) {
+    for (const auto &entry : map.links(f.children))
+      if (map[entry.target].constant == value.raw)
+        return std::string(map.str(map[entry.target].name));
+    return std::format("{} (no entry)", value.raw);
+  }
+  if (f.kind == gev::node_kind::boolean)
+    return value.raw ? "True" : "False";
+
+  std::string text;
+  if (r.kind == gev::node_kind::float_reg && r.length == 4)
+    text = std::format("{:g}", std::bit_cast<float>(
+                                   static_cast<uint32_t>(value.raw)));
+  else if (r.kind == gev::node_kind::float_reg && r.length == 8)
+    text = std::format("{:g}", std::bit_cast<double>(value.raw));
+  else
+    text = std::to_string(value.raw);
+
+  const auto unit = map.str(f.unit);
+  if (f.kind == gev::node_kind::converter ||
+      f.kind == gev::node_kind::int_converter ||
+      f.kind == gev::node_kind::swiss_knife ||
+      f.kind == gev::node_kind::int_swiss_knife)
+    text += " (raw)";
+  else if (!unit.empty())
+    text += std::format(" {}", unit);
+  return text;
+}
+#endif
+
+} // namespace
+
+#ifdef APP_HAS_SOCKET_DRIVER
+void feature_list_window::set_features(
+    std::shared_ptr<const gev::node_map>  map,
+    std::shared_ptr<gev::feature_poller> poller) {
+  poller_ = std::move(poller);
+  if (map == map_)
+    return;
+
+  map_ = std::move(map);
+  tree_.clear();
+  search_.clear();
+  row_nodes_.clear();
+  row_labels_.clear();
+  selected_row_ = feature_tree::no_row;
+  search_buffer_.fill('\0');
+  matches_ = 0;
+
+  if (!map_ || map_->root() == gev::no_node)
+    return;
+
+  // Root itself is not shown; its features are the top level.
+  for (const auto &child : map_->links((*map_)[map_->root()].children))
+    add_rows(child.target, 0);
+  search_.build();
+}
+
+void feature_list_window::add_rows(gev::node_index index, int depth) {
+  const gev::node &n = (*map_)[index];
+  if (n.visibility == gev::visibility_level::invisible)
+    return;
+
+  const uint32_t row = tree_.open();
+  row_nodes_.push_back(index);
+  row_labels_.push_back(
+      map_->str(n.display_name.empty() ? n.name : n.display_name));
+
+  const std::string_view texts[] = {map_->str(n.name),
+                                    map_->str(n.display_name)};
+  search_.add(texts);
+
+  if (n.kind == gev::node_kind::category && depth < max_depth)
+    for (const auto &child : map_->links(n.children))
+      add_rows(child.target, depth + 1);
+  tree_.close();
+
+  // Top-level categories start open, the rest closed.
+  tree_.set_expanded(row, depth == 0);
+}
+#endif
+
+void feature_list_window::render() {
+  if (ImGui::Begin(window_name)) {
+    if (tree_.size() == 0) {
+      ImGui::TextDisabled("No features; use Load Features in Device Control.");
+    } else {
+      render_search();
+      render_rows();
+      render_selection();
+      render_poll_stats();
+    }
+  }
+  ImGui::End();
+}
+
+void feature_list_window::render_search() {
+  ImGui::SetNextItemWidth(-1);
+  if (ImGui::InputTextWithHint("##search", "Search features",
+                               search_buffer_.data(), search_buffer_.size())) {
+    const std::string_view query = search_buffer_.data();
+    if (query.empty()) {
+      tree_.clear_filter();
+    } else {
+      const auto start = std::chrono::steady_clock::now();
+      const auto matches = search_.find(query);
+      tree_.set_filter(matches);
+      search_us_ = std::chrono::duration<double, std::micro>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      matches_ = matches.size();
+    }
+  }
+
+  if (tree_.filtered()) {
+    ImGui::TextDisabled("%zu of %zu features in %.0f us", matches_,
+                        tree_.size(), search_us_);
+  } else {
+    if (ImGui::SmallButton("Expand all"))
+      tree_.expand_all(true);
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Collapse all"))
+      tree_.expand_all(false);
+  }
+}
+
+void feature_list_window::render_rows() {
+  // Keep a few lines for the selection and poll statistics below.
+  const float details_height = ImGui::GetTextLineHeightWithSpacing() * 7;
+  if (ImGui::BeginChild("##features", ImVec2(0, -details_height), false,
+                        ImGuiWindowFlags_HorizontalScrollbar)) {
+    const auto  visible = tree_.visible();
+    const auto  rows = tree_.rows();
+    const float indent = ImGui::GetTreeNodeToLabelSpacing();
+    const bool  filtered = tree_.filtered();
+#ifdef APP_HAS_SOCKET_DRIVER
+    const float value_column = ImGui::GetContentRegionAvail().x * 0.55f;
+    on_screen_.clear();
+#endif
+
+    // Only the rows in view are submitted; the clipper spaces out the rest.
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(visible.size()));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+        const uint32_t     row = visible[i];
+        const feature_row &r = rows[row];
+
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen |
+                                   ImGuiTreeNodeFlags_SpanAvailWidth;
+        if (!tree_.has_children(row))
+          flags |= ImGuiTreeNodeFlags_Leaf;
+        else
+          flags |= ImGuiTreeNodeFlags_OpenOnArrow;
+        if (row == selected_row_)
+          flags |= ImGuiTreeNodeFlags_Selected;
+
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() + indent * r.depth);
+        if (tree_.has_children(row))
+          ImGui::SetNextItemOpen(filtered || r.expanded);
+
+        // Labels are views into the node map, not NUL-terminated strings.
+        const std::string_view label = row_labels_[row];
+        const bool open = ImGui::TreeNodeEx(
+            reinterpret_cast<void *>(static_cast<uintptr_t>(row)), flags,
+            "%.*s", static_cast<int>(label.size()), label.data());
+        if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
+          selected_row_ = row;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+        on_screen_.push_back(row_nodes_[row]);
+        if (poller_)
+          if (const auto v = poller_->value(row_nodes_[row])) {
+            const auto text = format_value(
+                *map_, row_nodes_[row], poller_->register_of(row_nodes_[row]),
+                *v);
+            ImGui::SameLine(value_column);
+            if (v->stale)
+              ImGui::TextDisabled("%s", text.c_str());
+            else
+              ImGui::TextUnformatted(text.c_str());
+          }
+#endif
+
+        // Takes effect from the next frame's visible().
+        if (tree_.has_children(row) && !filtered)
+          tree_.set_expanded(row, open);
+      }
+    }
+  }
+  ImGui::EndChild();
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Exactly what the clipper submitted: the poller reads nothing else,
+  // apart from watched features.
+  if (poller_)
+    poller_->set_visible(on_screen_);
+#endif
+}
+
+void feature_list_window::render_selection() {
+  ImGui::Separator();
+#ifdef APP_HAS_SOCKET_DRIVER
+  if (selected_row_ == feature_tree::no_row || !map_)
+    return;
+
+  const gev::node &n = (*map_)[row_nodes_[selected_row_]];
+  const auto       name = map_->str(n.name);
+  const auto       kind = kind_name(n.kind);
+  ImGui::Text("%.*s (%.*s)", static_cast<int>(name.size()), name.data(),
+              static_cast<int>(kind.size()), kind.data());
+
+  if (poller_ && poller_->register_of(row_nodes_[selected_row_]) != gev::no_node) {
+    ImGui::SameLine();
+    bool watched = poller_->subscribed(row_nodes_[selected_row_]);
+    if (ImGui::Checkbox("Watch", &watched)) {
+      if (watched)
+        poller_->subscribe(row_nodes_[selected_row_]);
+      else
+        poller_->unsubscribe(row_nodes_[selected_row_]);
+    }
+  }
+
+  const auto meta = map_->str(n.description.empty() ? n.tooltip : n.description);
+  ImGui::TextWrapped("Meta Information: %.*s", static_cast<int>(meta.size()),
+                     meta.data());
+#endif
+}
+
+void feature_list_window::render_poll_stats() {
+#ifdef APP_HAS_SOCKET_DRIVER
+  if (!poller_)
+    return;
+
+  const auto s = poller_->stats();
+  ImGui::TextDisabled("Polling %u registers: %.1f%% of the control channel, "
+                      "%u reads/s, %llu invalidated, %llu errors",
+                      s.polled, s.utilisation * 100.0, s.registers_per_second,
+                      static_cast<unsigned long long>(s.invalidations),
+                      static_cast<unsigned long long>(s.errors));
+#endif
+}
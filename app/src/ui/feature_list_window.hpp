@@ -1,21 +1,59 @@
 #pragma once
 
-#include <vector>
+#include <array>
+#include <memory>
 #include <string_view>
+#include <vector>
 
-struct tree_node {
-    std::string_view name;
-    std::vector<tree_node> children;
-    std::string_view meta_info;
-};
+#include "feature_tree.hpp"
+
+#ifdef APP_HAS_SOCKET_DRIVER
+#include <gev/feature_poller.hpp>
+#include <gev/node_map.hpp>
+#endif
 
+// The feature tree of the loaded GenICam node map, from its Root category
+// down, flattened once per map so that a frame only draws the rows on
+// screen. Names and descriptions are views into the map, which the window
+// keeps alive. With a poller, the rows on screen and the watched features
+// show live values; nothing else is read from the device.
 class feature_list_window {
 public:
-    feature_list_window();
-    void render();
+  static constexpr const char *window_name = "Features";
+
+  feature_list_window() = default;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Rebuilds the rows if map is not the one shown already. poller may be
+  // null, e.g. for a description loaded from a file.
+  void set_features(std::shared_ptr<const gev::node_map>  map,
+                    std::shared_ptr<gev::feature_poller> poller);
+#endif
+
+  void render();
+
 private:
-    void render_tree(const tree_node& node);
+  void render_search();
+  void render_rows();
+  void render_selection();
+  void render_poll_stats();
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  void add_rows(gev::node_index index, int depth);
+
+  std::shared_ptr<const gev::node_map> map_;
+  std::shared_ptr<gev::feature_poller> poller_;
+  std::vector<gev::node_index>         row_nodes_; // By row.
+  std::vector<gev::node_index>         on_screen_; // This frame's rows.
+#endif
+  std::vector<std::string_view> row_labels_;
 
-    tree_node root;
-    const tree_node* selected_node = nullptr;
-};
\ No newline at end of file
+  feature_tree   tree_;
+  feature_search search_;
+
+  std::array<char, 128> search_buffer_{};
+  size_t                matches_ = 0;
+  double                search_us_ = 0.0;
+
+  uint32_t selected_row_ = feature_tree::no_row;
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>   /* std::ranges::sort, std::ranges::lower_bound */
+#include <cassert>     /* assert */
+#include <cstdint>     /* uint32_t */
+#include <span>        /* std::span */
+#include <string>      /* lower-cased text pool */
+#include <string_view> /* std::string_view */
+#include <utility>     /* std::pair */
+#include <vector>      /* std::vector */
+
+// A tree flattened into pre-order rows, so that drawing it is a walk over
+// an array (and, with ImGuiListClipper, only over the rows on screen)
+// rather than a recursion over every node each frame.
+
+struct feature_row {
+  uint32_t depth = 0;
+  uint32_t parent = ~0u; // feature_tree::no_row at the top level.
+  uint32_t end = 0;      // One past the last row of this row's subtree.
+  bool     expanded = false;
+};
+
+class feature_tree {
+public:
+  static constexpr uint32_t no_row = ~0u;
+
+  void clear() {
+    rows_.clear();
+    open_.clear();
+    visible_.clear();
+    filter_.clear();
+    filtered_ = false;
+    dirty_ = true;
+  }
+
+  // Builds the rows in pre-order: open() a row, add its children, close()
+  // it. Returns the new row's index.
+  uint32_t open() {
+    const auto row = static_cast<uint32_t>(rows_.size());
+    rows_.push_back({.depth = static_cast<uint32_t>(open_.size()),
+                     .parent = open_.empty() ? no_row : open_.back(),
+                     .end = row + 1,
+                     .expanded = false});
+    open_.push_back(row);
+    dirty_ = true;
+    return row;
+  }
+
+  void close() {
+    assert(!open_.empty());
+    rows_[open_.back()].end = static_cast<uint32_t>(rows_.size());
+    open_.pop_back();
+  }
+
+  std::span<const feature_row> rows() const noexcept { return rows_; }
+  size_t                       size() const noexcept { return rows_.size(); }
+
+  bool has_children(uint32_t row) const noexcept {
+    return rows_[row].end > row + 1;
+  }
+
+  void set_expanded(uint32_t row, bool expanded) {
+    if (rows_[row].expanded != expanded) {
+      rows_[row].expanded = expanded;
+      dirty_ = !filtered_;
+    }
+  }
+
+  void expand_all(bool expanded) {
+    for (auto &r : rows_)
+      r.expanded = expanded;
+    dirty_ = !filtered_;
+  }
+
+  // Shows only matches (ascending row indices) and their ancestors, all
+  // expanded; expand state is left alone for when the filter is cleared.
+  void set_filter(std::span<const uint32_t> matches) {
+    filter_.assign(matches.begin(), matches.end());
+    filtered_ = true;
+    dirty_ = true;
+  }
+
+  void clear_filter() {
+    filter_.clear();
+    filtered_ = false;
+    dirty_ = true;
+  }
+
+  bool filtered() const noexcept { return filtered_; }
+
+  // Rows to draw, in order. Rebuilt only after a change, in one pass over
+  // the rows (or the matches and their ancestors).
+  std::span<const uint32_t> visible() {
+    if (dirty_)
+      filtered_ ? rebuild_filtered() : rebuild_expanded();
+    dirty_ = false;
+    return visible_;
+  }
+
+private:
+  void rebuild_expanded() {
+    visible_.clear();
+    for (uint32_t row = 0; row < rows_.size();) {
+      visible_.push_back(row);
+      row = rows_[row].expanded ? row + 1 : rows_[row].end;
+    }
+  }
+
+  void rebuild_filtered() {
+    marked_.assign(rows_.size(), 0);
+    for (uint32_t row : filter_)
+      for (uint32_t r = row; r != no_row && !marked_[r]; r = rows_[r].parent)
+        marked_[r] = 1;
+
+    visible_.clear();
+    for (uint32_t row = 0; row < rows_.size(); ++row)
+      if (marked_[row])
+        visible_.push_back(row);
+  }
+
+  std::vector<feature_row> rows_;
+  std::vector<uint32_t>    open_; // Rows open() has not closed, outermost first.
+
+  std::vector<uint32_t> visible_;
+  std::vector<uint32_t> filter_;
+  std::vector<uint8_t>  marked_;
+  bool                  filtered_ = false;
+  bool                  dirty_ = true;
+};
+
+/*========================================================================================
+ *  feature_search
+ *  -----------------------------------------------------------------------
+ *  •  Case-insensitive substring search over a fixed set of entries, each
+ *     one or more strings (a feature's name and display name, say).
+ *  •  A trigram index narrows a query to the entries holding its rarest
+ *     trigram before any string is compared, so a query costs in
+ *     proportion to its matches rather than to the number of entries.
+ *  •  Incremental: a query that contains the previous one (the user typed
+ *     another character) only rechecks the previous matches.
+ *=======================================================================================*/
+class feature_search {
+public:
+  void clear() {
+    text_.clear();
+    starts_.clear();
+    keys_.clear();
+    postings_.clear();
+    posting_starts_.clear();
+    last_query_.clear();
+    matches_.clear();
+  }
+
+  // Adds an entry; ids are assigned in order from 0.
+  uint32_t add(std::span<const std::string_view> texts) {
+    const auto id = static_cast<uint32_t>(starts_.size());
+    starts_.push_back(static_cast<uint32_t>(text_.size()));
+    for (auto t : texts) {
+      for (char c : t)
+        text_ += lower(c);
+      text_ += '\n'; // Keeps a query from matching across two strings.
+    }
+    return id;
+  }
+
+  // Indexes the entries added; call once after the last add().
+  void build() {
+    starts_.push_back(static_cast<uint32_t>(text_.size()));
+
+    std::vector<std::pair<uint32_t, uint32_t>> pairs; // (trigram, id)
+    pairs.reserve(text_.size());
+    for (uint32_t id = 0; id + 1 < starts_.size(); ++id)
+      for (uint32_t i = starts_[id]; i + 3 <= starts_[id + 1]; ++i)
+        pairs.emplace_back(trigram(std::string_view(text_).substr(i, 3)), id);
+    std::ranges::sort(pairs);
+    const auto [first, last] = std::ranges::unique(pairs);
+    pairs.erase(first, last);
+
+    keys_.clear();
+    postings_.clear();
+    posting_starts_.clear();
+    postings_.reserve(pairs.size());
+    for (const auto &[key, id] : pairs) {
+      if (keys_.empty() || keys_.back() != key) {
+        keys_.push_back(key);
+        posting_starts_.push_back(static_cast<uint32_t>(postings_.size()));
+      }
+      postings_.push_back(id);
+    }
+    posting_starts_.push_back(static_cast<uint32_t>(postings_.size()));
+
+    last_query_.clear();
+    matches_.clear();
+  }
+
+  size_t size() const noexcept {
+    return starts_.empty() ? 0 : starts_.size() - 1;
+  }
+
+  // Ids of the entries containing query, ascending. An empty query
+  // matches nothing; callers show everything instead.
+  std::span<const uint32_t> find(std::string_view query) {
+    std::string q;
+    q.reserve(query.size());
+    for (char c : query)
+      q += lower(c);
+
+    if (q.empty() || size() == 0) {
+      matches_.clear();
+    } else if (!last_query_.empty() && q.find(last_query_) != std::string::npos) {
+      // Narrowing: every match of q is already a match of the last query.
+      std::erase_if(matches_, [&](uint32_t id) { return !contains(id, q); });
+    } else {
+      candidates(q);
+    }
+
+    last_query_ = std::move(q);
+    return matches_;
+  }
+
+private:
+  static char lower(char c) noexcept {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+
+  static uint32_t trigram(std::string_view s) noexcept {
+    return uint32_t{static_cast<uint8_t>(s[0])} << 16 |
+           uint32_t{static_cast<uint8_t>(s[1])} << 8 |
+           uint32_t{static_cast<uint8_t>(s[2])};
+  }
+
+  bool contains(uint32_t id, std::string_view q) const noexcept {
+    const std::string_view entry =
+        std::string_view(text_).substr(starts_[id], starts_[id + 1] - starts_[id]);
+    return entry.find(q) != std::string_view::npos;
+  }
+
+  void candidates(std::string_view q) {
+    matches_.clear();
+
+    if (q.size() < 3) {
+      // Too short for a trigram; a scan of the pool is still only a few
+      // hundred kilobytes for the largest descriptions.
+      for (uint32_t id = 0; id < size(); ++id)
+        if (contains(id, q))
+          matches_.push_back(id);
+      return;
+    }
+
+    // Start from the rarest trigram; no entry outside it can match.
+    std::span<const uint32_t> best;
+    for (size_t i = 0; i + 3 <= q.size(); ++i) {
+      const auto it = std::ranges::lower_bound(keys_, trigram(q.substr(i, 3)));
+      if (it == keys_.end() || *it != trigram(q.substr(i, 3)))
+        return; // A trigram no entry has.
+      const auto k = static_cast<size_t>(it - keys_.begin());
+      const std::span<const uint32_t> list(postings_.data() + posting_starts_[k],
+                                           posting_starts_[k + 1] -
+                                               posting_starts_[k]);
+      if (best.empty() || list.size() < best.size())
+        best = list;
+    }
+
+    for (uint32_t id : best)
+      if (contains(id, q))
+        matches_.push_back(id);
+  }
+
+  std::string           text_;   // Lower-cased entries, back to back.
+  std::vector<uint32_t> starts_; // Entry i is text_[starts_[i], starts_[i+1]).
+
+  // Trigram -> ids, as sorted keys and one array of posting lists.
+  std::vector<uint32_t> keys_;
+  std::vector<uint32_t> posting_starts_;
+  std::vector<uint32_t> postings_;
+
+  std::string           last_query_;
+  std::vector<uint32_t> matches_;
+};
@@ -0,0 +1,291 @@
+#include "frame_viewer_window.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <imgui.h>
+#include <nfd.h>
+
+frame_viewer_window::frame_viewer_window(live_view                &view,
+                                         engine::jobs::job_system &jobs)
+    : view_(view), jobs_(jobs), window_low_(view.processor().window().low),
+      window_high_(view.processor().window().high),
+      raw_size_{static_cast<int>(view.texture().extent().width),
+                static_cast<int>(view.texture().extent().height)} {}
+
+void frame_viewer_window::render() {
+  if (ImGui::Begin(window_name)) {
+    ImGui::PushItemWidth(200.0f);
+    bool changed = ImGui::DragIntRange2("Window", &window_low_, &window_high_,
+                                        64.0f, 0, 0xFFFF, "Low: %d",
+                                        "High: %d");
+    ImGui::PopItemWidth();
+    if (changed)
+      view_.processor().set_window(
+          {.low = static_cast<uint16_t>(window_low_),
+           .high = static_cast<uint16_t>(std::max(window_high_, window_low_))});
+
+    ImGui::SameLine();
+    ImGui::Text("Frame %llu",
+                static_cast<unsigned long long>(view_.frame_index()));
+
+    render_playback();
+    render_export();
+
+    // Fit the frame into the remaining space, preserving aspect ratio.
+    const auto   extent = view_.texture().extent();
+    const ImVec2 avail = ImGui::GetContentRegionAvail();
+    const float  scale =
+        std::max(0.0f, std::min(avail.x / extent.width, avail.y / extent.height));
+
+    ImGui::Image(view_.texture().imgui_texture(),
+                 {extent.width * scale, extent.height * scale});
+  }
+  ImGui::End();
+}
+
+void frame_viewer_window::render_playback() {
+  auto *playback = view_.playback();
+
+  ImGui::SameLine();
+  if (ImGui::Button(playback ? "Open..." : "Open recording..."))
+    open_recording();
+  render_raw_layout();
+  if (!status_.empty()) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted(status_.c_str());
+  }
+  if (!playback)
+    return;
+
+  ImGui::SameLine();
+  if (ImGui::Button("Live")) {
+    view_.set_playback(nullptr);
+    return;
+  }
+
+  if (ImGui::Button(playback->playing() ? "Pause" : "Play"))
+    playback->set_playing(!playback->playing());
+  ImGui::SameLine();
+  bool loop = playback->loop();
+  if (ImGui::Checkbox("Loop", &loop))
+    playback->set_loop(loop);
+  ImGui::SameLine();
+  float rate = static_cast<float>(playback->rate());
+  ImGui::SetNextItemWidth(120.0f);
+  if (ImGui::InputFloat("fps (0: every frame)", &rate, 0.0f, 0.0f, "%.1f"))
+    playback->set_rate(rate);
+
+  // Scrubbing is a seek per frame drawn; the index makes each one a lookup.
+  int frame = static_cast<int>(playback->position());
+  ImGui::SetNextItemWidth(-1.0f);
+  if (ImGui::SliderInt("##frame", &frame, 0,
+                       static_cast<int>(playback->frame_count()) - 1,
+                       "Frame %d"))
+    playback->seek(static_cast<size_t>(frame));
+  if (ImGui::IsItemHovered() && playback->frame_count()) {
+    const auto &entry = playback->entry(playback->position());
+    ImGui::SetTooltip("%s\n%zu frames, recorded at %.1f fps\nid %llu, %ux%u%s",
+                      playback->path().string().c_str(),
+                      playback->frame_count(), playback->recorded_rate(),
+                      static_cast<unsigned long long>(entry.frame_id),
+                      entry.width, entry.height,
+                      entry.flags & recording::frame_incomplete ? ", incomplete"
+                                                                : "");
+  }
+}
+
+void frame_viewer_window::render_export() {
+  auto *playback = view_.playback();
+
+  if (ImGui::Button("Export frame..."))
+    export_snapshot();
+  if (playback && playback->frame_count()) {
+    const int last = static_cast<int>(playback->frame_count()) - 1;
+    ImGui::SameLine();
+    if (ImGui::Button("Export frames..."))
+      export_frames();
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160.0f);
+    ImGui::InputInt2("Range", export_range_);
+    export_range_[0] = std::clamp(export_range_[0], 0, last);
+    export_range_[1] = std::clamp(export_range_[1], export_range_[0], last);
+  }
+  ImGui::SameLine();
+  static const char *compression_names[] = {"Uncompressed", "Deflate"};
+  ImGui::SetNextItemWidth(130.0f);
+  ImGui::Combo("##compression", &export_compression_, compression_names,
+               IM_ARRAYSIZE(compression_names));
+  ImGui::SameLine();
+  ImGui::Checkbox("BigTIFF", &export_bigtiff_);
+  if (ImGui::IsItemHovered())
+    ImGui::SetTooltip("Used anyway once a file could pass 4 GiB");
+
+  for (size_t i = 0; i < exports_.size();) {
+    const auto &e = exports_[i];
+    const auto  progress = e->progress();
+    ImGui::PushID(e.get());
+    bool remove = false;
+    if (!progress.done) {
+      char overlay[64];
+      std::snprintf(overlay, sizeof(overlay), "%zu / %zu, %.0f MB/s",
+                    progress.frames, progress.total,
+                    progress.seconds > 0 ? progress.bytes / 1e6 / progress.seconds
+                                         : 0.0);
+      ImGui::ProgressBar(progress.total ? static_cast<float>(progress.frames) /
+                                              progress.total
+                                        : 0.0f,
+                         ImVec2(240.0f, 0.0f), overlay);
+      ImGui::SameLine();
+      if (ImGui::SmallButton("Cancel"))
+        e->cancel();
+    } else {
+      remove = ImGui::SmallButton("x");
+      ImGui::SameLine();
+      if (progress.error)
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "%s",
+                           progress.error.message().c_str());
+      else
+        ImGui::Text("%zu frame(s), %.1f MB in %.2f s", progress.frames,
+                    progress.bytes / 1e6, progress.seconds);
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(e->path().filename().string().c_str());
+    if (ImGui::IsItemHovered())
+      ImGui::SetTooltip("%s", e->path().string().c_str());
+    ImGui::PopID();
+
+    if (remove)
+      exports_.erase(exports_.begin() + static_cast<std::ptrdiff_t>(i));
+    else
+      ++i;
+  }
+}
+
+recording::tiff_options frame_viewer_window::export_options() const {
+  return {
+      .compression = export_compression_ == 1 ? recording::tiff_compression::deflate
+                                              : recording::tiff_compression::none,
+      .bigtiff = export_bigtiff_,
+  };
+}
+
+std::optional<std::filesystem::path>
+frame_viewer_window::pick_export_path(const char *name) {
+  nfdchar_t      *out_path = nullptr;
+  nfdfilteritem_t filter_item[1] = {{"TIFF", "tif,tiff"}};
+  nfdresult_t result = NFD_SaveDialog(&out_path, filter_item, 1, nullptr, name);
+  if (result == NFD_ERROR) {
+    status_ = std::string("Export failed: ") + NFD_GetError();
+    return std::nullopt;
+  }
+  if (result != NFD_OKAY)
+    return std::nullopt;
+  std::filesystem::path path(out_path);
+  NFD_FreePath(out_path);
+  return path;
+}
+
+void frame_viewer_window::export_snapshot() {
+  auto path = pick_export_path("frame.tif");
+  if (!path)
+    return;
+
+  // A recording frame is read back from the file by the export itself;
+  // a live one costs the UI thread a single copy.
+  if (auto *playback = view_.playback(); playback && playback->frame_count()) {
+    exports_.push_back(recording::tiff_export::sequence(
+        std::move(*path), export_options(), *playback, playback->position(), 1,
+        &jobs_));
+    return;
+  }
+  const auto frame = view_.raw_frame();
+  const auto extent = view_.texture().extent();
+  exports_.push_back(recording::tiff_export::frame(
+      std::move(*path), export_options(),
+      std::vector<uint16_t>(frame.begin(), frame.end()), extent.width,
+      extent.height, &jobs_));
+}
+
+void frame_viewer_window::export_frames() {
+  auto *playback = view_.playback();
+  auto  path = pick_export_path("frames.tif");
+  if (!playback || !path)
+    return;
+  exports_.push_back(recording::tiff_export::sequence(
+      std::move(*path), export_options(), *playback,
+      static_cast<size_t>(export_range_[0]),
+      static_cast<size_t>(export_range_[1] - export_range_[0] + 1), &jobs_));
+}
+
+void frame_viewer_window::open_recording() {
+  nfdchar_t      *in_path = nullptr;
+  nfdfilteritem_t filter_item[3] = {{"Recording", "vkrec"},
+                                    {"TIFF stack", "tif,tiff"},
+                                    {"Raw frames", "raw,bin,dat"}};
+  nfdresult_t     result = NFD_OpenDialog(&in_path, filter_item, 3, nullptr);
+  if (result == NFD_ERROR) {
+    status_ = std::string("Open failed: ") + NFD_GetError();
+    return;
+  }
+  if (result != NFD_OKAY)
+    return;
+  std::filesystem::path path(in_path);
+  NFD_FreePath(in_path);
+
+  const auto extension = path.extension();
+  if (extension == ".raw" || extension == ".bin" || extension == ".dat") {
+    raw_path_ = std::move(path);
+    ImGui::OpenPopup("Raw layout");
+    return;
+  }
+  open_playback(path, std::nullopt);
+}
+
+void frame_viewer_window::render_raw_layout() {
+  if (!ImGui::BeginPopupModal("Raw layout", nullptr,
+                              ImGuiWindowFlags_AlwaysAutoResize))
+    return;
+  ImGui::TextUnformatted(raw_path_.filename().string().c_str());
+  ImGui::SetNextItemWidth(160.0f);
+  ImGui::InputInt2("Width, height", raw_size_);
+  ImGui::SetNextItemWidth(160.0f);
+  ImGui::InputInt("Header bytes", &raw_header_);
+  ImGui::SetNextItemWidth(160.0f);
+  ImGui::InputInt("Frame stride (0: packed)", &raw_stride_);
+  ImGui::Checkbox("Big-endian", &raw_big_endian_);
+  raw_size_[0] = std::max(raw_size_[0], 1);
+  raw_size_[1] = std::max(raw_size_[1], 1);
+  raw_header_ = std::max(raw_header_, 0);
+  raw_stride_ = std::max(raw_stride_, 0);
+
+  if (ImGui::Button("Open")) {
+    open_playback(raw_path_,
+                  recording::raw_layout{
+                      .width = static_cast<uint32_t>(raw_size_[0]),
+                      .height = static_cast<uint32_t>(raw_size_[1]),
+                      .header_bytes = static_cast<uint64_t>(raw_header_),
+                      .frame_bytes = static_cast<uint64_t>(raw_stride_),
+                      .big_endian = raw_big_endian_,
+                  });
+    ImGui::CloseCurrentPopup();
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Cancel"))
+    ImGui::CloseCurrentPopup();
+  ImGui::EndPopup();
+}
+
+void frame_viewer_window::open_playback(const std::filesystem::path &path,
+                                        std::optional<recording::raw_layout> raw) {
+  auto playback = recording::playback::open(path, {.jobs = &jobs_, .raw = raw});
+  if (playback) {
+    (*playback)->set_playing(true);
+    export_range_[0] = 0;
+    export_range_[1] = static_cast<int>((*playback)->frame_count()) - 1;
+    view_.set_playback(std::move(*playback));
+    status_.clear();
+  } else {
+    status_ = "Cannot play " + path.string() + ": " + playback.error().message();
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "display/live_view.hpp"
+#include "recording/tiff_export.hpp"
+
+class frame_viewer_window {
+public:
+  static constexpr const char *window_name = "Viewer";
+
+  // Recordings opened here decode, and exports encode, on jobs.
+  frame_viewer_window(live_view &view, engine::jobs::job_system &jobs);
+
+  void render();
+
+private:
+  void render_playback();
+  void open_recording();
+  // Raw dumps say nothing about themselves; their layout is asked for.
+  void render_raw_layout();
+  void open_playback(const std::filesystem::path               &path,
+                     std::optional<recording::raw_layout> raw);
+
+  // Exports run in the background; the window only polls them.
+  void render_export();
+  void export_snapshot();
+  void export_frames();
+  recording::tiff_options              export_options() const;
+  std::optional<std::filesystem::path> pick_export_path(const char *name);
+
+  live_view                &view_;
+  engine::jobs::job_system &jobs_;
+
+  int window_low_;
+  int window_high_;
+
+  std::string status_;
+
+  std::filesystem::path raw_path_;
+  int                   raw_size_[2];
+  int                   raw_header_ = 0;
+  int                   raw_stride_ = 0;
+  bool                  raw_big_endian_ = false;
+
+  int  export_compression_ = 1; // Index into the compression names.
+  bool export_bigtiff_ = false;
+  int  export_range_[2] = {0, 0};
+  std::vector<std::unique_ptr<recording::tiff_export>> exports_;
+};
@@ -1,7 +1,15 @@
 #include "gev_device_control_window.hpp"
+#include <algorithm>
 #include <charconv>
-#include <iostream>
+#include <fstream>
+#include <limits>
 #include <nfd.h>
+#include <spdlog/spdlog.h>
+#include <util.hpp>
+
+#ifdef APP_HAS_SOCKET_DRIVER
+#include <device_control.hpp>
+#endif
 
 namespace {
 
@@ -10,29 +18,49 @@ constexpr ImVec4 COLOR_ERROR{1.0f, 0.0f, 0.0f, 1.0f};   // Red
 constexpr ImVec4 COLOR_INFO{1.0f, 1.0f, 1.0f, 1.0f};    // White
 constexpr ImVec4 COLOR_OK{0.0f, 1.0f, 0.0f, 1.0f};      // Green
 
+std::string session_label(const device_session &session) {
+  return util::format_ip_address(session.device().ip_address());
+}
+
 } // namespace
 
-gev_device_control_window::gev_device_control_window(std::string_view name)
-    : name_(name) {}
+gev_device_control_window::gev_device_control_window(
+    device_manager &device_manager, async::operations &operations)
+    : device_manager_(device_manager), operations_(operations) {}
 
 void gev_device_control_window::render() {
-  if (ImGui::Begin(name_.c_str())) {
-    ImGui::Text("Register Control");
-    ImGui::Separator();
-
-    ImGui::InputText("Address (hex/dec)", address_buffer_.data(),
-                     address_buffer_.size());
-
-    ImGui::InputText("Value (hex/dec)", value_buffer_.data(),
-                     value_buffer_.size());
+  if (ImGui::Begin(window_name)) {
+    const device_session *selected = selected_session();
+
+#ifdef APP_HAS_SOCKET_DRIVER
+    // Stop polling a device whose session has closed.
+    if (poller_ && std::ranges::none_of(device_manager_.sessions(),
+                                        [&](const auto &session) {
+                                          return session->registers() ==
+                                                 poller_->registers();
+                                        }))
+      poller_.reset();
+#endif
+
+    const std::string preview =
+        selected ? session_label(*selected) : std::string("(no session)");
+    if (ImGui::BeginCombo("Session", preview.c_str())) {
+      for (const auto &session : device_manager_.sessions()) {
+        const bool is_selected = session.get() == selected;
+        if (ImGui::Selectable(session_label(*session).c_str(), is_selected))
+          selected_ = session.get();
+        if (is_selected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+
+    ImGui::SetNextItemWidth(120);
+    ImGui::InputInt("Timeout (ms)", &timeout_ms_, 100, 1000);
+    timeout_ms_ = std::clamp(timeout_ms_, 100, 60000);
 
     ImGui::Spacing();
-
-    if (ImGui::Button("Read"))
-      handle_read_register_button();
-    ImGui::SameLine();
-    if (ImGui::Button("Write"))
-      handle_write_register_button();
+    render_registers();
 
     ImGui::Spacing();
     ImGui::Separator();
@@ -45,12 +73,38 @@ void gev_device_control_window::render() {
     ImGui::SameLine();
     if (ImGui::Button("Save XML"))
       handle_save_xml_button();
+    ImGui::SameLine();
+    if (ImGui::Button("Load Features"))
+      handle_load_features_button();
+
+    if (!xml_override_path_.empty()) {
+      ImGui::TextDisabled("Using %s", xml_override_path_.c_str());
+      ImGui::SameLine();
+      if (ImGui::SmallButton("Clear"))
+        xml_override_path_.clear();
+    }
+#ifdef APP_HAS_SOCKET_DRIVER
+    if (node_map_)
+      ImGui::TextDisabled("Features: %zu nodes from %s%s", node_map_->size(),
+                          node_map_source_.c_str(),
+                          node_map_->from_cache() ? " (cached)" : "");
+#endif
 
     ImGui::Spacing();
     ImGui::Separator();
 
     ImGui::Text("Acquisition");
     ImGui::Spacing();
+    ImGui::SetNextItemWidth(120);
+    ImGui::InputText("Start register", start_address_buffer_.data(),
+                     start_address_buffer_.size());
+    ImGui::SetNextItemWidth(120);
+    ImGui::InputText("Stop register", stop_address_buffer_.data(),
+                     stop_address_buffer_.size());
+    ImGui::SetNextItemWidth(120);
+    ImGui::InputText("Trigger register", trigger_address_buffer_.data(),
+                     trigger_address_buffer_.size());
+
     if (ImGui::Button("Start Acquisition"))
       handle_start_acq_button();
     ImGui::SameLine();
@@ -64,6 +118,13 @@ void gev_device_control_window::render() {
     ImGui::Spacing();
     ImGui::Separator();
 
+    ImGui::Text("Pending operations: %zu", operations_.pending());
+    ImGui::SameLine();
+    ImGui::BeginDisabled(operations_.pending() == 0);
+    if (ImGui::Button("Cancel all"))
+      operations_.cancel_all();
+    ImGui::EndDisabled();
+
     ImGui::Text("Status:");
     ImGui::SameLine();
     ImGui::TextColored(status_color_, "%s", status_message_.c_str());
@@ -71,6 +132,138 @@ void gev_device_control_window::render() {
   ImGui::End();
 }
 
+const device_session *gev_device_control_window::selected_session() {
+  for (const auto &session : device_manager_.sessions())
+    if (session.get() == selected_)
+      return selected_;
+
+  // Closed since it was selected; fall back to the first open session.
+  const auto &sessions = device_manager_.sessions();
+  selected_ = sessions.empty() ? nullptr : sessions.front().get();
+  return selected_;
+}
+
+void gev_device_control_window::render_registers() {
+  ImGui::Text("Register Control");
+  ImGui::Separator();
+
+  ImGui::InputText("Addresses (hex/dec)", address_buffer_.data(),
+                   address_buffer_.size());
+
+  ImGui::InputText("Values (hex/dec)", value_buffer_.data(),
+                   value_buffer_.size());
+
+  ImGui::Spacing();
+
+  if (ImGui::Button("Read"))
+    handle_read_register_button();
+  ImGui::SameLine();
+  if (ImGui::Button("Write"))
+    handle_write_register_button();
+  ImGui::SameLine();
+  if (ImGui::Button("Read on all devices"))
+    handle_read_all_button();
+
+  const char *policy_names[] = {"Volatile", "Cached", "Write-through"};
+  ImGui::SetNextItemWidth(140);
+  ImGui::Combo("##policy", &policy_, policy_names, IM_ARRAYSIZE(policy_names));
+  ImGui::SameLine();
+  if (ImGui::Button("Set cache policy"))
+    handle_set_policy_button();
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  if (const device_session *session = selected_session();
+      session && session->registers()) {
+    ImGui::SameLine();
+    if (ImGui::Button("Invalidate cache"))
+      session->registers()->invalidate_all();
+
+    const auto stats = session->registers()->stats();
+    ImGui::TextDisabled("Cache: %llu hits, %llu misses, %llu batches",
+                        static_cast<unsigned long long>(stats.hits),
+                        static_cast<unsigned long long>(stats.misses),
+                        static_cast<unsigned long long>(stats.batches));
+  }
+#endif
+
+  if (!all_results_.empty() &&
+      ImGui::BeginTable("all_results", 2,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Device");
+    ImGui::TableSetupColumn("Values");
+    ImGui::TableHeadersRow();
+    for (const auto &[device, values] : all_results_) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(device.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(values.c_str());
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::Spacing();
+  ImGui::Text("Register Sweep");
+  ImGui::SetNextItemWidth(120);
+  ImGui::InputText("Start", sweep_start_buffer_.data(),
+                   sweep_start_buffer_.size());
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(120);
+  if (ImGui::InputInt("Count", &sweep_count_, 64, 1024))
+    sweep_count_ = std::clamp(sweep_count_, 1, 1 << 20);
+  ImGui::SameLine();
+  if (ImGui::Button("Sweep"))
+    handle_sweep_button();
+
+  render_register_values();
+}
+
+void gev_device_control_window::render_register_values() {
+  if (register_values_.empty())
+    return;
+
+  const auto refused = std::ranges::count_if(
+      register_values_, [](const register_value &r) { return !r.value; });
+  ImGui::TextDisabled("%zu registers in %.2f ms, %zu refused",
+                      register_values_.size(), register_values_ms_,
+                      static_cast<size_t>(refused));
+
+  const float height = ImGui::GetTextLineHeightWithSpacing() *
+                       std::min<float>(register_values_.size() + 1.0f, 16.0f);
+  if (!ImGui::BeginTable("register_values", 3,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_ScrollY,
+                         ImVec2(0.0f, height)))
+    return;
+
+  ImGui::TableSetupScrollFreeze(0, 1);
+  ImGui::TableSetupColumn("Address");
+  ImGui::TableSetupColumn("Hex");
+  ImGui::TableSetupColumn("Decimal");
+  ImGui::TableHeadersRow();
+
+  // Sweeps can return many thousands of rows; only draw the visible ones.
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(register_values_.size()));
+  while (clipper.Step())
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+      const auto &r = register_values_[i];
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("0x%08X", r.address);
+      ImGui::TableNextColumn();
+      if (r.value) {
+        ImGui::Text("0x%08X", *r.value);
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", *r.value);
+      } else {
+        ImGui::TextDisabled("refused");
+        ImGui::TableNextColumn();
+      }
+    }
+  ImGui::EndTable();
+}
+
 std::optional<uint64_t>
 gev_device_control_window::parse_input(std::string_view input_str) const {
   auto sv = std::string_view(input_str.data());
@@ -97,72 +290,431 @@ gev_device_control_window::parse_input(std::string_view input_str) const {
   return std::nullopt;
 }
 
+std::optional<uint32_t>
+gev_device_control_window::parse_u32(std::string_view input_str,
+                                     std::string_view what) {
+  auto parsed = parse_input(input_str);
+  if (!parsed) {
+    set_status(std::format("Error: Invalid {} format.", what), COLOR_ERROR);
+    return std::nullopt;
+  }
+  if (*parsed > std::numeric_limits<uint32_t>::max()) {
+    set_status(std::format("Error: {} exceeds 32-bit limit.", what),
+               COLOR_ERROR);
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(*parsed);
+}
+
+std::optional<std::vector<uint32_t>>
+gev_device_control_window::parse_list(std::string_view input_str,
+                                      std::string_view what) {
+  std::vector<uint32_t> values;
+
+  std::string_view rest(input_str.data());
+  while (!rest.empty()) {
+    const size_t end = rest.find_first_of(", ");
+    const std::string token(rest.substr(0, end));
+    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+    if (token.empty())
+      continue;
+
+    auto value = parse_u32(token, what);
+    if (!value)
+      return std::nullopt;
+    values.push_back(*value);
+  }
+
+  if (values.empty()) {
+    set_status(std::format("Error: No {} given.", what), COLOR_ERROR);
+    return std::nullopt;
+  }
+  return values;
+}
+
 void gev_device_control_window::handle_set_xml_button() {
   nfdchar_t      *out_path = nullptr;
   nfdfilteritem_t filterItem[1] = {{"XML file", "xml"}};
   nfdresult_t     result = NFD_OpenDialog(&out_path, filterItem, 1, NULL);
 
-  if (result == NFD_OKAY)
-    NFD_FreePath(out_path);
-  else if (result == NFD_ERROR)
-    std::cerr << "Error: " << NFD_GetError() << std::endl;
+  if (result == NFD_ERROR) {
+    set_status(std::format("Error: {}", NFD_GetError()), COLOR_ERROR);
+    return;
+  }
+  if (result != NFD_OKAY)
+    return;
+
+  xml_override_path_ = out_path;
+  NFD_FreePath(out_path);
+
+  // Loading the features is what the description is for.
+  handle_load_features_button();
+}
+
+void gev_device_control_window::handle_load_features_button() {
+#ifdef APP_HAS_SOCKET_DRIVER
+  // A local description needs no session; the device's own does.
+  const device_session *session = selected_session();
+  auto registers = session ? session->registers() : nullptr;
+  if (xml_override_path_.empty() && !registers) {
+    set_status("Error: Needs a socket driver session or Set XML.", COLOR_ERROR);
+    return;
+  }
+
+  std::string source = xml_override_path_.empty()
+                           ? session_label(*session)
+                           : xml_override_path_;
+  operations_.spawn(
+      [registers, path = xml_override_path_](std::stop_token stop) {
+        return device_control::load_node_map(
+            registers, path, util::cache_directory() / "genicam", stop);
+      },
+      std::chrono::milliseconds(timeout_ms_) * 10, // Descriptions are large.
+      [this, source, registers](
+          std::expected<device_control::loaded_node_map, std::error_code> r) {
+        if (!r) {
+          set_status(std::format("Error: Loading features from {}: {}", source,
+                                 r.error().message()),
+                     COLOR_ERROR);
+          return;
+        }
+        node_map_ = std::move(r->map);
+        node_map_source_ = source;
+        poller_ = registers ? std::make_shared<gev::feature_poller>(
+                                  node_map_, registers)
+                            : nullptr;
+        set_status(std::format("Loaded {} nodes in {:.1f} ms{}; {} registers "
+                               "cacheable per the description.",
+                               node_map_->size(), r->compile_ms,
+                               node_map_->from_cache() ? " from the cache" : "",
+                               r->policies),
+                   COLOR_OK);
+      });
+  set_status("Loading features...", COLOR_INFO);
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
 }
 
 void gev_device_control_window::handle_save_xml_button() {
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
+    return;
+  }
+
+  operations_.spawn(
+      [registers = session->registers()](std::stop_token stop) {
+        return device_control::read_genicam_xml(registers, stop);
+      },
+      std::chrono::milliseconds(timeout_ms_) * 10, // Descriptions are large.
+      [this](std::expected<std::string, std::error_code> xml) {
+        if (!xml) {
+          set_status(std::format("Error: Reading XML: {}",
+                                 xml.error().message()),
+                     COLOR_ERROR);
+          return;
+        }
+
+        nfdchar_t      *out_path = nullptr;
+        nfdfilteritem_t filterItem[1] = {{"XML file", "xml"}};
+        nfdresult_t     result =
+            NFD_SaveDialog(&out_path, filterItem, 1, NULL, "device.xml");
+        if (result == NFD_ERROR) {
+          set_status(std::format("Error: {}", NFD_GetError()), COLOR_ERROR);
+          return;
+        }
+        if (result != NFD_OKAY) {
+          set_status("Save cancelled.", COLOR_INFO);
+          return;
+        }
+
+        std::ofstream out(out_path, std::ios::binary);
+        out.write(xml->data(), static_cast<std::streamsize>(xml->size()));
+        if (out)
+          set_status(std::format("Saved {} bytes to {}", xml->size(), out_path),
+                     COLOR_OK);
+        else
+          set_status(std::format("Error: Could not write {}", out_path),
+                     COLOR_ERROR);
+        NFD_FreePath(out_path);
+      });
+  set_status("Reading XML...", COLOR_INFO);
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
 }
 
 void gev_device_control_window::handle_write_register_button() {
-  auto parsed_addr = parse_input(address_buffer_.data());
-  if (!parsed_addr) {
-    set_status("Error: Invalid address format.", COLOR_ERROR);
+  const auto addresses = parse_list(address_buffer_.data(), "address");
+  if (!addresses)
+    return;
+  const auto values = parse_list(value_buffer_.data(), "value");
+  if (!values)
+    return;
+  if (values->size() != 1 && values->size() != addresses->size()) {
+    set_status("Error: Give one value, or one per address.", COLOR_ERROR);
     return;
   }
-  if (*parsed_addr > std::numeric_limits<uint32_t>::max()) {
-    set_status("Error: Address exceeds 32-bit limit.", COLOR_ERROR);
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
     return;
   }
 
-  auto parsed_val = parse_input(value_buffer_.data());
-  if (!parsed_val) {
-    set_status("Error: Invalid value format.", COLOR_ERROR);
+  std::vector<std::pair<uint32_t, uint32_t>> writes;
+  writes.reserve(addresses->size());
+  for (size_t i = 0; i < addresses->size(); ++i)
+    writes.emplace_back((*addresses)[i],
+                        (*values)[values->size() == 1 ? 0 : i]);
+
+  operations_.spawn(
+      [registers = session->registers(),
+       writes = std::move(writes)](std::stop_token stop) {
+        return device_control::write_registers(registers, writes, stop);
+      },
+      std::chrono::milliseconds(timeout_ms_),
+      [this, registers = session->registers(),
+       addresses = *addresses](std::expected<void, std::error_code> r) {
+        // Even a failed write may have landed in part.
+        notify_written(registers, addresses);
+        if (r)
+          set_status(std::format("Wrote {} registers", addresses.size()),
+                     COLOR_OK);
+        else
+          set_status(std::format("Error: Write: {}", r.error().message()),
+                     COLOR_ERROR);
+      });
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
+}
+
+void gev_device_control_window::handle_read_register_button() {
+  auto addresses = parse_list(address_buffer_.data(), "address");
+  if (!addresses)
+    return;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
     return;
   }
-  if (*parsed_val > std::numeric_limits<uint32_t>::max()) {
-    set_status("Error: Value exceeds 32-bit limit.", COLOR_ERROR);
+
+  operations_.spawn(
+      [registers = session->registers(),
+       addresses = *addresses](std::stop_token stop) {
+        return device_control::read_registers(registers, addresses, stop);
+      },
+      std::chrono::milliseconds(timeout_ms_),
+      [this, addresses = *addresses,
+       start = std::chrono::steady_clock::now()](
+          std::expected<std::vector<uint32_t>, std::error_code> r) {
+        if (!r) {
+          set_status(std::format("Error: Read: {}", r.error().message()),
+                     COLOR_ERROR);
+          return;
+        }
+
+        register_values_.clear();
+        for (size_t i = 0; i < addresses.size(); ++i)
+          register_values_.push_back({addresses[i], (*r)[i]});
+        register_values_ms_ = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        if (addresses.size() == 1)
+          set_status(std::format("0x{:08X} = 0x{:08X} ({})", addresses[0],
+                                 r->front(), r->front()),
+                     COLOR_SUCCESS);
+        else
+          set_status(std::format("Read {} registers", addresses.size()),
+                     COLOR_SUCCESS);
+      });
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
+}
+
+void gev_device_control_window::handle_read_all_button() {
+  const auto addresses = parse_list(address_buffer_.data(), "address");
+  if (!addresses)
+    return;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  // One operation per device, all in flight at once; each row fills in as
+  // its answer arrives.
+  all_results_.clear();
+  for (const auto &session : device_manager_.sessions()) {
+    const std::string label = session_label(*session);
+    if (!session->registers()) {
+      all_results_[label] = "filter driver";
+      continue;
+    }
+
+    all_results_[label] = "...";
+    operations_.spawn(
+        [registers = session->registers(),
+         addresses = *addresses](std::stop_token stop) {
+          return device_control::read_registers(registers, addresses, stop);
+        },
+        std::chrono::milliseconds(timeout_ms_),
+        [this, label](std::expected<std::vector<uint32_t>, std::error_code> r) {
+          if (!r) {
+            all_results_[label] = r.error().message();
+            return;
+          }
+          std::string text;
+          for (uint32_t v : *r)
+            text += std::format("{}0x{:08X}", text.empty() ? "" : " ", v);
+          all_results_[label] = std::move(text);
+        });
+  }
+  set_status(std::format("Reading {} registers on {} devices",
+                         addresses->size(), all_results_.size()),
+             COLOR_INFO);
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
+}
+
+void gev_device_control_window::handle_set_policy_button() {
+  const auto addresses = parse_list(address_buffer_.data(), "address");
+  if (!addresses)
+    return;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
     return;
   }
 
-  const uint32_t address = static_cast<uint32_t>(*parsed_addr);
-  const uint32_t value = static_cast<uint32_t>(*parsed_val);
+  // Only touches the cache; no device round trip.
+  for (uint32_t address : *addresses)
+    session->registers()->set_policy(address,
+                                     static_cast<gev::cache_policy>(policy_));
+  set_status(std::format("Cache policy set for {} registers", addresses->size()),
+             COLOR_OK);
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
 }
 
-void gev_device_control_window::handle_read_register_button() {
-  auto parsed_addr = parse_input(address_buffer_.data());
-  if (!parsed_addr) {
-    set_status("Error: Invalid address format.", COLOR_ERROR);
+void gev_device_control_window::handle_sweep_button() {
+  const auto first = parse_u32(sweep_start_buffer_.data(), "start address");
+  if (!first)
+    return;
+  if (*first % 4) {
+    set_status("Error: Registers are 4-byte aligned.", COLOR_ERROR);
     return;
   }
 
-  if (*parsed_addr > std::numeric_limits<uint32_t>::max()) {
-    set_status("Error: Address exceeds 32-bit limit.", COLOR_ERROR);
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
     return;
   }
+
+  const auto count = static_cast<uint32_t>(sweep_count_);
+  operations_.spawn(
+      [registers = session->registers(), first = *first,
+       count](std::stop_token stop) {
+        return device_control::sweep(registers, first, count, stop);
+      },
+      std::chrono::milliseconds(timeout_ms_) * 10,
+      [this, first = *first, start = std::chrono::steady_clock::now()](
+          std::expected<std::vector<std::optional<uint32_t>>, std::error_code>
+              r) {
+        if (!r) {
+          set_status(std::format("Error: Sweep: {}", r.error().message()),
+                     COLOR_ERROR);
+          return;
+        }
+
+        register_values_.clear();
+        register_values_.reserve(r->size());
+        for (size_t i = 0; i < r->size(); ++i)
+          register_values_.push_back(
+              {first + static_cast<uint32_t>(i * 4), (*r)[i]});
+        register_values_ms_ = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        set_status(std::format("Swept {} registers", r->size()), COLOR_SUCCESS);
+      });
+  set_status("Sweeping...", COLOR_INFO);
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
 }
 
 void gev_device_control_window::handle_start_acq_button() {
-  set_status("Acquisition started (dummy)", COLOR_OK);
+  execute_command(start_address_buffer_.data(), "Acquisition start");
 }
 
 void gev_device_control_window::handle_stop_acq_button() {
-  set_status("Acquisition stopped (dummy)", COLOR_OK);
+  execute_command(stop_address_buffer_.data(), "Acquisition stop");
 }
 
 void gev_device_control_window::handle_trigger_button() {
-  set_status("Software trigger fired (dummy)", COLOR_OK);
+  execute_command(trigger_address_buffer_.data(), "Software trigger");
+
+  // What led up to the trigger is saved with it, if the session keeps it.
+  if (const device_session *session = selected_session();
+      session && session->history())
+    if (auto ec = session->save_history())
+      set_status(std::format("Error: Saving history: {}", ec.message()),
+                 COLOR_ERROR);
+}
+
+void gev_device_control_window::execute_command(
+    std::string_view address_text, [[maybe_unused]] std::string_view what) {
+  const auto address = parse_u32(address_text, "command register");
+  if (!address)
+    return;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  const device_session *session = selected_session();
+  if (!session || !session->registers()) {
+    set_status("Error: Needs a socket driver session.", COLOR_ERROR);
+    return;
+  }
+
+  operations_.spawn(
+      [registers = session->registers(),
+       address = *address](std::stop_token stop) {
+        return device_control::execute_command(registers, address, stop);
+      },
+      std::chrono::milliseconds(timeout_ms_),
+      [this, registers = session->registers(), address = *address,
+       what = std::string(what)](std::expected<void, std::error_code> r) {
+        notify_written(registers, std::span(&address, 1));
+        if (r)
+          set_status(what + " sent", COLOR_OK);
+        else
+          set_status(std::format("Error: {}: {}", what, r.error().message()),
+                     COLOR_ERROR);
+      });
+#else
+  set_status("Error: Built without the socket driver.", COLOR_ERROR);
+#endif
 }
 
 void gev_device_control_window::set_status(std::string_view message,
                                          const ImVec4    &color) {
   status_message_ = message;
   status_color_ = color;
-}
\ No newline at end of file
+}
+
+#ifdef APP_HAS_SOCKET_DRIVER
+void gev_device_control_window::notify_written(
+    const std::shared_ptr<gev::register_cache> &registers,
+    std::span<const uint32_t>                   addresses) {
+  if (poller_ && poller_->registers() == registers)
+    poller_->written(addresses);
+}
+#endif
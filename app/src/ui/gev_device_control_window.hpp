@@ -3,34 +3,123 @@
 #include <imgui.h>
 
 #include <array>
+#include <map>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include <async/executor.hpp>
+#include <device_manager.hpp>
+
+#ifdef APP_HAS_SOCKET_DRIVER
+#include <gev/feature_poller.hpp>
+#include <gev/node_map.hpp>
+#endif
+
+// Register, GenICam and acquisition control for the open sessions. Every
+// device operation runs on the I/O executor; results land in the status
+// line on the UI thread, so the window never blocks on the network.
 class gev_device_control_window {
 public:
-  gev_device_control_window(std::string_view name = "GevDeviceControl");
+  static constexpr const char *window_name = "Device Control";
+
+  gev_device_control_window(device_manager &, async::operations &);
 
   void render();
 
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Latest node map loaded with Load Features; null until then.
+  std::shared_ptr<const gev::node_map> node_map() const noexcept {
+    return node_map_;
+  }
+
+  // Polls the features of node_map() on the session they were loaded
+  // from; null for a description loaded without one, or once that
+  // session closes.
+  std::shared_ptr<gev::feature_poller> poller() const noexcept {
+    return poller_;
+  }
+#endif
+
 private:
+  struct register_value {
+    uint32_t                address;
+    std::optional<uint32_t> value; // nullopt: refused by the device.
+  };
+
   std::optional<uint64_t> parse_input(std::string_view input_str) const;
+  std::optional<uint32_t> parse_u32(std::string_view input_str,
+                                    std::string_view what);
+  // Comma- or space-separated values, each checked like parse_u32.
+  std::optional<std::vector<uint32_t>> parse_list(std::string_view input_str,
+                                                  std::string_view what);
+
+  // The selected session, if it is still open; clears the selection if not.
+  const device_session *selected_session();
+
+  void render_registers();
+  void render_register_values();
 
   void handle_set_xml_button();
   void handle_save_xml_button();
+  void handle_load_features_button();
   void handle_read_register_button();
+  void handle_read_all_button();
   void handle_write_register_button();
+  void handle_set_policy_button();
+  void handle_sweep_button();
   void handle_start_acq_button();
   void handle_stop_acq_button();
   void handle_trigger_button();
-  
+  void execute_command(std::string_view address_text, std::string_view what);
+
   void set_status(std::string_view message, const ImVec4 &color);
 
-  std::string name_;
+#ifdef APP_HAS_SOCKET_DRIVER
+  // Lets the poller re-read what a write on registers may have changed.
+  void notify_written(const std::shared_ptr<gev::register_cache> &registers,
+                      std::span<const uint32_t>                   addresses);
+#endif
+
+  device_manager     &device_manager_;
+  async::operations  &operations_;
+  const device_session *selected_ = nullptr;
 
   std::array<char, 256> address_buffer_{};
   std::array<char, 256> value_buffer_{};
+  int                   policy_ = 0; // gev::cache_policy
+
+  std::array<char, 32> sweep_start_buffer_{"0x0000"};
+  int                  sweep_count_ = 1024;
+
+  // Command registers. The defaults match the loopback simulator, which
+  // has no software trigger; other devices publish theirs in their GenICam
+  // description.
+  std::array<char, 32> start_address_buffer_{"0xA010"};
+  std::array<char, 32> stop_address_buffer_{"0xA014"};
+  std::array<char, 32> trigger_address_buffer_{};
+
+  int timeout_ms_ = 2000;
+
+  // Latest Read or Sweep results and how long they took.
+  std::vector<register_value> register_values_;
+  double                      register_values_ms_ = 0.0;
+
+  // Latest "Read on all devices" answers, by device address.
+  std::map<std::string, std::string> all_results_;
+
+  // Description chosen with Set XML, used in place of the device's own.
+  std::string xml_override_path_;
+
+#ifdef APP_HAS_SOCKET_DRIVER
+  std::shared_ptr<const gev::node_map> node_map_;
+  std::shared_ptr<gev::feature_poller> poller_;
+#endif
+  std::string node_map_source_;
 
-  std::string           status_message_;
-  ImVec4                status_color_{1.0f, 1.0f, 1.0f, 1.0f};
-};
\ No newline at end of file
+  std::string status_message_;
+  ImVec4      status_color_{1.0f, 1.0f, 1.0f, 1.0f};
+};
@@ -0,0 +1,223 @@
+#include "profiler_window.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+#include <imgui.h>
+#include <nfd.h>
+
+namespace {
+
+using engine::profiling::profiler;
+using engine::profiling::scope_event;
+
+constexpr float ROW_HEIGHT = 18.0f;
+constexpr float LABEL_WIDTH = 110.0f;
+
+ImU32 color_for(const char *name) {
+  // Stable per-name colour; names are static strings so hashing the pointer
+  // is enough.
+  const auto h = std::hash<const void *>{}(name);
+  return ImColor::HSV(static_cast<float>(h % 360) / 360.0f, 0.55f, 0.75f);
+}
+
+} // namespace
+
+void profiler_window::render() {
+  if (!ImGui::Begin(window_name)) {
+    ImGui::End();
+    return;
+  }
+
+  auto &prof = profiler::get();
+
+  bool enabled = prof.enabled();
+  if (ImGui::Checkbox("Enabled", &enabled))
+    prof.set_enabled(enabled);
+
+  ImGui::SameLine();
+  if (ImGui::Checkbox("Pause", &paused_))
+    paused_at_ns_ = profiler::now_ns();
+
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome Trace"))
+    export_chrome_trace();
+
+  ImGui::PushItemWidth(140.0f);
+  ImGui::SliderFloat("View (ms)", &view_ms_, 5.0f, 500.0f, "%.0f",
+                     ImGuiSliderFlags_Logarithmic);
+  ImGui::SameLine();
+  ImGui::SliderFloat("History (s)", &history_seconds_, 0.5f, 30.0f, "%.1f");
+  ImGui::PopItemWidth();
+
+  if (prof.dropped_events()) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("(%llu dropped)",
+                        static_cast<unsigned long long>(prof.dropped_events()));
+  }
+
+  if (!status_.empty())
+    ImGui::TextUnformatted(status_.c_str());
+
+  // Keep draining while paused so the rings never overflow; only the view
+  // stops moving.
+  collect();
+
+  ImGui::Separator();
+  render_timeline(paused_ ? paused_at_ns_ : profiler::now_ns());
+  ImGui::Separator();
+  render_summary();
+
+  ImGui::End();
+}
+
+void profiler_window::collect() {
+  scratch_.clear();
+  profiler::get().collect(scratch_);
+  history_.insert(history_.end(), scratch_.begin(), scratch_.end());
+
+  const uint64_t keep_ns =
+      static_cast<uint64_t>(history_seconds_ * 1e9f) +
+      (paused_ ? profiler::now_ns() - paused_at_ns_ : 0);
+  const uint64_t now = profiler::now_ns();
+
+  // Events arrive roughly in end-time order per producer, so trimming from the
+  // front is close enough for a rolling window.
+  while (!history_.empty() && now - history_.front().end_ns > keep_ns)
+    history_.pop_front();
+
+  tracks_ = profiler::get().tracks();
+}
+
+void profiler_window::render_timeline(uint64_t view_end_ns) {
+  const uint64_t view_ns = static_cast<uint64_t>(view_ms_ * 1e6f);
+  const uint64_t view_begin_ns = view_end_ns - view_ns;
+
+  ImDrawList  *draw_list = ImGui::GetWindowDrawList();
+  const float  width =
+      std::max(ImGui::GetContentRegionAvail().x - LABEL_WIDTH, 50.0f);
+  const double px_per_ns = width / static_cast<double>(view_ns);
+
+  for (const auto &track : tracks_) {
+    uint32_t max_depth = 0;
+    bool     any = false;
+    for (const auto &e : history_) {
+      if (e.track != track.id || e.end_ns < view_begin_ns ||
+          e.start_ns > view_end_ns)
+        continue;
+      any = true;
+      max_depth = std::max(max_depth, e.depth);
+    }
+    if (!any)
+      continue;
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float  height = (max_depth + 1) * ROW_HEIGHT;
+
+    draw_list->AddText(origin, ImGui::GetColorU32(ImGuiCol_Text),
+                       track.name.c_str());
+
+    const float x0 = origin.x + LABEL_WIDTH;
+    for (const auto &e : history_) {
+      if (e.track != track.id || e.end_ns < view_begin_ns ||
+          e.start_ns > view_end_ns)
+        continue;
+
+      const float left = x0 + static_cast<float>(
+                                  (static_cast<double>(std::max(
+                                       e.start_ns, view_begin_ns)) -
+                                   view_begin_ns) *
+                                  px_per_ns);
+      const float right = x0 + static_cast<float>(
+                                   (static_cast<double>(std::min(
+                                        e.end_ns, view_end_ns)) -
+                                    view_begin_ns) *
+                                   px_per_ns);
+      const ImVec2 min{left, origin.y + e.depth * ROW_HEIGHT};
+      const ImVec2 max{std::max(right, left + 1.0f), min.y + ROW_HEIGHT - 1};
+
+      draw_list->AddRectFilled(min, max, color_for(e.name));
+      if (max.x - min.x > 30.0f) {
+        draw_list->PushClipRect(min, max, true);
+        draw_list->AddText({min.x + 2, min.y + 1}, IM_COL32_WHITE, e.name);
+        draw_list->PopClipRect();
+      }
+
+      if (ImGui::IsMouseHoveringRect(min, max))
+        ImGui::SetTooltip("%s\n%.3f ms", e.name,
+                          (e.end_ns - e.start_ns) / 1e6);
+    }
+
+    ImGui::Dummy({LABEL_WIDTH + width, height + 4.0f});
+  }
+}
+
+void profiler_window::render_summary() {
+  struct stats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+  };
+
+  std::unordered_map<const char *, stats> by_name;
+  for (const auto &e : history_) {
+    auto          &s = by_name[e.name];
+    const uint64_t d = e.end_ns - e.start_ns;
+    ++s.count;
+    s.total_ns += d;
+    s.max_ns = std::max(s.max_ns, d);
+  }
+
+  std::vector<std::pair<const char *, stats>> rows(by_name.begin(),
+                                                   by_name.end());
+  std::ranges::sort(rows, std::greater{},
+                    [](const auto &r) { return r.second.total_ns; });
+
+  if (ImGui::BeginTable("Scopes", 4,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_SizingFixedFit |
+                            ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("Mean (ms)");
+    ImGui::TableSetupColumn("Max (ms)");
+    ImGui::TableHeadersRow();
+
+    for (const auto &[name, s] : rows) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(s.count));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.total_ns / 1e6 / s.count);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", s.max_ns / 1e6);
+    }
+    ImGui::EndTable();
+  }
+}
+
+void profiler_window::export_chrome_trace() {
+  nfdchar_t      *out_path = nullptr;
+  nfdfilteritem_t filter_item[1] = {{"Chrome trace", "json"}};
+  nfdresult_t     result =
+      NFD_SaveDialog(&out_path, filter_item, 1, nullptr, "trace.json");
+
+  if (result == NFD_ERROR) {
+    status_ = std::string("Export failed: ") + NFD_GetError();
+    return;
+  }
+  if (result != NFD_OKAY)
+    return;
+
+  std::vector<scope_event> events(history_.begin(), history_.end());
+  std::ofstream            file(out_path);
+  engine::profiling::write_chrome_trace(file, events, tracks_);
+
+  status_ = file ? std::string("Exported ") + std::to_string(events.size()) +
+                       " events to " + out_path
+                 : std::string("Export failed: could not write ") + out_path;
+  NFD_FreePath(out_path);
+}
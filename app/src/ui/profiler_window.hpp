@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <profiling/profiler.hpp>
+
+// Rolling timeline of CPU and GPU scopes collected from
+// engine::profiling::profiler, with Chrome trace export.
+class profiler_window {
+public:
+  static constexpr const char *window_name = "Profiler";
+
+  void render();
+
+private:
+  void collect();
+  void render_timeline(uint64_t view_end_ns);
+  void render_summary();
+  void export_chrome_trace();
+
+  std::deque<engine::profiling::scope_event> history_;
+  std::vector<engine::profiling::scope_event> scratch_;
+  std::vector<engine::profiling::track_info>  tracks_;
+
+  float    history_seconds_ = 2.0f;
+  float    view_ms_ = 50.0f;
+  bool     paused_ = false;
+  uint64_t paused_at_ns_ = 0;
+
+  std::string status_;
+};
@@ -0,0 +1,299 @@
+#include "recorder_window.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <imgui.h>
+#include <imgui_stdlib.h>
+#include <nfd.h>
+
+#include <util.hpp>
+
+namespace {
+
+std::string session_name(const device_session &session) {
+  const auto &device = session.device();
+  return device.serial.empty()
+             ? util::format_ip_address(device.ip_address())
+             : device.serial;
+}
+
+} // namespace
+
+recorder_window::recorder_window(device_manager &device_manager)
+    : device_manager_(device_manager) {
+  std::error_code ec;
+  directory_ = std::filesystem::current_path(ec).string();
+}
+
+void recorder_window::render() {
+  if (!ImGui::Begin(window_name)) {
+    ImGui::End();
+    return;
+  }
+
+  ImGui::InputText("Directory", &directory_);
+  ImGui::SameLine();
+  if (ImGui::Button("Browse..."))
+    browse();
+  ImGui::Checkbox("Bypass page cache (O_DIRECT)", &direct_);
+  ImGui::SameLine();
+  ImGui::Checkbox("Compress", &compress_);
+  if (ImGui::IsItemHovered())
+    ImGui::SetTooltip("Lossless; spends cores to write fewer bytes");
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(120.0f);
+  ImGui::InputInt("Staging (MB)", &staging_megabytes_, 64);
+  staging_megabytes_ = std::clamp(staging_megabytes_, 16, 16384);
+
+  if (!status_.empty())
+    ImGui::TextWrapped("%s", status_.c_str());
+
+  // Works wherever focus is, like a trigger button on the hardware.
+  if (ImGui::IsKeyPressed(ImGuiKey_F9, false))
+    save_histories();
+
+  const auto &sessions = device_manager_.sessions();
+  std::erase_if(finished_, [&](const auto &entry) {
+    return std::ranges::none_of(sessions, [&](const auto &s) {
+      return s.get() == entry.first;
+    });
+  });
+
+  if (sessions.empty()) {
+    ImGui::TextDisabled("No open sessions");
+    ImGui::End();
+    return;
+  }
+
+  if (ImGui::BeginTable("Recordings", 9,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Device");
+    ImGui::TableSetupColumn("");
+    ImGui::TableSetupColumn("Frames");
+    ImGui::TableSetupColumn("MB/s");
+    ImGui::TableSetupColumn("Average MB/s");
+    ImGui::TableSetupColumn("Worst write (ms)");
+    ImGui::TableSetupColumn("Dropped");
+    ImGui::TableSetupColumn("Staged");
+    ImGui::TableSetupColumn("Ratio");
+    ImGui::TableHeadersRow();
+
+    for (const auto &session : sessions) {
+      ImGui::PushID(session.get());
+      auto recorder = session->recording();
+      const bool recording = recorder != nullptr;
+      if (!recorder)
+        if (auto it = finished_.find(session.get()); it != finished_.end())
+          recorder = it->second;
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(session_name(*session).c_str());
+      ImGui::TableNextColumn();
+      if (session->driver() != stream_driver::socket) {
+        ImGui::TextDisabled("Socket driver only");
+      } else if (recording) {
+        if (ImGui::Button("Stop"))
+          finished_[session.get()] = session->stop_recording();
+      } else if (ImGui::Button("Record")) {
+        start(*session);
+      }
+
+      if (recorder) {
+        const auto stats = recorder->stats();
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(stats.frames));
+        if (ImGui::IsItemHovered())
+          ImGui::SetTooltip(
+              "%s\n%s, %s\n%.1f s, %.1f MB", recorder->path().string().c_str(),
+              recorder->backend() == recording::write_backend::io_uring
+                  ? "io_uring"
+                  : "thread pool",
+              recorder->direct() ? "O_DIRECT" : "page cache", stats.seconds,
+              stats.bytes / 1e6);
+        ImGui::TableNextColumn();
+        if (recording)
+          ImGui::Text("%.1f", stats.megabytes_per_second);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", stats.average_megabytes_per_second);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", stats.worst_write_latency.count() / 1e6);
+        ImGui::TableNextColumn();
+        if (stats.dropped)
+          ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "%llu",
+                             static_cast<unsigned long long>(stats.dropped));
+        else
+          ImGui::TextUnformatted("0");
+        ImGui::TableNextColumn();
+        ImGui::Text("%u (peak %u)", stats.staged, stats.staged_peak);
+        if (auto ec = recorder->error(); ec && ImGui::IsItemHovered())
+          ImGui::SetTooltip("%s", ec.message().c_str());
+        ImGui::TableNextColumn();
+        if (recorder->compressing()) {
+          ImGui::Text("%.2f", stats.compression_ratio);
+          if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("%.1f MB raw\nencoding at %.2f GB/s",
+                              stats.raw_bytes / 1e6,
+                              stats.encode_gigabytes_per_second);
+        } else {
+          ImGui::TextDisabled("-");
+        }
+      }
+      ImGui::PopID();
+    }
+    ImGui::EndTable();
+  }
+
+  render_history();
+  ImGui::End();
+}
+
+void recorder_window::render_history() {
+  ImGui::SeparatorText("Pre-trigger history");
+  ImGui::SetNextItemWidth(120.0f);
+  ImGui::InputDouble("Seconds", &history_seconds_, 1.0, 10.0, "%.1f");
+  history_seconds_ = std::clamp(history_seconds_, 0.1, 3600.0);
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(120.0f);
+  ImGui::InputInt("Memory (MB)", &history_megabytes_, 256);
+  history_megabytes_ = std::clamp(history_megabytes_, 16, 262144);
+  ImGui::SameLine();
+  ImGui::Checkbox("Compress##history", &history_compress_);
+  ImGui::TextDisabled("F9 or a trigger saves every session's history");
+
+  const auto &sessions = device_manager_.sessions();
+  if (!ImGui::BeginTable("History", 8,
+                         ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                             ImGuiTableFlags_SizingFixedFit))
+    return;
+  ImGui::TableSetupColumn("Device");
+  ImGui::TableSetupColumn("");
+  ImGui::TableSetupColumn("Held (s)");
+  ImGui::TableSetupColumn("Frames");
+  ImGui::TableSetupColumn("Used / reserved (MB)");
+  ImGui::TableSetupColumn("Ratio");
+  ImGui::TableSetupColumn("Dropped");
+  ImGui::TableSetupColumn("Save");
+  ImGui::TableHeadersRow();
+
+  for (const auto &session : sessions) {
+    ImGui::PushID(session.get());
+    const auto history = session->history();
+    const auto stats = history ? history->stats() : recording::history_stats{};
+
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(session_name(*session).c_str());
+    ImGui::TableNextColumn();
+    if (session->driver() != stream_driver::socket) {
+      ImGui::TextDisabled("Socket driver only");
+    } else if (!history) {
+      if (ImGui::Button("Keep"))
+        keep_history(*session);
+    } else {
+      ImGui::BeginDisabled(stats.saving);
+      if (ImGui::Button("Save"))
+        if (auto ec = session->save_history())
+          status_ = "Cannot save history: " + ec.message();
+      ImGui::SameLine();
+      if (ImGui::Button("Drop"))
+        session->disable_history();
+      ImGui::EndDisabled();
+    }
+
+    if (history) {
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.seconds);
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(stats.frames));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.0f / %.0f", stats.bytes / 1e6, stats.memory_bytes / 1e6);
+      ImGui::TableNextColumn();
+      if (history->options().compress)
+        ImGui::Text("%.2f", stats.compression_ratio);
+      else
+        ImGui::TextDisabled("-");
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", static_cast<unsigned long long>(stats.dropped));
+      ImGui::TableNextColumn();
+      if (stats.saving) {
+        ImGui::ProgressBar(stats.save_frames
+                               ? static_cast<float>(stats.saved_frames) /
+                                     stats.save_frames
+                               : 0.0f,
+                           ImVec2(120.0f, 0.0f));
+      } else if (stats.save_error) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "Failed");
+      } else if (!stats.save_path.empty()) {
+        ImGui::Text("%llu frames",
+                    static_cast<unsigned long long>(stats.saved_frames));
+      }
+      if (!stats.save_path.empty() && ImGui::IsItemHovered())
+        ImGui::SetTooltip("%s%s%s", stats.save_path.string().c_str(),
+                          stats.save_error ? "\n" : "",
+                          stats.save_error.message().c_str());
+    }
+    ImGui::PopID();
+  }
+  ImGui::EndTable();
+}
+
+void recorder_window::keep_history(device_session &session) {
+  auto history = session.enable_history(
+      {
+          .max_bytes = size_t(history_megabytes_) << 20,
+          .max_seconds = history_seconds_,
+          .compress = history_compress_,
+      },
+      directory_);
+  if (!history)
+    status_ = "Cannot keep history: " + history.error().message();
+  else
+    status_.clear();
+}
+
+void recorder_window::save_histories() {
+  for (const auto &session : device_manager_.sessions())
+    if (session->history())
+      if (auto ec = session->save_history())
+        status_ = "Cannot save history: " + ec.message();
+}
+
+void recorder_window::start(device_session &session) {
+  std::error_code             ec;
+  const std::filesystem::path directory(directory_);
+  std::filesystem::create_directories(directory, ec);
+  if (ec) {
+    status_ = "Cannot create " + directory.string() + ": " + ec.message();
+    return;
+  }
+
+  recording::recorder_options options{
+      .path = recording_path(directory, session.device()),
+      .staging_bytes = size_t(staging_megabytes_) << 20,
+      .direct = direct_,
+      .compress = compress_,
+  };
+  auto recorder = session.start_recording(std::move(options));
+  if (!recorder) {
+    status_ = "Recording failed: " + recorder.error().message();
+    return;
+  }
+  finished_.erase(&session);
+  status_.clear();
+}
+
+void recorder_window::browse() {
+  nfdchar_t  *out_path = nullptr;
+  nfdresult_t result = NFD_PickFolder(&out_path, directory_.c_str());
+  if (result == NFD_ERROR) {
+    status_ = std::string("Cannot pick a folder: ") + NFD_GetError();
+    return;
+  }
+  if (result != NFD_OKAY)
+    return;
+  directory_ = out_path;
+  NFD_FreePath(out_path);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <device_manager.hpp>
+
+// Records open sessions to disk, one file per session, and shows whether
+// the disk is keeping up: sustained MB/s, worst write latency and the
+// frames dropped because it was not, and how well compression is doing.
+// Also keeps each session's last few seconds in memory, saved on F9 or a
+// trigger.
+class recorder_window {
+public:
+  static constexpr const char *window_name = "Recorder";
+
+  recorder_window(device_manager &);
+
+  void render();
+
+private:
+  void start(device_session &session);
+  void browse();
+
+  void render_history();
+  void keep_history(device_session &session);
+  void save_histories();
+
+  device_manager &device_manager_;
+
+  std::string directory_;
+  bool        direct_ = true;
+  bool        compress_ = false;
+  int         staging_megabytes_ = 256;
+  std::string status_;
+
+  double history_seconds_ = 10.0;
+  int    history_megabytes_ = 2048;
+  bool   history_compress_ = false;
+
+  // The last recording of each session, kept so its final figures stay
+  // on screen after Stop.
+  std::unordered_map<const device_session *,
+                     std::shared_ptr<recording::recorder>>
+      finished_;
+};
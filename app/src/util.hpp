@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdlib>
+#include <filesystem>
 #include <fmt/format.h>
 #include <source_location>
 #include <spdlog/spdlog.h>
@@ -24,4 +26,23 @@ inline std::string format_ip_address(uint32_t ip) {
                      (ip >> 8) & 0xFF, ip & 0xFF);
 }
 
+// Per-user directory for data that can be regenerated (pipeline caches,
+// last-known device lists). Not created here.
+inline std::filesystem::path cache_directory() {
+  std::filesystem::path base;
+#ifdef _WIN32
+  if (const char *local = std::getenv("LOCALAPPDATA"))
+    base = local;
+#else
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    base = xdg;
+  else if (const char *home = std::getenv("HOME"))
+    base = std::filesystem::path(home) / ".cache";
+#endif
+  if (base.empty())
+    base = std::filesystem::temp_directory_path();
+
+  return base / "vk_application";
+}
+
 } // namespace util
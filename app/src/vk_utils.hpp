@@ -6,8 +6,13 @@
 #include <optional>
 #include <ranges>
 #include <set>
+#include <stdexcept>
+#include <type_traits>
 #include <vulkan/vulkan.hpp>
 
+#include <device.hpp>
+#include <gpu.hpp>
+
 namespace vk_utils {
 /// True if a queue family supports graphics.
 [[nodiscard]]
@@ -47,6 +52,83 @@ pick_discrete_gpu(const std::vector<std::shared_ptr<engine::gpu>> &gpus) {
   return *it;
 }
 
+/// Pick a GPU with a graphics queue, preferring discrete over integrated over
+/// anything else (virtual, software rasterisers such as lavapipe).
+[[nodiscard]]
+inline std::expected<std::shared_ptr<engine::gpu>, std::string>
+pick_any_gpu(const std::vector<std::shared_ptr<engine::gpu>> &gpus) {
+  auto rank = [](vk::PhysicalDeviceType t) {
+    switch (t) {
+    case vk::PhysicalDeviceType::eDiscreteGpu:
+      return 0;
+    case vk::PhysicalDeviceType::eIntegratedGpu:
+      return 1;
+    case vk::PhysicalDeviceType::eVirtualGpu:
+      return 2;
+    case vk::PhysicalDeviceType::eCpu:
+      return 3;
+    default:
+      return 4;
+    }
+  };
+
+  std::shared_ptr<engine::gpu> best;
+  for (const auto &g : gpus) {
+    if (!first_graphics_queue(*g))
+      continue;
+    if (!best || rank(g->properties.properties.deviceType) <
+                     rank(best->properties.properties.deviceType))
+      best = g;
+  }
+
+  if (!best)
+    return std::unexpected{"No GPU with a graphics queue"};
+
+  return best;
+}
+
+/// Index of a memory type allowed by type_bits that has all of props.
+[[nodiscard]]
+inline std::optional<uint32_t> find_memory_type(const engine::gpu      &g,
+                                                uint32_t                type_bits,
+                                                vk::MemoryPropertyFlags props) {
+  const auto &mem = g.memory_properties.memoryProperties;
+  for (uint32_t i = 0; i < mem.memoryTypeCount; ++i)
+    if ((type_bits & (1u << i)) &&
+        (mem.memoryTypes[i].propertyFlags & props) == props)
+      return i;
+  return std::nullopt;
+}
+
+/// Allocates and binds dedicated memory for an image or buffer.
+template <typename THandle>
+[[nodiscard]] vk::UniqueDeviceMemory
+allocate_and_bind(const engine::device &dev, THandle handle,
+                  vk::MemoryPropertyFlags props) {
+  const auto reqs = [&] {
+    if constexpr (std::is_same_v<THandle, vk::Image>)
+      return dev.handle().getImageMemoryRequirements(handle);
+    else
+      return dev.handle().getBufferMemoryRequirements(handle);
+  }();
+
+  auto type = find_memory_type(*dev.physical_device(), reqs.memoryTypeBits,
+                               props);
+  if (!type)
+    throw std::runtime_error("No suitable memory type");
+
+  auto memory = dev.handle().allocateMemoryUnique(
+      vk::MemoryAllocateInfo().setAllocationSize(reqs.size).setMemoryTypeIndex(
+          *type));
+
+  if constexpr (std::is_same_v<THandle, vk::Image>)
+    dev.handle().bindImageMemory(handle, *memory, 0);
+  else
+    dev.handle().bindBufferMemory(handle, *memory, 0);
+
+  return memory;
+}
+
 struct selected_families {
   uint32_t graphics = UINT32_MAX;
   uint32_t compute = UINT32_MAX;
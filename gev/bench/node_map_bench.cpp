@@ -0,0 +1,239 @@
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include <gev/node_map.hpp>
+
+#include "../sim/device_description.hpp"
+
+// GenICam node map build times: parsing a vendor-sized description against
+// mapping its compiled cache. The description is synthesised in the shape
+// of a real one: categories of integer, enumeration and float features,
+// each with its register, tooltips, selectors and invalidators.
+
+namespace {
+
+struct bench_options {
+  uint32_t    features = 5000;
+  uint32_t    repeat = 20;
+  std::string xml; // A real description instead of the synthetic one.
+  std::string json;
+
+  static bench_options parse(std::span<const std::string_view> args);
+};
+
+template <typename T> T parse_number(std::string_view option, std::string_view s) {
+  T v{};
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (ec != std::errc{} || end != s.data() + s.size())
+    throw std::invalid_argument("invalid value for " + std::string(option) +
+                                ": " + std::string(s));
+  return v;
+}
+
+bench_options bench_options::parse(std::span<const std::string_view> args) {
+  bench_options o;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto option = args[i];
+    auto       value = [&]() -> std::string_view {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument(std::string(option) + " needs a value");
+      return args[++i];
+    };
+
+    if (option == "--features")
+      o.features = parse_number<uint32_t>(option, value());
+    else if (option == "--repeat")
+      o.repeat = parse_number<uint32_t>(option, value());
+    else if (option == "--xml")
+      o.xml = value();
+    else if (option == "--json")
+      o.json = value();
+    else
+      throw std::invalid_argument("unknown option: " + std::string(option));
+  }
+
+  if (o.features == 0 || o.repeat == 0)
+    throw std::invalid_argument("option out of range");
+  return o;
+}
+
+std::string synthetic_xml(uint32_t features) {
+  constexpr uint32_t per_category = 50;
+
+  std::string xml = R"(<?xml version="1.0" encoding="utf-8"?>
+<RegisterDescription ModelName="Bench" VendorName="Bench"
+    xmlns="http://www.genicam.org/GenApi/Version_1_1">
+  <Category Name="Root" NameSpace="Standard">
+)";
+  for (uint32_t c = 0; c < (features + per_category - 1) / per_category; ++c)
+    xml += "    <pFeature>Category" + std::to_string(c) + "</pFeature>\n";
+  xml += "  </Category>\n";
+
+  for (uint32_t i = 0; i < features; ++i) {
+    const auto n = std::to_string(i);
+    const auto address = std::to_string(0x10000 + i * 4);
+
+    if (i % per_category == 0) {
+      xml += "  <Category Name=\"Category" + std::to_string(i / per_category) +
+             "\">\n";
+      for (uint32_t j = i; j < std::min(i + per_category, features); ++j)
+        xml += "    <pFeature>Feature" + std::to_string(j) + "</pFeature>\n";
+      xml += "  </Category>\n";
+    }
+
+    switch (i % 3) {
+    case 0:
+      xml += "  <Integer Name=\"Feature" + n + "\">\n"
+             "    <ToolTip>Integer feature " + n + " &amp; its limits</ToolTip>\n"
+             "    <Visibility>Expert</Visibility>\n"
+             "    <pValue>Feature" + n + "Reg</pValue>\n"
+             "    <Min>0</Min><Max>65535</Max><Inc>1</Inc>\n"
+             "    <pSelected>Feature" + std::to_string(i + 1) + "</pSelected>\n"
+             "  </Integer>\n";
+      break;
+    case 1:
+      xml += "  <Enumeration Name=\"Feature" + n + "\">\n"
+             "    <ToolTip>Enumeration feature " + n + "</ToolTip>\n";
+      for (int e = 0; e < 4; ++e)
+        xml += "    <EnumEntry Name=\"Feature" + n + "Entry" +
+               std::to_string(e) + "\"><Value>" + std::to_string(e) +
+               "</Value></EnumEntry>\n";
+      xml += "    <pValue>Feature" + n + "Reg</pValue>\n"
+             "  </Enumeration>\n";
+      break;
+    default:
+      xml += "  <Converter Name=\"Feature" + n + "\">\n"
+             "    <ToolTip>Float feature " + n + "</ToolTip>\n"
+             "    <FormulaTo>TO * 1000</FormulaTo>\n"
+             "    <FormulaFrom>FROM / 1000</FormulaFrom>\n"
+             "    <pValue>Feature" + n + "Reg</pValue>\n"
+             "    <Unit>us</Unit>\n"
+             "  </Converter>\n";
+      break;
+    }
+
+    xml += "  <IntReg Name=\"Feature" + n + "Reg\">\n"
+           "    <Address>" + address + "</Address><Length>4</Length>\n"
+           "    <AccessMode>RW</AccessMode><pPort>Device</pPort>\n"
+           "    <pInvalidator>Feature" + std::to_string(i ? i - 1 : 0) +
+           "Reg</pInvalidator>\n"
+           "    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>\n"
+           "  </IntReg>\n";
+  }
+
+  xml += "  <Port Name=\"Device\"/>\n</RegisterDescription>\n";
+  return xml;
+}
+
+std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    throw std::runtime_error("cannot open " + path);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+double time_it(uint32_t repeat, const std::function<void()> &body) {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < repeat; ++i)
+    body();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+             .count() /
+         repeat;
+}
+
+template <typename T> T check(std::expected<T, std::error_code> r) {
+  if (!r)
+    throw std::runtime_error(r.error().message());
+  if constexpr (!std::is_void_v<T>)
+    return std::move(*r);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  bench_options opts;
+  try {
+    opts = bench_options::parse(args);
+  } catch (const std::invalid_argument &e) {
+    spdlog::error("{}", e.what());
+    spdlog::info("usage: gev_node_map_bench [--features N] [--repeat N] "
+                 "[--xml description.xml] [--json out.json]");
+    return 2;
+  }
+
+  const auto cache_dir = std::filesystem::temp_directory_path() /
+                         ("gev_node_map_bench." + std::to_string(::getpid()));
+
+  double parse_seconds = 0;
+  double load_seconds = 0;
+  size_t xml_bytes = 0;
+  size_t nodes = 0;
+  try {
+    // The simulator's description has to round-trip through the cache.
+    {
+      auto sim = check(gev::node_map::parse(std::string(gev::sim::device_xml)));
+      check(sim.save(cache_dir / "sim.bin"));
+      auto cached = check(gev::node_map::load(
+          cache_dir / "sim.bin", gev::node_map::hash(gev::sim::device_xml),
+          gev::sim::device_xml.size()));
+      const auto width = cached.find("Width");
+      if (cached.size() != sim.size() || !width ||
+          cached.str(cached[*width].name) != "Width" ||
+          cached.root() != sim.root() || sim.unresolved_references() != 0)
+        throw std::runtime_error("simulator description did not round-trip");
+    }
+
+    const std::string xml =
+        opts.xml.empty() ? synthetic_xml(opts.features) : read_file(opts.xml);
+    xml_bytes = xml.size();
+
+    parse_seconds = time_it(opts.repeat, [&] {
+      nodes = check(gev::node_map::parse(xml)).size();
+    });
+
+    const uint64_t hash = gev::node_map::hash(xml);
+    const auto     path = gev::node_map::cache_file(cache_dir, hash);
+    check(check(gev::node_map::parse(xml)).save(path));
+    load_seconds = time_it(opts.repeat, [&] {
+      // What a connect pays: hashing the downloaded XML, then the mapping.
+      auto map = check(gev::node_map::load(path, gev::node_map::hash(xml),
+                                           xml.size()));
+      if (map.size() != nodes)
+        throw std::runtime_error("cached node map differs");
+    });
+  } catch (const std::runtime_error &e) {
+    spdlog::error("{}", e.what());
+    std::filesystem::remove_all(cache_dir);
+    return 1;
+  }
+  std::filesystem::remove_all(cache_dir);
+
+  spdlog::info("{} nodes from {:.1f} KiB of XML", nodes, xml_bytes / 1024.0);
+  spdlog::info("parse        {:>8.3f} ms ({:.0f} MB/s)", parse_seconds * 1e3,
+               xml_bytes / parse_seconds / 1e6);
+  spdlog::info("cached load  {:>8.3f} ms ({:.0f}x)", load_seconds * 1e3,
+               parse_seconds / load_seconds);
+
+  if (!opts.json.empty()) {
+    std::ofstream out(opts.json);
+    out << "{\"nodes\": " << nodes << ", \"xml_bytes\": " << xml_bytes
+        << ", \"parse_seconds\": " << parse_seconds
+        << ", \"load_seconds\": " << load_seconds << "}\n";
+  }
+
+  return 0;
+}
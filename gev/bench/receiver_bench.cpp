@@ -0,0 +1,294 @@
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <gev/gvcp_client.hpp>
+#include <gev/stream_receiver.hpp>
+
+#include "../sim/simulated_device.hpp"
+
+// Measures the socket receiver against the simulator at emulated 1 and
+// 10 GbE line rates: sustained throughput, frame completeness and packet
+// loss after resends. Runs entirely on loopback, so the numbers show what
+// the receive path can absorb rather than what a NIC delivers.
+
+namespace {
+
+struct bench_options {
+  uint32_t               width = 1536;
+  uint32_t               height = 1536;
+  uint32_t               packet_size = 9000;
+  std::vector<double>    line_rates_mbps{1000.0, 10000.0};
+  double                 utilisation = 0.9; // Of the line rate.
+  double                 loss = 0.0;
+  double                 reorder = 0.0;
+  double                 seconds = 5.0;
+  uint32_t               buffers = 16;
+  gev::receive_mode      mode = gev::receive_mode::blocking;
+  bool                   verify = false;
+  std::string            json;
+
+  static bench_options parse(std::span<const std::string_view> args);
+};
+
+template <typename T> T parse_number(std::string_view option, std::string_view s) {
+  T v{};
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (ec != std::errc{} || end != s.data() + s.size())
+    throw std::invalid_argument("invalid value for " + std::string(option) +
+                                ": " + std::string(s));
+  return v;
+}
+
+bench_options bench_options::parse(std::span<const std::string_view> args) {
+  bench_options o;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto option = args[i];
+    auto       value = [&]() -> std::string_view {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument(std::string(option) + " needs a value");
+      return args[++i];
+    };
+
+    if (option == "--width")
+      o.width = parse_number<uint32_t>(option, value());
+    else if (option == "--height")
+      o.height = parse_number<uint32_t>(option, value());
+    else if (option == "--packet-size")
+      o.packet_size = parse_number<uint32_t>(option, value());
+    else if (option == "--line-rate") {
+      o.line_rates_mbps = {parse_number<double>(option, value())};
+    } else if (option == "--utilisation")
+      o.utilisation = parse_number<double>(option, value());
+    else if (option == "--loss")
+      o.loss = parse_number<double>(option, value());
+    else if (option == "--reorder")
+      o.reorder = parse_number<double>(option, value());
+    else if (option == "--seconds")
+      o.seconds = parse_number<double>(option, value());
+    else if (option == "--buffers")
+      o.buffers = parse_number<uint32_t>(option, value());
+    else if (option == "--busy-poll")
+      o.mode = gev::receive_mode::busy_poll;
+    else if (option == "--verify")
+      o.verify = true;
+    else if (option == "--json")
+      o.json = value();
+    else
+      throw std::invalid_argument("unknown option: " + std::string(option));
+  }
+  return o;
+}
+
+struct result {
+  double   line_rate_mbps;
+  double   frame_rate;
+  double   seconds;
+  uint64_t frames_sent;
+  uint64_t frames_complete;
+  uint64_t frames_incomplete;
+  uint64_t frames_no_buffer;
+  uint64_t frames_corrupt;
+  uint64_t packets;
+  uint64_t packets_lost;
+  uint64_t packets_dropped_by_sim;
+  uint64_t packets_copied;
+  uint64_t resend_requests;
+  uint64_t kernel_drops;
+  uint64_t bytes;
+  int      socket_buffer;
+
+  gev::latency_histogram::snapshot wakeup;
+};
+
+int64_t to_us(std::chrono::nanoseconds d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+bool matches_gradient(std::span<const std::byte> data, uint32_t width,
+                      uint32_t height, uint16_t block_id) {
+  for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x) {
+      const auto expected = static_cast<uint16_t>(x * 31u + y * 17u +
+                                                  block_id * 257u);
+      if (gev::load_be<uint16_t>(data.data() + (size_t{y} * width + x) * 2) !=
+          expected)
+        return false;
+    }
+  return true;
+}
+
+result run_one(const bench_options &o, double line_rate, uint32_t index) {
+  const size_t frame_bytes = size_t{o.width} * o.height * 2;
+  const size_t per_packet = gev::gvsp_payload_per_packet(o.packet_size);
+  const size_t packets_per_frame = (frame_bytes + per_packet - 1) / per_packet;
+  const double wire_bits_per_frame =
+      (frame_bytes + (packets_per_frame + 2) *
+                         (gev::ip_udp_overhead + gev::gvsp_header_size)) *
+      8.0;
+  const double fps = o.utilisation * line_rate * 1e6 / wire_bits_per_frame;
+
+  std::vector<std::vector<std::byte>> storage(o.buffers,
+                                              std::vector<std::byte>(frame_bytes));
+  std::vector<std::span<std::byte>>   framebuffers(storage.begin(),
+                                                   storage.end());
+
+  const gev::endpoint device_control{0x7F000001 + 16 + index, gev::gvcp_port};
+
+  std::unique_ptr<gev::gvcp_client> control;
+  std::atomic<uint64_t>             corrupt{0};
+  gev::stream_receiver             *receiver_ptr = nullptr;
+
+  auto receiver = gev::stream_receiver::create(
+      {.local = {0x7F000001, 0}, .mode = o.mode}, framebuffers, o.packet_size,
+      [&](const gev::received_frame &f) {
+        if (o.verify && f.complete() &&
+            !matches_gradient(storage[f.slot], f.width, f.height, f.block_id))
+          ++corrupt;
+        receiver_ptr->release(f.slot);
+      },
+      [&](uint16_t block, uint32_t first, uint32_t last) {
+        if (control)
+          control->request_resend(block, first, last);
+      });
+  if (!receiver)
+    throw std::runtime_error("receiver: " + receiver.error().message());
+  receiver_ptr = receiver->get();
+
+  auto sim = std::make_unique<gev::sim::simulated_device>(gev::sim::device_config{
+      .index = 16 + index,
+      .control = device_control,
+      .width = o.width,
+      .height = o.height,
+      .frame_rate = fps,
+      .packet_size = o.packet_size,
+      .loss = o.loss,
+      .reorder = o.reorder,
+      .line_rate_mbps = line_rate,
+      .stream_to = (*receiver)->local_endpoint(),
+  });
+
+  if (auto c = gev::gvcp_client::connect(device_control))
+    control = std::move(*c);
+
+  std::jthread rx([&](std::stop_token stop) { (void)(*receiver)->run(stop); });
+
+  const auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(o.seconds));
+  const uint64_t frames_sent = sim->stats().frames_sent;
+  const uint64_t sim_dropped = sim->stats().packets_dropped;
+  sim.reset(); // Stop sending, then let the last frames settle.
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  rx = {};
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  const auto &s = (*receiver)->stats();
+  return {
+      .line_rate_mbps = line_rate,
+      .frame_rate = fps,
+      .seconds = elapsed,
+      .frames_sent = frames_sent,
+      .frames_complete = s.frames_complete,
+      .frames_incomplete = s.frames_incomplete,
+      .frames_no_buffer = s.frames_no_buffer,
+      .frames_corrupt = corrupt,
+      .packets = s.packets,
+      .packets_lost = s.packets_lost,
+      .packets_dropped_by_sim = sim_dropped,
+      .packets_copied = s.packets_copied,
+      .resend_requests = s.resend_requests,
+      .kernel_drops = s.kernel_drops,
+      .bytes = s.bytes,
+      .socket_buffer = (*receiver)->socket_buffer(),
+      .wakeup = s.wakeup_latency.read(),
+  };
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  bench_options opts;
+  try {
+    opts = bench_options::parse(args);
+  } catch (const std::invalid_argument &e) {
+    spdlog::error("{}", e.what());
+    spdlog::info("usage: gev_receiver_bench [--width W] [--height H] "
+                 "[--packet-size BYTES] [--line-rate MBPS] [--utilisation F] "
+                 "[--loss P] [--reorder P] [--seconds S] [--buffers N] "
+                 "[--busy-poll] [--verify] [--json out.json]");
+    return 2;
+  }
+
+  std::vector<result> results;
+  try {
+    for (uint32_t i = 0; i < opts.line_rates_mbps.size(); ++i)
+      results.push_back(run_one(opts, opts.line_rates_mbps[i], i));
+  } catch (const std::runtime_error &e) {
+    spdlog::error("{}", e.what());
+    return 1;
+  }
+
+  for (const auto &r : results) {
+    const uint64_t frames = r.frames_complete + r.frames_incomplete;
+    const double   expected_packets =
+        static_cast<double>(r.packets + r.packets_lost);
+    spdlog::info(
+        "{:>6.0f} Mbit/s line, {:.1f} fps offered: {:.1f} MB/s received "
+        "({:.2f} Gbit/s), {}/{} frames ({} complete, {} incomplete, {} "
+        "without buffer, {} corrupt), packet loss {:.4f}% after {} resend "
+        "requests ({} injected), {:.1f}% copied, {} kernel drops, SO_RCVBUF "
+        "{} KiB, wake-up latency p50 <= {} us, p99 <= {} us, max {} us",
+        r.line_rate_mbps, r.frame_rate, r.bytes / r.seconds / 1e6,
+        r.bytes * 8.0 / r.seconds / 1e9, frames, r.frames_sent,
+        r.frames_complete,
+        r.frames_incomplete, r.frames_no_buffer, r.frames_corrupt,
+        expected_packets > 0 ? 100.0 * r.packets_lost / expected_packets : 0.0,
+        r.resend_requests, r.packets_dropped_by_sim,
+        r.packets ? 100.0 * r.packets_copied / r.packets : 0.0, r.kernel_drops,
+        r.socket_buffer / 1024, to_us(r.wakeup.quantile(0.5)),
+        to_us(r.wakeup.quantile(0.99)), to_us(r.wakeup.max));
+  }
+
+  if (!opts.json.empty()) {
+    std::ofstream out(opts.json);
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const auto &r = results[i];
+      out << "  {\"line_rate_mbps\": " << r.line_rate_mbps
+          << ", \"offered_fps\": " << r.frame_rate
+          << ", \"frames_sent\": " << r.frames_sent
+          << ", \"received_mb_per_s\": " << r.bytes / r.seconds / 1e6
+          << ", \"frames_complete\": " << r.frames_complete
+          << ", \"frames_incomplete\": " << r.frames_incomplete
+          << ", \"frames_no_buffer\": " << r.frames_no_buffer
+          << ", \"frames_corrupt\": " << r.frames_corrupt
+          << ", \"packets\": " << r.packets
+          << ", \"packets_lost\": " << r.packets_lost
+          << ", \"packets_copied\": " << r.packets_copied
+          << ", \"resend_requests\": " << r.resend_requests
+          << ", \"kernel_drops\": " << r.kernel_drops
+          << ", \"wakeup_p50_us\": " << to_us(r.wakeup.quantile(0.5))
+          << ", \"wakeup_p99_us\": " << to_us(r.wakeup.quantile(0.99))
+          << ", \"wakeup_max_us\": " << to_us(r.wakeup.max) << "}"
+          << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+  }
+
+  return 0;
+}
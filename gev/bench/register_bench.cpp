@@ -0,0 +1,205 @@
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <gev/gvcp_client.hpp>
+#include <gev/register_cache.hpp>
+
+#include "../sim/device_description.hpp"
+#include "../sim/simulated_device.hpp"
+
+// Bulk register access against the simulator with an emulated control
+// round trip: one command per register, batched READREG/WRITEREG,
+// pipelined reads and cache hits. Shows how much of a configuration pass
+// is spent waiting on the network.
+
+namespace {
+
+struct bench_options {
+  uint32_t                  registers = 1024; // Bootstrap registers read.
+  uint32_t                  writes = 256;
+  std::chrono::microseconds latency{200};
+  std::vector<uint32_t>     depths{1, 4, 16};
+  std::string               json;
+
+  static bench_options parse(std::span<const std::string_view> args);
+};
+
+template <typename T> T parse_number(std::string_view option, std::string_view s) {
+  T v{};
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (ec != std::errc{} || end != s.data() + s.size())
+    throw std::invalid_argument("invalid value for " + std::string(option) +
+                                ": " + std::string(s));
+  return v;
+}
+
+bench_options bench_options::parse(std::span<const std::string_view> args) {
+  bench_options o;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto option = args[i];
+    auto       value = [&]() -> std::string_view {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument(std::string(option) + " needs a value");
+      return args[++i];
+    };
+
+    if (option == "--registers")
+      o.registers = parse_number<uint32_t>(option, value());
+    else if (option == "--writes")
+      o.writes = parse_number<uint32_t>(option, value());
+    else if (option == "--latency")
+      o.latency =
+          std::chrono::microseconds(parse_number<uint32_t>(option, value()));
+    else if (option == "--depth")
+      o.depths = {parse_number<uint32_t>(option, value())};
+    else if (option == "--json")
+      o.json = value();
+    else
+      throw std::invalid_argument("unknown option: " + std::string(option));
+  }
+
+  // The simulator's bootstrap block holds 1024 registers.
+  if (o.registers == 0 || o.registers > 1024 || o.depths.front() == 0)
+    throw std::invalid_argument("option out of range");
+  return o;
+}
+
+struct result {
+  std::string name;
+  uint32_t    registers;
+  double      seconds;
+};
+
+double time_it(const std::function<void()> &body) {
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+std::unique_ptr<gev::gvcp_client> connect(gev::endpoint device,
+                                          uint32_t      max_outstanding) {
+  auto client = gev::gvcp_client::connect(
+      device, {.timeout = std::chrono::milliseconds(200),
+               .retries = 3,
+               .max_outstanding = max_outstanding});
+  if (!client)
+    throw std::runtime_error("connect: " + client.error().message());
+  return std::move(*client);
+}
+
+template <typename T> T check(std::expected<T, std::error_code> r) {
+  if (!r)
+    throw std::runtime_error(r.error().message());
+  if constexpr (!std::is_void_v<T>)
+    return std::move(*r);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  bench_options opts;
+  try {
+    opts = bench_options::parse(args);
+  } catch (const std::invalid_argument &e) {
+    spdlog::error("{}", e.what());
+    spdlog::info("usage: gev_register_bench [--registers N] [--writes N] "
+                 "[--latency US] [--depth N] [--json out.json]");
+    return 2;
+  }
+
+  const gev::endpoint device{0x7F000001, 37400};
+
+  std::vector<uint32_t> addresses(opts.registers);
+  for (uint32_t i = 0; i < opts.registers; ++i)
+    addresses[i] = i * 4;
+
+  // A configuration pass: writable device registers over and over.
+  const uint32_t writable[] = {gev::sim::device_reg::exposure_us,
+                               gev::sim::device_reg::test_pattern,
+                               gev::sim::device_reg::frame_rate_mhz,
+                               gev::reg::stream_channel_packet_delay};
+  std::vector<std::pair<uint32_t, uint32_t>> writes(opts.writes);
+  for (uint32_t i = 0; i < opts.writes; ++i)
+    writes[i] = {writable[i % std::size(writable)],
+                 writable[i % std::size(writable)] ==
+                         gev::sim::device_reg::test_pattern
+                     ? i % 2
+                     : 1000 + i};
+
+  std::vector<result> results;
+  try {
+    gev::sim::device_config config;
+    config.control = device;
+    config.control_latency = opts.latency;
+    gev::sim::simulated_device sim(config);
+
+    {
+      auto client = connect(device, 1);
+      results.push_back({"read, one command per register", opts.registers,
+                         time_it([&] {
+                           for (uint32_t a : addresses)
+                             check(client->read_register(a));
+                         })});
+      results.push_back({"write, one command per register", opts.writes,
+                         time_it([&] {
+                           for (const auto &[a, v] : writes)
+                             check(client->write_register(a, v));
+                         })});
+      results.push_back(
+          {"write, batched", opts.writes,
+           time_it([&] { check(client->write_registers(writes)); })});
+    }
+
+    for (uint32_t depth : opts.depths) {
+      auto client = connect(device, depth);
+      results.push_back(
+          {"read, batched, " + std::to_string(depth) + " in flight",
+           opts.registers,
+           time_it([&] { check(client->read_registers(addresses)); })});
+    }
+
+    gev::register_cache cache(connect(device, opts.depths.back()));
+    for (uint32_t a : addresses)
+      cache.set_policy(a, gev::cache_policy::cached);
+    check(cache.read(addresses));
+    results.push_back({"read, cached", opts.registers,
+                       time_it([&] { check(cache.read(addresses)); })});
+  } catch (const std::runtime_error &e) {
+    spdlog::error("{}", e.what());
+    return 1;
+  }
+
+  spdlog::info("control round trip {} us", opts.latency.count());
+  for (const auto &r : results)
+    spdlog::info("{:<36} {:>5} registers in {:>8.2f} ms ({:.1f} us each)",
+                 r.name, r.registers, r.seconds * 1e3,
+                 r.seconds * 1e6 / r.registers);
+
+  if (!opts.json.empty()) {
+    std::ofstream out(opts.json);
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i)
+      out << "  {\"name\": \"" << results[i].name
+          << "\", \"registers\": " << results[i].registers
+          << ", \"latency_us\": " << opts.latency.count()
+          << ", \"seconds\": " << results[i].seconds << "}"
+          << (i + 1 < results.size() ? ",\n" : "\n");
+    out << "]\n";
+  }
+
+  return 0;
+}
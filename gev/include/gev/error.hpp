@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>       /* std::string */
+#include <system_error> /* std::error_category, std::error_code */
+
+#include <gev/protocol.hpp>
+
+namespace gev {
+
+// Lets a GVCP status from a device travel in the same std::error_code as
+// socket errors and timeouts (std::errc::timed_out).
+class gvcp_category_impl final : public std::error_category {
+public:
+  const char *name() const noexcept override { return "gvcp"; }
+
+  std::string message(int value) const override {
+    switch (static_cast<gvcp_status>(value)) {
+    case gvcp_status::success:
+      return "success";
+    case gvcp_status::not_implemented:
+      return "command not implemented by the device";
+    case gvcp_status::invalid_parameter:
+      return "invalid parameter";
+    case gvcp_status::invalid_address:
+      return "invalid address";
+    case gvcp_status::write_protect:
+      return "address is write protected";
+    case gvcp_status::bad_alignment:
+      return "bad alignment";
+    case gvcp_status::access_denied:
+      return "access denied (another application has control)";
+    case gvcp_status::busy:
+      return "device busy";
+    case gvcp_status::packet_unavailable:
+      return "packet no longer available for resend";
+    default:
+      return "device error";
+    }
+  }
+};
+
+inline const std::error_category &gvcp_category() noexcept {
+  static const gvcp_category_impl instance;
+  return instance;
+}
+
+inline std::error_code make_error_code(gvcp_status s) noexcept {
+  return {static_cast<int>(s), gvcp_category()};
+}
+
+} // namespace gev
+
+template <> struct std::is_error_code_enum<gev::gvcp_status> : std::true_type {};
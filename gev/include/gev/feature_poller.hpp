@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>             /* periods and deadlines */
+#include <condition_variable> /* waking the poll thread */
+#include <cstdint>            /* uint32_t, uint64_t */
+#include <memory>             /* std::shared_ptr */
+#include <mutex>              /* state shared with the poll thread */
+#include <optional>           /* values not read yet */
+#include <span>               /* node lists */
+#include <stop_token>         /* std::stop_token */
+#include <thread>             /* poll std::jthread */
+#include <unordered_map>      /* entries by register node */
+#include <utility>            /* std::pair */
+#include <vector>             /* dependency index */
+
+#include <gev/node_map.hpp>
+#include <gev/register_cache.hpp>
+
+namespace gev {
+
+// Latest raw value of a feature's register: masked, sign-extended and in
+// host order, but before any Converter or SwissKnife formula.
+struct feature_value {
+  int64_t                               raw = 0;
+  std::chrono::steady_clock::time_point read_at;
+  bool                                  stale = false; // Invalidated since.
+};
+
+struct feature_poller_stats {
+  uint64_t batches = 0;       // register_cache reads issued.
+  uint64_t registers = 0;     // Registers in them.
+  uint64_t invalidations = 0; // Registers re-read because of pInvalidator.
+  uint64_t errors = 0;
+  uint32_t polled = 0;        // Registers currently scheduled.
+  // Share of the last second the control channel spent on polls, and how
+  // many registers it read in that second.
+  double   utilisation = 0.0;
+  uint32_t registers_per_second = 0;
+};
+
+/*========================================================================================
+ *  feature_poller
+ *  -----------------------------------------------------------------------
+ *  •  Keeps the values of the features on screen (set_visible) and the
+ *     ones asked for explicitly (subscribe) fresh, and nothing else: a
+ *     description has thousands of features and the control channel has
+ *     room for a few hundred reads per frame at best.
+ *  •  Each feature is followed through its pValue chain to the register
+ *     holding it. Registers are polled at their <PollingTime>; ones
+ *     without it are read once when they become visible, or every
+ *     default_period while subscribed. Every register due at once goes
+ *     out in one batched, pipelined register_cache read.
+ *  •  written() follows the <pInvalidator> graph backwards from the
+ *     registers written, so everything that depends on them is re-read on
+ *     the next pass rather than shown stale until its next poll.
+ *  •  Polls on its own thread; every public member is thread safe.
+ *=======================================================================================*/
+class feature_poller {
+public:
+  struct options {
+    std::chrono::milliseconds default_period{500};
+    // After a failed read, how long before the register is tried again.
+    std::chrono::milliseconds retry_period{1000};
+  };
+
+  feature_poller(std::shared_ptr<const node_map>  map,
+                 std::shared_ptr<register_cache> registers);
+  feature_poller(std::shared_ptr<const node_map>  map,
+                 std::shared_ptr<register_cache> registers, options options);
+  ~feature_poller();
+
+  feature_poller(const feature_poller &) = delete;
+  feature_poller &operator=(const feature_poller &) = delete;
+
+  const node_map &map() const noexcept { return *map_; }
+  const std::shared_ptr<register_cache> &registers() const noexcept {
+    return registers_;
+  }
+
+  // Replaces the set of features on screen; cheap when unchanged, so it
+  // can be called every frame.
+  void set_visible(std::span<const node_index> features);
+
+  void subscribe(node_index feature);
+  void unsubscribe(node_index feature);
+  bool subscribed(node_index feature) const;
+
+  // Latest value of a feature's register; nullopt if the feature has no
+  // pollable register or has not been read yet.
+  std::optional<feature_value> value(node_index feature) const;
+
+  // Registers written by someone else (the register window, say): re-reads
+  // them and everything they invalidate.
+  void written(std::span<const uint32_t> addresses);
+
+  feature_poller_stats stats() const;
+
+  // The register node holding a feature's value, following pValue; no_node
+  // if it has none this poller can read (strings, computed addresses).
+  node_index register_of(node_index feature) const noexcept;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct entry {
+    node_index                   reg;
+    uint32_t                     visible = 0; // Features on screen using it.
+    uint32_t                     subscribed = 0;
+    clock::time_point            due;
+    std::optional<feature_value> value;
+  };
+
+  void build_index();
+  void poll_loop(std::stop_token stop);
+  // Reads every due entry; returns when the next one is due.
+  clock::time_point poll_once(clock::time_point now);
+
+  void            add_use(node_index feature, bool subscription);
+  void            drop_use(node_index feature, bool subscription);
+  clock::duration period_of(const entry &e) const noexcept;
+
+  // The 32-bit registers a register node spans, and its value from them.
+  std::vector<uint32_t> words_of(node_index reg) const;
+  int64_t decode(node_index reg, std::span<const uint32_t> words) const noexcept;
+
+  std::shared_ptr<const node_map>  map_;
+  std::shared_ptr<register_cache> registers_;
+  options                         options_;
+
+  // Register nodes invalidated by a change of each register node, as
+  // CSR arrays, and register nodes sorted by address for written().
+  std::vector<uint32_t>                        dependent_starts_;
+  std::vector<node_index>                      dependents_;
+  std::vector<std::pair<uint32_t, node_index>> by_address_;
+
+  mutable std::mutex                    mutex_;
+  std::condition_variable_any           wake_;
+  std::unordered_map<node_index, entry> entries_; // By register node.
+  std::vector<node_index>               visible_; // Features, sorted.
+  std::vector<node_index>               subscriptions_;
+  feature_poller_stats                  stats_;
+  bool                                  wake_requested_ = false;
+
+  // Utilisation over the current one-second window.
+  clock::time_point window_start_;
+  clock::duration   window_busy_{};
+  uint32_t          window_registers_ = 0;
+
+  std::jthread thread_; // Last: stops before the state it uses goes.
+};
+
+} // namespace gev
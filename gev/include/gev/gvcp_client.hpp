@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>       /* request ids */
+#include <chrono>       /* timeouts, heartbeat interval */
+#include <cstddef>      /* std::byte */
+#include <cstdint>      /* uint16_t, uint32_t */
+#include <expected>     /* std::expected */
+#include <functional>   /* discovery callback */
+#include <memory>       /* std::unique_ptr */
+#include <mutex>        /* one call at a time */
+#include <span>         /* std::span */
+#include <system_error> /* std::error_code */
+#include <thread>       /* heartbeat std::jthread */
+#include <utility>      /* std::pair */
+#include <vector>       /* std::vector */
+
+#include <gev/error.hpp>
+#include <gev/protocol.hpp>
+#include <gev/udp_socket.hpp>
+
+namespace gev {
+
+struct discovered_device {
+  endpoint       control; // Where the DISCOVERY_ACK came from.
+  discovery_info info;
+};
+
+/*========================================================================================
+ *  gvcp_client
+ *  -----------------------------------------------------------------------
+ *  •  Control channel to one device. Calls are synchronous with timeout
+ *     and retry, and calls from several threads serialise.
+ *  •  Register lists and memory ranges are split into as few commands as
+ *     the protocol allows. Reads keep up to options::max_outstanding of
+ *     those commands in flight; writes always go one at a time so the
+ *     device applies them in order.
+ *  •  Errors are std::error_code: socket errors, std::errc::timed_out, or a
+ *     gvcp_status from the device (see gev/error.hpp).
+ *=======================================================================================*/
+class gvcp_client {
+public:
+  struct options {
+    std::chrono::milliseconds timeout{200};
+    uint32_t                  retries = 3;
+    // Read commands sent ahead of their acks. GigE Vision only requires
+    // devices to take one command at a time, so more is opt-in.
+    uint32_t max_outstanding = 1;
+  };
+
+  static std::expected<std::unique_ptr<gvcp_client>, std::error_code>
+  connect(endpoint device, options opts);
+  static std::expected<std::unique_ptr<gvcp_client>, std::error_code>
+  connect(endpoint device) {
+    return connect(device, options{});
+  }
+
+  using discovery_callback = std::function<void(const discovered_device &)>;
+
+  // Sends DISCOVERY_CMD from local to every target (unicast or a broadcast
+  // address) and gathers the answers that arrive before the timeout.
+  // Binding local to an interface's address sends broadcasts out of that
+  // interface. on_found, if set, sees each device as soon as it answers.
+  static std::expected<std::vector<discovered_device>, std::error_code>
+  discover(std::span<const endpoint> targets, std::chrono::milliseconds timeout,
+           endpoint local = {}, const discovery_callback &on_found = {});
+
+  ~gvcp_client();
+
+  gvcp_client(const gvcp_client &) = delete;
+  gvcp_client &operator=(const gvcp_client &) = delete;
+
+  endpoint device() const noexcept { return device_; }
+
+  // Up to gvcp_max_read_registers addresses (gvcp_max_write_registers
+  // writes) go in one command; longer lists are split.
+  std::expected<std::vector<uint32_t>, std::error_code>
+  read_registers(std::span<const uint32_t> addresses);
+  std::expected<uint32_t, std::error_code> read_register(uint32_t address);
+
+  std::expected<void, std::error_code>
+  write_registers(std::span<const std::pair<uint32_t, uint32_t>> writes);
+  std::expected<void, std::error_code> write_register(uint32_t address,
+                                                      uint32_t value);
+
+  // Reads any length, in gvcp_max_memory_transfer chunks.
+  std::expected<void, std::error_code> read_memory(uint32_t             address,
+                                                   std::span<std::byte> out);
+
+  // Fire and forget; safe to call from the stream receive thread, and
+  // never waits for a call in progress.
+  void request_resend(uint16_t block_id, uint32_t first_packet,
+                      uint32_t last_packet);
+
+  // Takes control privilege and keeps it by reading the privilege register
+  // every interval, which must be well under the device heartbeat timeout.
+  std::expected<void, std::error_code>
+  take_control(std::chrono::milliseconds heartbeat_interval);
+  void release_control();
+
+private:
+  gvcp_client(udp_socket socket, endpoint device, options opts);
+
+  struct request {
+    gvcp_command               command;
+    std::span<const std::byte> payload;
+    gvcp_command               expected_answer;
+    std::span<std::byte>       reply;
+    // Ack payload size; an empty error_code if the request was never sent.
+    std::expected<size_t, std::error_code> result =
+        std::unexpected(std::error_code{});
+  };
+
+  // Sends one command and waits for its ack; returns the ack payload size.
+  std::expected<size_t, std::error_code>
+  transact(gvcp_command command, std::span<const std::byte> payload,
+           gvcp_command expected_answer, std::span<std::byte> reply);
+
+  // Sends the requests in order with up to max_outstanding awaiting their
+  // acks, each with its own timeout and retries. Nothing further is sent
+  // once one fails, so the first failure in order is the real one.
+  void transact(std::span<request> requests, uint32_t max_outstanding);
+
+  // Any thread; transactions and resend requests draw from one sequence.
+  uint16_t next_request_id() noexcept {
+    // 0 is not a valid request id; the counter passes it once per wrap.
+    uint16_t id = next_req_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (id == 0)
+      id = next_req_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+    return id;
+  }
+
+  udp_socket socket_;
+  endpoint   device_;
+  options    options_;
+
+  std::mutex            mutex_; // One transaction at a time.
+  std::atomic<uint16_t> next_req_id_{0};
+
+  std::jthread heartbeat_;
+};
+
+} // namespace gev
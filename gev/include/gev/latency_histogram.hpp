@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm> /* std::min */
+#include <array>     /* buckets */
+#include <atomic>    /* counters read by other threads */
+#include <bit>       /* std::bit_width */
+#include <chrono>    /* durations */
+#include <cstddef>   /* size_t */
+#include <cstdint>   /* uint64_t */
+
+namespace gev {
+
+/*========================================================================================
+ *  latency_histogram
+ *  -----------------------------------------------------------------------
+ *  •  Power-of-two microsecond buckets: bucket 0 holds samples under 1 µs,
+ *     bucket k samples in [2^(k-1), 2^k) µs. Cheap enough to record on
+ *     every wake-up of a receive loop.
+ *  •  One writer; any thread may take a snapshot. Counters are relaxed
+ *     atomics, so a snapshot taken mid-record can be off by one sample.
+ *=======================================================================================*/
+class latency_histogram {
+public:
+  static constexpr size_t bucket_count = 24; // Last bucket: 4 s and up.
+
+  struct snapshot {
+    std::array<uint64_t, bucket_count> counts{};
+    uint64_t                           count = 0;
+    std::chrono::nanoseconds           total{0};
+    std::chrono::nanoseconds           max{0};
+
+    std::chrono::nanoseconds mean() const noexcept {
+      return count ? total / static_cast<int64_t>(count)
+                   : std::chrono::nanoseconds{0};
+    }
+
+    // Upper bound of the bucket holding quantile q (0..1); within a factor
+    // of two of the true value.
+    std::chrono::nanoseconds quantile(double q) const noexcept {
+      if (count == 0)
+        return std::chrono::nanoseconds{0};
+      const auto rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+      uint64_t   seen = 0;
+      for (size_t k = 0; k < bucket_count; ++k) {
+        seen += counts[k];
+        if (seen >= rank)
+          return std::min(bucket_upper(k), max);
+      }
+      return max;
+    }
+  };
+
+  static constexpr std::chrono::nanoseconds bucket_upper(size_t k) noexcept {
+    return std::chrono::microseconds(uint64_t{1} << k);
+  }
+
+  static constexpr size_t bucket_of(std::chrono::nanoseconds d) noexcept {
+    const auto us = static_cast<uint64_t>(std::max<int64_t>(d.count(), 0)) / 1000;
+    return std::min<size_t>(std::bit_width(us), bucket_count - 1);
+  }
+
+  void record(std::chrono::nanoseconds d) noexcept {
+    if (d.count() < 0)
+      d = std::chrono::nanoseconds{0};
+    counts_[bucket_of(d)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(static_cast<uint64_t>(d.count()),
+                        std::memory_order_relaxed);
+    if (static_cast<uint64_t>(d.count()) > max_ns_.load(std::memory_order_relaxed))
+      max_ns_.store(static_cast<uint64_t>(d.count()), std::memory_order_relaxed);
+  }
+
+  snapshot read() const noexcept {
+    snapshot s;
+    for (size_t k = 0; k < bucket_count; ++k)
+      s.counts[k] = counts_[k].load(std::memory_order_relaxed);
+    s.count = count_.load(std::memory_order_relaxed);
+    s.total = std::chrono::nanoseconds(total_ns_.load(std::memory_order_relaxed));
+    s.max = std::chrono::nanoseconds(max_ns_.load(std::memory_order_relaxed));
+    return s;
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, bucket_count> counts_{};
+  std::atomic<uint64_t>                           count_{0};
+  std::atomic<uint64_t>                           total_ns_{0};
+  std::atomic<uint64_t>                           max_ns_{0};
+};
+
+} // namespace gev
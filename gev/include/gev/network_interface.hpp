@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint> /* uint32_t */
+#include <string>  /* interface names */
+#include <vector>  /* interface list */
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+
+namespace gev {
+
+// An IPv4 address of a local interface, in host byte order.
+struct network_interface {
+  std::string name;
+  uint32_t    address = 0;
+  uint32_t    netmask = 0;
+  uint32_t    broadcast = 0; // Directed broadcast for the subnet.
+  bool        loopback = false;
+
+  bool contains(uint32_t ip) const noexcept {
+    return (ip & netmask) == (address & netmask);
+  }
+};
+
+// Every IPv4 address on an interface that is up, in getifaddrs order.
+inline std::vector<network_interface> ipv4_interfaces() {
+  std::vector<network_interface> result;
+
+  ifaddrs *addresses = nullptr;
+  if (::getifaddrs(&addresses) != 0)
+    return result;
+
+  for (ifaddrs *a = addresses; a; a = a->ifa_next) {
+    if (!a->ifa_addr || a->ifa_addr->sa_family != AF_INET ||
+        !(a->ifa_flags & IFF_UP))
+      continue;
+
+    const auto ip = [](const sockaddr *sa) {
+      return sa ? ntohl(reinterpret_cast<const sockaddr_in *>(sa)->sin_addr.s_addr)
+                : 0u;
+    };
+
+    network_interface i{
+        .name = a->ifa_name,
+        .address = ip(a->ifa_addr),
+        .netmask = ip(a->ifa_netmask),
+        .loopback = (a->ifa_flags & IFF_LOOPBACK) != 0,
+    };
+    i.broadcast = i.address | ~i.netmask;
+    result.push_back(std::move(i));
+  }
+
+  ::freeifaddrs(addresses);
+  return result;
+}
+
+} // namespace gev
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>      /* std::byte */
+#include <cstdint>      /* uint32_t, int64_t */
+#include <expected>     /* std::expected */
+#include <filesystem>   /* cache and XML paths */
+#include <memory>       /* shared backing storage */
+#include <optional>     /* name lookups */
+#include <span>         /* node and link arrays */
+#include <string>       /* owned XML */
+#include <string_view>  /* node strings */
+#include <system_error> /* std::error_code */
+#include <type_traits>  /* layout checks */
+
+namespace gev {
+
+// GenICam node map: every node of a device description in one flat array,
+// cross-referenced by index. Strings are views into the XML itself (or the
+// compiled cache) rather than copies.
+
+using node_index = uint32_t;
+inline constexpr node_index no_node = ~node_index{0};
+
+enum class node_kind : uint8_t {
+  other, // Anything else with a Name; kept so references still resolve.
+  category,
+  integer,
+  float_,
+  boolean,
+  enumeration,
+  enum_entry,
+  command,
+  string,
+  int_reg,
+  masked_int_reg, // Also every StructEntry of a StructReg.
+  float_reg,
+  string_reg,
+  register_,
+  struct_reg, // Unnamed container; its entries are the features.
+  converter,
+  int_converter,
+  swiss_knife,
+  int_swiss_knife,
+  port,
+};
+
+enum class access_mode : uint8_t { rw, ro, wo, na };
+
+// <Cachable>; the GenICam default is write_through.
+enum class cachable : uint8_t { write_through, write_around, no_cache };
+
+enum class visibility_level : uint8_t { beginner, expert, guru, invisible };
+
+// A string in the node map, resolved with node_map::str().
+struct string_ref {
+  uint32_t offset = 0;
+  uint32_t size = 0;
+
+  bool empty() const noexcept { return size == 0; }
+};
+
+// A run of entries in node_map::links().
+struct link_range {
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+struct node_link {
+  node_index target = no_node;
+  string_ref label; // pVariable Name; empty otherwise.
+};
+
+// One node. Trivially copyable and free of pointers, so the node array is
+// written to and mapped back from the compiled cache as is.
+struct node {
+  string_ref name;
+  string_ref display_name;
+  string_ref tooltip;
+  string_ref description;
+  string_ref unit;
+
+  // Constants as written (<Value>, <Min>, <Max>, <Inc>); the p* references
+  // below take precedence when set.
+  string_ref value;
+  string_ref min;
+  string_ref max;
+  string_ref inc;
+
+  string_ref formula; // SwissKnife
+  string_ref formula_to; // Converter
+  string_ref formula_from;
+
+  uint64_t address = 0;  // Sum of every <Address>.
+  int64_t  constant = 0; // EnumEntry <Value>, Command <CommandValue>.
+  uint32_t length = 0;
+  uint32_t polling_ms = 0;
+
+  node_index value_ref = no_node;
+  node_index min_ref = no_node;
+  node_index max_ref = no_node;
+  node_index inc_ref = no_node;
+  node_index address_ref = no_node; // Added to address.
+
+  link_range children;     // pFeature, EnumEntry, StructEntry.
+  link_range invalidators; // pInvalidator: nodes whose change stales this.
+  link_range selected;     // pSelected.
+  link_range variables;    // pVariable, labelled.
+
+  node_kind        kind = node_kind::other;
+  access_mode      access = access_mode::rw;
+  cachable         cache = cachable::write_through;
+  visibility_level visibility = visibility_level::beginner;
+  uint8_t          lsb = 0; // Masked registers, counted as in the XML.
+  uint8_t          msb = 0;
+  bool             is_signed = false;
+  bool             little_endian = false;
+};
+
+static_assert(std::is_trivially_copyable_v<node> &&
+              std::is_standard_layout_v<node>);
+
+/*========================================================================================
+ *  node_map
+ *  -----------------------------------------------------------------------
+ *  •  parse() tokenises the XML in one pass without building a DOM: nodes
+ *     are appended to a flat array as their elements open, properties
+ *     are stored as views into the source, and references by name are
+ *     resolved afterwards through a sorted name index.
+ *  •  The compiled form (nodes, links, name index and a compacted string
+ *     pool) is cached on disk keyed by a hash of the XML, so later loads
+ *     are an open, an mmap and a bounds check.
+ *  •  Immutable once built; copies share storage and can be used from any
+ *     thread.
+ *=======================================================================================*/
+class node_map {
+public:
+  // Malformed XML fails with std::errc::bad_message.
+  static std::expected<node_map, std::error_code> parse(std::string xml);
+  static std::expected<node_map, std::error_code>
+  parse_file(const std::filesystem::path &xml_file);
+
+  // Maps a compiled cache written by save(); fails with
+  // std::errc::invalid_argument if it is not one, or not for this XML.
+  static std::expected<node_map, std::error_code>
+  load(const std::filesystem::path &cache_file, uint64_t xml_hash,
+       uint64_t xml_size);
+
+  // The compiled cache for xml in cache_dir if there is one; otherwise
+  // parses xml and writes the cache for next time.
+  static std::expected<node_map, std::error_code>
+  load_or_compile(std::string xml, const std::filesystem::path &cache_dir);
+  static std::expected<node_map, std::error_code>
+  load_or_compile_file(const std::filesystem::path &xml_file,
+                       const std::filesystem::path &cache_dir);
+
+  static uint64_t              hash(std::string_view xml) noexcept;
+  static std::filesystem::path cache_file(const std::filesystem::path &cache_dir,
+                                          uint64_t xml_hash);
+
+  // Parsed maps only. Via a temporary file and a rename, so readers never
+  // see a torn file.
+  std::expected<void, std::error_code>
+  save(const std::filesystem::path &cache_file) const;
+
+  std::span<const node>       nodes() const noexcept { return nodes_; }
+  std::span<const node_link>  links() const noexcept { return links_; }
+  const node &operator[](node_index i) const noexcept { return nodes_[i]; }
+  size_t      size() const noexcept { return nodes_.size(); }
+
+  std::span<const node_link> links(link_range r) const noexcept {
+    return links_.subspan(r.first, r.count);
+  }
+
+  std::string_view str(string_ref r) const noexcept;
+
+  std::optional<node_index> find(std::string_view name) const noexcept;
+
+  // The "Root" category, or no_node.
+  node_index root() const noexcept { return root_; }
+
+  // Whether this map was mapped from the compiled cache.
+  bool from_cache() const noexcept { return from_cache_; }
+
+  // References to names no node has; vendor descriptions have a few.
+  uint32_t unresolved_references() const noexcept { return unresolved_; }
+
+private:
+  struct storage;
+  friend class node_map_builder;
+
+  node_map() = default;
+
+  std::shared_ptr<const void> backing_;
+
+  std::span<const node>       nodes_;
+  std::span<const node_link>  links_;
+  std::span<const node_index> names_; // Named nodes, sorted by name.
+  std::string_view            strings_;
+  std::string_view            decoded_; // Strings with entities expanded.
+
+  node_index root_ = no_node;
+  uint32_t   unresolved_ = 0;
+  bool       from_cache_ = false;
+};
+
+} // namespace gev
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <bit>     /* std::byteswap, std::endian */
+#include <cstddef> /* std::byte, size_t */
+#include <cstdint> /* uint8_t .. uint64_t */
+#include <cstring> /* std::memcpy */
+#include <span>    /* std::span */
+
+/*========================================================================================
+ *  GigE Vision wire format
+ *  -----------------------------------------------------------------------
+ *  •  Just enough of GVCP (control, UDP 3956) and GVSP (streaming) to talk to
+ *     our detectors and to the in-tree simulator. Standard (16-bit block id)
+ *     mode only; the extended-id mode is not used by our hardware.
+ *  •  Everything on the wire is big-endian. Structs here are host-order
+ *     views; use encode/decode rather than copying them onto the wire.
+ *=======================================================================================*/
+namespace gev {
+
+/*------------------------------  byte order  ------------------------------*/
+
+template <typename T> constexpr T to_big_endian(T v) noexcept {
+  if constexpr (std::endian::native == std::endian::little)
+    return std::byteswap(v);
+  else
+    return v;
+}
+
+template <typename T> T load_be(const std::byte *p) noexcept {
+  T v;
+  std::memcpy(&v, p, sizeof(T));
+  return to_big_endian(v);
+}
+
+template <typename T> void store_be(std::byte *p, T v) noexcept {
+  v = to_big_endian(v);
+  std::memcpy(p, &v, sizeof(T));
+}
+
+/*---------------------------------  GVCP  ---------------------------------*/
+
+inline constexpr uint16_t gvcp_port = 3956;
+inline constexpr uint8_t  gvcp_key = 0x42;
+
+// Command header flags.
+inline constexpr uint8_t gvcp_flag_ack_required = 0x01;
+inline constexpr uint8_t gvcp_flag_allow_broadcast_ack = 0x10;
+
+enum class gvcp_command : uint16_t {
+  discovery_cmd = 0x0002,
+  discovery_ack = 0x0003,
+  packet_resend_cmd = 0x0040,
+  readreg_cmd = 0x0080,
+  readreg_ack = 0x0081,
+  writereg_cmd = 0x0082,
+  writereg_ack = 0x0083,
+  readmem_cmd = 0x0084,
+  readmem_ack = 0x0085,
+  writemem_cmd = 0x0086,
+  writemem_ack = 0x0087,
+  pending_ack = 0x0089,
+};
+
+enum class gvcp_status : uint16_t {
+  success = 0x0000,
+  not_implemented = 0x8001,
+  invalid_parameter = 0x8002,
+  invalid_address = 0x8003,
+  write_protect = 0x8004,
+  bad_alignment = 0x8005,
+  access_denied = 0x8006,
+  busy = 0x8007,
+  packet_unavailable = 0x800C,
+  error = 0x8FFF,
+};
+
+inline constexpr size_t gvcp_header_size = 8;
+
+// Largest GVCP payload: a 576-byte datagram minus IP, UDP and GVCP headers.
+inline constexpr size_t gvcp_max_payload = 540;
+
+// READREG carries up to this many addresses per command, WRITEREG this
+// many address/value pairs.
+inline constexpr size_t gvcp_max_read_registers = gvcp_max_payload / 4;
+inline constexpr size_t gvcp_max_write_registers = gvcp_max_payload / 8;
+
+// READMEM/WRITEMEM transfer at most this many bytes per command.
+inline constexpr size_t gvcp_max_memory_transfer = 512;
+
+struct gvcp_command_header {
+  uint8_t      flags = gvcp_flag_ack_required;
+  gvcp_command command{};
+  uint16_t     length = 0; // Payload bytes following the header.
+  uint16_t     req_id = 0; // Never 0 on the wire.
+
+  void encode(std::byte *p) const noexcept {
+    p[0] = std::byte{gvcp_key};
+    p[1] = std::byte{flags};
+    store_be(p + 2, static_cast<uint16_t>(command));
+    store_be(p + 4, length);
+    store_be(p + 6, req_id);
+  }
+
+  // False if the key byte is wrong or the buffer is too short.
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < gvcp_header_size || b[0] != std::byte{gvcp_key})
+      return false;
+    flags = static_cast<uint8_t>(b[1]);
+    command = static_cast<gvcp_command>(load_be<uint16_t>(b.data() + 2));
+    length = load_be<uint16_t>(b.data() + 4);
+    req_id = load_be<uint16_t>(b.data() + 6);
+    return true;
+  }
+};
+
+struct gvcp_ack_header {
+  gvcp_status  status = gvcp_status::success;
+  gvcp_command answer{};
+  uint16_t     length = 0;
+  uint16_t     ack_id = 0; // Echoes the command's req_id.
+
+  void encode(std::byte *p) const noexcept {
+    store_be(p, static_cast<uint16_t>(status));
+    store_be(p + 2, static_cast<uint16_t>(answer));
+    store_be(p + 4, length);
+    store_be(p + 6, ack_id);
+  }
+
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < gvcp_header_size)
+      return false;
+    status = static_cast<gvcp_status>(load_be<uint16_t>(b.data()));
+    answer = static_cast<gvcp_command>(load_be<uint16_t>(b.data() + 2));
+    length = load_be<uint16_t>(b.data() + 4);
+    ack_id = load_be<uint16_t>(b.data() + 6);
+    return true;
+  }
+};
+
+// DISCOVERY_ACK payload; the layout mirrors bootstrap registers 0x0000-0x00F7.
+inline constexpr size_t discovery_ack_size = 0xF8;
+
+struct discovery_info {
+  uint16_t spec_major = 2;
+  uint16_t spec_minor = 0;
+  uint32_t device_mode = 0x80000000; // Big-endian device, class transmitter.
+  uint64_t mac = 0;                  // Low 48 bits.
+  uint32_t ip = 0;
+  uint32_t subnet = 0;
+  uint32_t gateway = 0;
+  char     manufacturer[32]{};
+  char     model[32]{};
+  char     version[32]{};
+  char     manufacturer_info[48]{};
+  char     serial[16]{};
+  char     user_name[16]{};
+
+  void encode(std::byte *p) const noexcept {
+    std::memset(p, 0, discovery_ack_size);
+    store_be(p + 0x00, spec_major);
+    store_be(p + 0x02, spec_minor);
+    store_be(p + 0x04, device_mode);
+    store_be(p + 0x0A, static_cast<uint16_t>(mac >> 32));
+    store_be(p + 0x0C, static_cast<uint32_t>(mac));
+    store_be(p + 0x10, uint32_t{0x7}); // Supports persistent IP, DHCP, LLA.
+    store_be(p + 0x14, uint32_t{0x4}); // Currently LLA.
+    store_be(p + 0x24, ip);
+    store_be(p + 0x34, subnet);
+    store_be(p + 0x44, gateway);
+    std::memcpy(p + 0x48, manufacturer, sizeof(manufacturer));
+    std::memcpy(p + 0x68, model, sizeof(model));
+    std::memcpy(p + 0x88, version, sizeof(version));
+    std::memcpy(p + 0xA8, manufacturer_info, sizeof(manufacturer_info));
+    std::memcpy(p + 0xD8, serial, sizeof(serial));
+    std::memcpy(p + 0xE8, user_name, sizeof(user_name));
+  }
+
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < discovery_ack_size)
+      return false;
+    const std::byte *p = b.data();
+    spec_major = load_be<uint16_t>(p + 0x00);
+    spec_minor = load_be<uint16_t>(p + 0x02);
+    device_mode = load_be<uint32_t>(p + 0x04);
+    mac = (uint64_t{load_be<uint16_t>(p + 0x0A)} << 32) |
+          load_be<uint32_t>(p + 0x0C);
+    ip = load_be<uint32_t>(p + 0x24);
+    subnet = load_be<uint32_t>(p + 0x34);
+    gateway = load_be<uint32_t>(p + 0x44);
+    std::memcpy(manufacturer, p + 0x48, sizeof(manufacturer));
+    std::memcpy(model, p + 0x68, sizeof(model));
+    std::memcpy(version, p + 0x88, sizeof(version));
+    std::memcpy(manufacturer_info, p + 0xA8, sizeof(manufacturer_info));
+    std::memcpy(serial, p + 0xD8, sizeof(serial));
+    std::memcpy(user_name, p + 0xE8, sizeof(user_name));
+    // Strings are not required to be terminated when they fill the field.
+    manufacturer[sizeof(manufacturer) - 1] = model[sizeof(model) - 1] =
+        version[sizeof(version) - 1] = serial[sizeof(serial) - 1] =
+            user_name[sizeof(user_name) - 1] = '\0';
+    manufacturer_info[sizeof(manufacturer_info) - 1] = '\0';
+    return true;
+  }
+};
+
+// Bootstrap register map (GigE Vision 2.0, section 28).
+namespace reg {
+inline constexpr uint32_t version = 0x0000;
+inline constexpr uint32_t device_mode = 0x0004;
+inline constexpr uint32_t mac_high = 0x0008;
+inline constexpr uint32_t mac_low = 0x000C;
+inline constexpr uint32_t current_ip = 0x0024;
+inline constexpr uint32_t current_subnet = 0x0034;
+inline constexpr uint32_t current_gateway = 0x0044;
+inline constexpr uint32_t manufacturer_name = 0x0048;
+inline constexpr uint32_t model_name = 0x0068;
+inline constexpr uint32_t device_version = 0x0088;
+inline constexpr uint32_t manufacturer_info = 0x00A8;
+inline constexpr uint32_t serial_number = 0x00D8;
+inline constexpr uint32_t user_defined_name = 0x00E8;
+inline constexpr uint32_t first_url = 0x0200;
+inline constexpr uint32_t second_url = 0x0400;
+inline constexpr uint32_t url_size = 0x200;
+inline constexpr uint32_t network_interface_count = 0x0600;
+inline constexpr uint32_t message_channel_count = 0x0900;
+inline constexpr uint32_t stream_channel_count = 0x0904;
+inline constexpr uint32_t gvcp_capability = 0x0934;
+inline constexpr uint32_t heartbeat_timeout = 0x0938; // Milliseconds.
+inline constexpr uint32_t timestamp_frequency_high = 0x093C;
+inline constexpr uint32_t timestamp_frequency_low = 0x0940;
+inline constexpr uint32_t timestamp_control = 0x0944;
+inline constexpr uint32_t timestamp_value_high = 0x0948;
+inline constexpr uint32_t timestamp_value_low = 0x094C;
+inline constexpr uint32_t control_channel_privilege = 0x0A00;
+
+// Stream channel registers; channel n is at + n * stream_channel_stride.
+inline constexpr uint32_t stream_channel_stride = 0x40;
+inline constexpr uint32_t stream_channel_port = 0x0D00;
+inline constexpr uint32_t stream_channel_packet_size = 0x0D04;
+inline constexpr uint32_t stream_channel_packet_delay = 0x0D08;
+inline constexpr uint32_t stream_channel_destination = 0x0D18;
+inline constexpr uint32_t stream_channel_source_port = 0x0D1C;
+
+// GVCP capability bits.
+inline constexpr uint32_t capability_write_memory = 1u << 1;
+inline constexpr uint32_t capability_packet_resend = 1u << 2;
+inline constexpr uint32_t capability_concatenation = 1u << 0; // Multi-register.
+
+// Control channel privilege bits.
+inline constexpr uint32_t privilege_exclusive = 1u << 0;
+inline constexpr uint32_t privilege_control = 1u << 1;
+
+// Packet size register: low 16 bits hold the size in bytes.
+inline constexpr uint32_t packet_size_mask = 0xFFFF;
+} // namespace reg
+
+/*---------------------------------  GVSP  ---------------------------------*/
+
+enum class gvsp_format : uint8_t {
+  leader = 1,
+  trailer = 2,
+  payload = 3,
+};
+
+inline constexpr uint16_t gvsp_payload_image = 0x0001;
+
+// PFNC pixel formats we produce or accept.
+inline constexpr uint32_t pixel_format_mono16 = 0x01100007;
+
+inline constexpr size_t gvsp_header_size = 8;
+inline constexpr size_t ip_udp_overhead = 20 + 8;
+
+// Image data bytes carried by one payload packet for a given
+// SCPS packet size (which counts the IP and UDP headers).
+constexpr size_t gvsp_payload_per_packet(uint32_t packet_size) noexcept {
+  return packet_size - ip_udp_overhead - gvsp_header_size;
+}
+
+struct gvsp_header {
+  uint16_t    status = 0;
+  uint16_t    block_id = 0; // Frame number; 0 is never used.
+  gvsp_format format{};
+  uint32_t    packet_id = 0; // 24 bits; the leader is 0.
+
+  void encode(std::byte *p) const noexcept {
+    store_be(p, status);
+    store_be(p + 2, block_id);
+    store_be(p + 4, (uint32_t{static_cast<uint8_t>(format)} << 24) |
+                        (packet_id & 0x00FFFFFF));
+  }
+
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < gvsp_header_size)
+      return false;
+    status = load_be<uint16_t>(b.data());
+    block_id = load_be<uint16_t>(b.data() + 2);
+    const uint32_t w = load_be<uint32_t>(b.data() + 4);
+    // The top bit of the format byte selects extended ids, which we reject.
+    if (w & 0x80000000)
+      return false;
+    format = static_cast<gvsp_format>((w >> 24) & 0x0F);
+    packet_id = w & 0x00FFFFFF;
+    return true;
+  }
+};
+
+inline constexpr size_t gvsp_image_leader_size = 36;
+
+struct gvsp_image_leader {
+  uint64_t timestamp = 0; // Device ticks.
+  uint32_t pixel_format = pixel_format_mono16;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t offset_x = 0;
+  uint32_t offset_y = 0;
+
+  void encode(std::byte *p) const noexcept {
+    store_be(p, uint16_t{0});
+    store_be(p + 2, gvsp_payload_image);
+    store_be(p + 4, timestamp);
+    store_be(p + 12, pixel_format);
+    store_be(p + 16, width);
+    store_be(p + 20, height);
+    store_be(p + 24, offset_x);
+    store_be(p + 28, offset_y);
+    store_be(p + 32, uint32_t{0}); // Padding x/y.
+  }
+
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < gvsp_image_leader_size ||
+        load_be<uint16_t>(b.data() + 2) != gvsp_payload_image)
+      return false;
+    timestamp = load_be<uint64_t>(b.data() + 4);
+    pixel_format = load_be<uint32_t>(b.data() + 12);
+    width = load_be<uint32_t>(b.data() + 16);
+    height = load_be<uint32_t>(b.data() + 20);
+    offset_x = load_be<uint32_t>(b.data() + 24);
+    offset_y = load_be<uint32_t>(b.data() + 28);
+    return true;
+  }
+};
+
+inline constexpr size_t gvsp_image_trailer_size = 8;
+
+// PACKETRESEND_CMD payload: stream channel, block id, first and last packet.
+inline constexpr size_t packet_resend_size = 12;
+
+struct packet_resend {
+  uint16_t channel = 0;
+  uint16_t block_id = 0;
+  uint32_t first_packet = 0;
+  uint32_t last_packet = 0;
+
+  void encode(std::byte *p) const noexcept {
+    store_be(p, channel);
+    store_be(p + 2, block_id);
+    store_be(p + 4, first_packet & 0x00FFFFFF);
+    store_be(p + 8, last_packet & 0x00FFFFFF);
+  }
+
+  bool decode(std::span<const std::byte> b) noexcept {
+    if (b.size() < packet_resend_size)
+      return false;
+    channel = load_be<uint16_t>(b.data());
+    block_id = load_be<uint16_t>(b.data() + 2);
+    first_packet = load_be<uint32_t>(b.data() + 4) & 0x00FFFFFF;
+    last_packet = load_be<uint32_t>(b.data() + 8) & 0x00FFFFFF;
+    return true;
+  }
+};
+
+// Block ids wrap from 0xFFFF to 1; 0 is reserved.
+constexpr uint16_t next_block_id(uint16_t id) noexcept {
+  return id == 0xFFFF ? 1 : static_cast<uint16_t>(id + 1);
+}
+
+// Extends block ids into a frame count that keeps rising across wraps: the
+// frame after 0xFFFF counts on from it instead of starting again at 1. An
+// id up to half the range ahead of the newest is a newer frame, any lost
+// in between counted; one further ahead is an older frame completing late,
+// and gets the count it would have had.
+class block_counter {
+public:
+  uint64_t count(uint16_t block_id) noexcept {
+    constexpr uint32_t period = 0xFFFF; // Ids 1 to 0xFFFF.
+    if (newest_ == 0) {
+      newest_id_ = block_id;
+      newest_ = block_id;
+      return newest_;
+    }
+    const uint32_t ahead = (uint32_t{block_id} + period - newest_id_) % period;
+    if (ahead <= period / 2) {
+      newest_id_ = block_id;
+      newest_ += ahead;
+      return newest_;
+    }
+    // Late, from before the first frame counted: there is no count left.
+    const uint32_t behind = period - ahead;
+    return newest_ > behind ? newest_ - behind : 0;
+  }
+
+private:
+  uint16_t newest_id_ = 0;
+  uint64_t newest_ = 0; // 0: nothing counted yet.
+};
+
+} // namespace gev
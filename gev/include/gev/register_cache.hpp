@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>       /* uint32_t */
+#include <expected>      /* std::expected */
+#include <memory>        /* std::shared_ptr */
+#include <mutex>         /* cache access from several threads */
+#include <optional>      /* sweep results */
+#include <span>          /* address lists */
+#include <system_error>  /* std::error_code */
+#include <unordered_map> /* policies and cached values */
+#include <utility>       /* std::pair */
+#include <vector>        /* results */
+
+#include <gev/gvcp_client.hpp>
+
+namespace gev {
+
+// How reads and writes of one register use the cache; the same choices as
+// GenICam's <Cachable>.
+enum class cache_policy : uint8_t {
+  // Every read goes to the device: status, counters, temperatures.
+  volatile_,
+  // Reads are served from the cache once filled. Writes go to the device
+  // and drop the cached value, since the device may adjust what it stores.
+  cached,
+  // Reads are served from the cache once filled. Writes go to the device
+  // and, once acknowledged, are cached as written.
+  write_through,
+};
+
+struct register_cache_stats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;  // Reads of cacheable registers that went out.
+  uint64_t batches = 0; // Client calls; each is one or more commands.
+};
+
+/*========================================================================================
+ *  register_cache
+ *  -----------------------------------------------------------------------
+ *  •  Register access for one device on top of gvcp_client: any number of
+ *     reads or writes become the fewest READREG/WRITEREG commands, and
+ *     reads are pipelined as far as the client's options allow.
+ *  •  Registers default to cache_policy::volatile_ until told otherwise,
+ *     e.g. from the device's GenICam description.
+ *  •  Thread safe; the client serialises the commands themselves.
+ *=======================================================================================*/
+class register_cache {
+public:
+  explicit register_cache(std::shared_ptr<gvcp_client> client)
+      : client_(std::move(client)) {}
+
+  gvcp_client &client() const noexcept { return *client_; }
+
+  void         set_policy(uint32_t address, cache_policy policy);
+  cache_policy policy(uint32_t address) const;
+
+  // Values in the order of addresses. Cached registers already known are
+  // not read again; the rest go out in one batch.
+  std::expected<std::vector<uint32_t>, std::error_code>
+  read(std::span<const uint32_t> addresses);
+  std::expected<uint32_t, std::error_code> read(uint32_t address);
+
+  // Written in order; on failure, cached values of every register in the
+  // call are dropped, since some of the writes may have landed.
+  std::expected<void, std::error_code>
+  write(std::span<const std::pair<uint32_t, uint32_t>> writes);
+  std::expected<void, std::error_code> write(uint32_t address, uint32_t value);
+
+  // Reads count consecutive registers from first, bypassing and refreshing
+  // the cache. Registers the device refuses are nullopt; failed batches are
+  // split until the refusing registers are isolated. Only timeouts and
+  // socket errors fail the whole sweep.
+  std::expected<std::vector<std::optional<uint32_t>>, std::error_code>
+  sweep(uint32_t first, uint32_t count);
+
+  void invalidate(uint32_t address);
+  void invalidate_all();
+
+  register_cache_stats stats() const;
+
+private:
+  std::expected<void, std::error_code>
+  sweep_batch(std::span<const uint32_t> addresses,
+              std::span<std::optional<uint32_t>> out);
+
+  // Caches values read while generation_ was generation; a write or
+  // invalidation since then may have made them stale, so they are dropped.
+  void store(std::span<const uint32_t> addresses,
+             std::span<const uint32_t> values, uint64_t generation);
+
+  std::shared_ptr<gvcp_client> client_;
+
+  mutable std::mutex                         mutex_;
+  std::unordered_map<uint32_t, cache_policy> policies_;
+  std::unordered_map<uint32_t, uint32_t>     values_;
+  register_cache_stats                       stats_;
+  // Bumped as each write goes out and again once it is answered, and by
+  // every invalidation.
+  uint64_t generation_ = 0;
+};
+
+} // namespace gev
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>        /* iovec triples */
+#include <atomic>       /* slot ownership, counters */
+#include <chrono>       /* timeouts */
+#include <cstddef>      /* std::byte */
+#include <cstdint>      /* uint16_t .. uint64_t */
+#include <expected>     /* std::expected */
+#include <functional>   /* callbacks */
+#include <memory>       /* std::unique_ptr */
+#include <span>         /* framebuffers */
+#include <stop_token>   /* std::stop_token */
+#include <system_error> /* std::error_code */
+#include <vector>       /* per-slot state */
+
+#include <sys/socket.h> /* mmsghdr */
+
+#include <gev/latency_histogram.hpp>
+#include <gev/protocol.hpp>
+#include <gev/udp_socket.hpp>
+
+namespace gev {
+
+enum class receive_mode {
+  // recvmmsg blocks (MSG_WAITFORONE) with a short socket timeout; cheap on
+  // CPU, adds a wake-up latency per batch.
+  blocking,
+  // Spins on non-blocking recvmmsg; burns a core for the lowest latency
+  // and the best chance of keeping up at 10 GbE.
+  busy_poll,
+};
+
+struct receiver_options {
+  endpoint     local{};                   // Port 0 picks one.
+  int          socket_buffer = 64 << 20;  // SO_RCVBUF request, bytes.
+  uint32_t     batch = 64;                // Datagrams per recvmmsg.
+  receive_mode mode = receive_mode::blocking;
+
+  std::chrono::microseconds poll_timeout{1000}; // Blocking-mode wake-up.
+  // How long a gap must persist before its packets are requested again,
+  // so that merely reordered packets are not resent.
+  std::chrono::microseconds resend_delay{2000};
+  std::chrono::milliseconds frame_timeout{200};
+  uint32_t                  max_resend_requests = 3; // Per frame.
+  bool                      deliver_incomplete = true;
+};
+
+struct received_frame {
+  uint32_t slot;
+  uint16_t block_id;
+  uint64_t timestamp; // Device ticks from the leader.
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  size_t   size; // Image bytes, from the leader.
+  uint32_t missing_packets;
+
+  std::chrono::steady_clock::time_point first_packet;
+  std::chrono::steady_clock::time_point completed;
+
+  bool complete() const noexcept { return missing_packets == 0; }
+};
+
+struct receiver_stats {
+  std::atomic<uint64_t> packets{0};
+  std::atomic<uint64_t> bytes{0};         // Image payload bytes.
+  std::atomic<uint64_t> packets_copied{0}; // Missed the predicted slot.
+  std::atomic<uint64_t> duplicates{0};
+  std::atomic<uint64_t> stray{0};         // Late, unknown or malformed.
+  std::atomic<uint64_t> kernel_drops{0};  // Socket buffer overflows.
+  std::atomic<uint64_t> resend_requests{0};
+  std::atomic<uint64_t> packets_requested{0};
+  std::atomic<uint64_t> packets_lost{0};  // Still missing at delivery.
+  std::atomic<uint64_t> frames_complete{0};
+  std::atomic<uint64_t> frames_incomplete{0};
+  std::atomic<uint64_t> frames_no_buffer{0}; // Every slot held by consumers.
+
+  // From the kernel timestamping the first datagram of a batch to the
+  // receive thread returning from recvmmsg with it: scheduling delay plus
+  // batching. Its spread is the receive thread's wake-up jitter.
+  latency_histogram wakeup_latency;
+};
+
+/*========================================================================================
+ *  stream_receiver
+ *  -----------------------------------------------------------------------
+ *  •  User-space GVSP receiver; the socket alternative to the vendor filter
+ *     driver. Datagrams are pulled in batches with recvmmsg into a large
+ *     SO_RCVBUF.
+ *  •  Each datagram's payload is scattered straight into its framebuffer
+ *     slot: the iovecs for a batch point at where the next packets of the
+ *     current frame are expected to land. Packets that arrive out of the
+ *     predicted order are copied into place instead.
+ *  •  A per-frame bitmap tracks received packet ids; gaps that persist for
+ *     resend_delay are requested again through the resend callback.
+ *  •  Completed (or timed-out) frames are handed to the frame callback on
+ *     the receive thread. The slot then belongs to the consumer until it
+ *     calls release().
+ *=======================================================================================*/
+class stream_receiver {
+public:
+  using frame_callback = std::function<void(const received_frame &)>;
+  using resend_callback =
+      std::function<void(uint16_t block_id, uint32_t first, uint32_t last)>;
+
+  // packet_size is the SCPS value programmed into the device.
+  static std::expected<std::unique_ptr<stream_receiver>, std::error_code>
+  create(const receiver_options &options,
+         std::span<const std::span<std::byte>> framebuffers,
+         uint32_t packet_size, frame_callback on_frame,
+         resend_callback on_resend);
+
+  ~stream_receiver();
+
+  stream_receiver(const stream_receiver &) = delete;
+  stream_receiver &operator=(const stream_receiver &) = delete;
+
+  endpoint local_endpoint() const noexcept { return local_; }
+  int      socket_buffer() const noexcept { return socket_buffer_; }
+
+  // Receives until stop is requested or the socket fails; returns the
+  // socket error, if any. Run it on the thread that should own reception;
+  // the callbacks are invoked from it.
+  std::error_code run(std::stop_token stop);
+
+  // Hands a delivered slot back. Thread-safe.
+  void release(uint32_t slot) noexcept;
+
+  const receiver_stats &stats() const noexcept { return stats_; }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct frame_slot {
+    std::span<std::byte> buffer;
+    uint32_t             capacity_packets; // Payload packets that fit.
+
+    // True while the receiver may write into the buffer.
+    std::atomic<bool> owned_by_receiver{true};
+
+    bool     active = false;
+    uint16_t block_id = 0;
+    uint32_t payload_packets = 0; // 0 until the leader or trailer says.
+    uint32_t received = 0;
+    uint32_t highest_id = 0;
+    uint32_t resend_count = 0;
+    bool     leader_seen = false;
+    bool     trailer_seen = false;
+    bool     oversize = false;
+
+    gvsp_image_leader     leader;
+    std::vector<uint64_t> bitmap; // One bit per packet id.
+
+    clock::time_point first_packet;
+    clock::time_point last_packet;
+    clock::time_point trailer_time;
+    clock::time_point last_resend;
+
+    bool test(uint32_t id) const noexcept {
+      return bitmap[id >> 6] >> (id & 63) & 1;
+    }
+    void set(uint32_t id) noexcept { bitmap[id >> 6] |= uint64_t{1} << (id & 63); }
+  };
+
+  // Where each datagram of the next batch lands.
+  struct batch_target {
+    uint32_t    slot;       // no_slot: primary is scratch.
+    uint32_t    packet_id;  // Predicted id.
+    std::byte  *primary;
+    size_t      primary_size;
+  };
+
+  // What the first pass over a received batch found out about a datagram.
+  struct batch_packet {
+    gvsp_header h;
+    uint32_t    slot;
+    size_t      size; // GVSP payload bytes.
+    bool        valid;
+    bool        in_place;
+  };
+
+  static constexpr uint32_t no_slot = ~0u;
+
+  stream_receiver(udp_socket socket, const receiver_options &options,
+                  std::span<const std::span<std::byte>> framebuffers,
+                  uint32_t packet_size, frame_callback on_frame,
+                  resend_callback on_resend);
+
+  void prepare_batch();
+  void process_batch(uint32_t count, clock::time_point now);
+  void record_wakeup(msghdr &first, const timespec &woke) noexcept;
+  void service(clock::time_point now);
+
+  uint32_t find_slot(uint16_t block_id) const noexcept;
+  uint32_t start_frame(uint16_t block_id, clock::time_point now);
+  void     accept(frame_slot &s, uint32_t slot, const gvsp_header &h,
+                  std::span<const std::byte> payload, bool in_place,
+                  clock::time_point now);
+  void     request_missing(frame_slot &s, clock::time_point now);
+  void     deliver(uint32_t slot, clock::time_point now);
+  uint32_t missing_packets(const frame_slot &s) const noexcept;
+
+  udp_socket       socket_;
+  receiver_options options_;
+  endpoint         local_;
+  int              socket_buffer_ = 0;
+  size_t           per_packet_; // Image bytes per payload packet.
+
+  frame_callback  on_frame_;
+  resend_callback on_resend_;
+
+  // Not a vector: frame_slot holds an atomic and cannot move.
+  std::unique_ptr<frame_slot[]> slots_;
+  uint32_t                      slot_count_;
+  uint32_t                current_ = no_slot; // Newest active frame.
+  uint32_t                reserved_ = no_slot; // Predicted next frame.
+  uint16_t                newest_block_ = 0;
+
+  // recvmmsg state, one entry per datagram in a batch.
+  std::vector<mmsghdr>                  msgs_;
+  std::vector<std::array<iovec, 3>>     iov_;
+  std::vector<std::array<std::byte, gvsp_header_size>> headers_;
+  std::vector<batch_target>             targets_;
+  std::vector<batch_packet>             packets_;
+  std::vector<std::byte>                scratch_;  // Unpredicted payloads.
+  std::vector<std::byte>                overflow_; // Spill past a short slot.
+  std::vector<std::byte>                bounce_;   // Mispredicted, saved.
+  std::vector<std::byte>                control_;  // Timestamp, drop cmsgs.
+
+  clock::time_point last_service_{};
+
+  receiver_stats stats_;
+};
+
+} // namespace gev
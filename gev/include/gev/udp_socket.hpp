@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cerrno>       /* errno */
+#include <chrono>       /* receive timeouts */
+#include <cstddef>      /* std::byte */
+#include <cstdint>      /* uint16_t, uint32_t */
+#include <expected>     /* std::expected */
+#include <span>         /* std::span */
+#include <system_error> /* std::error_code */
+#include <utility>      /* std::exchange */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace gev {
+
+// IPv4 endpoint in host byte order.
+struct endpoint {
+  uint32_t address = 0;
+  uint16_t port = 0;
+
+  sockaddr_in to_sockaddr() const noexcept {
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(address);
+    sa.sin_port = htons(port);
+    return sa;
+  }
+
+  static endpoint from_sockaddr(const sockaddr_in &sa) noexcept {
+    return {ntohl(sa.sin_addr.s_addr), ntohs(sa.sin_port)};
+  }
+
+  friend bool operator==(const endpoint &, const endpoint &) = default;
+};
+
+inline std::error_code last_error() noexcept {
+  return {errno, std::system_category()};
+}
+
+/*========================================================================================
+ *  udp_socket
+ *  -----------------------------------------------------------------------
+ *  •  Owning wrapper around a POSIX IPv4 UDP socket, shared by the GVCP and
+ *     GVSP sides of both the simulator and the receiver.
+ *  •  sendto/recvfrom on one socket are safe from several threads at once.
+ *=======================================================================================*/
+class udp_socket {
+public:
+  udp_socket() = default;
+  explicit udp_socket(int fd) noexcept : fd_(fd) {}
+
+  udp_socket(udp_socket &&o) noexcept : fd_(std::exchange(o.fd_, -1)) {}
+  udp_socket &operator=(udp_socket &&o) noexcept {
+    if (this != &o) {
+      close();
+      fd_ = std::exchange(o.fd_, -1);
+    }
+    return *this;
+  }
+
+  udp_socket(const udp_socket &) = delete;
+  udp_socket &operator=(const udp_socket &) = delete;
+
+  ~udp_socket() { close(); }
+
+  // Binds to local; port 0 picks an ephemeral port.
+  static std::expected<udp_socket, std::error_code> bind(endpoint local) {
+    udp_socket s(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+    if (!s)
+      return std::unexpected(last_error());
+
+    const int one = 1;
+    ::setsockopt(s.fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    const sockaddr_in sa = local.to_sockaddr();
+    if (::bind(s.fd_, reinterpret_cast<const sockaddr *>(&sa), sizeof(sa)) != 0)
+      return std::unexpected(last_error());
+
+    return s;
+  }
+
+  // The local address the kernel would use to reach remote, i.e. the
+  // address a device should stream to.
+  static std::expected<uint32_t, std::error_code>
+  local_address_for(endpoint remote) {
+    udp_socket s(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+    if (!s)
+      return std::unexpected(last_error());
+
+    const sockaddr_in sa = remote.to_sockaddr();
+    if (::connect(s.fd_, reinterpret_cast<const sockaddr *>(&sa), sizeof(sa)) !=
+        0)
+      return std::unexpected(last_error());
+
+    auto local = s.local_endpoint();
+    if (!local)
+      return std::unexpected(local.error());
+    return local->address;
+  }
+
+  explicit operator bool() const noexcept { return fd_ >= 0; }
+  int      fd() const noexcept { return fd_; }
+
+  void close() noexcept {
+    if (fd_ >= 0)
+      ::close(std::exchange(fd_, -1));
+  }
+
+  std::expected<endpoint, std::error_code> local_endpoint() const {
+    sockaddr_in sa{};
+    socklen_t   len = sizeof(sa);
+    if (::getsockname(fd_, reinterpret_cast<sockaddr *>(&sa), &len) != 0)
+      return std::unexpected(last_error());
+    return endpoint::from_sockaddr(sa);
+  }
+
+  // Timeout for blocking receives; zero blocks forever.
+  std::expected<void, std::error_code>
+  set_receive_timeout(std::chrono::microseconds timeout) {
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1'000'000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1'000'000);
+    if (::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0)
+      return std::unexpected(last_error());
+    return {};
+  }
+
+  // Returns the size the kernel actually granted, which is capped by
+  // net.core.rmem_max unless the caller has CAP_NET_ADMIN.
+  std::expected<int, std::error_code> set_receive_buffer(int bytes) {
+    if (::setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) !=
+            0 &&
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) != 0)
+      return std::unexpected(last_error());
+
+    int       granted = 0;
+    socklen_t len = sizeof(granted);
+    ::getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    return granted;
+  }
+
+  std::expected<void, std::error_code> send_to(std::span<const std::byte> data,
+                                               endpoint                   to) {
+    const sockaddr_in sa = to.to_sockaddr();
+    if (::sendto(fd_, data.data(), data.size(), 0,
+                 reinterpret_cast<const sockaddr *>(&sa), sizeof(sa)) < 0)
+      return std::unexpected(last_error());
+    return {};
+  }
+
+  // Returns the datagram size, or a timeout/would-block error code.
+  std::expected<size_t, std::error_code> receive_from(std::span<std::byte> buf,
+                                                      endpoint &from) {
+    sockaddr_in sa{};
+    socklen_t   len = sizeof(sa);
+    const auto  n = ::recvfrom(fd_, buf.data(), buf.size(), 0,
+                               reinterpret_cast<sockaddr *>(&sa), &len);
+    if (n < 0)
+      return std::unexpected(last_error());
+    from = endpoint::from_sockaddr(sa);
+    return static_cast<size_t>(n);
+  }
+
+private:
+  int fd_ = -1;
+};
+
+} // namespace gev
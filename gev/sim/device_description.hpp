@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>     /* uint32_t */
+#include <string_view> /* std::string_view */
+
+namespace gev::sim {
+
+// Device-specific register block; the GenICam description below maps
+// features onto these.
+namespace device_reg {
+inline constexpr uint32_t width = 0xA000;
+inline constexpr uint32_t height = 0xA004;
+inline constexpr uint32_t pixel_format = 0xA008;
+inline constexpr uint32_t payload_size = 0xA00C;
+inline constexpr uint32_t acquisition_start = 0xA010;
+inline constexpr uint32_t acquisition_stop = 0xA014;
+inline constexpr uint32_t frame_rate_mhz = 0xA018; // Milli-hertz.
+inline constexpr uint32_t temperature_mc = 0xA01C; // Milli-degrees C.
+inline constexpr uint32_t test_pattern = 0xA020;
+inline constexpr uint32_t exposure_us = 0xA024;
+inline constexpr uint32_t acquisition_status = 0xA028;
+inline constexpr uint32_t frame_counter = 0xA02C;
+inline constexpr uint32_t end = 0xA030;
+} // namespace device_reg
+
+// Where the description lives in device memory; the first URL register
+// points here.
+inline constexpr uint32_t xml_address = 0x10000;
+
+// A small but well-formed GenICam (schema 1.1) description of the
+// simulator, enough for the feature tree and node-map code to exercise
+// integer, float, enumeration, command and string nodes, selectors and
+// invalidators.
+inline constexpr std::string_view device_xml =
+    R"(<?xml version="1.0" encoding="utf-8"?>
+<RegisterDescription ModelName="GevSim" VendorName="SpectrumLogic"
+    ToolTip="Loopback GigE Vision simulator" StandardNameSpace="GEV"
+    SchemaMajorVersion="1" SchemaMinorVersion="1" SchemaSubMinorVersion="0"
+    MajorVersion="1" MinorVersion="0" SubMinorVersion="0" ProductGuid="6C1F4C12-5A6E-4C59-8F0D-0E3B1A4F2C01"
+    VersionGuid="1B7E6F38-9A2C-4E8D-B2C5-7D1E0F3A6B02"
+    xmlns="http://www.genicam.org/GenApi/Version_1_1">
+  <Category Name="Root" NameSpace="Standard">
+    <pFeature>DeviceControl</pFeature>
+    <pFeature>ImageFormatControl</pFeature>
+    <pFeature>AcquisitionControl</pFeature>
+    <pFeature>TransportLayerControl</pFeature>
+  </Category>
+
+  <Category Name="DeviceControl" NameSpace="Standard">
+    <pFeature>DeviceVendorName</pFeature>
+    <pFeature>DeviceModelName</pFeature>
+    <pFeature>DeviceSerialNumber</pFeature>
+    <pFeature>DeviceTemperature</pFeature>
+  </Category>
+  <StringReg Name="DeviceVendorName" NameSpace="Standard">
+    <Address>0x48</Address><Length>32</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+  </StringReg>
+  <StringReg Name="DeviceModelName" NameSpace="Standard">
+    <Address>0x68</Address><Length>32</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+  </StringReg>
+  <StringReg Name="DeviceSerialNumber" NameSpace="Standard">
+    <Address>0xD8</Address><Length>16</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort>
+  </StringReg>
+  <Converter Name="DeviceTemperature" NameSpace="Standard">
+    <ToolTip>Sensor temperature in degrees Celsius</ToolTip>
+    <FormulaTo>TO * 1000</FormulaTo>
+    <FormulaFrom>FROM / 1000</FormulaFrom>
+    <pValue>DeviceTemperatureReg</pValue>
+    <Unit>C</Unit>
+  </Converter>
+  <IntReg Name="DeviceTemperatureReg">
+    <Address>0xA01C</Address><Length>4</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort><PollingTime>1000</PollingTime>
+    <Cachable>NoCache</Cachable><Sign>Signed</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Category Name="ImageFormatControl" NameSpace="Standard">
+    <pFeature>Width</pFeature>
+    <pFeature>Height</pFeature>
+    <pFeature>PixelFormat</pFeature>
+    <pFeature>TestPattern</pFeature>
+  </Category>
+  <Integer Name="Width" NameSpace="Standard">
+    <pValue>WidthReg</pValue><Min>16</Min><Max>8192</Max><Inc>16</Inc>
+  </Integer>
+  <IntReg Name="WidthReg">
+    <Address>0xA000</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>WriteThrough</Cachable><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="Height" NameSpace="Standard">
+    <pValue>HeightReg</pValue><Min>16</Min><Max>8192</Max><Inc>16</Inc>
+  </Integer>
+  <IntReg Name="HeightReg">
+    <Address>0xA004</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort>
+    <Cachable>WriteThrough</Cachable><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Enumeration Name="PixelFormat" NameSpace="Standard">
+    <EnumEntry Name="Mono16"><Value>0x01100007</Value></EnumEntry>
+    <pValue>PixelFormatReg</pValue>
+  </Enumeration>
+  <IntReg Name="PixelFormatReg">
+    <Address>0xA008</Address><Length>4</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Enumeration Name="TestPattern" NameSpace="Standard">
+    <EnumEntry Name="Gradient"><Value>0</Value></EnumEntry>
+    <EnumEntry Name="Noise"><Value>1</Value></EnumEntry>
+    <pValue>TestPatternReg</pValue>
+  </Enumeration>
+  <IntReg Name="TestPatternReg">
+    <Address>0xA020</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Category Name="AcquisitionControl" NameSpace="Standard">
+    <pFeature>AcquisitionStart</pFeature>
+    <pFeature>AcquisitionStop</pFeature>
+    <pFeature>AcquisitionFrameRate</pFeature>
+    <pFeature>ExposureTime</pFeature>
+    <pFeature>AcquisitionStatus</pFeature>
+    <pFeature>FrameCounter</pFeature>
+    <pFeature>PayloadSize</pFeature>
+  </Category>
+  <Command Name="AcquisitionStart" NameSpace="Standard">
+    <pValue>AcquisitionStartReg</pValue><CommandValue>1</CommandValue>
+  </Command>
+  <IntReg Name="AcquisitionStartReg">
+    <Address>0xA010</Address><Length>4</Length><AccessMode>WO</AccessMode>
+    <pPort>Device</pPort>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Command Name="AcquisitionStop" NameSpace="Standard">
+    <pValue>AcquisitionStopReg</pValue><CommandValue>1</CommandValue>
+  </Command>
+  <IntReg Name="AcquisitionStopReg">
+    <Address>0xA014</Address><Length>4</Length><AccessMode>WO</AccessMode>
+    <pPort>Device</pPort>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Converter Name="AcquisitionFrameRate" NameSpace="Standard">
+    <FormulaTo>TO * 1000</FormulaTo>
+    <FormulaFrom>FROM / 1000</FormulaFrom>
+    <pValue>AcquisitionFrameRateReg</pValue>
+    <Unit>Hz</Unit>
+  </Converter>
+  <IntReg Name="AcquisitionFrameRateReg">
+    <Address>0xA018</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><Cachable>WriteThrough</Cachable>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="ExposureTime" NameSpace="Standard">
+    <pValue>ExposureTimeReg</pValue><Min>10</Min><Max>1000000</Max><Unit>us</Unit>
+  </Integer>
+  <IntReg Name="ExposureTimeReg">
+    <Address>0xA024</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><Cachable>WriteThrough</Cachable>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="AcquisitionStatus" NameSpace="Standard">
+    <pValue>AcquisitionStatusReg</pValue>
+  </Integer>
+  <IntReg Name="AcquisitionStatusReg">
+    <pInvalidator>AcquisitionStartReg</pInvalidator>
+    <pInvalidator>AcquisitionStopReg</pInvalidator>
+    <Address>0xA028</Address><Length>4</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort><Cachable>WriteThrough</Cachable>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="FrameCounter" NameSpace="Standard">
+    <pValue>FrameCounterReg</pValue>
+  </Integer>
+  <IntReg Name="FrameCounterReg">
+    <Address>0xA02C</Address><Length>4</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort><PollingTime>250</PollingTime><Cachable>NoCache</Cachable>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="PayloadSize" NameSpace="Standard">
+    <pValue>PayloadSizeReg</pValue>
+  </Integer>
+  <IntReg Name="PayloadSizeReg">
+    <pInvalidator>WidthReg</pInvalidator>
+    <pInvalidator>HeightReg</pInvalidator>
+    <Address>0xA00C</Address><Length>4</Length><AccessMode>RO</AccessMode>
+    <pPort>Device</pPort><Cachable>WriteThrough</Cachable>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Category Name="TransportLayerControl" NameSpace="Standard">
+    <pFeature>GevSCPSPacketSize</pFeature>
+    <pFeature>GevSCPD</pFeature>
+    <pFeature>GevHeartbeatTimeout</pFeature>
+  </Category>
+  <Integer Name="GevSCPSPacketSize" NameSpace="Standard">
+    <pValue>GevSCPSPacketSizeReg</pValue><Min>576</Min><Max>9000</Max><Inc>4</Inc>
+  </Integer>
+  <MaskedIntReg Name="GevSCPSPacketSizeReg">
+    <Address>0x0D04</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><LSB>31</LSB><MSB>16</MSB>
+    <Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </MaskedIntReg>
+  <Integer Name="GevSCPD" NameSpace="Standard">
+    <pValue>GevSCPDReg</pValue><Min>0</Min><Max>100000</Max>
+  </Integer>
+  <IntReg Name="GevSCPDReg">
+    <Address>0x0D08</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+  <Integer Name="GevHeartbeatTimeout" NameSpace="Standard">
+    <pValue>GevHeartbeatTimeoutReg</pValue><Min>500</Min><Max>60000</Max><Unit>ms</Unit>
+  </Integer>
+  <IntReg Name="GevHeartbeatTimeoutReg">
+    <Address>0x0938</Address><Length>4</Length><AccessMode>RW</AccessMode>
+    <pPort>Device</pPort><Sign>Unsigned</Sign><Endianess>BigEndian</Endianess>
+  </IntReg>
+
+  <Port Name="Device" NameSpace="Standard"/>
+</RegisterDescription>
+)";
+
+} // namespace gev::sim
@@ -0,0 +1,206 @@
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include <spdlog/spdlog.h>
+
+#include "simulated_device.hpp"
+
+namespace {
+
+std::atomic<bool> quit{false};
+
+struct sim_options {
+  uint32_t               devices = 1;
+  gev::sim::device_config device;
+  double                 duration_s = 0.0; // 0 runs until interrupted.
+
+  static sim_options parse(std::span<const std::string_view> args);
+};
+
+template <typename T> T parse_number(std::string_view option, std::string_view s) {
+  T v{};
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (ec != std::errc{} || end != s.data() + s.size())
+    throw std::invalid_argument("invalid value for " + std::string(option) +
+                                ": " + std::string(s));
+  return v;
+}
+
+gev::endpoint parse_endpoint(std::string_view option, std::string_view s) {
+  const auto colon = s.rfind(':');
+  const std::string host(s.substr(0, colon));
+
+  in_addr addr{};
+  if (::inet_pton(AF_INET, host.c_str(), &addr) != 1)
+    throw std::invalid_argument("invalid address for " + std::string(option) +
+                                ": " + std::string(s));
+
+  gev::endpoint e{ntohl(addr.s_addr), gev::gvcp_port};
+  if (colon != std::string_view::npos)
+    e.port = parse_number<uint16_t>(option, s.substr(colon + 1));
+  return e;
+}
+
+sim_options sim_options::parse(std::span<const std::string_view> args) {
+  sim_options opts;
+  auto       &d = opts.device;
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    const auto option = args[i];
+    auto       value = [&]() -> std::string_view {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument(std::string(option) + " needs a value");
+      return args[++i];
+    };
+
+    if (option == "--devices")
+      opts.devices = parse_number<uint32_t>(option, value());
+    else if (option == "--address")
+      d.control = parse_endpoint(option, value());
+    else if (option == "--width")
+      d.width = parse_number<uint32_t>(option, value());
+    else if (option == "--height")
+      d.height = parse_number<uint32_t>(option, value());
+    else if (option == "--fps")
+      d.frame_rate = parse_number<double>(option, value());
+    else if (option == "--packet-size")
+      d.packet_size = parse_number<uint32_t>(option, value());
+    else if (option == "--loss")
+      d.loss = parse_number<double>(option, value());
+    else if (option == "--reorder")
+      d.reorder = parse_number<double>(option, value());
+    else if (option == "--reorder-distance")
+      d.reorder_distance = parse_number<uint32_t>(option, value());
+    else if (option == "--line-rate")
+      d.line_rate_mbps = parse_number<double>(option, value());
+    else if (option == "--control-latency")
+      d.control_latency = std::chrono::microseconds(
+          parse_number<uint32_t>(option, value()));
+    else if (option == "--pattern") {
+      const auto p = value();
+      if (p == "gradient")
+        d.pattern = gev::sim::test_pattern::gradient;
+      else if (p == "noise")
+        d.pattern = gev::sim::test_pattern::noise;
+      else
+        throw std::invalid_argument("unknown pattern: " + std::string(p));
+    } else if (option == "--seed")
+      d.seed = parse_number<uint64_t>(option, value());
+    else if (option == "--stream-to")
+      d.stream_to = parse_endpoint(option, value());
+    else if (option == "--duration")
+      opts.duration_s = parse_number<double>(option, value());
+    else
+      throw std::invalid_argument("unknown option: " + std::string(option));
+  }
+
+  if (opts.devices == 0 || d.frame_rate <= 0.0 || d.loss < 0.0 ||
+      d.loss >= 1.0 || d.reorder < 0.0 || d.reorder > 1.0 || d.width % 16 ||
+      d.height % 16 || d.width == 0 || d.height == 0)
+    throw std::invalid_argument("option out of range");
+
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+  sim_options opts;
+  try {
+    opts = sim_options::parse(args);
+  } catch (const std::invalid_argument &e) {
+    spdlog::error("{}", e.what());
+    spdlog::info(
+        "usage: gev_sim [--devices N] [--address 127.0.0.1[:3956]] "
+        "[--width W] [--height H] [--fps F] [--packet-size BYTES] "
+        "[--loss P] [--reorder P] [--reorder-distance N] [--line-rate MBPS] "
+        "[--control-latency US] [--pattern gradient|noise] [--seed S] "
+        "[--stream-to IP:PORT] "
+        "[--duration SECONDS]");
+    return 2;
+  }
+
+  std::signal(SIGINT, [](int) { quit = true; });
+  std::signal(SIGTERM, [](int) { quit = true; });
+
+  // Each device gets its own loopback address (127.0.0.1, .2, ...) so they
+  // can all listen on the standard GVCP port.
+  std::vector<std::unique_ptr<gev::sim::simulated_device>> devices;
+  try {
+    for (uint32_t i = 0; i < opts.devices; ++i) {
+      auto config = opts.device;
+      config.index = i;
+      config.control.address += i;
+      if (config.stream_to)
+        config.stream_to->port = static_cast<uint16_t>(config.stream_to->port + i);
+      devices.push_back(std::make_unique<gev::sim::simulated_device>(config));
+
+      const auto a = config.control.address;
+      spdlog::info("sim{}: {}.{}.{}.{}:{} {}x{} @ {} fps, packet {} B", i,
+                   a >> 24, (a >> 16) & 0xFF, (a >> 8) & 0xFF, a & 0xFF,
+                   config.control.port, config.width, config.height,
+                   config.frame_rate, config.packet_size);
+    }
+  } catch (const std::runtime_error &e) {
+    spdlog::error("{}", e.what());
+    return 1;
+  }
+
+  using clock = std::chrono::steady_clock;
+  const auto start = clock::now();
+  auto       last = start;
+  uint64_t   last_bytes = 0;
+  uint64_t   last_frames = 0;
+
+  while (!quit) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto now = clock::now();
+    if (now - last < std::chrono::seconds(1))
+      continue;
+
+    uint64_t frames = 0, bytes = 0, packets = 0, dropped = 0, reordered = 0,
+             resends = 0, resent = 0, late = 0;
+    for (const auto &d : devices) {
+      const auto &s = d->stats();
+      frames += s.frames_sent;
+      bytes += s.bytes_sent;
+      packets += s.packets_sent;
+      dropped += s.packets_dropped;
+      reordered += s.packets_reordered;
+      resends += s.resend_requests;
+      resent += s.packets_resent;
+      late += s.frames_late;
+    }
+
+    const double dt = std::chrono::duration<double>(now - last).count();
+    spdlog::info("{:.1f} fps, {:.1f} MB/s ({:.2f} Gbit/s) | packets {} "
+                 "dropped {} reordered {} | resend requests {} resent {} | "
+                 "late frames {}",
+                 (frames - last_frames) / dt, (bytes - last_bytes) / dt / 1e6,
+                 (bytes - last_bytes) * 8.0 / dt / 1e9, packets, dropped,
+                 reordered, resends, resent, late);
+    last = now;
+    last_bytes = bytes;
+    last_frames = frames;
+
+    if (opts.duration_s > 0.0 &&
+        std::chrono::duration<double>(now - start).count() >= opts.duration_s)
+      break;
+  }
+
+  return 0;
+}
@@ -0,0 +1,735 @@
+#include "simulated_device.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+
+#include <spdlog/spdlog.h>
+
+#include "device_description.hpp"
+
+namespace gev::sim {
+
+namespace {
+
+// sendmmsg batch; 64 jumbo packets is ~0.5 ms of a 10 GbE link.
+constexpr size_t send_batch = 64;
+
+constexpr uint64_t tick_frequency = 1'000'000'000; // Timestamps are in ns.
+constexpr uint32_t min_packet_size = 576;
+constexpr uint32_t max_packet_size = 9000;
+
+int64_t now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void store_string(std::span<std::byte> bootstrap, uint32_t address,
+                  size_t field_size, std::string_view s) {
+  std::memcpy(bootstrap.data() + address, s.data(),
+              std::min(s.size(), field_size - 1));
+}
+
+} // namespace
+
+simulated_device::simulated_device(device_config config)
+    : config_(std::move(config)), width_(config_.width),
+      height_(config_.height),
+      frame_rate_mhz_(static_cast<uint32_t>(config_.frame_rate * 1000.0)),
+      pattern_(config_.pattern), rng_(config_.seed + config_.index),
+      epoch_ns_(now_ns()) {
+  auto control = udp_socket::bind(config_.control);
+  if (!control)
+    throw std::runtime_error("gev_sim: cannot bind control port: " +
+                             control.error().message());
+  control_socket_ = std::move(*control);
+  (void)control_socket_.set_receive_timeout(std::chrono::milliseconds(50));
+
+  auto stream = udp_socket::bind({config_.control.address, 0});
+  if (!stream)
+    throw std::runtime_error("gev_sim: cannot bind stream socket: " +
+                             stream.error().message());
+  stream_socket_ = std::move(*stream);
+  const uint16_t stream_port = stream_socket_.local_endpoint()->port;
+
+  // The XML is padded to a whole number of words for READMEM.
+  xml_.resize((device_xml.size() + 3) & ~size_t{3});
+  std::memcpy(xml_.data(), device_xml.data(), device_xml.size());
+
+  std::byte *b = bootstrap_.data();
+  const uint64_t mac = 0x02005E000000ull | (config_.index + 1);
+  store_be(b + reg::version, uint32_t{0x00020000});
+  store_be(b + reg::device_mode, uint32_t{0x80000000});
+  store_be(b + reg::mac_high, static_cast<uint32_t>(mac >> 32));
+  store_be(b + reg::mac_low, static_cast<uint32_t>(mac));
+  store_be(b + reg::current_ip, config_.control.address);
+  store_be(b + reg::current_subnet, uint32_t{0xFF000000});
+  store_string(bootstrap_, reg::manufacturer_name, 32, "SpectrumLogic");
+  store_string(bootstrap_, reg::model_name, 32, "GevSim");
+  store_string(bootstrap_, reg::device_version, 32, "1.0.0");
+  store_string(bootstrap_, reg::manufacturer_info, 48,
+               "Loopback GigE Vision simulator");
+  store_string(bootstrap_, reg::serial_number, 16,
+               "SIM" + std::to_string(1000 + config_.index));
+  store_string(bootstrap_, reg::user_defined_name, 16,
+               "sim" + std::to_string(config_.index));
+
+  char url[reg::url_size];
+  std::snprintf(url, sizeof(url), "Local:gev_sim.xml;%X;%zX", xml_address,
+                device_xml.size());
+  store_string(bootstrap_, reg::first_url, reg::url_size, url);
+
+  store_be(b + reg::network_interface_count, uint32_t{1});
+  store_be(b + reg::message_channel_count, uint32_t{0});
+  store_be(b + reg::stream_channel_count, uint32_t{1});
+  store_be(b + reg::gvcp_capability,
+           reg::capability_concatenation | reg::capability_packet_resend);
+  store_be(b + reg::heartbeat_timeout, uint32_t{3000});
+  store_be(b + reg::timestamp_frequency_high,
+           static_cast<uint32_t>(tick_frequency >> 32));
+  store_be(b + reg::timestamp_frequency_low,
+           static_cast<uint32_t>(tick_frequency));
+  store_be(b + reg::stream_channel_packet_size,
+           std::clamp(config_.packet_size, min_packet_size, max_packet_size));
+  store_be(b + reg::stream_channel_source_port, uint32_t{stream_port});
+
+  if (config_.stream_to) {
+    store_be(b + reg::stream_channel_destination, config_.stream_to->address);
+    store_be(b + reg::stream_channel_port, uint32_t{config_.stream_to->port});
+    acquiring_ = true;
+  }
+
+  control_thread_ =
+      std::jthread([this](std::stop_token stop) { control_loop(stop); });
+  stream_thread_ =
+      std::jthread([this](std::stop_token stop) { stream_loop(stop); });
+}
+
+simulated_device::~simulated_device() = default;
+
+uint64_t simulated_device::timestamp_ticks() const noexcept {
+  return static_cast<uint64_t>(now_ns() - epoch_ns_.load());
+}
+
+/*--------------------------------  control  -------------------------------*/
+
+void simulated_device::control_loop(std::stop_token stop) {
+  std::array<std::byte, 1500> request;
+  std::array<std::byte, 1500> reply;
+
+  while (!stop.stop_requested()) {
+    // Delayed acks are due in order, as every one waits equally long.
+    const auto now = std::chrono::steady_clock::now();
+    while (!delayed_acks_.empty() && delayed_acks_.front().due <= now) {
+      (void)control_socket_.send_to(delayed_acks_.front().datagram,
+                                    delayed_acks_.front().to);
+      delayed_acks_.pop_front();
+    }
+    // SO_RCVTIMEO only has jiffy resolution, too coarse to release acks
+    // on time; wait with ppoll instead.
+    const auto wait =
+        delayed_acks_.empty()
+            ? std::chrono::nanoseconds(std::chrono::milliseconds(50))
+            : std::chrono::nanoseconds(delayed_acks_.front().due - now);
+    const timespec wait_ts{
+        .tv_sec = static_cast<time_t>(wait.count() / 1'000'000'000),
+        .tv_nsec = static_cast<long>(wait.count() % 1'000'000'000)};
+    pollfd pfd{.fd = control_socket_.fd(), .events = POLLIN, .revents = 0};
+
+    endpoint                               from;
+    std::expected<size_t, std::error_code> received =
+        std::unexpected(std::make_error_code(std::errc::timed_out));
+    if (::ppoll(&pfd, 1, &wait_ts, nullptr) > 0)
+      received = control_socket_.receive_from(request, from);
+
+    {
+      std::scoped_lock lock(registers_mutex_);
+      const auto timeout = std::chrono::milliseconds(
+          load_be<uint32_t>(bootstrap_.data() + reg::heartbeat_timeout));
+      if (controller_ &&
+          std::chrono::steady_clock::now() - last_heartbeat_ > timeout) {
+        spdlog::warn("sim{}: heartbeat expired, releasing control",
+                     config_.index);
+        controller_.reset();
+        store_be(bootstrap_.data() + reg::control_channel_privilege,
+                 uint32_t{0});
+        acquiring_ = false;
+      }
+    }
+
+    if (!received)
+      continue; // Timeout; loop round to check for stop.
+
+    const auto          datagram = std::span(request.data(), *received);
+    gvcp_command_header cmd;
+    if (!cmd.decode(datagram))
+      continue;
+
+    const auto payload = datagram.subspan(
+        gvcp_header_size,
+        std::min<size_t>(cmd.length, datagram.size() - gvcp_header_size));
+
+    ++stats_.control_commands;
+    const size_t reply_size = handle_command(cmd, payload, from, reply);
+    if (!reply_size)
+      continue;
+    if (config_.control_latency.count() > 0)
+      delayed_acks_.push_back(
+          {.due = std::chrono::steady_clock::now() + config_.control_latency,
+           .to = from,
+           .datagram = {reply.begin(), reply.begin() + reply_size}});
+    else
+      (void)control_socket_.send_to(std::span(reply.data(), reply_size), from);
+  }
+}
+
+size_t simulated_device::handle_command(const gvcp_command_header &cmd,
+                                        std::span<const std::byte> payload,
+                                        endpoint                   from,
+                                        std::span<std::byte>       reply) {
+  gvcp_ack_header ack{.ack_id = cmd.req_id};
+  std::byte      *body = reply.data() + gvcp_header_size;
+  size_t          body_size = 0;
+
+  {
+    std::scoped_lock lock(registers_mutex_);
+    if (controller_ && *controller_ == from)
+      last_heartbeat_ = std::chrono::steady_clock::now();
+  }
+
+  // Writes are refused while another client holds control.
+  auto may_write = [&] {
+    std::scoped_lock lock(registers_mutex_);
+    return !controller_ || *controller_ == from;
+  };
+
+  switch (cmd.command) {
+  case gvcp_command::discovery_cmd: {
+    ack.answer = gvcp_command::discovery_ack;
+    discovery_info info;
+    std::scoped_lock lock(registers_mutex_);
+    info.decode(std::span<const std::byte>(bootstrap_));
+    info.encode(body);
+    body_size = discovery_ack_size;
+    // Discovery is always answered, whatever the ack flag says.
+    ack.length = static_cast<uint16_t>(body_size);
+    ack.encode(reply.data());
+    return gvcp_header_size + body_size;
+  }
+
+  case gvcp_command::readreg_cmd: {
+    ack.answer = gvcp_command::readreg_ack;
+    const size_t count = std::min(payload.size() / 4, gvcp_max_read_registers);
+    for (size_t i = 0; i < count; ++i) {
+      const auto value = read_register(load_be<uint32_t>(&payload[i * 4]));
+      if (!value) {
+        ack.status = gvcp_status::invalid_address;
+        break;
+      }
+      store_be(body + body_size, *value);
+      body_size += 4;
+    }
+    break;
+  }
+
+  case gvcp_command::writereg_cmd: {
+    ack.answer = gvcp_command::writereg_ack;
+    const size_t count = std::min(payload.size() / 8, gvcp_max_write_registers);
+    uint16_t     written = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t address = load_be<uint32_t>(&payload[i * 8]);
+      const uint32_t value = load_be<uint32_t>(&payload[i * 8 + 4]);
+
+      if (address == reg::control_channel_privilege) {
+        std::scoped_lock lock(registers_mutex_);
+        if (controller_ && *controller_ != from) {
+          ack.status = gvcp_status::access_denied;
+        } else if (value & (reg::privilege_control | reg::privilege_exclusive)) {
+          controller_ = from;
+          last_heartbeat_ = std::chrono::steady_clock::now();
+        } else {
+          controller_.reset();
+        }
+        if (ack.status == gvcp_status::success)
+          store_be(bootstrap_.data() + reg::control_channel_privilege, value);
+      } else if (!may_write()) {
+        ack.status = gvcp_status::access_denied;
+      } else {
+        ack.status = write_register(address, value);
+      }
+
+      if (ack.status != gvcp_status::success)
+        break;
+      ++written;
+    }
+
+    // Reserved half-word, then the number of registers written.
+    store_be(body, uint16_t{0});
+    store_be(body + 2, written);
+    body_size = 4;
+    break;
+  }
+
+  case gvcp_command::readmem_cmd: {
+    ack.answer = gvcp_command::readmem_ack;
+    if (payload.size() < 8) {
+      ack.status = gvcp_status::invalid_parameter;
+      break;
+    }
+    const uint32_t address = load_be<uint32_t>(payload.data());
+    const uint16_t count = load_be<uint16_t>(payload.data() + 6);
+    if (count % 4 || count > gvcp_max_memory_transfer) {
+      ack.status = gvcp_status::invalid_parameter;
+      break;
+    }
+    store_be(body, address);
+    ack.status = read_memory(address, std::span(body + 4, count));
+    if (ack.status == gvcp_status::success)
+      body_size = 4 + count;
+    break;
+  }
+
+  case gvcp_command::packet_resend_cmd:
+    handle_resend(payload);
+    return 0; // Never acknowledged.
+
+  default:
+    ack.status = gvcp_status::not_implemented;
+    ack.answer = static_cast<gvcp_command>(static_cast<uint16_t>(cmd.command) + 1);
+    break;
+  }
+
+  if (!(cmd.flags & gvcp_flag_ack_required))
+    return 0;
+
+  ack.length = static_cast<uint16_t>(body_size);
+  ack.encode(reply.data());
+  return gvcp_header_size + body_size;
+}
+
+std::optional<uint32_t> simulated_device::read_register(uint32_t address) {
+  if (address % 4)
+    return std::nullopt;
+
+  std::scoped_lock lock(registers_mutex_);
+
+  if (address < bootstrap_size)
+    return load_be<uint32_t>(bootstrap_.data() + address);
+
+  switch (address) {
+  case device_reg::width:
+    return width_;
+  case device_reg::height:
+    return height_;
+  case device_reg::pixel_format:
+    return pixel_format_mono16;
+  case device_reg::payload_size:
+    return width_ * height_ * 2;
+  case device_reg::acquisition_start:
+  case device_reg::acquisition_stop:
+    return 0;
+  case device_reg::frame_rate_mhz:
+    return frame_rate_mhz_;
+  case device_reg::temperature_mc: {
+    // Slow drift around 35 C so polled values visibly change.
+    const double t = timestamp_ticks() * 1e-9;
+    return static_cast<uint32_t>(35000.0 + 1500.0 * std::sin(t / 20.0));
+  }
+  case device_reg::test_pattern:
+    return static_cast<uint32_t>(pattern_);
+  case device_reg::exposure_us:
+    return exposure_us_;
+  case device_reg::acquisition_status:
+    return acquiring_ ? 1u : 0u;
+  case device_reg::frame_counter:
+    return frame_counter_.load();
+  default:
+    return std::nullopt;
+  }
+}
+
+gvcp_status simulated_device::write_register(uint32_t address,
+                                             uint32_t value) {
+  if (address % 4)
+    return gvcp_status::bad_alignment;
+
+  std::scoped_lock lock(registers_mutex_);
+  std::byte       *b = bootstrap_.data();
+
+  switch (address) {
+  case reg::heartbeat_timeout:
+    store_be(b + address, std::max(value, uint32_t{500}));
+    return gvcp_status::success;
+
+  case reg::timestamp_control:
+    if (value & 0x1) // Reset.
+      epoch_ns_ = now_ns();
+    if (value & 0x2) { // Latch.
+      const uint64_t ts = timestamp_ticks();
+      store_be(b + reg::timestamp_value_high, static_cast<uint32_t>(ts >> 32));
+      store_be(b + reg::timestamp_value_low, static_cast<uint32_t>(ts));
+    }
+    return gvcp_status::success;
+
+  case reg::stream_channel_packet_size: {
+    // Keep the flag bits, clamp the size to what we can send.
+    uint32_t size = std::clamp(value & reg::packet_size_mask, min_packet_size,
+                               max_packet_size) &
+                    ~uint32_t{3};
+    store_be(b + address, (value & ~reg::packet_size_mask) | size);
+    return gvcp_status::success;
+  }
+
+  case reg::stream_channel_port:
+  case reg::stream_channel_packet_delay:
+  case reg::stream_channel_destination:
+    store_be(b + address, value);
+    return gvcp_status::success;
+
+  case device_reg::width:
+  case device_reg::height:
+    if (acquiring_)
+      return gvcp_status::busy;
+    if (value < 16 || value > 8192 || value % 16)
+      return gvcp_status::invalid_parameter;
+    (address == device_reg::width ? width_ : height_) = value;
+    return gvcp_status::success;
+
+  case device_reg::acquisition_start:
+    if (load_be<uint32_t>(b + reg::stream_channel_destination) == 0 ||
+        load_be<uint32_t>(b + reg::stream_channel_port) == 0)
+      return gvcp_status::error; // Stream channel not configured.
+    acquiring_ = true;
+    return gvcp_status::success;
+
+  case device_reg::acquisition_stop:
+    acquiring_ = false;
+    return gvcp_status::success;
+
+  case device_reg::frame_rate_mhz:
+    if (value == 0)
+      return gvcp_status::invalid_parameter;
+    frame_rate_mhz_ = value;
+    return gvcp_status::success;
+
+  case device_reg::test_pattern:
+    if (value > static_cast<uint32_t>(test_pattern::noise))
+      return gvcp_status::invalid_parameter;
+    pattern_ = static_cast<test_pattern>(value);
+    return gvcp_status::success;
+
+  case device_reg::exposure_us:
+    exposure_us_ = value;
+    return gvcp_status::success;
+
+  default:
+    if (address < bootstrap_size || address < device_reg::end)
+      return gvcp_status::write_protect;
+    return gvcp_status::invalid_address;
+  }
+}
+
+gvcp_status simulated_device::read_memory(uint32_t             address,
+                                          std::span<std::byte> out) {
+  if (address % 4)
+    return gvcp_status::bad_alignment;
+
+  if (address >= xml_address && address - xml_address <= xml_.size()) {
+    const size_t offset = address - xml_address;
+    const size_t n = std::min(out.size(), xml_.size() - offset);
+    std::memcpy(out.data(), xml_.data() + offset, n);
+    std::memset(out.data() + n, 0, out.size() - n);
+    return gvcp_status::success;
+  }
+
+  if (address + out.size() <= bootstrap_size) {
+    std::scoped_lock lock(registers_mutex_);
+    std::memcpy(out.data(), bootstrap_.data() + address, out.size());
+    return gvcp_status::success;
+  }
+
+  for (size_t i = 0; i < out.size(); i += 4) {
+    const auto value = read_register(address + static_cast<uint32_t>(i));
+    if (!value)
+      return gvcp_status::invalid_address;
+    store_be(out.data() + i, *value);
+  }
+  return gvcp_status::success;
+}
+
+/*--------------------------------  stream  --------------------------------*/
+
+std::optional<simulated_device::stream_params>
+simulated_device::stream_parameters() {
+  std::scoped_lock lock(registers_mutex_);
+  const std::byte *b = bootstrap_.data();
+
+  stream_params p{
+      .destination = {load_be<uint32_t>(b + reg::stream_channel_destination),
+                      static_cast<uint16_t>(
+                          load_be<uint32_t>(b + reg::stream_channel_port))},
+      .packet_size = load_be<uint32_t>(b + reg::stream_channel_packet_size) &
+                     reg::packet_size_mask,
+      .packet_delay_ticks =
+          load_be<uint32_t>(b + reg::stream_channel_packet_delay),
+  };
+  if (p.destination.address == 0 || p.destination.port == 0)
+    return std::nullopt;
+  return p;
+}
+
+void simulated_device::stream_loop(std::stop_token stop) {
+  using clock = std::chrono::steady_clock;
+
+  uint16_t block_id = 0;
+  size_t   slot = 0;
+  auto     next_frame = clock::now();
+
+  while (!stop.stop_requested()) {
+    const auto params = stream_parameters();
+    if (!acquiring_ || !params) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      next_frame = clock::now();
+      continue;
+    }
+
+    block_id = next_block_id(block_id);
+    retained_frame &f = retained_[slot];
+    slot = (slot + 1) % retained_frames;
+
+    // Retire the slot first so a concurrent resend cannot read it half-built.
+    {
+      std::scoped_lock lock(retained_mutex_);
+      f.block_id = 0;
+    }
+    build_frame(f, block_id);
+    {
+      std::scoped_lock lock(retained_mutex_);
+      f.block_id = block_id;
+    }
+
+    send_frame(f, *params);
+    ++frame_counter_;
+    ++stats_.frames_sent;
+
+    uint32_t rate_mhz;
+    {
+      std::scoped_lock lock(registers_mutex_);
+      rate_mhz = frame_rate_mhz_;
+    }
+    next_frame += std::chrono::nanoseconds(1'000'000'000'000ull / rate_mhz);
+
+    const auto now = clock::now();
+    if (now > next_frame) {
+      ++stats_.frames_late;
+      next_frame = now;
+    } else {
+      std::this_thread::sleep_until(next_frame);
+    }
+  }
+}
+
+void simulated_device::build_frame(retained_frame &f, uint16_t block_id) {
+  test_pattern pattern;
+  {
+    std::scoped_lock lock(registers_mutex_);
+    f.width = width_;
+    f.height = height_;
+    pattern = pattern_;
+  }
+  f.timestamp = timestamp_ticks();
+  f.data.resize(size_t{f.width} * f.height * 2);
+
+  std::byte *out = f.data.data();
+  if (pattern == test_pattern::gradient) {
+    for (uint32_t y = 0; y < f.height; ++y) {
+      const uint32_t row_base = y * 17u + block_id * 257u;
+      for (uint32_t x = 0; x < f.width; ++x, out += 2)
+        store_be(out, static_cast<uint16_t>(x * 31u + row_base));
+    }
+  } else {
+    uint64_t s = rng_() | 1;
+    for (size_t i = 0; i < f.data.size(); i += 8) {
+      s ^= s << 13;
+      s ^= s >> 7;
+      s ^= s << 17;
+      std::memcpy(out + i, &s, std::min<size_t>(8, f.data.size() - i));
+    }
+  }
+}
+
+uint32_t simulated_device::packet_count(const retained_frame &f,
+                                        uint32_t packet_size) const {
+  const size_t per_packet = gvsp_payload_per_packet(packet_size);
+  return static_cast<uint32_t>((f.data.size() + per_packet - 1) / per_packet);
+}
+
+void simulated_device::send_frame(const retained_frame &f,
+                                  const stream_params  &p) {
+  // Leader is packet 0, payload 1..n, trailer n + 1.
+  send_packets(f, p, 0, packet_count(f, p.packet_size) + 1, true);
+}
+
+uint64_t simulated_device::send_packets(const retained_frame &f,
+                                        const stream_params  &p,
+                                        uint32_t first, uint32_t last,
+                                        bool impair) {
+  using clock = std::chrono::steady_clock;
+
+  const uint32_t payload_packets = packet_count(f, p.packet_size);
+  const size_t   per_packet = gvsp_payload_per_packet(p.packet_size);
+  last = std::min(last, payload_packets + 1);
+  if (first > last)
+    return 0;
+
+  std::vector<uint32_t> order(last - first + 1);
+  for (uint32_t i = 0; i < order.size(); ++i)
+    order[i] = first + i;
+
+  if (impair && config_.reorder > 0.0 && order.size() > 1) {
+    std::bernoulli_distribution             reorder(config_.reorder);
+    std::uniform_int_distribution<uint32_t> distance(
+        1, std::max(1u, config_.reorder_distance));
+    for (size_t i = 0; i + 1 < order.size(); ++i)
+      if (reorder(rng_)) {
+        std::swap(order[i], order[std::min(i + distance(rng_),
+                                           order.size() - 1)]);
+        ++stats_.packets_reordered;
+      }
+  }
+
+  std::bernoulli_distribution drop(config_.loss);
+
+  const sockaddr_in dest = p.destination.to_sockaddr();
+  std::array<std::array<std::byte, gvsp_header_size + gvsp_image_leader_size>,
+             send_batch>
+                                                     headers;
+  std::array<std::array<iovec, 2>, send_batch>       iov;
+  std::array<mmsghdr, send_batch>                    msgs;
+  size_t                                             batched = 0;
+  size_t                                             batch_bytes = 0;
+
+  // Pacing: either the emulated line rate or the SCPD inter-packet delay,
+  // whichever is slower. Both are measured from the start of this call.
+  const auto start = clock::now();
+  double     wire_bits = 0.0;
+  uint64_t   packets_out = 0;
+
+  auto flush = [&] {
+    size_t sent = 0;
+    while (sent < batched) {
+      const int n = ::sendmmsg(stream_socket_.fd(), msgs.data() + sent,
+                               static_cast<unsigned>(batched - sent), 0);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        // ENOBUFS etc: the rest of the batch is lost, as on a real link.
+        stats_.packets_dropped += batched - sent;
+        break;
+      }
+      sent += static_cast<size_t>(n);
+    }
+    stats_.packets_sent += sent;
+    stats_.bytes_sent += batch_bytes;
+    packets_out += sent;
+    batched = 0;
+    batch_bytes = 0;
+
+    std::chrono::nanoseconds due{0};
+    if (config_.line_rate_mbps > 0.0)
+      due = std::chrono::nanoseconds(
+          static_cast<int64_t>(wire_bits * 1e3 / config_.line_rate_mbps));
+    // SCPD is in timestamp ticks, which are nanoseconds here.
+    due = std::max(due, std::chrono::nanoseconds(packets_out *
+                                                 p.packet_delay_ticks));
+    if (due.count() > 0)
+      std::this_thread::sleep_until(start + due);
+  };
+
+  for (uint32_t id : order) {
+    if (impair && config_.loss > 0.0 && drop(rng_)) {
+      ++stats_.packets_dropped;
+      continue;
+    }
+
+    auto &header = headers[batched];
+    auto &v = iov[batched];
+    auto &m = msgs[batched];
+    m = {};
+    m.msg_hdr.msg_name = const_cast<sockaddr_in *>(&dest);
+    m.msg_hdr.msg_namelen = sizeof(dest);
+    m.msg_hdr.msg_iov = v.data();
+
+    gvsp_header h{.block_id = f.block_id, .packet_id = id};
+    size_t header_size = gvsp_header_size;
+
+    if (id == 0) {
+      h.format = gvsp_format::leader;
+      gvsp_image_leader{.timestamp = f.timestamp,
+                        .width = f.width,
+                        .height = f.height}
+          .encode(header.data() + gvsp_header_size);
+      header_size += gvsp_image_leader_size;
+      m.msg_hdr.msg_iovlen = 1;
+    } else if (id == payload_packets + 1) {
+      h.format = gvsp_format::trailer;
+      std::byte *t = header.data() + gvsp_header_size;
+      store_be(t, uint16_t{0});
+      store_be(t + 2, gvsp_payload_image);
+      store_be(t + 4, f.height);
+      header_size += gvsp_image_trailer_size;
+      m.msg_hdr.msg_iovlen = 1;
+    } else {
+      h.format = gvsp_format::payload;
+      const size_t offset = (id - 1) * per_packet;
+      const size_t size = std::min(per_packet, f.data.size() - offset);
+      v[1] = {const_cast<std::byte *>(f.data.data() + offset), size};
+      m.msg_hdr.msg_iovlen = 2;
+      batch_bytes += size;
+      wire_bits += size * 8.0;
+    }
+
+    h.encode(header.data());
+    v[0] = {header.data(), header_size};
+    wire_bits += (header_size + ip_udp_overhead) * 8.0;
+
+    if (++batched == send_batch)
+      flush();
+  }
+  if (batched)
+    flush();
+  return packets_out;
+}
+
+void simulated_device::handle_resend(std::span<const std::byte> payload) {
+  packet_resend req;
+  if (!req.decode(payload) || req.channel != 0)
+    return;
+
+  ++stats_.resend_requests;
+  const auto params = stream_parameters();
+  if (!params)
+    return;
+
+  // Holding the lock keeps the stream thread from recycling the frame
+  // while it is being resent.
+  std::scoped_lock lock(retained_mutex_);
+  for (const auto &f : retained_) {
+    if (f.block_id != req.block_id)
+      continue;
+    stats_.packets_resent +=
+        send_packets(f, *params, req.first_packet, req.last_packet, false);
+    return;
+  }
+  // Too old: the receiver will time the frame out.
+}
+
+} // namespace gev::sim
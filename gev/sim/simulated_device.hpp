@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>      /* bootstrap memory */
+#include <atomic>     /* counters shared with the stats printer */
+#include <chrono>     /* heartbeat and frame timing */
+#include <cstddef>    /* std::byte */
+#include <cstdint>    /* uint16_t .. uint64_t */
+#include <deque>      /* delayed control acks */
+#include <mutex>      /* retained frame ring */
+#include <optional>   /* controller endpoint */
+#include <random>     /* loss and reordering */
+#include <thread>     /* std::jthread */
+#include <vector>     /* frame storage */
+
+#include <gev/protocol.hpp>
+#include <gev/udp_socket.hpp>
+
+namespace gev::sim {
+
+enum class test_pattern : uint32_t {
+  // (x * 31 + y * 17 + block_id * 257) & 0xFFFF; lets a receiver verify
+  // reassembly pixel by pixel.
+  gradient = 0,
+  noise = 1,
+};
+
+struct device_config {
+  uint32_t     index = 0;                     // Used for MAC and serial.
+  endpoint     control{0x7F000001, gvcp_port}; // 127.0.0.1:3956
+  uint32_t     width = 1024;
+  uint32_t     height = 1024;
+  double       frame_rate = 30.0;
+  uint32_t     packet_size = 1500; // SCPS default; the client may change it.
+  test_pattern pattern = test_pattern::gradient;
+
+  // Impairments, applied to first transmissions only so that resends can
+  // always repair a frame.
+  double   loss = 0.0;    // Probability of dropping each packet.
+  double   reorder = 0.0; // Probability of delaying each packet ...
+  uint32_t reorder_distance = 8; // ... by up to this many packets.
+
+  // Emulated line rate in Mbit/s; 0 sends each frame as fast as possible.
+  double   line_rate_mbps = 0.0;
+  // Emulated control round trip: each ack is held back this long, without
+  // holding up the commands behind it.
+  std::chrono::microseconds control_latency{0};
+  uint64_t seed = 1;
+
+  // Stream without a client programming the stream channel, e.g. straight
+  // into a receiver benchmark.
+  std::optional<endpoint> stream_to;
+};
+
+struct device_stats {
+  std::atomic<uint64_t> frames_sent{0};
+  std::atomic<uint64_t> packets_sent{0};
+  std::atomic<uint64_t> bytes_sent{0};
+  std::atomic<uint64_t> packets_dropped{0};
+  std::atomic<uint64_t> packets_reordered{0};
+  std::atomic<uint64_t> resend_requests{0};
+  std::atomic<uint64_t> packets_resent{0};
+  std::atomic<uint64_t> frames_late{0}; // Send overran the frame period.
+  std::atomic<uint64_t> control_commands{0};
+};
+
+/*========================================================================================
+ *  simulated_device
+ *  -----------------------------------------------------------------------
+ *  •  One simulated GigE Vision camera: a GVCP server on its control
+ *     endpoint (discovery, READREG/WRITEREG, READMEM, packet resend) and a
+ *     GVSP stream channel sending synthetic Mono16 frames.
+ *  •  Two threads: control and stream. The stream thread builds each frame
+ *     into a small retained ring so resend requests arriving on the
+ *     control thread can be served after the frame has gone out.
+ *  •  Control privilege and heartbeat follow the spec loosely: the last
+ *     client to take control loses it (and acquisition stops) when it is
+ *     silent for longer than the heartbeat timeout.
+ *=======================================================================================*/
+class simulated_device {
+public:
+  explicit simulated_device(device_config config);
+  ~simulated_device();
+
+  simulated_device(const simulated_device &) = delete;
+  simulated_device &operator=(const simulated_device &) = delete;
+
+  const device_config &config() const noexcept { return config_; }
+  const device_stats  &stats() const noexcept { return stats_; }
+
+private:
+  static constexpr size_t retained_frames = 4;
+  static constexpr size_t bootstrap_size = 0x1000;
+
+  struct retained_frame {
+    uint16_t               block_id = 0; // 0 while being rebuilt.
+    uint64_t               timestamp = 0;
+    uint32_t               width = 0;
+    uint32_t               height = 0;
+    std::vector<std::byte> data; // Big-endian Mono16.
+  };
+
+  struct stream_params {
+    endpoint destination;
+    uint32_t packet_size;
+    uint32_t packet_delay_ticks;
+  };
+
+  void control_loop(std::stop_token stop);
+  void stream_loop(std::stop_token stop);
+
+  size_t handle_command(const gvcp_command_header &cmd,
+                        std::span<const std::byte> payload, endpoint from,
+                        std::span<std::byte> reply);
+  void   handle_resend(std::span<const std::byte> payload);
+
+  struct delayed_ack {
+    std::chrono::steady_clock::time_point due;
+    endpoint                              to;
+    std::vector<std::byte>                datagram;
+  };
+
+  std::optional<uint32_t> read_register(uint32_t address);
+  gvcp_status             write_register(uint32_t address, uint32_t value);
+  gvcp_status read_memory(uint32_t address, std::span<std::byte> out);
+
+  // Nullopt until a client (or stream_to) has set a destination.
+  std::optional<stream_params> stream_parameters();
+
+  void build_frame(retained_frame &f, uint16_t block_id);
+  void send_frame(const retained_frame &f, const stream_params &p);
+  // Sends packets first..last of f; returns how many left the socket.
+  uint64_t send_packets(const retained_frame &f, const stream_params &p,
+                        uint32_t first, uint32_t last, bool impair);
+  uint32_t packet_count(const retained_frame &f, uint32_t packet_size) const;
+
+  uint64_t timestamp_ticks() const noexcept;
+
+  device_config config_;
+  device_stats  stats_;
+
+  udp_socket              control_socket_;
+  std::deque<delayed_ack> delayed_acks_; // Control thread only.
+  udp_socket stream_socket_;
+
+  // Bootstrap registers and strings, stored big-endian as on the device.
+  std::mutex                             registers_mutex_;
+  std::array<std::byte, bootstrap_size>  bootstrap_{};
+  std::vector<std::byte>                 xml_;
+  uint32_t                               width_;
+  uint32_t                               height_;
+  uint32_t                               frame_rate_mhz_;
+  uint32_t                               exposure_us_ = 10000;
+  test_pattern                           pattern_;
+  std::optional<endpoint>                controller_;
+  std::chrono::steady_clock::time_point  last_heartbeat_;
+  std::atomic<bool>                      acquiring_{false};
+  std::atomic<uint32_t>                  frame_counter_{0};
+
+  std::mutex                                  retained_mutex_;
+  std::array<retained_frame, retained_frames> retained_;
+
+  std::mt19937_64      rng_; // Stream thread only.
+  std::atomic<int64_t> epoch_ns_; // Timestamp zero; reset by the client.
+
+  std::jthread control_thread_;
+  std::jthread stream_thread_;
+};
+
+} // namespace gev::sim
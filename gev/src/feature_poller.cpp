@@ -0,0 +1,390 @@
+#include <gev/feature_poller.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+namespace gev {
+
+namespace {
+
+// pValue chains are short; the limit only guards against cycles.
+constexpr int max_value_hops = 8;
+
+// How often utilisation is sampled; the poll thread wakes at least this
+// often.
+constexpr auto stats_window = std::chrono::seconds(1);
+
+bool is_register(node_kind kind) noexcept {
+  switch (kind) {
+  case node_kind::int_reg:
+  case node_kind::masked_int_reg:
+  case node_kind::float_reg:
+  case node_kind::register_:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+feature_poller::feature_poller(std::shared_ptr<const node_map>  map,
+                               std::shared_ptr<register_cache> registers)
+    : feature_poller(std::move(map), std::move(registers), options{}) {}
+
+feature_poller::feature_poller(std::shared_ptr<const node_map>  map,
+                               std::shared_ptr<register_cache> registers,
+                               options                         options)
+    : map_(std::move(map)), registers_(std::move(registers)),
+      options_(options), window_start_(clock::now()) {
+  build_index();
+  thread_ = std::jthread([this](std::stop_token stop) { poll_loop(stop); });
+}
+
+feature_poller::~feature_poller() {
+  thread_.request_stop();
+  wake_.notify_all();
+}
+
+node_index feature_poller::register_of(node_index feature) const noexcept {
+  for (int hop = 0; hop < max_value_hops && feature != no_node; ++hop) {
+    const node &n = (*map_)[feature];
+    if (is_register(n.kind))
+      return n.address_ref == no_node && n.length > 0 && n.length <= 8 &&
+                     n.address + n.length <= 0x1'0000'0000ull
+                 ? feature
+                 : no_node;
+    feature = n.value_ref;
+  }
+  return no_node;
+}
+
+void feature_poller::build_index() {
+  const auto &map = *map_;
+
+  for (node_index i = 0; i < map.size(); ++i)
+    if (register_of(i) == i)
+      for (uint32_t word : words_of(i))
+        by_address_.emplace_back(word, i);
+  std::ranges::sort(by_address_);
+
+  // Edges from each invalidating register to the registers it stales,
+  // whether the pInvalidator sits on a register or on the feature above.
+  std::vector<std::pair<node_index, node_index>> edges;
+  for (node_index i = 0; i < map.size(); ++i) {
+    const node &n = map[i];
+    if (n.invalidators.count == 0)
+      continue;
+    const node_index stale = register_of(i);
+    if (stale == no_node)
+      continue;
+    for (const auto &link : map.links(n.invalidators))
+      if (const node_index source = register_of(link.target); source != no_node)
+        edges.emplace_back(source, stale);
+  }
+  std::ranges::sort(edges);
+  const auto [first, last] = std::ranges::unique(edges);
+  edges.erase(first, last);
+
+  dependent_starts_.assign(map.size() + 1, 0);
+  for (const auto &[source, stale] : edges)
+    ++dependent_starts_[source + 1];
+  for (size_t i = 1; i < dependent_starts_.size(); ++i)
+    dependent_starts_[i] += dependent_starts_[i - 1];
+  dependents_.reserve(edges.size());
+  for (const auto &[source, stale] : edges)
+    dependents_.push_back(stale); // Already grouped by source.
+}
+
+void feature_poller::set_visible(std::span<const node_index> features) {
+  std::vector<node_index> next(features.begin(), features.end());
+  std::ranges::sort(next);
+  const auto [first, last] = std::ranges::unique(next);
+  next.erase(first, last);
+
+  std::scoped_lock lock(mutex_);
+  if (next == visible_)
+    return;
+
+  std::vector<node_index> changed;
+  std::ranges::set_difference(visible_, next, std::back_inserter(changed));
+  for (node_index f : changed)
+    drop_use(f, false);
+
+  changed.clear();
+  std::ranges::set_difference(next, visible_, std::back_inserter(changed));
+  for (node_index f : changed)
+    add_use(f, false);
+
+  visible_ = std::move(next);
+}
+
+void feature_poller::subscribe(node_index feature) {
+  std::scoped_lock lock(mutex_);
+  if (std::ranges::find(subscriptions_, feature) != subscriptions_.end())
+    return;
+  subscriptions_.push_back(feature);
+  add_use(feature, true);
+}
+
+void feature_poller::unsubscribe(node_index feature) {
+  std::scoped_lock lock(mutex_);
+  if (std::erase(subscriptions_, feature))
+    drop_use(feature, true);
+}
+
+bool feature_poller::subscribed(node_index feature) const {
+  std::scoped_lock lock(mutex_);
+  return std::ranges::find(subscriptions_, feature) != subscriptions_.end();
+}
+
+void feature_poller::add_use(node_index feature, bool subscription) {
+  const node_index reg = register_of(feature);
+  if (reg == no_node)
+    return;
+
+  auto [it, inserted] = entries_.try_emplace(reg);
+  entry &e = it->second;
+  if (inserted) {
+    e.reg = reg;
+    e.due = clock::now();
+  }
+  ++(subscription ? e.subscribed : e.visible);
+
+  // A subscription may shorten the period of a read-once register.
+  if (inserted || subscription) {
+    e.due = std::min(e.due, clock::now());
+    wake_requested_ = true;
+    wake_.notify_one();
+  }
+}
+
+void feature_poller::drop_use(node_index feature, bool subscription) {
+  const node_index reg = register_of(feature);
+  auto             it = entries_.find(reg);
+  if (it == entries_.end())
+    return;
+
+  entry &e = it->second;
+  --(subscription ? e.subscribed : e.visible);
+  if (e.visible == 0 && e.subscribed == 0)
+    entries_.erase(it);
+}
+
+feature_poller::clock::duration
+feature_poller::period_of(const entry &e) const noexcept {
+  if (const uint32_t ms = (*map_)[e.reg].polling_ms)
+    return std::chrono::milliseconds(ms);
+  if (e.subscribed)
+    return options_.default_period;
+  return clock::duration::max(); // Read once; again only when invalidated.
+}
+
+std::optional<feature_value> feature_poller::value(node_index feature) const {
+  const node_index reg = register_of(feature);
+  std::scoped_lock lock(mutex_);
+  auto             it = entries_.find(reg);
+  if (it == entries_.end())
+    return std::nullopt;
+  return it->second.value;
+}
+
+void feature_poller::written(std::span<const uint32_t> addresses) {
+  std::vector<uint8_t>    seen(map_->size(), 0);
+  std::vector<node_index> queue;
+  for (uint32_t address : addresses) {
+    auto range = std::ranges::equal_range(
+        by_address_, address, {}, &std::pair<uint32_t, node_index>::first);
+    for (const auto &[word, reg] : range)
+      if (!seen[reg]) {
+        seen[reg] = 1;
+        queue.push_back(reg);
+      }
+  }
+  const size_t written_registers = queue.size();
+
+  // Breadth first through everything the written registers invalidate.
+  std::vector<uint32_t> stale_words;
+  for (size_t i = 0; i < queue.size(); ++i)
+    for (uint32_t d = dependent_starts_[queue[i]];
+         d < dependent_starts_[queue[i] + 1]; ++d)
+      if (const node_index stale = dependents_[d]; !seen[stale]) {
+        seen[stale] = 1;
+        queue.push_back(stale);
+        for (uint32_t word : words_of(stale))
+          stale_words.push_back(word);
+      }
+
+  // Cached copies of the dependents are stale too, whatever their policy.
+  for (uint32_t word : stale_words)
+    registers_->invalidate(word);
+
+  std::scoped_lock lock(mutex_);
+  stats_.invalidations += queue.size() - written_registers;
+  const auto now = clock::now();
+  for (node_index reg : queue)
+    if (auto it = entries_.find(reg); it != entries_.end()) {
+      it->second.due = now;
+      if (it->second.value)
+        it->second.value->stale = true;
+    }
+  wake_requested_ = true;
+  wake_.notify_one();
+}
+
+feature_poller_stats feature_poller::stats() const {
+  std::scoped_lock lock(mutex_);
+  feature_poller_stats s = stats_;
+  s.polled = static_cast<uint32_t>(entries_.size());
+  return s;
+}
+
+std::vector<uint32_t> feature_poller::words_of(node_index reg) const {
+  const node    &n = (*map_)[reg];
+  const uint64_t first = n.address & ~uint64_t{3};
+  std::vector<uint32_t> words;
+  for (uint64_t a = first; a < n.address + n.length; a += 4)
+    words.push_back(static_cast<uint32_t>(a));
+  return words;
+}
+
+int64_t feature_poller::decode(node_index                reg,
+                               std::span<const uint32_t> words) const noexcept {
+  const node &n = (*map_)[reg];
+
+  // Registers arrive in host order; lay them out as the device stores them
+  // (network order) and take the register's bytes from there.
+  std::array<uint8_t, 16> bytes{};
+  for (size_t w = 0; w < words.size() && w < 4; ++w)
+    for (int b = 0; b < 4; ++b)
+      bytes[w * 4 + b] = static_cast<uint8_t>(words[w] >> (24 - 8 * b));
+
+  const size_t offset = n.address & 3;
+  uint64_t     v = 0;
+  for (uint32_t i = 0; i < n.length; ++i) {
+    const uint8_t byte = bytes[offset + i];
+    if (n.little_endian)
+      v |= uint64_t{byte} << (8 * i);
+    else
+      v = v << 8 | byte;
+  }
+
+  uint32_t bits = n.length * 8;
+  if (n.kind == node_kind::masked_int_reg) {
+    // Bit numbers count from the least significant bit for little-endian
+    // registers and from the most significant one for big-endian ones.
+    uint32_t lo = n.lsb;
+    uint32_t hi = n.msb;
+    if (!n.little_endian) {
+      lo = bits - 1 - n.lsb;
+      hi = bits - 1 - n.msb;
+    }
+    if (lo > hi)
+      std::swap(lo, hi);
+    bits = hi - lo + 1;
+    v >>= lo;
+  }
+
+  if (bits < 64)
+    v &= (uint64_t{1} << bits) - 1;
+  if (n.is_signed && bits < 64 && (v >> (bits - 1)) & 1)
+    v |= ~uint64_t{0} << bits;
+  return static_cast<int64_t>(v);
+}
+
+void feature_poller::poll_loop(std::stop_token stop) {
+  while (!stop.stop_requested()) {
+    const auto now = clock::now();
+    const auto next = std::min(poll_once(now), now + stats_window);
+
+    std::unique_lock lock(mutex_);
+    wake_.wait_until(lock, stop, next, [this] { return wake_requested_; });
+    wake_requested_ = false;
+  }
+}
+
+feature_poller::clock::time_point
+feature_poller::poll_once(clock::time_point now) {
+  struct due_read {
+    node_index reg;
+    size_t     first_word;
+    size_t     words;
+  };
+  std::vector<due_read> due;
+  std::vector<uint32_t> words;
+
+  {
+    std::scoped_lock lock(mutex_);
+    for (const auto &[reg, e] : entries_)
+      if (e.due <= now) {
+        const auto w = words_of(reg);
+        due.push_back({reg, words.size(), w.size()});
+        words.insert(words.end(), w.begin(), w.end());
+      }
+  }
+
+  // One batch for everything due; if the device refuses any register in
+  // it, each register is read on its own so the rest still update.
+  std::vector<std::optional<std::vector<uint32_t>>> results(due.size());
+  uint32_t batches = 0;
+  if (!due.empty()) {
+    ++batches;
+    if (auto values = registers_->read(words)) {
+      for (size_t i = 0; i < due.size(); ++i)
+        results[i].emplace(values->begin() + due[i].first_word,
+                           values->begin() + due[i].first_word + due[i].words);
+    } else if (due.size() > 1) {
+      for (size_t i = 0; i < due.size(); ++i) {
+        ++batches;
+        if (auto one = registers_->read(std::span(words).subspan(
+                due[i].first_word, due[i].words)))
+          results[i] = std::move(*one);
+      }
+    }
+  }
+  const auto done = clock::now();
+
+  std::scoped_lock lock(mutex_);
+  stats_.batches += batches;
+  stats_.registers += words.size();
+  window_busy_ += done - now;
+  window_registers_ += static_cast<uint32_t>(words.size());
+
+  for (size_t i = 0; i < due.size(); ++i) {
+    auto it = entries_.find(due[i].reg);
+    if (it == entries_.end())
+      continue; // Dropped while the read was out.
+    entry &e = it->second;
+
+    if (!results[i]) {
+      ++stats_.errors;
+      e.due = done + options_.retry_period;
+      continue;
+    }
+    e.value = feature_value{.raw = decode(e.reg, *results[i]),
+                            .read_at = done,
+                            .stale = false};
+    const auto period = period_of(e);
+    e.due = period == clock::duration::max() ? clock::time_point::max()
+                                             : done + period;
+  }
+
+  if (done - window_start_ >= stats_window) {
+    const auto elapsed = done - window_start_;
+    stats_.utilisation = std::chrono::duration<double>(window_busy_).count() /
+                         std::chrono::duration<double>(elapsed).count();
+    stats_.registers_per_second = static_cast<uint32_t>(
+        window_registers_ / std::chrono::duration<double>(elapsed).count());
+    window_start_ = done;
+    window_busy_ = {};
+    window_registers_ = 0;
+  }
+
+  auto next = clock::time_point::max();
+  for (const auto &[reg, e] : entries_)
+    next = std::min(next, e.due);
+  return next;
+}
+
+} // namespace gev
@@ -0,0 +1,413 @@
+#include <gev/gvcp_client.hpp>
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+
+namespace gev {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+// Largest GVCP datagram we ever send or expect back: a full READREG ack.
+constexpr size_t datagram_size = gvcp_header_size + gvcp_max_payload;
+static_assert(datagram_size >= gvcp_header_size + 4 + gvcp_max_memory_transfer);
+
+} // namespace
+
+std::expected<std::unique_ptr<gvcp_client>, std::error_code>
+gvcp_client::connect(endpoint device, options opts) {
+  auto socket = udp_socket::bind({});
+  if (!socket)
+    return std::unexpected(socket.error());
+
+  return std::unique_ptr<gvcp_client>(
+      new gvcp_client(std::move(*socket), device, opts));
+}
+
+gvcp_client::gvcp_client(udp_socket socket, endpoint device, options opts)
+    : socket_(std::move(socket)), device_(device), options_(opts) {}
+
+gvcp_client::~gvcp_client() { release_control(); }
+
+std::expected<std::vector<discovered_device>, std::error_code>
+gvcp_client::discover(std::span<const endpoint> targets,
+                      std::chrono::milliseconds timeout, endpoint local,
+                      const discovery_callback &on_found) {
+  auto socket = udp_socket::bind(local);
+  if (!socket)
+    return std::unexpected(socket.error());
+
+  const int one = 1;
+  ::setsockopt(socket->fd(), SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+
+  std::array<std::byte, gvcp_header_size> request;
+  gvcp_command_header{.flags = gvcp_flag_ack_required |
+                               gvcp_flag_allow_broadcast_ack,
+                      .command = gvcp_command::discovery_cmd,
+                      .req_id = 1}
+      .encode(request.data());
+
+  for (const auto &target : targets)
+    (void)socket->send_to(request, target);
+
+  std::vector<discovered_device> found;
+  std::array<std::byte, 1500>    reply;
+  const auto                     deadline = clock::now() + timeout;
+
+  for (auto now = clock::now(); now < deadline; now = clock::now()) {
+    (void)socket->set_receive_timeout(
+        std::chrono::duration_cast<std::chrono::microseconds>(deadline - now) +
+        std::chrono::microseconds(1));
+
+    endpoint from;
+    auto     n = socket->receive_from(reply, from);
+    if (!n)
+      continue;
+
+    const auto      datagram = std::span<const std::byte>(reply.data(), *n);
+    gvcp_ack_header ack;
+    discovered_device d{.control = from, .info = {}};
+    if (!ack.decode(datagram) || ack.answer != gvcp_command::discovery_ack ||
+        ack.status != gvcp_status::success ||
+        !d.info.decode(datagram.subspan(gvcp_header_size)))
+      continue;
+
+    // A device on several targeted subnets may answer more than once.
+    if (std::ranges::none_of(found, [&](const discovered_device &e) {
+          return e.control == from;
+        })) {
+      found.push_back(d);
+      if (on_found)
+        on_found(d);
+    }
+  }
+
+  return found;
+}
+
+std::expected<size_t, std::error_code>
+gvcp_client::transact(gvcp_command command, std::span<const std::byte> payload,
+                      gvcp_command expected_answer, std::span<std::byte> reply) {
+  request r{.command = command,
+            .payload = payload,
+            .expected_answer = expected_answer,
+            .reply = reply};
+  transact(std::span(&r, 1), 1);
+  return r.result;
+}
+
+void gvcp_client::transact(std::span<request> requests,
+                           uint32_t max_outstanding) {
+  struct in_flight {
+    size_t            index;
+    uint16_t          req_id;
+    uint32_t          attempt;
+    clock::time_point deadline;
+  };
+
+  std::array<std::byte, datagram_size> datagram;
+  std::array<std::byte, datagram_size> response;
+
+  std::scoped_lock lock(mutex_);
+
+  const size_t           window = std::max<uint32_t>(max_outstanding, 1);
+  std::vector<in_flight> flight;
+  flight.reserve(window);
+
+  const auto send = [&](in_flight &f) {
+    const request &r = requests[f.index];
+    gvcp_command_header{.command = r.command,
+                        .length = static_cast<uint16_t>(r.payload.size()),
+                        .req_id = f.req_id}
+        .encode(datagram.data());
+    std::ranges::copy(r.payload, datagram.begin() + gvcp_header_size);
+
+    f.deadline = clock::now() + options_.timeout;
+    if (auto sent = socket_.send_to(
+            std::span(datagram.data(), gvcp_header_size + r.payload.size()),
+            device_);
+        !sent) {
+      requests[f.index].result = std::unexpected(sent.error());
+      return false;
+    }
+    return true;
+  };
+
+  size_t next = 0;
+  bool   failed = false;
+
+  while ((!failed && next < requests.size()) || !flight.empty()) {
+    while (!failed && next < requests.size() && flight.size() < window) {
+      in_flight f{.index = next++,
+                  .req_id = next_request_id(),
+                  .attempt = 0,
+                  .deadline = {}};
+      if (send(f))
+        flight.push_back(f);
+      else
+        failed = true;
+    }
+    if (flight.empty())
+      break;
+
+    // Retry or give up on whatever has timed out.
+    const auto now = clock::now();
+    for (auto it = flight.begin(); it != flight.end();) {
+      if (now < it->deadline) {
+        ++it;
+        continue;
+      }
+      if (it->attempt < options_.retries) {
+        ++it->attempt;
+        if (send(*it)) {
+          ++it;
+          continue;
+        }
+      } else {
+        requests[it->index].result =
+            std::unexpected(std::make_error_code(std::errc::timed_out));
+      }
+      failed = true;
+      it = flight.erase(it);
+    }
+    if (flight.empty())
+      continue;
+
+    const auto earliest =
+        std::ranges::min(flight, {}, &in_flight::deadline).deadline;
+    (void)socket_.set_receive_timeout(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::max(earliest - clock::now(), clock::duration::zero())) +
+        std::chrono::microseconds(1));
+
+    endpoint from;
+    auto     n = socket_.receive_from(response, from);
+    if (!n || from.address != device_.address)
+      continue;
+
+    gvcp_ack_header ack;
+    if (!ack.decode(std::span(response.data(), *n)))
+      continue;
+    auto it = std::ranges::find(flight, ack.ack_id, &in_flight::req_id);
+    if (it == flight.end())
+      continue; // Late answer to an earlier, retried command.
+
+    const auto body =
+        std::span<const std::byte>(response.data(), *n).subspan(gvcp_header_size);
+
+    if (ack.answer == gvcp_command::pending_ack && body.size() >= 4) {
+      // The device needs longer; it tells us how long in milliseconds.
+      it->deadline = clock::now() + std::chrono::milliseconds(
+                                        load_be<uint16_t>(body.data() + 2));
+      continue;
+    }
+
+    request &r = requests[it->index];
+    flight.erase(it);
+
+    if (ack.status != gvcp_status::success) {
+      r.result = std::unexpected(make_error_code(ack.status));
+      failed = true;
+    } else if (ack.answer != r.expected_answer) {
+      r.result = std::unexpected(make_error_code(gvcp_status::error));
+      failed = true;
+    } else {
+      const size_t size =
+          std::min<size_t>({ack.length, body.size(), r.reply.size()});
+      std::copy_n(body.begin(), size, r.reply.begin());
+      r.result = size;
+    }
+  }
+}
+
+namespace {
+
+// The result of the first request that did not succeed, if any.
+std::error_code first_error(std::span<const auto> requests) {
+  for (const auto &r : requests)
+    if (!r.result)
+      return r.result.error();
+  return {};
+}
+
+} // namespace
+
+std::expected<std::vector<uint32_t>, std::error_code>
+gvcp_client::read_registers(std::span<const uint32_t> addresses) {
+  const size_t commands =
+      (addresses.size() + gvcp_max_read_registers - 1) / gvcp_max_read_registers;
+
+  // Every command's payload and reply stay alive until the last ack.
+  std::vector<std::byte> payloads(commands * gvcp_max_payload);
+  std::vector<std::byte> replies(commands * gvcp_max_payload);
+  std::vector<request>   requests;
+  requests.reserve(commands);
+
+  for (size_t c = 0; c < commands; ++c) {
+    const auto   batch = addresses.subspan(c * gvcp_max_read_registers).first(
+        std::min(addresses.size() - c * gvcp_max_read_registers,
+                 gvcp_max_read_registers));
+    std::byte   *payload = payloads.data() + c * gvcp_max_payload;
+    for (size_t i = 0; i < batch.size(); ++i)
+      store_be(payload + i * 4, batch[i]);
+
+    requests.push_back(
+        {.command = gvcp_command::readreg_cmd,
+         .payload = std::span(payload, batch.size() * 4),
+         .expected_answer = gvcp_command::readreg_ack,
+         .reply = std::span(replies.data() + c * gvcp_max_payload,
+                            gvcp_max_payload)});
+  }
+
+  transact(requests, options_.max_outstanding);
+  if (auto err = first_error(std::span<const request>(requests)))
+    return std::unexpected(err);
+
+  std::vector<uint32_t> values;
+  values.reserve(addresses.size());
+  for (const auto &r : requests) {
+    if (*r.result != r.payload.size())
+      return std::unexpected(make_error_code(gvcp_status::error));
+    for (size_t i = 0; i < *r.result; i += 4)
+      values.push_back(load_be<uint32_t>(r.reply.data() + i));
+  }
+
+  return values;
+}
+
+std::expected<uint32_t, std::error_code>
+gvcp_client::read_register(uint32_t address) {
+  auto values = read_registers(std::span(&address, 1));
+  if (!values)
+    return std::unexpected(values.error());
+  return values->front();
+}
+
+std::expected<void, std::error_code> gvcp_client::write_registers(
+    std::span<const std::pair<uint32_t, uint32_t>> writes) {
+  std::array<std::byte, gvcp_max_payload> payload;
+  std::array<std::byte, 4>                reply;
+
+  while (!writes.empty()) {
+    const size_t count = std::min(writes.size(), gvcp_max_write_registers);
+    for (size_t i = 0; i < count; ++i) {
+      store_be(payload.data() + i * 8, writes[i].first);
+      store_be(payload.data() + i * 8 + 4, writes[i].second);
+    }
+
+    auto n = transact(gvcp_command::writereg_cmd,
+                      std::span(payload.data(), count * 8),
+                      gvcp_command::writereg_ack, reply);
+    if (!n)
+      return std::unexpected(n.error());
+    writes = writes.subspan(count);
+  }
+
+  return {};
+}
+
+std::expected<void, std::error_code>
+gvcp_client::write_register(uint32_t address, uint32_t value) {
+  const std::pair<uint32_t, uint32_t> w{address, value};
+  return write_registers(std::span(&w, 1));
+}
+
+std::expected<void, std::error_code>
+gvcp_client::read_memory(uint32_t address, std::span<std::byte> out) {
+  constexpr size_t payload_size = 8;
+  constexpr size_t reply_size = 4 + gvcp_max_memory_transfer;
+
+  const size_t commands =
+      (out.size() + gvcp_max_memory_transfer - 1) / gvcp_max_memory_transfer;
+
+  std::vector<std::byte> payloads(commands * payload_size);
+  std::vector<std::byte> replies(commands * reply_size);
+  std::vector<request>   requests;
+  requests.reserve(commands);
+
+  for (size_t c = 0; c < commands; ++c) {
+    // READMEM counts must be multiples of 4; over-read and trim the tail.
+    const size_t chunk = std::min(out.size() - c * gvcp_max_memory_transfer,
+                                  gvcp_max_memory_transfer);
+    const auto   count = static_cast<uint16_t>((chunk + 3) & ~size_t{3});
+
+    std::byte *payload = payloads.data() + c * payload_size;
+    store_be(payload,
+             address + static_cast<uint32_t>(c * gvcp_max_memory_transfer));
+    store_be(payload + 4, uint16_t{0});
+    store_be(payload + 6, count);
+
+    requests.push_back({.command = gvcp_command::readmem_cmd,
+                        .payload = std::span(payload, payload_size),
+                        .expected_answer = gvcp_command::readmem_ack,
+                        .reply = std::span(replies.data() + c * reply_size,
+                                           reply_size)});
+  }
+
+  transact(requests, options_.max_outstanding);
+  if (auto err = first_error(std::span<const request>(requests)))
+    return std::unexpected(err);
+
+  for (size_t c = 0; c < commands; ++c) {
+    const auto   chunk_out = out.subspan(c * gvcp_max_memory_transfer).first(
+        std::min(out.size() - c * gvcp_max_memory_transfer,
+                 gvcp_max_memory_transfer));
+    if (*requests[c].result < 4 + chunk_out.size())
+      return std::unexpected(make_error_code(gvcp_status::error));
+    std::copy_n(requests[c].reply.begin() + 4, chunk_out.size(),
+                chunk_out.begin());
+  }
+
+  return {};
+}
+
+void gvcp_client::request_resend(uint16_t block_id, uint32_t first_packet,
+                                 uint32_t last_packet) {
+  std::array<std::byte, gvcp_header_size + packet_resend_size> request;
+
+  // Not under mutex_: a batch of reads holds it for as long as its retries
+  // take, and packets must be asked for again while the device has them.
+  gvcp_command_header{.flags = 0,
+                      .command = gvcp_command::packet_resend_cmd,
+                      .length = packet_resend_size,
+                      .req_id = next_request_id()}
+      .encode(request.data());
+  packet_resend{.block_id = block_id,
+                .first_packet = first_packet,
+                .last_packet = last_packet}
+      .encode(request.data() + gvcp_header_size);
+
+  (void)socket_.send_to(request, device_);
+}
+
+std::expected<void, std::error_code>
+gvcp_client::take_control(std::chrono::milliseconds heartbeat_interval) {
+  if (auto r = write_register(reg::control_channel_privilege,
+                              reg::privilege_control);
+      !r)
+    return r;
+
+  heartbeat_ = std::jthread([this, heartbeat_interval](std::stop_token stop) {
+    std::mutex                  m;
+    std::condition_variable_any cv;
+    while (!stop.stop_requested()) {
+      std::unique_lock lock(m);
+      if (cv.wait_for(lock, stop, heartbeat_interval,
+                      [&] { return stop.stop_requested(); }))
+        break;
+      (void)read_register(reg::control_channel_privilege);
+    }
+  });
+  return {};
+}
+
+void gvcp_client::release_control() {
+  if (!heartbeat_.joinable())
+    return;
+  heartbeat_ = {};
+  (void)write_register(reg::control_channel_privilege, 0);
+}
+
+} // namespace gev
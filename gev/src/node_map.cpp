@@ -0,0 +1,1005 @@
+#include <gev/node_map.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gev {
+
+namespace {
+
+std::error_code bad_message() {
+  return std::make_error_code(std::errc::bad_message);
+}
+
+std::error_code last_error() { return {errno, std::generic_category()}; }
+
+/*--------------------------------  files  ---------------------------------*/
+
+// A read-only private mapping of a whole file.
+class mapped_file {
+public:
+  static std::expected<mapped_file, std::error_code>
+  open(const std::filesystem::path &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return std::unexpected(last_error());
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      const auto err = last_error();
+      ::close(fd);
+      return std::unexpected(err);
+    }
+
+    mapped_file file;
+    file.size_ = static_cast<size_t>(st.st_size);
+    if (file.size_ > 0) {
+      void *data = ::mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        const auto err = last_error();
+        ::close(fd);
+        return std::unexpected(err);
+      }
+      file.data_ = static_cast<const char *>(data);
+    }
+    ::close(fd); // The mapping keeps the file open.
+    return file;
+  }
+
+  mapped_file() = default;
+  mapped_file(mapped_file &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  mapped_file &operator=(mapped_file &&other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~mapped_file() {
+    if (data_)
+      ::munmap(const_cast<char *>(data_), size_);
+  }
+
+  std::string_view bytes() const noexcept { return {data_, size_}; }
+
+private:
+  const char *data_ = nullptr;
+  size_t      size_ = 0;
+};
+
+/*-----------------------------  cache format  -----------------------------*/
+
+// header | nodes | links | name index | strings, each 8-byte aligned. Host
+// byte order: the cache never leaves the machine that wrote it.
+struct cache_header {
+  std::array<char, 8> magic;
+  uint32_t            version;
+  uint32_t            node_size; // Catches layout changes between builds.
+  uint64_t            xml_hash;
+  uint64_t            xml_size;
+  uint32_t            node_count;
+  uint32_t            link_count;
+  uint32_t            name_count;
+  uint32_t            string_size;
+  node_index          root;
+  uint32_t            unresolved;
+};
+
+constexpr std::array<char, 8> cache_magic{'G', 'E', 'N', 'I', 'M', 'A', 'P', 0};
+constexpr uint32_t            cache_version = 1;
+
+constexpr size_t align8(size_t n) noexcept { return (n + 7) & ~size_t{7}; }
+
+struct cache_layout {
+  size_t nodes;
+  size_t links;
+  size_t names;
+  size_t strings;
+  size_t end;
+
+  explicit cache_layout(const cache_header &h)
+      : nodes(align8(sizeof(cache_header))),
+        links(align8(nodes + size_t{h.node_count} * sizeof(node))),
+        names(align8(links + size_t{h.link_count} * sizeof(node_link))),
+        strings(align8(names + size_t{h.name_count} * sizeof(node_index))),
+        end(strings + h.string_size) {}
+};
+
+// Every string a node holds, for compaction and validation.
+template <typename Node, typename F> void for_each_string(Node &n, F &&f) {
+  for (auto *r : {&n.name, &n.display_name, &n.tooltip, &n.description,
+                  &n.unit, &n.value, &n.min, &n.max, &n.inc, &n.formula,
+                  &n.formula_to, &n.formula_from})
+    f(*r);
+}
+
+template <typename Node, typename F> void for_each_reference(Node &n, F &&f) {
+  for (auto *r : {&n.value_ref, &n.min_ref, &n.max_ref, &n.inc_ref,
+                  &n.address_ref})
+    f(*r);
+}
+
+template <typename Node, typename F> void for_each_range(Node &n, F &&f) {
+  for (auto *r : {&n.children, &n.invalidators, &n.selected, &n.variables})
+    f(*r);
+}
+
+/*--------------------------------  parsing  -------------------------------*/
+
+// Offsets with this bit set are in the decoded pool rather than the source.
+constexpr uint32_t decoded_bit = 1u << 31;
+
+constexpr bool is_space(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string_view trim(std::string_view s) noexcept {
+  while (!s.empty() && is_space(s.front()))
+    s.remove_prefix(1);
+  while (!s.empty() && is_space(s.back()))
+    s.remove_suffix(1);
+  return s;
+}
+
+template <typename T> T parse_integer(std::string_view s) noexcept {
+  s = trim(s);
+  bool negative = false;
+  if (s.starts_with('-')) {
+    negative = true;
+    s.remove_prefix(1);
+  }
+  int base = 10;
+  if (s.starts_with("0x") || s.starts_with("0X")) {
+    s.remove_prefix(2);
+    base = 16;
+  }
+  uint64_t v = 0;
+  std::from_chars(s.data(), s.data() + s.size(), v, base);
+  return static_cast<T>(negative ? uint64_t{0} - v : v);
+}
+
+// Element names we act on, looked up by binary search.
+enum class tag : uint8_t {
+  other,
+  // Nodes.
+  category, integer, float_, boolean, enumeration, enum_entry, command,
+  string, int_reg, masked_int_reg, float_reg, string_reg, register_,
+  struct_reg, struct_entry, converter, int_converter, swiss_knife,
+  int_swiss_knife, port,
+  // Structure.
+  group,
+  // Properties.
+  tooltip, description, display_name, visibility, unit, value, min, max,
+  inc, p_value, p_min, p_max, p_inc, address, p_address, length,
+  access_mode, cachable, polling_time, p_invalidator, p_feature,
+  p_selected, p_variable, sign, endianess, formula, formula_to,
+  formula_from, command_value, lsb, msb, bit,
+};
+
+struct tag_name {
+  std::string_view name;
+  tag              id;
+};
+
+constexpr auto tag_names = [] {
+  std::array<tag_name, 53> t{{
+      {"AccessMode", tag::access_mode},
+      {"Address", tag::address},
+      {"Bit", tag::bit},
+      {"Boolean", tag::boolean},
+      {"Cachable", tag::cachable},
+      {"Category", tag::category},
+      {"Command", tag::command},
+      {"CommandValue", tag::command_value},
+      {"Converter", tag::converter},
+      {"Description", tag::description},
+      {"DisplayName", tag::display_name},
+      {"Endianess", tag::endianess},
+      {"EnumEntry", tag::enum_entry},
+      {"Enumeration", tag::enumeration},
+      {"Float", tag::float_},
+      {"FloatReg", tag::float_reg},
+      {"Formula", tag::formula},
+      {"FormulaFrom", tag::formula_from},
+      {"FormulaTo", tag::formula_to},
+      {"Group", tag::group},
+      {"Inc", tag::inc},
+      {"IntConverter", tag::int_converter},
+      {"IntReg", tag::int_reg},
+      {"IntSwissKnife", tag::int_swiss_knife},
+      {"Integer", tag::integer},
+      {"LSB", tag::lsb},
+      {"Length", tag::length},
+      {"MSB", tag::msb},
+      {"MaskedIntReg", tag::masked_int_reg},
+      {"Max", tag::max},
+      {"Min", tag::min},
+      {"PollingTime", tag::polling_time},
+      {"Port", tag::port},
+      {"Register", tag::register_},
+      {"Sign", tag::sign},
+      {"String", tag::string},
+      {"StringReg", tag::string_reg},
+      {"StructEntry", tag::struct_entry},
+      {"StructReg", tag::struct_reg},
+      {"SwissKnife", tag::swiss_knife},
+      {"ToolTip", tag::tooltip},
+      {"Unit", tag::unit},
+      {"Value", tag::value},
+      {"Visibility", tag::visibility},
+      {"pAddress", tag::p_address},
+      {"pFeature", tag::p_feature},
+      {"pInc", tag::p_inc},
+      {"pInvalidator", tag::p_invalidator},
+      {"pMax", tag::p_max},
+      {"pMin", tag::p_min},
+      {"pSelected", tag::p_selected},
+      {"pValue", tag::p_value},
+      {"pVariable", tag::p_variable},
+  }};
+  return t;
+}();
+static_assert(std::ranges::is_sorted(tag_names, {}, &tag_name::name));
+
+tag lookup_tag(std::string_view name) noexcept {
+  auto it = std::ranges::lower_bound(tag_names, name, {}, &tag_name::name);
+  return it != tag_names.end() && it->name == name ? it->id : tag::other;
+}
+
+node_kind kind_of(tag t) noexcept {
+  switch (t) {
+  case tag::category: return node_kind::category;
+  case tag::integer: return node_kind::integer;
+  case tag::float_: return node_kind::float_;
+  case tag::boolean: return node_kind::boolean;
+  case tag::enumeration: return node_kind::enumeration;
+  case tag::enum_entry: return node_kind::enum_entry;
+  case tag::command: return node_kind::command;
+  case tag::string: return node_kind::string;
+  case tag::int_reg: return node_kind::int_reg;
+  case tag::masked_int_reg:
+  case tag::struct_entry: return node_kind::masked_int_reg;
+  case tag::float_reg: return node_kind::float_reg;
+  case tag::string_reg: return node_kind::string_reg;
+  case tag::register_: return node_kind::register_;
+  case tag::struct_reg: return node_kind::struct_reg;
+  case tag::converter: return node_kind::converter;
+  case tag::int_converter: return node_kind::int_converter;
+  case tag::swiss_knife: return node_kind::swiss_knife;
+  case tag::int_swiss_knife: return node_kind::int_swiss_knife;
+  case tag::port: return node_kind::port;
+  default: return node_kind::other;
+  }
+}
+
+} // namespace
+
+// Everything a parsed (rather than mapped) node map owns.
+struct node_map::storage {
+  std::string             xml;
+  mapped_file             xml_file;
+  std::string             decoded;
+  std::vector<node>       nodes;
+  std::vector<node_link>  links;
+  std::vector<node_index> names;
+  mapped_file             cache;
+};
+
+/*========================================================================================
+ *  node_map_builder
+ *  -----------------------------------------------------------------------
+ *  •  One pass over the source with a stack of open elements. Elements
+ *     directly under RegisterDescription (or a Group) are nodes; elements
+ *     inside a node are its properties, except EnumEntry and StructEntry,
+ *     which are nodes of their own.
+ *  •  References by name are queued and resolved once every node exists,
+ *     since descriptions refer forwards freely.
+ *=======================================================================================*/
+class node_map_builder {
+public:
+  node_map_builder(std::string_view src, node_map::storage &out)
+      : src_(src), out_(out) {
+    // Vendor descriptions run at a few hundred bytes per node.
+    out_.nodes.reserve(src.size() / 256);
+    pending_.reserve(src.size() / 128);
+    stack_.reserve(16);
+  }
+
+  // Builds a node map over source, which storage already owns.
+  static std::expected<node_map, std::error_code>
+  build(std::shared_ptr<node_map::storage> storage, std::string_view source);
+
+  std::expected<void, std::error_code> run();
+
+private:
+  enum class role : uint8_t { document, group, node, property, ignored };
+  enum class link_kind : uint8_t {
+    child, invalidator, selected, variable, // Lists, in link_range order.
+    value, min, max, inc, address,           // Single references.
+  };
+
+  struct element {
+    std::string_view name;
+    role             what;
+    node_index       owner;      // The node this element is or belongs to.
+    size_t           text_begin; // Just past the start tag.
+    std::string_view label;      // Name attribute of a property.
+  };
+
+  struct pending_link {
+    node_index       owner;
+    link_kind        kind;
+    std::string_view target_name; // Or:
+    node_index       target;
+    string_ref       label;
+  };
+
+  void start_element(std::string_view name, std::string_view name_attribute,
+                     size_t text_begin);
+  std::expected<void, std::error_code> end_element(std::string_view name,
+                                                   size_t           text_end);
+  void property(node &n, node_index owner, tag t, std::string_view text,
+                std::string_view label);
+
+  string_ref       ref(std::string_view s);
+  std::string_view str(string_ref r) const noexcept {
+    return r.offset & decoded_bit
+               ? std::string_view(out_.decoded)
+                     .substr(r.offset & ~decoded_bit, r.size)
+               : src_.substr(r.offset, r.size);
+  }
+
+  void resolve();
+
+  std::string_view   src_;
+  node_map::storage &out_;
+
+  std::vector<element>      stack_;
+  std::vector<pending_link> pending_;
+  uint32_t                  unresolved_ = 0;
+};
+
+string_ref node_map_builder::ref(std::string_view s) {
+  const bool cdata = s.starts_with("<![CDATA[") && s.ends_with("]]>");
+  if (cdata)
+    s = s.substr(9, s.size() - 12);
+
+  if (cdata || s.find('&') == std::string_view::npos)
+    return {static_cast<uint32_t>(s.data() - src_.data()),
+            static_cast<uint32_t>(s.size())};
+
+  // Expand the predefined and numeric entities into the decoded pool.
+  const size_t start = out_.decoded.size();
+  while (!s.empty()) {
+    const size_t amp = s.find('&');
+    out_.decoded.append(s.substr(0, amp));
+    if (amp == std::string_view::npos)
+      break;
+    s.remove_prefix(amp);
+
+    const size_t semi = s.find(';');
+    const auto   entity = s.substr(1, semi == std::string_view::npos ? 0 : semi - 1);
+    if (entity == "lt")
+      out_.decoded += '<';
+    else if (entity == "gt")
+      out_.decoded += '>';
+    else if (entity == "amp")
+      out_.decoded += '&';
+    else if (entity == "quot")
+      out_.decoded += '"';
+    else if (entity == "apos")
+      out_.decoded += '\'';
+    else if (entity.starts_with('#')) {
+      uint32_t cp = entity.starts_with("#x")
+                        ? parse_integer<uint32_t>("0x" + std::string(entity.substr(2)))
+                        : parse_integer<uint32_t>(entity.substr(1));
+      // UTF-8; descriptions only ever use this for the odd symbol.
+      if (cp < 0x80)
+        out_.decoded += static_cast<char>(cp);
+      else if (cp < 0x800) {
+        out_.decoded += static_cast<char>(0xC0 | (cp >> 6));
+        out_.decoded += static_cast<char>(0x80 | (cp & 0x3F));
+      } else {
+        out_.decoded += static_cast<char>(0xE0 | ((cp >> 12) & 0x0F));
+        out_.decoded += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out_.decoded += static_cast<char>(0x80 | (cp & 0x3F));
+      }
+    } else {
+      out_.decoded += '&'; // Not an entity; keep it as written.
+      s.remove_prefix(1);
+      continue;
+    }
+    s.remove_prefix(semi + 1);
+  }
+
+  return {static_cast<uint32_t>(start) | decoded_bit,
+          static_cast<uint32_t>(out_.decoded.size() - start)};
+}
+
+std::expected<void, std::error_code> node_map_builder::run() {
+  size_t pos = 0;
+  while (true) {
+    const size_t lt = src_.find('<', pos);
+    if (lt == std::string_view::npos)
+      break;
+
+    const auto rest = src_.substr(lt);
+    const auto skip_past = [&](std::string_view terminator) {
+      const size_t end = src_.find(terminator, lt);
+      return end == std::string_view::npos ? end : end + terminator.size();
+    };
+
+    if (rest.starts_with("<?")) {
+      pos = skip_past("?>");
+    } else if (rest.starts_with("<!--")) {
+      pos = skip_past("-->");
+    } else if (rest.starts_with("<![CDATA[")) {
+      pos = skip_past("]]>"); // Text; taken whole by the enclosing element.
+    } else if (rest.starts_with("<!")) {
+      pos = skip_past(">");
+    } else if (rest.starts_with("</")) {
+      const size_t gt = src_.find('>', lt);
+      if (gt == std::string_view::npos)
+        return std::unexpected(bad_message());
+      if (auto r = end_element(trim(src_.substr(lt + 2, gt - lt - 2)), lt); !r)
+        return r;
+      pos = gt + 1;
+    } else {
+      // Start tag: name, attributes, then > or />.
+      size_t i = lt + 1;
+      while (i < src_.size() && !is_space(src_[i]) && src_[i] != '>' &&
+             src_[i] != '/')
+        ++i;
+      const auto name = src_.substr(lt + 1, i - lt - 1);
+
+      std::string_view name_attribute;
+      bool             self_closing = false;
+      while (true) {
+        while (i < src_.size() && is_space(src_[i]))
+          ++i;
+        if (i >= src_.size())
+          return std::unexpected(bad_message());
+        if (src_[i] == '>')
+          break;
+        if (src_[i] == '/') {
+          self_closing = true;
+          i = src_.find('>', i);
+          if (i == std::string_view::npos)
+            return std::unexpected(bad_message());
+          break;
+        }
+
+        const size_t eq = src_.find('=', i);
+        if (eq == std::string_view::npos)
+          return std::unexpected(bad_message());
+        const auto attribute = trim(src_.substr(i, eq - i));
+
+        size_t q = eq + 1;
+        while (q < src_.size() && is_space(src_[q]))
+          ++q;
+        if (q >= src_.size() || (src_[q] != '"' && src_[q] != '\''))
+          return std::unexpected(bad_message());
+        const size_t close = src_.find(src_[q], q + 1);
+        if (close == std::string_view::npos)
+          return std::unexpected(bad_message());
+
+        if (attribute == "Name")
+          name_attribute = src_.substr(q + 1, close - q - 1);
+        i = close + 1;
+      }
+
+      start_element(name, name_attribute, i + 1);
+      if (self_closing)
+        if (auto r = end_element(name, i + 1); !r)
+          return r;
+      pos = i + 1;
+    }
+
+    if (pos == std::string_view::npos)
+      return std::unexpected(bad_message());
+  }
+
+  if (!stack_.empty())
+    return std::unexpected(bad_message());
+
+  resolve();
+  return {};
+}
+
+void node_map_builder::start_element(std::string_view name,
+                                     std::string_view name_attribute,
+                                     size_t           text_begin) {
+  element e{.name = name,
+            .what = role::ignored,
+            .owner = no_node,
+            .text_begin = text_begin,
+            .label = {}};
+
+  const auto new_node = [&](tag t) {
+    node n;
+    n.kind = kind_of(t);
+    n.name = ref(name_attribute);
+    out_.nodes.push_back(n);
+    return static_cast<node_index>(out_.nodes.size() - 1);
+  };
+
+  if (stack_.empty()) {
+    e.what = role::document;
+  } else {
+    const element &parent = stack_.back();
+    const tag      t = lookup_tag(name);
+
+    switch (parent.what) {
+    case role::document:
+    case role::group:
+      if (t == tag::group) {
+        e.what = role::group;
+      } else if (!name_attribute.empty() || t == tag::struct_reg) {
+        e.what = role::node;
+        e.owner = new_node(t);
+      }
+      break;
+
+    case role::node:
+      if (t == tag::enum_entry || t == tag::struct_entry) {
+        // Entries inherit their container's register properties, which
+        // the schema puts before the first entry.
+        const node parent_node = out_.nodes[parent.owner];
+        e.what = role::node;
+        e.owner = new_node(t);
+        if (t == tag::struct_entry) {
+          node &n = out_.nodes[e.owner];
+          n.address = parent_node.address;
+          n.address_ref = parent_node.address_ref;
+          n.length = parent_node.length;
+          n.access = parent_node.access;
+          n.cache = parent_node.cache;
+          n.polling_ms = parent_node.polling_ms;
+          n.is_signed = parent_node.is_signed;
+          n.little_endian = parent_node.little_endian;
+          for (size_t i = 0, count = pending_.size(); i < count; ++i)
+            if (pending_[i].owner == parent.owner &&
+                pending_[i].kind == link_kind::invalidator) {
+              pending_.push_back(pending_[i]);
+              pending_.back().owner = e.owner;
+            }
+        }
+        pending_.push_back({.owner = parent.owner,
+                            .kind = link_kind::child,
+                            .target_name = {},
+                            .target = e.owner,
+                            .label = {}});
+      } else {
+        e.what = role::property;
+        e.owner = parent.owner;
+        e.label = name_attribute;
+      }
+      break;
+
+    case role::property:
+    case role::ignored:
+      break;
+    }
+  }
+
+  stack_.push_back(e);
+}
+
+std::expected<void, std::error_code>
+node_map_builder::end_element(std::string_view name, size_t text_end) {
+  if (stack_.empty() || stack_.back().name != name)
+    return std::unexpected(bad_message());
+
+  const element e = stack_.back();
+  stack_.pop_back();
+
+  if (e.what == role::property) {
+    const auto text = trim(src_.substr(e.text_begin, text_end - e.text_begin));
+    property(out_.nodes[e.owner], e.owner, lookup_tag(name), text, e.label);
+  }
+  return {};
+}
+
+void node_map_builder::property(node &n, node_index owner, tag t,
+                                std::string_view text, std::string_view label) {
+  const auto link = [&](link_kind kind) {
+    pending_.push_back({.owner = owner,
+                        .kind = kind,
+                        .target_name = text,
+                        .target = no_node,
+                        .label = label.empty() ? string_ref{} : ref(label)});
+  };
+
+  switch (t) {
+  case tag::tooltip: n.tooltip = ref(text); break;
+  case tag::description: n.description = ref(text); break;
+  case tag::display_name: n.display_name = ref(text); break;
+  case tag::unit: n.unit = ref(text); break;
+  case tag::value:
+    n.value = ref(text);
+    if (n.kind == node_kind::enum_entry)
+      n.constant = parse_integer<int64_t>(text);
+    break;
+  case tag::min: n.min = ref(text); break;
+  case tag::max: n.max = ref(text); break;
+  case tag::inc: n.inc = ref(text); break;
+  case tag::formula: n.formula = ref(text); break;
+  case tag::formula_to: n.formula_to = ref(text); break;
+  case tag::formula_from: n.formula_from = ref(text); break;
+  case tag::command_value: n.constant = parse_integer<int64_t>(text); break;
+
+  case tag::address: n.address += parse_integer<uint64_t>(text); break;
+  case tag::length: n.length = parse_integer<uint32_t>(text); break;
+  case tag::polling_time: n.polling_ms = parse_integer<uint32_t>(text); break;
+  case tag::lsb: n.lsb = parse_integer<uint8_t>(text); break;
+  case tag::msb: n.msb = parse_integer<uint8_t>(text); break;
+  case tag::bit: n.lsb = n.msb = parse_integer<uint8_t>(text); break;
+  case tag::sign: n.is_signed = text == "Signed"; break;
+  case tag::endianess: n.little_endian = text == "LittleEndian"; break;
+
+  case tag::access_mode:
+    n.access = text == "RO"   ? access_mode::ro
+               : text == "WO" ? access_mode::wo
+               : text == "NA" ? access_mode::na
+                              : access_mode::rw;
+    break;
+  case tag::cachable:
+    n.cache = text == "NoCache"       ? cachable::no_cache
+              : text == "WriteAround" ? cachable::write_around
+                                      : cachable::write_through;
+    break;
+  case tag::visibility:
+    n.visibility = text == "Expert"      ? visibility_level::expert
+                   : text == "Guru"      ? visibility_level::guru
+                   : text == "Invisible" ? visibility_level::invisible
+                                         : visibility_level::beginner;
+    break;
+
+  case tag::p_feature: link(link_kind::child); break;
+  case tag::p_invalidator: link(link_kind::invalidator); break;
+  case tag::p_selected: link(link_kind::selected); break;
+  case tag::p_variable: link(link_kind::variable); break;
+  case tag::p_value: link(link_kind::value); break;
+  case tag::p_min: link(link_kind::min); break;
+  case tag::p_max: link(link_kind::max); break;
+  case tag::p_inc: link(link_kind::inc); break;
+  case tag::p_address: link(link_kind::address); break;
+
+  default: break;
+  }
+}
+
+void node_map_builder::resolve() {
+  auto &nodes = out_.nodes;
+
+  for (node_index i = 0; i < nodes.size(); ++i)
+    if (!nodes[i].name.empty())
+      out_.names.push_back(i);
+  std::ranges::sort(out_.names, {}, [&](node_index i) {
+    return str(nodes[i].name);
+  });
+
+  const auto find = [&](std::string_view name) {
+    auto it = std::ranges::lower_bound(out_.names, name, {}, [&](node_index i) {
+      return str(nodes[i].name);
+    });
+    return it != out_.names.end() && str(nodes[*it].name) == name ? *it
+                                                                   : no_node;
+  };
+
+  // Group list entries by owner and kind, keeping document order within.
+  std::ranges::stable_sort(pending_, [](const pending_link &a,
+                                        const pending_link &b) {
+    return a.owner != b.owner ? a.owner < b.owner : a.kind < b.kind;
+  });
+
+  out_.links.reserve(pending_.size());
+  for (const auto &p : pending_) {
+    const node_index target =
+        p.target != no_node ? p.target : find(p.target_name);
+    if (target == no_node) {
+      ++unresolved_;
+      continue;
+    }
+
+    node &owner = nodes[p.owner];
+    const auto append = [&](link_range &r) {
+      if (r.count == 0)
+        r.first = static_cast<uint32_t>(out_.links.size());
+      out_.links.push_back({.target = target, .label = p.label});
+      ++r.count;
+    };
+
+    switch (p.kind) {
+    case link_kind::child: append(owner.children); break;
+    case link_kind::invalidator: append(owner.invalidators); break;
+    case link_kind::selected: append(owner.selected); break;
+    case link_kind::variable: append(owner.variables); break;
+    case link_kind::value: owner.value_ref = target; break;
+    case link_kind::min: owner.min_ref = target; break;
+    case link_kind::max: owner.max_ref = target; break;
+    case link_kind::inc: owner.inc_ref = target; break;
+    case link_kind::address: owner.address_ref = target; break;
+    }
+  }
+}
+
+std::expected<node_map, std::error_code>
+node_map_builder::build(std::shared_ptr<node_map::storage> storage,
+                        std::string_view                   source) {
+  node_map_builder builder(source, *storage);
+  if (auto r = builder.run(); !r)
+    return std::unexpected(r.error());
+
+  node_map map;
+  map.nodes_ = storage->nodes;
+  map.links_ = storage->links;
+  map.names_ = storage->names;
+  map.strings_ = source;
+  map.decoded_ = storage->decoded;
+  map.unresolved_ = builder.unresolved_;
+  map.root_ = map.find("Root").value_or(no_node);
+  map.backing_ = std::move(storage);
+  return map;
+}
+
+/*===============================  node_map  ===============================*/
+
+std::string_view node_map::str(string_ref r) const noexcept {
+  return r.offset & decoded_bit
+             ? decoded_.substr(r.offset & ~decoded_bit, r.size)
+             : strings_.substr(r.offset, r.size);
+}
+
+std::optional<node_index> node_map::find(std::string_view name) const noexcept {
+  auto it = std::ranges::lower_bound(names_, name, {}, [&](node_index i) {
+    return str(nodes_[i].name);
+  });
+  if (it == names_.end() || str(nodes_[*it].name) != name)
+    return std::nullopt;
+  return *it;
+}
+
+uint64_t node_map::hash(std::string_view xml) noexcept {
+  // Eight bytes per step with a multiply-rotate mix and a murmur3
+  // finaliser; keying a cache needs speed more than strength, and the
+  // header also records the size.
+  uint64_t h = 0x9E3779B97F4A7C15ull ^ xml.size();
+  size_t   i = 0;
+  for (; i + 8 <= xml.size(); i += 8) {
+    uint64_t w;
+    std::memcpy(&w, xml.data() + i, 8);
+    h = std::rotl((h ^ w) * 0xFF51AFD7ED558CCDull, 31);
+  }
+  uint64_t tail = 0;
+  if (i < xml.size())
+    std::memcpy(&tail, xml.data() + i, xml.size() - i);
+  h = std::rotl((h ^ tail) * 0xFF51AFD7ED558CCDull, 31);
+
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+std::filesystem::path node_map::cache_file(const std::filesystem::path &cache_dir,
+                                           uint64_t                     xml_hash) {
+  std::array<char, 16> hex;
+  hex.fill('0');
+  char *end = std::to_chars(hex.data(), hex.data() + hex.size(), xml_hash, 16).ptr;
+  std::rotate(hex.data(), end, hex.data() + hex.size()); // Zero-pad on the left.
+  return cache_dir / ("genicam_" + std::string(hex.data(), hex.size()) + ".bin");
+}
+
+std::expected<node_map, std::error_code> node_map::parse(std::string xml) {
+  auto storage = std::make_shared<node_map::storage>();
+  storage->xml = std::move(xml);
+  const std::string_view source = storage->xml;
+  return node_map_builder::build(std::move(storage), source);
+}
+
+std::expected<node_map, std::error_code>
+node_map::parse_file(const std::filesystem::path &xml_file) {
+  auto file = mapped_file::open(xml_file);
+  if (!file)
+    return std::unexpected(file.error());
+
+  auto storage = std::make_shared<node_map::storage>();
+  storage->xml_file = std::move(*file);
+  const std::string_view source = storage->xml_file.bytes();
+  return node_map_builder::build(std::move(storage), source);
+}
+
+std::expected<node_map, std::error_code>
+node_map::load(const std::filesystem::path &cache_file, uint64_t xml_hash,
+               uint64_t xml_size) {
+  auto file = mapped_file::open(cache_file);
+  if (!file)
+    return std::unexpected(file.error());
+
+  const auto invalid = [] {
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+  };
+
+  const auto bytes = file->bytes();
+  if (bytes.size() < sizeof(cache_header))
+    return invalid();
+
+  cache_header h;
+  std::memcpy(&h, bytes.data(), sizeof(h));
+  if (h.magic != cache_magic || h.version != cache_version ||
+      h.node_size != sizeof(node) || h.xml_hash != xml_hash ||
+      h.xml_size != xml_size)
+    return invalid();
+
+  const cache_layout layout(h);
+  if (bytes.size() < layout.end)
+    return invalid();
+
+  node_map map;
+  map.nodes_ = {reinterpret_cast<const node *>(bytes.data() + layout.nodes),
+                h.node_count};
+  map.links_ = {reinterpret_cast<const node_link *>(bytes.data() + layout.links),
+                h.link_count};
+  map.names_ = {reinterpret_cast<const node_index *>(bytes.data() + layout.names),
+                h.name_count};
+  map.strings_ = bytes.substr(layout.strings, h.string_size);
+  map.root_ = h.root;
+  map.unresolved_ = h.unresolved;
+  map.from_cache_ = true;
+
+  // Never trust an index read from disk.
+  const auto string_ok = [&](string_ref r) {
+    return !(r.offset & decoded_bit) && size_t{r.offset} + r.size <= h.string_size;
+  };
+  const auto index_ok = [&](node_index i) {
+    return i == no_node || i < h.node_count;
+  };
+  bool ok = index_ok(map.root_);
+  for (const node &n : map.nodes_) {
+    for_each_string(n, [&](string_ref r) { ok &= string_ok(r); });
+    for_each_reference(n, [&](node_index i) { ok &= index_ok(i); });
+    for_each_range(n, [&](link_range r) {
+      ok &= size_t{r.first} + r.count <= h.link_count;
+    });
+  }
+  for (const node_link &l : map.links_)
+    ok &= l.target < h.node_count && string_ok(l.label);
+  for (node_index i : map.names_)
+    ok &= i < h.node_count;
+  if (!ok)
+    return invalid();
+
+  auto storage = std::make_shared<node_map::storage>();
+  storage->cache = std::move(*file);
+  map.backing_ = std::move(storage);
+  return map;
+}
+
+std::expected<node_map, std::error_code>
+node_map::load_or_compile(std::string xml, const std::filesystem::path &cache_dir) {
+  const uint64_t h = hash(xml);
+  const auto     path = cache_file(cache_dir, h);
+  if (auto cached = load(path, h, xml.size()))
+    return cached;
+
+  auto map = parse(std::move(xml));
+  if (map)
+    (void)map->save(path); // Only costs the next load a parse.
+  return map;
+}
+
+std::expected<node_map, std::error_code>
+node_map::load_or_compile_file(const std::filesystem::path &xml_file,
+                               const std::filesystem::path &cache_dir) {
+  auto file = mapped_file::open(xml_file);
+  if (!file)
+    return std::unexpected(file.error());
+
+  const uint64_t h = hash(file->bytes());
+  const auto     path = cache_file(cache_dir, h);
+  if (auto cached = load(path, h, file->bytes().size()))
+    return cached;
+
+  auto storage = std::make_shared<node_map::storage>();
+  storage->xml_file = std::move(*file);
+  const std::string_view source = storage->xml_file.bytes();
+  auto map = node_map_builder::build(std::move(storage), source);
+  if (map)
+    (void)map->save(path);
+  return map;
+}
+
+std::expected<void, std::error_code>
+node_map::save(const std::filesystem::path &cache_file) const {
+  // Compact every string into one pool, sharing repeats.
+  std::string                                    pool;
+  std::unordered_map<std::string_view, string_ref> seen;
+  const auto compact = [&](string_ref &r) {
+    if (r.empty()) {
+      r = {};
+      return;
+    }
+    const auto s = str(r);
+    auto [it, inserted] = seen.try_emplace(s);
+    if (inserted) {
+      it->second = {static_cast<uint32_t>(pool.size()),
+                    static_cast<uint32_t>(s.size())};
+      pool += s;
+    }
+    r = it->second;
+  };
+
+  std::vector<node> nodes(nodes_.begin(), nodes_.end());
+  for (node &n : nodes)
+    for_each_string(n, compact);
+  std::vector<node_link> links(links_.begin(), links_.end());
+  for (node_link &l : links)
+    compact(l.label);
+
+  cache_header h{};
+  h.magic = cache_magic;
+  h.version = cache_version;
+  h.node_size = sizeof(node);
+  h.xml_hash = 0;
+  h.xml_size = 0;
+  h.node_count = static_cast<uint32_t>(nodes.size());
+  h.link_count = static_cast<uint32_t>(links.size());
+  h.name_count = static_cast<uint32_t>(names_.size());
+  h.string_size = static_cast<uint32_t>(pool.size());
+  h.root = root_;
+  h.unresolved = unresolved_;
+
+  // The key is the source the map was parsed from.
+  if (const auto *s = static_cast<const storage *>(backing_.get());
+      s && !from_cache_) {
+    const std::string_view source =
+        s->xml.empty() ? s->xml_file.bytes() : std::string_view(s->xml);
+    h.xml_hash = hash(source);
+    h.xml_size = source.size();
+  } else {
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+  }
+
+  const cache_layout layout(h);
+  std::string        out(layout.end, '\0');
+  std::memcpy(out.data(), &h, sizeof(h));
+  std::memcpy(out.data() + layout.nodes, nodes.data(), nodes.size() * sizeof(node));
+  std::memcpy(out.data() + layout.links, links.data(),
+              links.size() * sizeof(node_link));
+  std::memcpy(out.data() + layout.names, names_.data(),
+              names_.size() * sizeof(node_index));
+  std::memcpy(out.data() + layout.strings, pool.data(), pool.size());
+
+  std::error_code ec;
+  std::filesystem::create_directories(cache_file.parent_path(), ec);
+  if (ec)
+    return std::unexpected(ec);
+
+  auto tmp = cache_file;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file.write(out.data(), static_cast<std::streamsize>(out.size())))
+      return std::unexpected(std::make_error_code(std::errc::io_error));
+  }
+
+  std::filesystem::rename(tmp, cache_file, ec);
+  if (ec)
+    return std::unexpected(ec);
+  return {};
+}
+
+} // namespace gev
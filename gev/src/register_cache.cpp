@@ -0,0 +1,175 @@
+#include <gev/register_cache.hpp>
+
+#include <algorithm>
+
+namespace gev {
+
+namespace {
+
+// Only a device refusing a register is worth splitting a sweep batch for;
+// a timeout or socket error would fail every half too.
+bool refused_by_device(std::error_code err) noexcept {
+  return err.category() == gvcp_category();
+}
+
+} // namespace
+
+void register_cache::set_policy(uint32_t address, cache_policy policy) {
+  std::scoped_lock lock(mutex_);
+  if (policy == cache_policy::volatile_) {
+    policies_.erase(address);
+    values_.erase(address);
+  } else {
+    policies_[address] = policy;
+  }
+}
+
+cache_policy register_cache::policy(uint32_t address) const {
+  std::scoped_lock lock(mutex_);
+  auto it = policies_.find(address);
+  return it == policies_.end() ? cache_policy::volatile_ : it->second;
+}
+
+std::expected<std::vector<uint32_t>, std::error_code>
+register_cache::read(std::span<const uint32_t> addresses) {
+  std::vector<uint32_t> values(addresses.size());
+  std::vector<uint32_t> missing;
+  std::vector<size_t>   missing_index;
+  uint64_t              generation;
+
+  {
+    std::scoped_lock lock(mutex_);
+    for (size_t i = 0; i < addresses.size(); ++i) {
+      if (auto it = values_.find(addresses[i]); it != values_.end()) {
+        values[i] = it->second;
+        ++stats_.hits;
+        continue;
+      }
+      if (policies_.contains(addresses[i]))
+        ++stats_.misses;
+      missing.push_back(addresses[i]);
+      missing_index.push_back(i);
+    }
+    if (!missing.empty())
+      ++stats_.batches;
+    generation = generation_;
+  }
+
+  if (missing.empty())
+    return values;
+
+  auto fetched = client_->read_registers(missing);
+  if (!fetched)
+    return std::unexpected(fetched.error());
+
+  for (size_t i = 0; i < missing.size(); ++i)
+    values[missing_index[i]] = (*fetched)[i];
+  store(missing, *fetched, generation);
+  return values;
+}
+
+std::expected<uint32_t, std::error_code> register_cache::read(uint32_t address) {
+  auto values = read(std::span(&address, 1));
+  if (!values)
+    return std::unexpected(values.error());
+  return values->front();
+}
+
+std::expected<void, std::error_code> register_cache::write(
+    std::span<const std::pair<uint32_t, uint32_t>> writes) {
+  {
+    std::scoped_lock lock(mutex_);
+    ++stats_.batches;
+    ++generation_;
+  }
+
+  auto result = client_->write_registers(writes);
+
+  std::scoped_lock lock(mutex_);
+  // A read answered before the write landed may be waiting to store.
+  ++generation_;
+  for (const auto &[address, value] : writes) {
+    auto it = policies_.find(address);
+    if (it == policies_.end())
+      continue;
+    if (result && it->second == cache_policy::write_through)
+      values_[address] = value;
+    else
+      values_.erase(address);
+  }
+  return result;
+}
+
+std::expected<void, std::error_code> register_cache::write(uint32_t address,
+                                                           uint32_t value) {
+  const std::pair<uint32_t, uint32_t> w{address, value};
+  return write(std::span(&w, 1));
+}
+
+std::expected<std::vector<std::optional<uint32_t>>, std::error_code>
+register_cache::sweep(uint32_t first, uint32_t count) {
+  std::vector<uint32_t> addresses(count);
+  for (uint32_t i = 0; i < count; ++i)
+    addresses[i] = first + i * 4;
+
+  std::vector<std::optional<uint32_t>> values(count);
+  if (auto r = sweep_batch(addresses, values); !r)
+    return std::unexpected(r.error());
+  return values;
+}
+
+std::expected<void, std::error_code>
+register_cache::sweep_batch(std::span<const uint32_t>          addresses,
+                            std::span<std::optional<uint32_t>> out) {
+  uint64_t generation;
+  {
+    std::scoped_lock lock(mutex_);
+    ++stats_.batches;
+    generation = generation_;
+  }
+
+  auto values = client_->read_registers(addresses);
+  if (values) {
+    std::ranges::copy(*values, out.begin());
+    store(addresses, *values, generation);
+    return {};
+  }
+  if (!refused_by_device(values.error()))
+    return std::unexpected(values.error());
+  if (addresses.size() == 1)
+    return {}; // Leave it nullopt.
+
+  const size_t half = addresses.size() / 2;
+  if (auto r = sweep_batch(addresses.first(half), out.first(half)); !r)
+    return r;
+  return sweep_batch(addresses.subspan(half), out.subspan(half));
+}
+
+void register_cache::store(std::span<const uint32_t> addresses,
+                           std::span<const uint32_t> values, uint64_t generation) {
+  std::scoped_lock lock(mutex_);
+  if (generation != generation_)
+    return;
+  for (size_t i = 0; i < addresses.size(); ++i)
+    if (policies_.contains(addresses[i]))
+      values_[addresses[i]] = values[i];
+}
+
+void register_cache::invalidate(uint32_t address) {
+  std::scoped_lock lock(mutex_);
+  ++generation_;
+  values_.erase(address);
+}
+
+void register_cache::invalidate_all() {
+  std::scoped_lock lock(mutex_);
+  ++generation_;
+  values_.clear();
+}
+
+register_cache_stats register_cache::stats() const {
+  std::scoped_lock lock(mutex_);
+  return stats_;
+}
+
+} // namespace gev
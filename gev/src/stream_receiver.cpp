@@ -0,0 +1,526 @@
+#include <gev/stream_receiver.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace gev {
+
+namespace {
+
+// How often frame timeouts and resends are looked at while packets flow.
+constexpr auto service_interval = std::chrono::microseconds(250);
+
+// Resend requests sent per frame per pass; beyond this the rest of the
+// frame is asked for as one range.
+constexpr uint32_t max_resend_ranges = 32;
+
+constexpr size_t control_size =
+    CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+// Block ids wrap; a is newer than b if it is less than half the range ahead.
+bool newer(uint16_t a, uint16_t b) noexcept {
+  return static_cast<int16_t>(a - b) > 0;
+}
+
+uint32_t bits_per_pixel(uint32_t pixel_format) noexcept {
+  return (pixel_format >> 16) & 0xFF;
+}
+
+} // namespace
+
+std::expected<std::unique_ptr<stream_receiver>, std::error_code>
+stream_receiver::create(const receiver_options              &options,
+                        std::span<const std::span<std::byte>> framebuffers,
+                        uint32_t packet_size, frame_callback on_frame,
+                        resend_callback on_resend) {
+  if (framebuffers.empty() || options.batch == 0 ||
+      packet_size <= ip_udp_overhead + gvsp_header_size)
+    return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+  auto socket = udp_socket::bind(options.local);
+  if (!socket)
+    return std::unexpected(socket.error());
+
+  // Counts datagrams the kernel dropped for lack of buffer space.
+  const int one = 1;
+  ::setsockopt(socket->fd(), SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+  // Kernel receive timestamps, for the wake-up latency histogram.
+  ::setsockopt(socket->fd(), SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+
+  if (options.mode == receive_mode::busy_poll) {
+    // Best effort; needs CAP_NET_ADMIN to raise above net.core.busy_read.
+    const int busy_us = 50;
+    ::setsockopt(socket->fd(), SOL_SOCKET, SO_BUSY_POLL, &busy_us,
+                 sizeof(busy_us));
+  } else if (auto r = socket->set_receive_timeout(options.poll_timeout); !r) {
+    return std::unexpected(r.error());
+  }
+
+  return std::unique_ptr<stream_receiver>(
+      new stream_receiver(std::move(*socket), options, framebuffers,
+                          packet_size, std::move(on_frame),
+                          std::move(on_resend)));
+}
+
+stream_receiver::stream_receiver(
+    udp_socket socket, const receiver_options &options,
+    std::span<const std::span<std::byte>> framebuffers, uint32_t packet_size,
+    frame_callback on_frame, resend_callback on_resend)
+    : socket_(std::move(socket)), options_(options),
+      per_packet_(gvsp_payload_per_packet(packet_size)),
+      on_frame_(std::move(on_frame)), on_resend_(std::move(on_resend)),
+      slots_(std::make_unique<frame_slot[]>(framebuffers.size())),
+      slot_count_(static_cast<uint32_t>(framebuffers.size())) {
+  local_ = socket_.local_endpoint().value_or(options.local);
+  socket_buffer_ = socket_.set_receive_buffer(options.socket_buffer).value_or(0);
+
+  for (uint32_t i = 0; i < slot_count_; ++i) {
+    auto &s = slots_[i];
+    s.buffer = framebuffers[i];
+    s.capacity_packets =
+        static_cast<uint32_t>((s.buffer.size() + per_packet_ - 1) / per_packet_);
+    // Leader and trailer take ids 0 and capacity + 1.
+    s.bitmap.resize((s.capacity_packets + 2 + 63) / 64);
+  }
+
+  const size_t batch = options_.batch;
+  msgs_.resize(batch);
+  iov_.resize(batch);
+  headers_.resize(batch);
+  targets_.resize(batch);
+  packets_.resize(batch);
+  scratch_.resize(batch * per_packet_);
+  overflow_.resize(batch * per_packet_);
+  bounce_.resize(batch * per_packet_);
+  control_.resize(batch * control_size);
+}
+
+stream_receiver::~stream_receiver() = default;
+
+void stream_receiver::release(uint32_t slot) noexcept {
+  if (slot < slot_count_)
+    slots_[slot].owned_by_receiver.store(true, std::memory_order_release);
+}
+
+std::error_code stream_receiver::run(std::stop_token stop) {
+  const int flags =
+      options_.mode == receive_mode::busy_poll ? MSG_DONTWAIT : MSG_WAITFORONE;
+
+  while (!stop.stop_requested()) {
+    prepare_batch();
+
+    const int n = ::recvmmsg(socket_.fd(), msgs_.data(),
+                             static_cast<unsigned>(msgs_.size()), flags,
+                             nullptr);
+    const auto now = clock::now();
+
+    if (n > 0) {
+      // Kernel timestamps are CLOCK_REALTIME.
+      timespec woke;
+      ::clock_gettime(CLOCK_REALTIME, &woke);
+      record_wakeup(msgs_[0].msg_hdr, woke);
+      process_batch(static_cast<uint32_t>(n), now);
+    } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+               errno != EINTR) {
+      return last_error();
+    }
+
+    if (now - last_service_ >= service_interval) {
+      service(now);
+      last_service_ = now;
+    }
+  }
+  return {};
+}
+
+/*------------------------------  batching  --------------------------------*/
+
+void stream_receiver::prepare_batch() {
+  // Predict where the next datagrams go: the packets following the highest
+  // one seen of the newest frame, or, once its trailer is in, the start of
+  // a frame in the slot the next block will most likely get.
+  uint32_t slot = no_slot;
+  uint32_t next_id = 0;
+  uint32_t limit = 0;
+
+  if (current_ != no_slot && slots_[current_].active &&
+      !slots_[current_].trailer_seen) {
+    const auto &s = slots_[current_];
+    slot = current_;
+    next_id = s.highest_id + 1;
+    limit = s.payload_packets ? s.payload_packets : s.capacity_packets;
+  } else {
+    if (reserved_ == no_slot || slots_[reserved_].active ||
+        !slots_[reserved_].owned_by_receiver.load(std::memory_order_acquire)) {
+      reserved_ = no_slot;
+      for (uint32_t i = 1; i <= slot_count_; ++i) {
+        const uint32_t c = (current_ == no_slot ? 0 : current_ + i) % slot_count_;
+        if (!slots_[c].active &&
+            slots_[c].owned_by_receiver.load(std::memory_order_acquire)) {
+          reserved_ = c;
+          break;
+        }
+      }
+    }
+    if (reserved_ != no_slot) {
+      slot = reserved_;
+      limit = slots_[reserved_].capacity_packets;
+    }
+  }
+
+  for (size_t k = 0; k < msgs_.size(); ++k) {
+    auto          &t = targets_[k];
+    const uint32_t id = next_id + static_cast<uint32_t>(k);
+
+    if (slot != no_slot && id >= 1 && id <= limit) {
+      auto        &buffer = slots_[slot].buffer;
+      const size_t offset = size_t{id - 1} * per_packet_;
+      t = {.slot = slot,
+           .packet_id = id,
+           .primary = buffer.data() + offset,
+           .primary_size = std::min(per_packet_, buffer.size() - offset)};
+    } else {
+      t = {.slot = no_slot,
+           .packet_id = id,
+           .primary = scratch_.data() + k * per_packet_,
+           .primary_size = per_packet_};
+    }
+
+    // Header, predicted destination, and spill space in case the
+    // destination is a short final packet but the datagram is not.
+    iov_[k] = {iovec{headers_[k].data(), gvsp_header_size},
+               iovec{t.primary, t.primary_size},
+               iovec{overflow_.data() + k * per_packet_, per_packet_}};
+
+    auto &m = msgs_[k];
+    m.msg_hdr = {};
+    m.msg_hdr.msg_iov = iov_[k].data();
+    m.msg_hdr.msg_iovlen = iov_[k].size();
+    m.msg_hdr.msg_control = control_.data() + k * control_size;
+    m.msg_hdr.msg_controllen = control_size;
+    m.msg_len = 0;
+  }
+}
+
+void stream_receiver::process_batch(uint32_t count, clock::time_point now) {
+  const auto packets = std::span(packets_.data(), count);
+
+  // Pass 1: classify every datagram and move mispredicted payloads out of
+  // the framebuffers before anything is written into place, since one
+  // packet's landing spot can be another packet's destination.
+  for (uint32_t k = 0; k < count; ++k) {
+    auto       &p = packets[k];
+    const auto &m = msgs_[k];
+    const auto &t = targets_[k];
+    p = {};
+
+    if (m.msg_len < gvsp_header_size || (m.msg_hdr.msg_flags & MSG_TRUNC) ||
+        !p.h.decode(headers_[k]))
+      continue;
+    p.size = m.msg_len - gvsp_header_size;
+    if (p.size > per_packet_)
+      continue; // Bigger than the packet size we were told; not ours.
+    p.valid = true;
+
+    p.slot = find_slot(p.h.block_id);
+    if (p.slot == no_slot &&
+        (newest_block_ == 0 || newer(p.h.block_id, newest_block_)))
+      p.slot = start_frame(p.h.block_id, now);
+
+    p.in_place = p.h.format == gvsp_format::payload && p.slot == t.slot &&
+                 p.h.packet_id == t.packet_id && p.size <= t.primary_size;
+
+    if (!p.in_place && t.slot != no_slot) {
+      std::byte   *dst = bounce_.data() + k * per_packet_;
+      const size_t head = std::min(p.size, t.primary_size);
+      std::memcpy(dst, t.primary, head);
+      std::memcpy(dst + head, overflow_.data() + k * per_packet_,
+                  p.size - head);
+    }
+  }
+
+  // Pass 2: apply.
+  for (uint32_t k = 0; k < count; ++k) {
+    const auto &p = packets[k];
+    if (!p.valid || p.slot == no_slot) {
+      ++stats_.stray;
+      continue;
+    }
+
+    const std::byte *data =
+        p.in_place                        ? targets_[k].primary
+        : targets_[k].slot != no_slot ? bounce_.data() + k * per_packet_
+                                          : scratch_.data() + k * per_packet_;
+    accept(slots_[p.slot], p.slot, p.h, std::span(data, p.size), p.in_place,
+           now);
+  }
+
+  // The overflow counter is cumulative; the last datagram has the latest.
+  auto &last = msgs_[count - 1].msg_hdr;
+  for (auto *c = CMSG_FIRSTHDR(&last); c; c = CMSG_NXTHDR(&last, c))
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+      uint32_t drops;
+      std::memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+      stats_.kernel_drops.store(drops, std::memory_order_relaxed);
+    }
+}
+
+void stream_receiver::record_wakeup(msghdr         &first,
+                                    const timespec &woke) noexcept {
+  for (auto *c = CMSG_FIRSTHDR(&first); c; c = CMSG_NXTHDR(&first, c))
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec received;
+      std::memcpy(&received, CMSG_DATA(c), sizeof(received));
+      stats_.wakeup_latency.record(
+          std::chrono::seconds(woke.tv_sec - received.tv_sec) +
+          std::chrono::nanoseconds(woke.tv_nsec - received.tv_nsec));
+      return;
+    }
+}
+
+/*-------------------------------  frames  ---------------------------------*/
+
+uint32_t stream_receiver::find_slot(uint16_t block_id) const noexcept {
+  if (current_ != no_slot && slots_[current_].active &&
+      slots_[current_].block_id == block_id)
+    return current_;
+  for (uint32_t i = 0; i < slot_count_; ++i)
+    if (slots_[i].active && slots_[i].block_id == block_id)
+      return i;
+  return no_slot;
+}
+
+uint32_t stream_receiver::start_frame(uint16_t block_id,
+                                      clock::time_point now) {
+  newest_block_ = block_id;
+
+  uint32_t slot = no_slot;
+  if (reserved_ != no_slot && !slots_[reserved_].active &&
+      slots_[reserved_].owned_by_receiver.load(std::memory_order_acquire)) {
+    slot = reserved_;
+  } else {
+    for (uint32_t i = 0; i < slot_count_; ++i)
+      if (!slots_[i].active &&
+          slots_[i].owned_by_receiver.load(std::memory_order_acquire)) {
+        slot = i;
+        break;
+      }
+  }
+
+  if (slot == no_slot) {
+    ++stats_.frames_no_buffer;
+    return no_slot;
+  }
+
+  auto &s = slots_[slot];
+  s.active = true;
+  s.block_id = block_id;
+  s.payload_packets = 0;
+  s.received = 0;
+  s.highest_id = 0;
+  s.resend_count = 0;
+  s.leader_seen = s.trailer_seen = s.oversize = false;
+  s.leader = {};
+  std::ranges::fill(s.bitmap, 0);
+  s.first_packet = s.last_packet = now;
+
+  current_ = slot;
+  if (reserved_ == slot)
+    reserved_ = no_slot;
+  return slot;
+}
+
+void stream_receiver::accept(frame_slot &s, uint32_t slot,
+                             const gvsp_header         &h,
+                             std::span<const std::byte> payload,
+                             bool in_place, clock::time_point now) {
+  const uint32_t id = h.packet_id;
+  if (id > s.capacity_packets + 1 || s.oversize) {
+    ++stats_.stray;
+    return;
+  }
+  if (s.test(id)) {
+    ++stats_.duplicates;
+    return;
+  }
+
+  switch (h.format) {
+  case gvsp_format::leader: {
+    if (id != 0 || !s.leader.decode(payload)) {
+      ++stats_.stray;
+      return;
+    }
+    s.leader_seen = true;
+    const size_t bytes = size_t{s.leader.width} * s.leader.height *
+                         bits_per_pixel(s.leader.pixel_format) / 8;
+    const auto packets =
+        static_cast<uint32_t>((bytes + per_packet_ - 1) / per_packet_);
+    if (bytes > s.buffer.size()) {
+      // Device is configured for bigger frames than our buffers hold.
+      s.oversize = true;
+      s.active = false;
+      ++stats_.frames_incomplete;
+      return;
+    }
+    s.payload_packets = packets;
+    break;
+  }
+
+  case gvsp_format::trailer:
+    if (id == 0) {
+      ++stats_.stray;
+      return;
+    }
+    s.payload_packets = id - 1;
+    s.trailer_seen = true;
+    s.trailer_time = now;
+    break;
+
+  case gvsp_format::payload: {
+    const size_t offset = size_t{id - 1} * per_packet_;
+    if (id == 0 || offset + payload.size() > s.buffer.size()) {
+      ++stats_.stray;
+      return;
+    }
+    if (!in_place) {
+      std::memcpy(s.buffer.data() + offset, payload.data(), payload.size());
+      ++stats_.packets_copied;
+    }
+    stats_.bytes.fetch_add(payload.size(), std::memory_order_relaxed);
+    break;
+  }
+
+  default:
+    ++stats_.stray;
+    return;
+  }
+
+  s.set(id);
+  ++s.received;
+  s.highest_id = std::max(s.highest_id, id);
+  s.last_packet = now;
+  stats_.packets.fetch_add(1, std::memory_order_relaxed);
+
+  if (s.leader_seen && s.trailer_seen &&
+      s.received == s.payload_packets + 2)
+    deliver(slot, now);
+}
+
+uint32_t stream_receiver::missing_packets(const frame_slot &s) const noexcept {
+  const uint32_t total =
+      (s.payload_packets ? s.payload_packets : s.capacity_packets) + 2;
+  return total > s.received ? total - s.received : 0;
+}
+
+void stream_receiver::request_missing(frame_slot &s, clock::time_point now) {
+  if (!on_resend_)
+    return;
+
+  // While the frame may still be streaming, only gaps below the highest
+  // packet seen are known to be missing. Once it is over, ask for the rest
+  // too; without a leader or trailer the frame's length is unknown, so ask
+  // up to the buffer capacity and let the device clamp.
+  const bool     finished = s.trailer_seen || current_ == no_slot ||
+                        &s != &slots_[current_] ||
+                        now - s.last_packet >= 4 * options_.resend_delay;
+  const uint32_t last_id =
+      !finished         ? s.highest_id
+      : s.payload_packets ? s.payload_packets + 1
+                          : s.capacity_packets + 1;
+
+  uint32_t ranges = 0;
+  uint32_t id = 0;
+  while (id <= last_id) {
+    // Skip received packets a word at a time.
+    const uint64_t missing = ~s.bitmap[id >> 6] >> (id & 63);
+    if (missing == 0) {
+      id = (id | 63) + 1;
+      continue;
+    }
+    id += static_cast<uint32_t>(std::countr_zero(missing));
+    if (id > last_id)
+      break;
+
+    uint32_t end = id;
+    if (ranges + 1 == max_resend_ranges)
+      end = last_id; // Out of ranges; ask for everything that is left.
+    else
+      while (end + 1 <= last_id && !s.test(end + 1))
+        ++end;
+
+    on_resend_(s.block_id, id, end);
+    ++ranges;
+    stats_.packets_requested += end - id + 1;
+    id = end + 1;
+  }
+
+  stats_.resend_requests += ranges;
+  ++s.resend_count;
+  s.last_resend = now;
+}
+
+void stream_receiver::deliver(uint32_t slot, clock::time_point now) {
+  auto          &s = slots_[slot];
+  const uint32_t missing = missing_packets(s);
+
+  s.active = false;
+  if (missing) {
+    ++stats_.frames_incomplete;
+    stats_.packets_lost += missing;
+    if (!options_.deliver_incomplete)
+      return; // The slot stays with the receiver.
+  } else {
+    ++stats_.frames_complete;
+  }
+
+  const received_frame frame{
+      .slot = slot,
+      .block_id = s.block_id,
+      .timestamp = s.leader.timestamp,
+      .width = s.leader.width,
+      .height = s.leader.height,
+      .pixel_format = s.leader.pixel_format,
+      .size = size_t{s.leader.width} * s.leader.height *
+              bits_per_pixel(s.leader.pixel_format) / 8,
+      .missing_packets = missing,
+      .first_packet = s.first_packet,
+      .completed = now,
+  };
+
+  s.owned_by_receiver.store(false, std::memory_order_release);
+  if (on_frame_)
+    on_frame_(frame);
+  else
+    release(slot);
+}
+
+void stream_receiver::service(clock::time_point now) {
+  for (uint32_t i = 0; i < slot_count_; ++i) {
+    auto &s = slots_[i];
+    if (!s.active)
+      continue;
+
+    if (now - s.first_packet > options_.frame_timeout) {
+      deliver(i, now);
+      continue;
+    }
+
+    // A gap is only worth asking about once the frame has finished
+    // streaming (trailer in) or gone quiet, and the delay has passed for
+    // reordered packets to turn up on their own.
+    const bool settled =
+        (s.trailer_seen && now - s.trailer_time >= options_.resend_delay) ||
+        now - s.last_packet >= options_.resend_delay;
+    const bool due = s.resend_count == 0 ||
+                     now - s.last_resend >= 2 * options_.resend_delay;
+
+    if (settled && due && s.resend_count < options_.max_resend_requests &&
+        missing_packets(s) > 0)
+      request_missing(s, now);
+  }
+}
+
+} // namespace gev
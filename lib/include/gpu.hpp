@@ -18,15 +18,18 @@ struct gpu {
   vk::PhysicalDeviceMemoryProperties2    memory_properties;
   std::vector<vk::QueueFamilyProperties> queue_family_properties;
   vk::PhysicalDeviceSubgroupProperties   subgroup_properties;
+  vk::PhysicalDeviceIDProperties         id_properties;
 
   // ───────────────────────────────────────────────────────────────────────────
   gpu(vk::PhysicalDevice pd, std::shared_ptr<instance> &inst)
       : handle_{pd}, instance_(inst) {
     auto props = pd.getProperties2<vk::PhysicalDeviceProperties2,
-                                   vk::PhysicalDeviceSubgroupProperties>();
+                                   vk::PhysicalDeviceSubgroupProperties,
+                                   vk::PhysicalDeviceIDProperties>();
 
     properties = props.get<vk::PhysicalDeviceProperties2>();
     subgroup_properties = props.get<vk::PhysicalDeviceSubgroupProperties>();
+    id_properties = props.get<vk::PhysicalDeviceIDProperties>();
     features = pd.getFeatures2();
     memory_properties = pd.getMemoryProperties2();
     queue_family_properties = pd.getQueueFamilyProperties();
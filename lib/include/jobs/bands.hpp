@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef> /* std::size_t */
+
+namespace engine::jobs {
+
+// Below this many pixels a band is not worth a hand-off to another thread.
+inline constexpr size_t min_band_pixels = 64 * 1024;
+
+// Rows per band of an image width pixels wide, as the grain of a
+// job_system::parallel_for over its rows.
+constexpr size_t band_rows(size_t width) noexcept {
+  return width ? (min_band_pixels + width - 1) / width : 1;
+}
+
+} // namespace engine::jobs
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>      /* std::atomic, fences */
+#include <cstddef>     /* std::size_t */
+#include <cstdint>     /* int64_t */
+#include <memory>      /* std::unique_ptr for rings */
+#include <optional>    /* steal/pop results */
+#include <type_traits> /* std::is_trivially_copyable_v */
+#include <vector>      /* retired rings */
+
+namespace engine::jobs {
+
+/*========================================================================================
+ *  chase_lev_deque<T>
+ *  -----------------------------------------------------------------------
+ *  •  Single-owner work-stealing deque (Chase & Lev, with the C11 memory
+ *     orders of Lê et al., PPoPP 2013). The owner pushes and pops at the
+ *     bottom, LIFO; any thread steals from the top, FIFO, so thieves take
+ *     the oldest and usually largest pieces of work.
+ *  •  push() and pop() are wait-free apart from growing; steal() is
+ *     lock-free and may fail spuriously when it loses a race, in which
+ *     case the caller should look elsewhere rather than spin on it.
+ *  •  The ring doubles when full. Old rings are kept until the deque is
+ *     destroyed, since a thief may still be reading one: a deque that
+ *     grew to N slots holds at most 2N.
+ *=======================================================================================*/
+template <typename T> class chase_lev_deque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "chase_lev_deque: T is read racily by thieves and must be "
+                "trivially copyable (typically a pointer).");
+
+public:
+  explicit chase_lev_deque(std::size_t capacity = 256) {
+    std::size_t c = 1;
+    while (c < capacity)
+      c <<= 1;
+    auto first = std::make_unique<ring>(static_cast<int64_t>(c));
+    ring_.store(first.get(), std::memory_order_relaxed);
+    rings_.push_back(std::move(first));
+  }
+
+  chase_lev_deque(const chase_lev_deque &) = delete;
+  chase_lev_deque &operator=(const chase_lev_deque &) = delete;
+
+  // Owner only.
+  void push(T value) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    ring         *r = ring_.load(std::memory_order_relaxed);
+    if (b - t > r->capacity - 1)
+      r = grow(r, t, b);
+    r->put(b, value);
+    // A release store rather than the paper's release fence: the same on
+    // x86 and ARM, and visible to ThreadSanitizer, which ignores fences.
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  // Owner only.
+  std::optional<T> pop() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    ring         *r = ring_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    std::optional<T> value = r->get(b);
+    if (t == b) {
+      // The last item: race any thief for it.
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        value.reset();
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  // Any thread.
+  std::optional<T> steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b)
+      return std::nullopt;
+
+    // Acquire pairs with the release in grow(), so the ring's contents are
+    // visible before it is read.
+    ring   *r = ring_.load(std::memory_order_acquire);
+    const T value = r->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return std::nullopt;
+    return value;
+  }
+
+  // A snapshot; only exact when no other thread touches the deque.
+  [[nodiscard]] std::size_t size() const noexcept {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+  }
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return static_cast<std::size_t>(ring_.load(std::memory_order_relaxed)->capacity);
+  }
+
+private:
+  struct ring {
+    explicit ring(int64_t c)
+        : capacity(c), mask(c - 1), slots(std::make_unique<std::atomic<T>[]>(
+                                        static_cast<std::size_t>(c))) {}
+
+    void put(int64_t i, T value) noexcept {
+      slots[static_cast<std::size_t>(i & mask)].store(value, std::memory_order_relaxed);
+    }
+    T get(int64_t i) const noexcept {
+      return slots[static_cast<std::size_t>(i & mask)].load(std::memory_order_relaxed);
+    }
+
+    int64_t                           capacity;
+    int64_t                           mask;
+    std::unique_ptr<std::atomic<T>[]> slots;
+  };
+
+  ring *grow(ring *old, int64_t top, int64_t bottom) {
+    auto bigger = std::make_unique<ring>(old->capacity * 2);
+    for (int64_t i = top; i < bottom; ++i)
+      bigger->put(i, old->get(i));
+    ring *r = bigger.get();
+    rings_.push_back(std::move(bigger));
+    ring_.store(r, std::memory_order_release);
+    return r;
+  }
+
+  // top_ is written by thieves and bottom_ by the owner; apart, they do not
+  // bounce one cache line between them on every push.
+  alignas(64) std::atomic<int64_t>   top_{0};
+  alignas(64) std::atomic<int64_t>   bottom_{0};
+  std::atomic<ring *>                ring_{nullptr};
+  std::vector<std::unique_ptr<ring>> rings_; // Owner only.
+};
+
+} // namespace engine::jobs
@@ -0,0 +1,548 @@
+#pragma once
+
+#include <algorithm>   /* std::min, std::max */
+#include <array>       /* per-priority queues */
+#include <atomic>      /* counters, epoch */
+#include <cstddef>     /* std::size_t */
+#include <cstdint>     /* uint32_t */
+#include <deque>       /* locked queues */
+#include <functional>  /* std::move_only_function */
+#include <memory>      /* std::unique_ptr for workers */
+#include <mutex>       /* locked queues */
+#include <thread>      /* std::jthread, yield */
+#include <utility>     /* std::forward */
+#include <vector>      /* workers, CPU lists */
+
+#if defined(__linux__)
+#include <pthread.h> /* pthread_setaffinity_np */
+#include <sched.h>   /* cpu_set_t */
+#endif
+
+#include "chase_lev_deque.hpp"
+
+namespace engine::jobs {
+
+// Jobs of a higher priority are taken before any of a lower one, by every
+// thread looking for work. Running jobs are never interrupted, so the
+// latency a high job sees is that of the longest job already running.
+enum class priority : uint8_t {
+  high,   // The acquisition path: per-frame work that must keep up.
+  normal, // Interactive processing.
+  low,    // Background work: exports, reprocessing, cache writes.
+};
+
+inline constexpr size_t priority_count = 3;
+
+// No worker preference.
+inline constexpr uint32_t any_worker = UINT32_MAX;
+
+struct job_options {
+  jobs::priority priority = priority::normal;
+  // A hint: the job is queued for this worker, which takes it before any
+  // other work of its priority. Another thread takes it only if it has
+  // found nothing else to do after a round of spinning, so a hint never
+  // leaves a job stranded behind a busy worker.
+  uint32_t worker = any_worker;
+};
+
+struct job_system_options {
+  // 0: hardware_concurrency() - 1, at least one. The thread that waits on
+  // a task group works too, so the default fills every core.
+  uint32_t threads = 0;
+  // Worker i is pinned to cpus[i % cpus.size()]; empty leaves the
+  // scheduler to place them. Linux only.
+  std::vector<int> cpus{};
+  // Called on each worker as it starts, e.g. to name its profiler track
+  // or raise its priority.
+  std::function<void(uint32_t worker)> on_start{};
+};
+
+// A tile of a 2D index space: [x, x + width) x [y, y + height).
+struct tile {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+class job_system;
+
+/*========================================================================================
+ *  task_group
+ *  -----------------------------------------------------------------------
+ *  •  Fork/join: run() forks jobs, wait() joins them. Jobs may run further
+ *     jobs into the same or other groups, to any depth.
+ *  •  wait() does not block while there is work anywhere in the system: it
+ *     runs jobs, its own or any other's, until the group is done, so a
+ *     worker waiting on nested jobs neither idles a core nor deadlocks.
+ *  •  A thread outside the workers, such as the UI thread in
+ *     parallel_for(), only runs jobs as urgent as its group's least
+ *     urgent one: it must not end up behind a low-priority export strip
+ *     while its own work is done.
+ *  •  Jobs must not throw.
+ *=======================================================================================*/
+class task_group {
+public:
+  explicit task_group(job_system &system) noexcept : system_(system) {}
+  ~task_group() { wait(); }
+
+  task_group(const task_group &) = delete;
+  task_group &operator=(const task_group &) = delete;
+
+  template <typename F> void run(F &&fn, job_options options = {});
+
+  void wait();
+
+  [[nodiscard]] bool done() const noexcept {
+    return pending_.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  friend class job_system;
+
+  job_system           &system_;
+  std::atomic<uint32_t> pending_{0};
+  std::atomic<uint8_t>  lowest_{0}; // The least urgent priority run into it.
+};
+
+/*========================================================================================
+ *  job_system
+ *  -----------------------------------------------------------------------
+ *  •  Fixed set of workers, one Chase-Lev deque per worker and priority.
+ *     Jobs forked on a worker go to its own deque and run LIFO, hot in
+ *     its cache; idle workers steal the oldest (largest) ones. Jobs from
+ *     other threads, and jobs with a worker hint, go through small locked
+ *     queues instead.
+ *  •  Idle workers spin briefly, then sleep on one futex. Forking costs a
+ *     fence and a load while no one sleeps; only waking pays a syscall.
+ *  •  parallel_for() splits lazily in halves, so a range is cut only as
+ *     far as there are thieves to take the pieces.
+ *=======================================================================================*/
+class job_system {
+public:
+  explicit job_system(job_system_options options = {}) {
+    uint32_t threads = options.threads;
+    if (threads == 0)
+      threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    workers_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+      workers_.push_back(std::make_unique<worker>());
+    // Every worker's deques must exist before any of them steals.
+    threads_.reserve(threads);
+    for (uint32_t i = 0; i < threads; ++i)
+      threads_.emplace_back([this, i, cpus = options.cpus, on_start = options.on_start] {
+        if (!cpus.empty())
+          pin_current_thread(cpus[i % cpus.size()]);
+        if (on_start)
+          on_start(i);
+        worker_loop(i);
+      });
+  }
+
+  ~job_system() {
+    stopping_.store(true, std::memory_order_seq_cst);
+    wake(true);
+    threads_.clear();
+    // Jobs left behind belong to groups nobody waited on; their owners
+    // are gone, so they are dropped unrun.
+    for (auto &w : workers_) {
+      for (auto &d : w->deques)
+        while (auto j = d.pop())
+          delete *j;
+      w->inbox.clear();
+    }
+    injected_.clear();
+  }
+
+  job_system(const job_system &) = delete;
+  job_system &operator=(const job_system &) = delete;
+
+  [[nodiscard]] uint32_t size() const noexcept {
+    return static_cast<uint32_t>(workers_.size());
+  }
+
+  // The calling thread's worker index in this system, or any_worker.
+  [[nodiscard]] uint32_t current_worker() const noexcept {
+    return current_.system == this ? current_.index : any_worker;
+  }
+
+  // Runs a and b, possibly in parallel, and returns when both are done.
+  template <typename A, typename B>
+  void join(A &&a, B &&b, jobs::priority priority = priority::normal) {
+    task_group group(*this);
+    group.run([&b] { b(); }, {.priority = priority});
+    a();
+    group.wait();
+  }
+
+  // Runs body(begin, end) over [first, last) in pieces of at least grain
+  // items (0: about eight pieces per thread), and returns once all have.
+  template <typename F>
+  void parallel_for(size_t first, size_t last, size_t grain, F &&body,
+                    jobs::priority priority = priority::normal) {
+    if (first >= last)
+      return;
+    if (grain == 0)
+      grain = std::max<size_t>(1, (last - first) / (8 * (size_t{size()} + 1)));
+    task_group group(*this);
+    split_range(group, first, last, grain, body, priority);
+    group.wait();
+  }
+
+  // Runs body(const tile &) over every tile_width x tile_height tile of a
+  // width x height space (edge tiles are cut short), and returns once all
+  // have. The grid is halved along its longer side, so the tiles a thread
+  // runs in a row, and those a thief takes, stay close together.
+  template <typename F>
+  void parallel_for(uint32_t width, uint32_t height, uint32_t tile_width,
+                    uint32_t tile_height, F &&body,
+                    jobs::priority priority = priority::normal) {
+    if (width == 0 || height == 0)
+      return;
+    tile_width = std::max(tile_width, 1u);
+    tile_height = std::max(tile_height, 1u);
+    const grid g{width, height, tile_width, tile_height};
+    task_group group(*this);
+    split_grid(group, g, 0, (width + tile_width - 1) / tile_width, 0,
+               (height + tile_height - 1) / tile_height, body, priority);
+    group.wait();
+  }
+
+private:
+  friend class task_group;
+
+  struct job {
+    std::move_only_function<void()> fn;
+    task_group                     *group;
+  };
+
+  // For work from outside the workers and for hinted work: rare enough
+  // that a lock does not matter, but checked on every search, so emptiness
+  // is tested without it.
+  class locked_queue {
+  public:
+    void push(job *j, jobs::priority p) {
+      std::lock_guard lock(mutex_);
+      queues_[static_cast<size_t>(p)].push_back(j);
+      size_.fetch_add(1, std::memory_order_release);
+    }
+
+    job *pop(jobs::priority p) {
+      if (size_.load(std::memory_order_acquire) == 0)
+        return nullptr;
+      std::lock_guard lock(mutex_);
+      auto           &q = queues_[static_cast<size_t>(p)];
+      if (q.empty())
+        return nullptr;
+      job *j = q.front();
+      q.pop_front();
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return j;
+    }
+
+    void clear() {
+      std::lock_guard lock(mutex_);
+      for (auto &q : queues_) {
+        for (job *j : q)
+          delete j;
+        q.clear();
+      }
+      size_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::mutex                                    mutex_;
+    std::array<std::deque<job *>, priority_count> queues_;
+    std::atomic<size_t>                           size_{0};
+  };
+
+  struct worker {
+    std::array<chase_lev_deque<job *>, priority_count> deques;
+    locked_queue                                       inbox;
+  };
+
+  struct grid {
+    uint32_t width, height, tile_width, tile_height;
+  };
+
+  struct thread_identity {
+    const job_system *system = nullptr;
+    uint32_t          index = any_worker;
+    uint32_t          victim = 0; // Where the next search starts stealing.
+    uint32_t          depth = 0;  // Jobs running on this thread's stack.
+  };
+
+  static thread_local thread_identity current_;
+
+  // Spin rounds an idle thread makes before it goes to sleep.
+  static constexpr int spin_rounds = 64;
+  // Jobs a waiting thread may nest on its stack. Each wait() that runs
+  // someone else's job can itself wait and take another, so past this a
+  // waiter runs only its own group's jobs and otherwise blocks.
+  static constexpr uint32_t max_depth = 32;
+
+  static void pin_current_thread([[maybe_unused]] int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+      return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+  }
+
+  void submit(task_group &group, std::move_only_function<void()> fn,
+              job_options options) {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    const auto level = static_cast<uint8_t>(options.priority);
+    for (uint8_t seen = group.lowest_.load(std::memory_order_relaxed);
+         seen < level &&
+         !group.lowest_.compare_exchange_weak(seen, level, std::memory_order_relaxed);)
+      ;
+    job *j = new job{std::move(fn), &group};
+
+    const uint32_t self = current_worker();
+    if (options.worker != any_worker && options.worker < size() &&
+        options.worker != self) {
+      workers_[options.worker]->inbox.push(j, options.priority);
+      // Only the hinted worker will take it for now; make sure it is up.
+      wake(true);
+      return;
+    }
+    if (self != any_worker)
+      workers_[self]->deques[static_cast<size_t>(options.priority)].push(j);
+    else
+      injected_.push(j, options.priority);
+    wake(false);
+  }
+
+  // Called after publishing work or finishing a group. Pairs with the
+  // sleepers_ increment in idle(): either the sleeper's last search sees
+  // the work, or this sees the sleeper and moves the epoch it waits on.
+  void wake(bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) == 0)
+      return;
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (all)
+      epoch_.notify_all();
+    else
+      epoch_.notify_one();
+  }
+
+  // Jobs down to lowest, most urgent first.
+  job *find(uint32_t self, bool foreign_inboxes,
+            jobs::priority lowest = priority::low) {
+    const uint32_t n = size();
+    for (size_t p = 0; p <= static_cast<size_t>(lowest); ++p) {
+      const auto level = static_cast<jobs::priority>(p);
+      if (self != any_worker) {
+        if (job *j = workers_[self]->inbox.pop(level))
+          return j;
+        if (auto j = workers_[self]->deques[p].pop())
+          return *j;
+      }
+      if (job *j = injected_.pop(level))
+        return j;
+      // Start at a different victim each time so thieves spread out.
+      const uint32_t start = n ? current_.victim++ % n : 0;
+      for (uint32_t k = 0; k < n; ++k) {
+        const uint32_t victim = (start + k) % n;
+        if (victim == self)
+          continue;
+        if (auto j = workers_[victim]->deques[p].steal())
+          return *j;
+      }
+      if (foreign_inboxes)
+        for (uint32_t victim = 0; victim < n; ++victim)
+          if (victim != self)
+            if (job *j = workers_[victim]->inbox.pop(level))
+              return j;
+    }
+    return nullptr;
+  }
+
+  void execute(job *j) {
+    ++current_.depth;
+    j->fn();
+    --current_.depth;
+    task_group &group = *j->group;
+    delete j;
+    // The waiter may destroy the group as soon as pending_ reaches zero.
+    // Like std::latch, the notify only hands the address to the kernel,
+    // which does not mind if it has gone.
+    if (group.pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      group.pending_.notify_all();
+      wake(true);
+    }
+  }
+
+  void wait(task_group &group) {
+    const uint32_t self = current_worker();
+    if (self == any_worker) {
+      wait_outside(group);
+      return;
+    }
+    if (current_.depth < max_depth) {
+      work_until(self, [&group] { return group.done(); });
+      return;
+    }
+    // The group's own jobs forked from here sit at the bottom of this
+    // worker's deque, above anything older.
+    while (true) {
+      const uint32_t pending = group.pending_.load(std::memory_order_acquire);
+      if (pending == 0)
+        return;
+      if (job *j = pop_own(self, group)) {
+        execute(j);
+        continue;
+      }
+      group.pending_.wait(pending, std::memory_order_acquire);
+    }
+  }
+
+  // A thread outside the workers runs jobs down to its group's lowest
+  // priority, then sleeps on the group rather than on epoch_: a wake meant
+  // for a worker must not land on a thread that may refuse the job.
+  void wait_outside(task_group &group) {
+    while (true) {
+      job *j = nullptr;
+      if (current_.depth < max_depth) {
+        const auto lowest = static_cast<jobs::priority>(
+            group.lowest_.load(std::memory_order_relaxed));
+        for (int round = 0; round < spin_rounds && !group.done(); ++round) {
+          if ((j = find(any_worker, false, lowest)))
+            break;
+          std::this_thread::yield();
+        }
+        if (!j && !group.done())
+          j = find(any_worker, true, lowest);
+      }
+      if (j) {
+        execute(j);
+        continue;
+      }
+      const uint32_t pending = group.pending_.load(std::memory_order_acquire);
+      if (pending == 0)
+        return;
+      group.pending_.wait(pending, std::memory_order_acquire);
+    }
+  }
+
+  job *pop_own(uint32_t self, const task_group &group) {
+    for (auto &deque : workers_[self]->deques)
+      if (auto j = deque.pop()) {
+        if ((*j)->group == &group)
+          return *j;
+        deque.push(*j);
+      }
+    return nullptr;
+  }
+
+  // Runs jobs until done() returns true, sleeping when there are none.
+  template <typename Done> void work_until(uint32_t self, Done done) {
+    while (!done()) {
+      if (job *j = find(self, false)) {
+        execute(j);
+        continue;
+      }
+      bool found = false;
+      for (int round = 0; round < spin_rounds && !done(); ++round) {
+        if (job *j = find(self, false)) {
+          execute(j);
+          found = true;
+          break;
+        }
+        std::this_thread::yield();
+      }
+      if (found)
+        continue;
+
+      const uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (done()) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+      if (job *j = find(self, true)) {
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        execute(j);
+        continue;
+      }
+      epoch_.wait(epoch, std::memory_order_seq_cst);
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void worker_loop(uint32_t index) {
+    current_ = {this, index, index};
+    work_until(index, [this] { return stopping_.load(std::memory_order_seq_cst); });
+  }
+
+  template <typename F>
+  void split_range(task_group &group, size_t first, size_t last, size_t grain,
+                   F &body, jobs::priority priority) {
+    while (last - first > grain) {
+      const size_t middle = first + (last - first) / 2;
+      group.run(
+          [this, &group, middle, last, grain, &body, priority] {
+            split_range(group, middle, last, grain, body, priority);
+          },
+          {.priority = priority});
+      last = middle;
+    }
+    body(first, last);
+  }
+
+  // Tiles [tx0, tx1) x [ty0, ty1) of the grid.
+  template <typename F>
+  void split_grid(task_group &group, const grid &g, uint32_t tx0, uint32_t tx1,
+                  uint32_t ty0, uint32_t ty1, F &body, jobs::priority priority) {
+    while (tx1 - tx0 > 1 || ty1 - ty0 > 1) {
+      if (tx1 - tx0 >= ty1 - ty0) {
+        const uint32_t middle = tx0 + (tx1 - tx0) / 2;
+        group.run(
+            [this, &group, g, middle, tx1, ty0, ty1, &body, priority] {
+              split_grid(group, g, middle, tx1, ty0, ty1, body, priority);
+            },
+            {.priority = priority});
+        tx1 = middle;
+      } else {
+        const uint32_t middle = ty0 + (ty1 - ty0) / 2;
+        group.run(
+            [this, &group, g, tx0, tx1, middle, ty1, &body, priority] {
+              split_grid(group, g, tx0, tx1, middle, ty1, body, priority);
+            },
+            {.priority = priority});
+        ty1 = middle;
+      }
+    }
+    const uint32_t x = tx0 * g.tile_width, y = ty0 * g.tile_height;
+    body(tile{.x = x,
+              .y = y,
+              .width = std::min(g.tile_width, g.width - x),
+              .height = std::min(g.tile_height, g.height - y)});
+  }
+
+  std::vector<std::unique_ptr<worker>> workers_;
+  locked_queue                         injected_;
+  alignas(64) std::atomic<uint32_t>    epoch_{0};
+  alignas(64) std::atomic<uint32_t>    sleepers_{0};
+  std::atomic<bool>                    stopping_{false};
+  std::vector<std::jthread>            threads_; // Last: joined first.
+};
+
+inline thread_local job_system::thread_identity job_system::current_{};
+
+template <typename F> void task_group::run(F &&fn, job_options options) {
+  system_.submit(*this, std::move_only_function<void()>(std::forward<F>(fn)), options);
+}
+
+inline void task_group::wait() {
+  system_.wait(*this);
+}
+
+} // namespace engine::jobs
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>    /* std::byte */
+#include <filesystem> /* std::filesystem::path for the cache location */
+#include <memory>     /* std::shared_ptr for device */
+#include <span>       /* std::span */
+#include <vector>     /* std::vector */
+
+#include <vulkan/vulkan.hpp>
+
+#include <device.hpp>
+#include <gpu.hpp>
+
+namespace engine {
+
+// A VkPipelineCache persisted to disk. Files are keyed by the device UUID and
+// driver version so a driver update or a different GPU starts from scratch
+// instead of feeding the driver a blob it will reject anyway.
+class pipeline_cache {
+public:
+  // Reads the blob saved for gpu, or returns an empty vector if there is none
+  // or it does not match the device. Needs no vk::Device, so it can run while
+  // the device is being created.
+  [[nodiscard]]
+  static std::vector<std::byte> load_blob(const gpu                   &gpu,
+                                          const std::filesystem::path &dir);
+
+  [[nodiscard]]
+  static std::filesystem::path file_path(const gpu                   &gpu,
+                                         const std::filesystem::path &dir);
+
+  pipeline_cache(std::shared_ptr<device> dev, std::filesystem::path dir,
+                 std::span<const std::byte> initial_data = {});
+
+  // Saves the cache.
+  ~pipeline_cache();
+
+  pipeline_cache(const pipeline_cache &) = delete;
+  pipeline_cache &operator=(const pipeline_cache &) = delete;
+
+  vk::PipelineCache handle() const noexcept { return *handle_; }
+
+  // Writes the current contents to disk via a temporary file and a rename, so
+  // a crash mid-write never leaves a torn cache behind. Returns false on I/O
+  // failure.
+  bool save() const;
+
+private:
+  vk::UniquePipelineCache handle_;
+  std::shared_ptr<device> device_;
+  std::filesystem::path   path_;
+};
+
+} // namespace engine
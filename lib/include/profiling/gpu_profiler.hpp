@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint> /* uint32_t, uint64_t */
+#include <memory>  /* std::shared_ptr for device */
+#include <vector>  /* std::vector */
+
+#include <vulkan/vulkan.hpp>
+
+#include <device.hpp>
+#include <profiling/profiler.hpp>
+
+namespace engine::profiling {
+
+/*========================================================================================
+ *  gpu_profiler
+ *  -----------------------------------------------------------------------
+ *  •  One timestamp query range per frame slot. Results of a slot are read
+ *     back without waiting the next time that slot is begun, by which point
+ *     the caller has already waited for the frame's work to finish.
+ *  •  Resolved regions are pushed to profiler::get() on their own track.
+ *     GPU times are anchored to the CPU clock at the moment the frame was
+ *     begun, so the GPU track is offset from the CPU tracks by the submit
+ *     latency.
+ *  •  Not thread-safe; use from the thread that records the command buffers.
+ *=======================================================================================*/
+class gpu_profiler {
+public:
+  gpu_profiler(std::shared_ptr<device> dev, uint32_t queue_family_index,
+               const char *track_name, uint32_t frame_slots = 8,
+               uint32_t max_regions_per_frame = 64);
+
+  gpu_profiler(const gpu_profiler &) = delete;
+  gpu_profiler &operator=(const gpu_profiler &) = delete;
+
+  // Resolves the previous use of slot and resets its queries. Must be recorded
+  // outside of a render pass, before any region of the frame.
+  void begin_frame(vk::CommandBuffer cmd, uint32_t slot);
+
+  // Returns a region index for end_region, or no_region when profiling is
+  // disabled or the frame is out of queries.
+  [[nodiscard]]
+  uint32_t begin_region(vk::CommandBuffer cmd, const char *name);
+  void     end_region(vk::CommandBuffer cmd, uint32_t region);
+
+  // Resolves every outstanding slot. Only valid once all recorded work has
+  // completed, e.g. after the queue has been waited idle.
+  void resolve_all();
+
+  static constexpr uint32_t no_region = ~0u;
+
+private:
+  struct frame_slot {
+    std::vector<const char *> names;
+    std::vector<uint32_t>     depths;
+    uint64_t                  cpu_anchor_ns = 0;
+    bool                      pending = false;
+  };
+
+  void resolve(uint32_t slot);
+
+  std::shared_ptr<device> device_;
+  vk::UniqueQueryPool     pool_;
+  double                  ns_per_tick_;
+  uint64_t                valid_mask_;
+  uint32_t                track_;
+  uint32_t                max_regions_;
+  uint32_t                current_slot_ = 0;
+  uint32_t                depth_ = 0;
+  bool                    supported_;
+
+  std::vector<frame_slot>  slots_;
+  std::vector<scope_event> resolved_;
+};
+
+// RAII region; compiles to nothing with ENGINE_PROFILING_DISABLED via
+// ENGINE_PROFILE_GPU_SCOPE.
+class gpu_scope {
+public:
+  gpu_scope(gpu_profiler &profiler, vk::CommandBuffer cmd, const char *name)
+      : profiler_(profiler), cmd_(cmd),
+        region_(profiler.begin_region(cmd, name)) {}
+
+  ~gpu_scope() { profiler_.end_region(cmd_, region_); }
+
+  gpu_scope(const gpu_scope &) = delete;
+  gpu_scope &operator=(const gpu_scope &) = delete;
+
+private:
+  gpu_profiler     &profiler_;
+  vk::CommandBuffer cmd_;
+  uint32_t          region_;
+};
+
+} // namespace engine::profiling
+
+#ifdef ENGINE_PROFILING_DISABLED
+#define ENGINE_PROFILE_GPU_SCOPE(profiler, cmd, name) ((void)0)
+#else
+#define ENGINE_PROFILE_GPU_SCOPE(profiler, cmd, name)                          \
+  ::engine::profiling::gpu_scope ENGINE_PROFILE_CONCAT(gpu_profile_scope_,     \
+                                                       __LINE__) {             \
+    profiler, cmd, name                                                        \
+  }
+#endif
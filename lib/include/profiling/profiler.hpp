@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>      /* std::atomic for the enabled flag and ring indices */
+#include <chrono>      /* std::chrono::steady_clock for timestamps */
+#include <cstdint>     /* uint64_t */
+#include <memory>      /* std::unique_ptr for per-thread buffers */
+#include <mutex>       /* std::mutex for thread registration */
+#include <ostream>     /* std::ostream for trace export */
+#include <span>        /* std::span */
+#include <string>      /* std::string for track names */
+#include <string_view> /* std::string_view */
+#include <vector>      /* std::vector */
+
+namespace engine::profiling {
+
+// One completed scope. Names must have static storage duration; only the
+// pointer is recorded.
+struct scope_event {
+  const char *name;
+  uint64_t    start_ns;
+  uint64_t    end_ns;
+  uint32_t    track;
+  uint32_t    depth;
+};
+
+struct track_info {
+  uint32_t    id;
+  std::string name;
+};
+
+/*========================================================================================
+ *  profiler
+ *  -----------------------------------------------------------------------
+ *  •  Every thread that records gets its own single-producer ring buffer, so
+ *     recording a scope never takes a lock or touches another thread's cache
+ *     lines.
+ *  •  Rings are allocated on a thread's first event while enabled, so
+ *     naming a thread costs no ring; an exited thread's ring is reused by
+ *     the next thread once collect() has drained it.
+ *  •  One collector (normally the UI thread) drains all rings with collect().
+ *  •  When disabled, a scope costs one relaxed load.
+ *=======================================================================================*/
+class profiler {
+public:
+  static constexpr size_t ring_capacity = 1u << 14;
+
+  [[nodiscard]]
+  static profiler &get() noexcept;
+
+  [[nodiscard]]
+  static uint64_t now_ns() noexcept {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  [[nodiscard]]
+  bool enabled() const noexcept {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  void set_enabled(bool enabled) noexcept {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Names the calling thread's track. Registers the thread if needed.
+  void set_thread_name(std::string_view name);
+
+  // Adds a track that is not tied to a CPU thread, e.g. a GPU queue. Events for
+  // it are pushed with submit().
+  [[nodiscard]]
+  uint32_t register_track(std::string_view name);
+
+  // Records an event on the calling thread's ring. Drops (and counts) the event
+  // if the collector has fallen a full ring behind.
+  void record(const char *name, uint64_t start_ns, uint64_t end_ns,
+              uint32_t depth) noexcept;
+
+  // Records an event on a track registered with register_track. Takes a lock;
+  // meant for low-rate producers such as resolved GPU queries.
+  void submit(std::span<const scope_event> events);
+
+  // Moves every buffered event into out. Single consumer.
+  void collect(std::vector<scope_event> &out);
+
+  [[nodiscard]]
+  std::vector<track_info> tracks() const;
+
+  [[nodiscard]]
+  uint64_t dropped_events() const noexcept {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct thread_buffer;
+  struct thread_state;
+
+  profiler() = default;
+
+  static thread_state &local_state() noexcept;
+  uint32_t             local_track();
+  thread_buffer       &local_buffer();
+  void                 retire(thread_buffer &buffer);
+
+  std::atomic<bool>     enabled_{false};
+  std::atomic<uint64_t> dropped_{0};
+
+  mutable std::mutex                          registry_mutex_;
+  std::vector<std::unique_ptr<thread_buffer>> buffers_;
+  std::vector<thread_buffer *>                free_buffers_; // Drained, unowned.
+  std::vector<track_info>                     tracks_;
+  std::vector<scope_event>                    submitted_;
+};
+
+// RAII CPU scope. Prefer ENGINE_PROFILE_SCOPE so it compiles out entirely when
+// ENGINE_PROFILING_DISABLED is defined.
+class scope {
+public:
+  explicit scope(const char *name) noexcept {
+    if (profiler::get().enabled()) {
+      name_ = name;
+      depth_ = depth_counter()++;
+      start_ns_ = profiler::now_ns();
+    }
+  }
+
+  ~scope() {
+    if (name_) {
+      --depth_counter();
+      profiler::get().record(name_, start_ns_, profiler::now_ns(), depth_);
+    }
+  }
+
+  scope(const scope &) = delete;
+  scope &operator=(const scope &) = delete;
+
+private:
+  static uint32_t &depth_counter() noexcept {
+    thread_local uint32_t depth = 0;
+    return depth;
+  }
+
+  const char *name_ = nullptr;
+  uint64_t    start_ns_ = 0;
+  uint32_t    depth_ = 0;
+};
+
+// Writes events in the Chrome trace event format (chrome://tracing, Perfetto).
+void write_chrome_trace(std::ostream &os, std::span<const scope_event> events,
+                        std::span<const track_info> tracks);
+
+} // namespace engine::profiling
+
+#define ENGINE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ENGINE_PROFILE_CONCAT(a, b) ENGINE_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef ENGINE_PROFILING_DISABLED
+#define ENGINE_PROFILE_SCOPE(name) ((void)0)
+#else
+#define ENGINE_PROFILE_SCOPE(name)                                             \
+  ::engine::profiling::scope ENGINE_PROFILE_CONCAT(profile_scope_,             \
+                                                   __LINE__) {                 \
+    name                                                                       \
+  }
+#endif
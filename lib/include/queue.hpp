@@ -3,28 +3,133 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
-#include <memory> /* std::shared_ptr for device */
+#include <atomic>             /* std::atomic for error and timeline state */
+#include <chrono>             /* std::chrono::nanoseconds for timeouts */
+#include <condition_variable> /* std::condition_variable_any */
+#include <expected>           /* std::expected */
+#include <future>             /* std::future for present results */
+#include <memory>             /* std::shared_ptr for device */
+#include <mutex>              /* std::mutex */
+#include <thread>             /* std::jthread for the submit thread */
+#include <variant>            /* std::variant for pending operations */
+#include <vector>             /* std::vector */
 
 #include <device.hpp>
 
 namespace engine {
 
+// A unit of GPU work handed to queue::submit. Every submission additionally
+// signals the queue's timeline semaphore with the value returned by submit.
+struct queue_submission {
+  std::vector<vk::SemaphoreSubmitInfo>     wait_semaphores;
+  std::vector<vk::CommandBufferSubmitInfo> command_buffers;
+  std::vector<vk::SemaphoreSubmitInfo>     signal_semaphores;
+};
+
 class queue {
 public:
   queue(std::shared_ptr<device> dev, const vk::DeviceQueueInfo2 &queue_info);
+  ~queue();
+
+  queue(const queue &) = delete;
+  queue &operator=(const queue &) = delete;
+  queue(queue &&) = delete;
+  queue &operator=(queue &&) = delete;
 
+  // Raw handle. Any direct use must hold lock_handle() since the submit thread
+  // owns the queue between flushes.
   vk::Queue handle() const noexcept { return handle_; }
 
   const vk::QueueFamilyProperties &queue_family_properties() const noexcept;
   uint32_t queue_family_index() const noexcept { return queue_family_index_; }
   uint32_t queue_index() const noexcept { return queue_index_; }
 
+  // Thread-safe. Queues the submission for the submit thread, which batches
+  // everything pending into one vkQueueSubmit2. Returns the timeline value
+  // that is signalled once the work completes.
+  [[nodiscard]]
+  uint64_t submit(queue_submission submission);
+
+  // Thread-safe. Presents after every submission queued before it.
+  [[nodiscard]]
+  std::future<vk::Result> present(vk::SwapchainKHR swapchain,
+                                  uint32_t image_index, vk::Semaphore wait);
+
+  [[nodiscard]]
+  std::expected<void, vk::Result> wait(uint64_t                 value,
+                                       std::chrono::nanoseconds timeout) const;
+
+  [[nodiscard]]
+  uint64_t completed_value() const;
+
+  [[nodiscard]]
+  uint64_t last_submitted_value() const noexcept {
+    return next_value_.load(std::memory_order_acquire) - 1;
+  }
+
+  [[nodiscard]]
+  vk::Semaphore timeline() const noexcept {
+    return *timeline_;
+  }
+
+  // Convenience for making another submission wait on work from this queue.
+  [[nodiscard]]
+  vk::SemaphoreSubmitInfo wait_info(uint64_t                value,
+                                    vk::PipelineStageFlags2 stages) const {
+    return vk::SemaphoreSubmitInfo()
+        .setSemaphore(*timeline_)
+        .setValue(value)
+        .setStageMask(stages);
+  }
+
+  // Blocks until every queued operation has been handed to the driver and the
+  // queue is idle.
+  void wait_idle();
+
+  // External synchronisation for code that must touch the raw handle (e.g.
+  // ImGui's multi-viewport renderer).
+  [[nodiscard]]
+  std::unique_lock<std::mutex> lock_handle() {
+    return std::unique_lock(handle_mutex_);
+  }
+
 private:
+  struct pending_submit {
+    queue_submission submission;
+    uint64_t         value;
+  };
+
+  struct pending_present {
+    vk::SwapchainKHR        swapchain;
+    uint32_t                image_index;
+    vk::Semaphore           wait;
+    std::promise<vk::Result> result;
+  };
+
+  using pending_op = std::variant<pending_submit, pending_present>;
+
+  void submit_thread_main(std::stop_token stop);
+  void flush(std::vector<pending_submit *> &batch);
+
   vk::Queue                  handle_;
   std::shared_ptr<device>    device_;
   vk::DeviceQueueCreateFlags queue_create_flags_;
   uint32_t                   queue_family_index_;
   uint32_t                   queue_index_; // Index within family
+
+  vk::UniqueSemaphore     timeline_;
+  std::atomic<uint64_t>   next_value_{1};
+  std::atomic<vk::Result> error_{vk::Result::eSuccess};
+
+  std::mutex handle_mutex_;
+
+  std::mutex                  pending_mutex_;
+  std::condition_variable_any pending_cv_;
+  std::condition_variable     idle_cv_;
+  std::vector<pending_op>     pending_;
+  bool                        busy_ = false;
+
+  std::jthread submit_thread_;
 };
 
-} // namespace engine
\ No newline at end of file
+} // namespace engine
@@ -2,11 +2,13 @@
 
 #include <chrono>   /* std::chrono::nanoseconds for timeout */
 #include <expected> /* std::expected */
+#include <future>   /* std::future for present results */
 #include <memory>   /* std::shared_ptr for vk handles */
 
 #include <vulkan/vulkan.hpp>
 
 #include <device.hpp>
+#include <queue.hpp>
 #include <swapchain/surface.hpp>
 
 namespace engine {
@@ -69,28 +71,13 @@ public:
     }
   }
 
+  // Presentation goes through the queue's submit thread so it is ordered after
+  // the submission that signals render_finished.
   [[nodiscard]]
-  std::expected<void, vk::Result> present(uint32_t      image_index,
-                                          vk::Semaphore render_finished,
-                                          vk::Queue     present_queue) const {
-    try {
-      auto present_info = vk::PresentInfoKHR()
-                              .setWaitSemaphores(render_finished)
-                              .setSwapchains(handle_.get())
-                              .setPImageIndices(&image_index);
-
-      auto res = present_queue.presentKHR(present_info);
-      if (res == vk::Result::eErrorOutOfDateKHR ||
-          res == vk::Result::eSuboptimalKHR)
-        return std::unexpected(res);
-      if (res != vk::Result::eSuccess)
-        return std::unexpected(res);
-      return {};
-    } catch (const vk::OutOfDateKHRError &) {
-      return std::unexpected(vk::Result::eErrorOutOfDateKHR);
-    } catch (const vk::SystemError &e) {
-      return std::unexpected(static_cast<vk::Result>(e.code().value()));
-    }
+  std::future<vk::Result> present(uint32_t      image_index,
+                                  vk::Semaphore render_finished,
+                                  queue        &present_queue) const {
+    return present_queue.present(*handle_, image_index, render_finished);
   }
 
   [[nodiscard]]
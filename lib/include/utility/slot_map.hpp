@@ -90,7 +90,7 @@ public:
 
   ~slot_map() {
     for (auto &s : slots_)
-      if (s.occupied)
+      if (id::is_occupied(s.generation))
         std::destroy_at(std::launder(reinterpret_cast<T *>(s.storage)));
   }
 
@@ -101,7 +101,7 @@ public:
     uint32_t idx;
 
     if (free_.empty()) {
-      assert(live_ >= MaxCapacity);
+      assert(live_ < MaxCapacity);
 
       idx = static_cast<uint32_t>(slots_.size());
       slots_.push_back(slot{});
@@ -137,12 +137,12 @@ public:
   [[nodiscard]]
   std::optional<T> remove(id handle) {
     auto slotp = get_impl<T>(handle);
-    if (slotp)
+    if (!slotp)
       return std::nullopt;
 
     // Safe: the slot is live and the pointer is valid.
     slot &s = slots_[handle.index()];
-    T     payload = s.payload();
+    T     payload = std::move(s.payload());
 
     std::destroy_at(slotp.value());
 
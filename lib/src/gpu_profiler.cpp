@@ -0,0 +1,122 @@
+#include <profiling/gpu_profiler.hpp>
+
+#include <algorithm> /* std::min */
+
+namespace engine::profiling {
+
+gpu_profiler::gpu_profiler(std::shared_ptr<device> dev,
+                           uint32_t queue_family_index, const char *track_name,
+                           uint32_t frame_slots, uint32_t max_regions_per_frame)
+    : device_(std::move(dev)), max_regions_(max_regions_per_frame),
+      slots_(frame_slots) {
+  const auto &gpu = *device_->physical_device();
+  const auto  valid_bits =
+      gpu.queue_family_properties[queue_family_index].timestampValidBits;
+
+  supported_ = valid_bits != 0;
+  valid_mask_ = valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << valid_bits) - 1;
+  ns_per_tick_ = gpu.properties.properties.limits.timestampPeriod;
+  track_ = profiler::get().register_track(track_name);
+
+  if (!supported_)
+    return;
+
+  pool_ = device_->handle().createQueryPoolUnique(
+      vk::QueryPoolCreateInfo()
+          .setQueryType(vk::QueryType::eTimestamp)
+          .setQueryCount(frame_slots * max_regions_per_frame * 2));
+}
+
+void gpu_profiler::begin_frame(vk::CommandBuffer cmd, uint32_t slot) {
+  current_slot_ = slot % static_cast<uint32_t>(slots_.size());
+  auto &s = slots_[current_slot_];
+
+  if (s.pending)
+    resolve(current_slot_);
+
+  s.names.clear();
+  s.depths.clear();
+  depth_ = 0;
+
+  if (!supported_ || !profiler::get().enabled())
+    return;
+
+  cmd.resetQueryPool(*pool_, current_slot_ * max_regions_ * 2,
+                     max_regions_ * 2);
+  s.cpu_anchor_ns = profiler::now_ns();
+  s.pending = true;
+}
+
+uint32_t gpu_profiler::begin_region(vk::CommandBuffer cmd, const char *name) {
+  auto &s = slots_[current_slot_];
+  if (!s.pending || s.names.size() >= max_regions_)
+    return no_region;
+
+  const auto region = static_cast<uint32_t>(s.names.size());
+  s.names.push_back(name);
+  s.depths.push_back(depth_++);
+
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *pool_,
+                      (current_slot_ * max_regions_ + region) * 2);
+  return region;
+}
+
+void gpu_profiler::end_region(vk::CommandBuffer cmd, uint32_t region) {
+  if (region == no_region)
+    return;
+
+  --depth_;
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *pool_,
+                      (current_slot_ * max_regions_ + region) * 2 + 1);
+}
+
+void gpu_profiler::resolve_all() {
+  for (uint32_t slot = 0; slot < slots_.size(); ++slot)
+    if (slots_[slot].pending)
+      resolve(slot);
+}
+
+void gpu_profiler::resolve(uint32_t slot) {
+  auto &s = slots_[slot];
+  s.pending = false;
+  if (s.names.empty())
+    return;
+
+  // [value, availability] per query.
+  const auto            query_count = static_cast<uint32_t>(s.names.size() * 2);
+  std::vector<uint64_t> data(query_count * 2);
+
+  const auto res = device_->handle().getQueryPoolResults(
+      *pool_, slot * max_regions_ * 2, query_count,
+      data.size() * sizeof(uint64_t), data.data(), 2 * sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64 |
+          vk::QueryResultFlagBits::eWithAvailability);
+  if (res != vk::Result::eSuccess && res != vk::Result::eNotReady)
+    return;
+
+  uint64_t base = ~uint64_t{0};
+  for (uint32_t q = 0; q < query_count; ++q)
+    if (data[q * 2 + 1])
+      base = std::min(base, data[q * 2] & valid_mask_);
+
+  resolved_.clear();
+  for (size_t r = 0; r < s.names.size(); ++r) {
+    const uint64_t *begin = &data[r * 4];
+    const uint64_t *end = &data[r * 4 + 2];
+    if (!begin[1] || !end[1])
+      continue; // Not available; drop rather than stall.
+
+    auto to_cpu = [&](uint64_t ticks) {
+      return s.cpu_anchor_ns +
+             static_cast<uint64_t>(
+                 static_cast<double>((ticks & valid_mask_) - base) *
+                 ns_per_tick_);
+    };
+    resolved_.push_back(scope_event{s.names[r], to_cpu(begin[0]),
+                                    to_cpu(end[0]), track_, s.depths[r]});
+  }
+
+  profiler::get().submit(resolved_);
+}
+
+} // namespace engine::profiling
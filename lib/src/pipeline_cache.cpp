@@ -0,0 +1,97 @@
+#include <pipeline_cache.hpp>
+
+#include <algorithm> /* std::ranges::equal */
+#include <cstring>   /* std::memcpy */
+#include <format>    /* std::format */
+#include <fstream>   /* std::ifstream, std::ofstream */
+
+namespace engine {
+
+namespace {
+
+// Matches VkPipelineCacheHeaderVersionOne; drivers reject blobs whose header
+// does not match the device, but checking up front avoids handing them
+// megabytes of data to parse first.
+bool header_matches(std::span<const std::byte> blob, const gpu &gpu) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (blob.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, blob.data(), sizeof(header));
+
+  const auto &props = gpu.properties.properties;
+  return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == props.vendorID &&
+         header.deviceID == props.deviceID &&
+         std::ranges::equal(header.pipelineCacheUUID, props.pipelineCacheUUID);
+}
+
+} // namespace
+
+std::filesystem::path
+pipeline_cache::file_path(const gpu &gpu, const std::filesystem::path &dir) {
+  std::string uuid;
+  for (auto b : gpu.id_properties.deviceUUID)
+    uuid += std::format("{:02x}", b);
+
+  return dir / std::format("pipeline_cache_{}_{:08x}.bin", uuid,
+                           gpu.properties.properties.driverVersion);
+}
+
+std::vector<std::byte>
+pipeline_cache::load_blob(const gpu &gpu, const std::filesystem::path &dir) {
+  std::ifstream file(file_path(gpu, dir), std::ios::binary | std::ios::ate);
+  if (!file)
+    return {};
+
+  std::vector<std::byte> blob(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char *>(blob.data()),
+                 static_cast<std::streamsize>(blob.size())))
+    return {};
+
+  if (!header_matches(blob, gpu))
+    return {};
+
+  return blob;
+}
+
+pipeline_cache::pipeline_cache(std::shared_ptr<device>    dev,
+                               std::filesystem::path      dir,
+                               std::span<const std::byte> initial_data)
+    : device_(std::move(dev)),
+      path_(file_path(*device_->physical_device(), dir)) {
+  handle_ = device_->handle().createPipelineCacheUnique(
+      vk::PipelineCacheCreateInfo()
+          .setInitialDataSize(initial_data.size())
+          .setPInitialData(initial_data.data()));
+}
+
+pipeline_cache::~pipeline_cache() { save(); }
+
+bool pipeline_cache::save() const {
+  std::vector<uint8_t> data;
+  try {
+    data = device_->handle().getPipelineCacheData(*handle_);
+  } catch (const vk::SystemError &) {
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(path_.parent_path(), ec);
+  if (ec)
+    return false;
+
+  auto tmp = path_;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char *>(data.data()),
+                    static_cast<std::streamsize>(data.size())))
+      return false;
+  }
+
+  std::filesystem::rename(tmp, path_, ec);
+  return !ec;
+}
+
+} // namespace engine
@@ -0,0 +1,182 @@
+#include <profiling/profiler.hpp>
+
+#include <algorithm> /* std::ranges::sort */
+#include <array>     /* std::array for the ring storage */
+#include <format>    /* std::format */
+#include <thread>    /* std::this_thread::get_id */
+
+namespace engine::profiling {
+
+struct profiler::thread_buffer {
+  uint32_t track;
+  // Its thread has exited; collect() drains it and frees it for reuse.
+  // Guarded by registry_mutex_.
+  bool retired = false;
+
+  // Single producer (the owning thread), single consumer (collect). Indices
+  // increase monotonically and are masked on access.
+  alignas(64) std::atomic<uint64_t> head{0}; // written by producer
+  alignas(64) std::atomic<uint64_t> tail{0}; // written by consumer
+  std::array<scope_event, ring_capacity> events;
+};
+
+namespace {
+constexpr uint32_t no_track = ~0u;
+}
+
+// The calling thread's track and ring. Its destructor runs as the thread
+// exits, after the thread's last event.
+struct profiler::thread_state {
+  uint32_t       track = no_track;
+  thread_buffer *buffer = nullptr;
+
+  ~thread_state() {
+    if (buffer)
+      profiler::get().retire(*buffer);
+  }
+};
+
+profiler &profiler::get() noexcept {
+  static profiler instance;
+  return instance;
+}
+
+profiler::thread_state &profiler::local_state() noexcept {
+  thread_local thread_state state;
+  return state;
+}
+
+uint32_t profiler::local_track() {
+  auto &state = local_state();
+  if (state.track != no_track)
+    return state.track;
+
+  std::scoped_lock lock(registry_mutex_);
+  state.track = static_cast<uint32_t>(tracks_.size());
+  tracks_.push_back(
+      {state.track, std::format("thread {}", std::hash<std::thread::id>{}(
+                                                 std::this_thread::get_id()))});
+  return state.track;
+}
+
+profiler::thread_buffer &profiler::local_buffer() {
+  auto &state = local_state();
+  if (state.buffer)
+    return *state.buffer;
+
+  const uint32_t   track = local_track();
+  std::scoped_lock lock(registry_mutex_);
+  if (free_buffers_.empty()) {
+    buffers_.push_back(std::make_unique<thread_buffer>());
+    free_buffers_.push_back(buffers_.back().get());
+  }
+  state.buffer = free_buffers_.back();
+  free_buffers_.pop_back();
+  state.buffer->track = track;
+  state.buffer->retired = false;
+  return *state.buffer;
+}
+
+void profiler::retire(thread_buffer &buffer) {
+  std::scoped_lock lock(registry_mutex_);
+  buffer.retired = true;
+}
+
+void profiler::set_thread_name(std::string_view name) {
+  const uint32_t track = local_track();
+
+  std::scoped_lock lock(registry_mutex_);
+  tracks_[track].name = name;
+}
+
+uint32_t profiler::register_track(std::string_view name) {
+  std::scoped_lock lock(registry_mutex_);
+  auto             track = static_cast<uint32_t>(tracks_.size());
+  tracks_.push_back({track, std::string(name)});
+  return track;
+}
+
+void profiler::record(const char *name, uint64_t start_ns, uint64_t end_ns,
+                      uint32_t depth) noexcept {
+  auto &buffer = local_buffer();
+
+  const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  if (head - buffer.tail.load(std::memory_order_acquire) >= ring_capacity) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  buffer.events[head & (ring_capacity - 1)] =
+      scope_event{name, start_ns, end_ns, buffer.track, depth};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void profiler::submit(std::span<const scope_event> events) {
+  std::scoped_lock lock(registry_mutex_);
+  submitted_.insert(submitted_.end(), events.begin(), events.end());
+}
+
+void profiler::collect(std::vector<scope_event> &out) {
+  std::scoped_lock lock(registry_mutex_);
+
+  for (auto &buffer : buffers_) {
+    uint64_t       tail = buffer->tail.load(std::memory_order_relaxed);
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail)
+      out.push_back(buffer->events[tail & (ring_capacity - 1)]);
+    buffer->tail.store(tail, std::memory_order_release);
+
+    // Its thread is gone, so nothing was written after the drain.
+    if (buffer->retired) {
+      buffer->retired = false;
+      free_buffers_.push_back(buffer.get());
+    }
+  }
+
+  out.insert(out.end(), submitted_.begin(), submitted_.end());
+  submitted_.clear();
+}
+
+std::vector<track_info> profiler::tracks() const {
+  std::scoped_lock lock(registry_mutex_);
+  return tracks_;
+}
+
+void write_chrome_trace(std::ostream &os, std::span<const scope_event> events,
+                        std::span<const track_info> tracks) {
+  auto escaped = [](std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+    return out;
+  };
+
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+  for (const auto &t : tracks) {
+    os << (first ? "" : ",")
+       << std::format("{{\"ph\":\"M\",\"pid\":1,\"tid\":{},\"name\":"
+                      "\"thread_name\",\"args\":{{\"name\":\"{}\"}}}}",
+                      t.id, escaped(t.name));
+    first = false;
+  }
+
+  // Chrome traces use microseconds; keep sub-microsecond precision.
+  for (const auto &e : events) {
+    os << (first ? "" : ",")
+       << std::format("{{\"ph\":\"X\",\"pid\":1,\"tid\":{},\"name\":\"{}\","
+                      "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                      e.track, escaped(e.name), e.start_ns / 1000.0,
+                      (e.end_ns - e.start_ns) / 1000.0);
+    first = false;
+  }
+
+  os << "]}\n";
+}
+
+} // namespace engine::profiling
@@ -1,3 +1,4 @@
+#include <profiling/profiler.hpp>
 #include <queue.hpp>
 
 namespace engine {
@@ -8,6 +9,25 @@ queue::queue(std::shared_ptr<device>     dev,
       queue_family_index_(queue_info.queueFamilyIndex),
       queue_index_(queue_info.queueIndex) {
   handle_ = device_->handle().getQueue2(queue_info);
+
+  vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo>
+      timeline_chain;
+  timeline_chain.get<vk::SemaphoreTypeCreateInfo>()
+      .setSemaphoreType(vk::SemaphoreType::eTimeline)
+      .setInitialValue(0);
+  timeline_ = device_->handle().createSemaphoreUnique(
+      timeline_chain.get<vk::SemaphoreCreateInfo>());
+
+  submit_thread_ =
+      std::jthread([this](std::stop_token stop) { submit_thread_main(stop); });
+}
+
+queue::~queue() {
+  // The submit thread drains everything still pending before it exits, so
+  // join it before the timeline semaphore and device go away.
+  submit_thread_.request_stop();
+  if (submit_thread_.joinable())
+    submit_thread_.join();
 }
 
 const vk::QueueFamilyProperties &
@@ -16,4 +36,166 @@ queue::queue_family_properties() const noexcept {
       ->queue_family_properties[queue_family_index_];
 }
 
-} // namespace engine
\ No newline at end of file
+uint64_t queue::submit(queue_submission submission) {
+  uint64_t value;
+  {
+    std::scoped_lock lock(pending_mutex_);
+    // Values are assigned under the lock so they are monotonic in the order
+    // the submit thread sees them.
+    value = next_value_.fetch_add(1, std::memory_order_acq_rel);
+    pending_.emplace_back(pending_submit{std::move(submission), value});
+  }
+  pending_cv_.notify_one();
+  return value;
+}
+
+std::future<vk::Result> queue::present(vk::SwapchainKHR swapchain,
+                                       uint32_t         image_index,
+                                       vk::Semaphore    wait) {
+  std::future<vk::Result> result;
+  {
+    std::scoped_lock lock(pending_mutex_);
+    auto &op = std::get<pending_present>(pending_.emplace_back(
+        pending_present{swapchain, image_index, wait, {}}));
+    result = op.result.get_future();
+  }
+  pending_cv_.notify_one();
+  return result;
+}
+
+std::expected<void, vk::Result>
+queue::wait(uint64_t value, std::chrono::nanoseconds timeout) const {
+  const vk::Semaphore semaphore = *timeline_;
+  const auto          wait_info =
+      vk::SemaphoreWaitInfo().setSemaphores(semaphore).setValues(value);
+
+  const auto res = device_->handle().waitSemaphores(
+      wait_info, static_cast<uint64_t>(timeout.count()));
+  if (res != vk::Result::eSuccess)
+    return std::unexpected(res);
+
+  // A failed flush signals the timeline from the host so that waiters wake up;
+  // report the failure rather than pretending the work ran.
+  if (auto err = error_.load(std::memory_order_acquire);
+      err != vk::Result::eSuccess)
+    return std::unexpected(err);
+
+  return {};
+}
+
+uint64_t queue::completed_value() const {
+  return device_->handle().getSemaphoreCounterValue(*timeline_);
+}
+
+void queue::wait_idle() {
+  {
+    std::unique_lock lock(pending_mutex_);
+    idle_cv_.wait(lock, [this] { return pending_.empty() && !busy_; });
+  }
+
+  auto lock = lock_handle();
+  handle_.waitIdle();
+}
+
+void queue::submit_thread_main(std::stop_token stop) {
+  profiling::profiler::get().set_thread_name("queue submit");
+
+  std::vector<pending_op>       ops;
+  std::vector<pending_submit *> batch;
+
+  for (;;) {
+    {
+      std::unique_lock lock(pending_mutex_);
+      pending_cv_.wait(lock, stop, [this] { return !pending_.empty(); });
+      if (pending_.empty()) // Only possible once a stop was requested.
+        return;
+
+      ops.swap(pending_);
+      busy_ = true;
+    }
+
+    // Consecutive submissions coalesce into one vkQueueSubmit2; a present
+    // closes the batch since it must observe the semaphores signalled so far.
+    for (auto &op : ops) {
+      if (auto *s = std::get_if<pending_submit>(&op)) {
+        batch.push_back(s);
+        continue;
+      }
+
+      flush(batch);
+
+      auto &p = std::get<pending_present>(op);
+      auto  present_info = vk::PresentInfoKHR()
+                              .setWaitSemaphores(p.wait)
+                              .setSwapchains(p.swapchain)
+                              .setPImageIndices(&p.image_index);
+
+      ENGINE_PROFILE_SCOPE("vkQueuePresentKHR");
+
+      vk::Result res;
+      try {
+        auto lock = lock_handle();
+        res = handle_.presentKHR(present_info);
+      } catch (const vk::OutOfDateKHRError &) {
+        res = vk::Result::eErrorOutOfDateKHR;
+      } catch (const vk::SystemError &e) {
+        res = static_cast<vk::Result>(e.code().value());
+      }
+      p.result.set_value(res);
+    }
+    flush(batch);
+    ops.clear();
+
+    {
+      std::scoped_lock lock(pending_mutex_);
+      busy_ = false;
+    }
+    idle_cv_.notify_all();
+  }
+}
+
+void queue::flush(std::vector<pending_submit *> &batch) {
+  if (batch.empty())
+    return;
+
+  ENGINE_PROFILE_SCOPE("vkQueueSubmit2");
+
+  std::vector<vk::SubmitInfo2> infos;
+  infos.reserve(batch.size());
+
+  for (auto *s : batch) {
+    s->submission.signal_semaphores.push_back(
+        vk::SemaphoreSubmitInfo()
+            .setSemaphore(*timeline_)
+            .setValue(s->value)
+            .setStageMask(vk::PipelineStageFlagBits2::eAllCommands));
+
+    infos.push_back(vk::SubmitInfo2()
+                        .setWaitSemaphoreInfos(s->submission.wait_semaphores)
+                        .setCommandBufferInfos(s->submission.command_buffers)
+                        .setSignalSemaphoreInfos(
+                            s->submission.signal_semaphores));
+  }
+
+  try {
+    auto lock = lock_handle();
+    handle_.submit2(infos);
+  } catch (const vk::SystemError &e) {
+    error_.store(static_cast<vk::Result>(e.code().value()),
+                 std::memory_order_release);
+
+    // Nothing will signal these values now; do it from the host so waiters
+    // wake up and observe the error.
+    try {
+      device_->handle().signalSemaphore(
+          vk::SemaphoreSignalInfo().setSemaphore(*timeline_).setValue(
+              batch.back()->value));
+    } catch (const vk::SystemError &) {
+      // Device is gone; waits will fail on their own.
+    }
+  }
+
+  batch.clear();
+}
+
+} // namespace engine
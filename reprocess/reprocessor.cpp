@@ -0,0 +1,262 @@
+#include "reprocessor.hpp"
+
+#include "processing/correction.hpp"
+#include "recording/recorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <mutex>
+#include <vector>
+
+#include <jobs/bands.hpp>
+#include <jobs/job_system.hpp>
+#include <profiling/profiler.hpp>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// The per-pixel mean of every frame of a series.
+std::expected<std::vector<float>, std::error_code>
+average(const std::filesystem::path &path, uint32_t width, uint32_t height,
+        engine::jobs::job_system &jobs) {
+  auto series = recording::playback::open(path, {.jobs = &jobs});
+  if (!series)
+    return std::unexpected(series.error());
+  if ((*series)->frame_count() == 0)
+    return std::unexpected(std::make_error_code(std::errc::no_message_available));
+
+  // Doubles: a float sum of a long series loses the low bits.
+  std::vector<double> sum(size_t{width} * height);
+  const size_t        rows = engine::jobs::band_rows(width);
+  for (size_t f = 0; f < (*series)->frame_count(); ++f) {
+    const auto &entry = (*series)->entry(f);
+    const auto  pixels = (*series)->frame(f);
+    if (entry.width != width || entry.height != height ||
+        pixels.size() < sum.size())
+      return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    jobs.parallel_for(0, height, rows, [&](size_t begin, size_t end) {
+      for (size_t i = begin * width; i < end * width; ++i)
+        sum[i] += pixels[i];
+    });
+  }
+
+  const double        frames = static_cast<double>((*series)->frame_count());
+  std::vector<float> mean(sum.size());
+  for (size_t i = 0; i < sum.size(); ++i)
+    mean[i] = static_cast<float>(sum[i] / frames);
+  return mean;
+}
+
+// A dark map, and the gain that brings each pixel's flat response, less
+// the dark, to the mean response. Pixels without one keep a gain of 1.
+std::error_code calibrate(const reprocess_options &options, uint32_t width,
+                          uint32_t height, engine::jobs::job_system &jobs,
+                          std::vector<uint16_t> &dark, std::vector<float> &gain) {
+  const size_t pixels = size_t{width} * height;
+  std::vector<float> dark_mean(pixels, 0.0f);
+  if (!options.dark.empty()) {
+    auto mean = average(options.dark, width, height, jobs);
+    if (!mean)
+      return mean.error();
+    dark_mean = std::move(*mean);
+  }
+  dark.resize(pixels);
+  for (size_t i = 0; i < pixels; ++i)
+    dark[i] = static_cast<uint16_t>(std::clamp(dark_mean[i], 0.0f, 65535.0f) + 0.5f);
+
+  gain.assign(pixels, 1.0f);
+  if (options.flat.empty())
+    return {};
+  auto flat = average(options.flat, width, height, jobs);
+  if (!flat)
+    return flat.error();
+
+  double response = 0.0;
+  size_t responding = 0;
+  for (size_t i = 0; i < pixels; ++i) {
+    const float r = (*flat)[i] - dark[i];
+    if (r > 0.0f) {
+      response += r;
+      ++responding;
+    }
+  }
+  if (responding == 0)
+    return std::make_error_code(std::errc::invalid_argument);
+  const auto mean_response = static_cast<float>(response / responding);
+  for (size_t i = 0; i < pixels; ++i) {
+    const float r = (*flat)[i] - dark[i];
+    if (r > 0.0f)
+      gain[i] = mean_response / r;
+  }
+  return {};
+}
+
+} // namespace
+
+std::error_code reprocess(const reprocess_options                          &options,
+                          const std::function<void(const reprocess_stats &)> &report,
+                          reprocess_stats                                    &stats) {
+  // Truncating the input under its own mapping would end in SIGBUS.
+  std::error_code same_ec;
+  if (std::filesystem::equivalent(options.input, options.output, same_ec))
+    return std::make_error_code(std::errc::file_exists);
+
+  engine::jobs::job_system jobs({
+      .threads = options.threads,
+      .on_start =
+          [](uint32_t worker) {
+            engine::profiling::profiler::get().set_thread_name(
+                "reprocess " + std::to_string(worker));
+          },
+  });
+
+  auto opened =
+      recording::playback::open(options.input, {.jobs = &jobs, .raw = options.raw});
+  if (!opened)
+    return opened.error();
+  recording::playback &source = **opened;
+
+  const size_t first = std::min(options.first, source.frame_count());
+  const size_t count = std::min(options.count, source.frame_count() - first);
+  if (count == 0)
+    return std::make_error_code(std::errc::invalid_argument);
+  const uint32_t width = source.entry(first).width;
+  const uint32_t height = source.entry(first).height;
+  const size_t   pixels = size_t{width} * height;
+  const int64_t  first_received_ns = source.entry(first).received_ns;
+
+  std::vector<uint16_t> dark;
+  std::vector<float>    gain;
+  const bool            correcting = !options.dark.empty() || !options.flat.empty();
+  if (correcting) {
+    if (auto ec = calibrate(options, width, height, jobs, dark, gain))
+      return ec;
+  }
+
+  auto recorder = recording::recorder::create({
+      .path = options.output,
+      .direct = options.direct,
+      .wait_when_full = true,
+      .compress = options.compress,
+      .jobs = &jobs,
+  });
+  if (!recorder)
+    return recorder.error();
+
+  spdlog::info("Reprocessing {} frames of {} ({}x{}) into {}{}{}", count,
+               options.input.string(), width, height, options.output.string(),
+               correcting ? ", corrected" : "",
+               options.compress ? ", compressed" : "");
+
+  struct frame {
+    size_t                 index = 0;
+    std::vector<uint16_t>  pixels;
+    recording::index_entry entry{};
+  };
+
+  // The first error stops every stage; frames already in flight fall
+  // through untouched.
+  std::mutex            error_mutex;
+  std::error_code       error;
+  std::atomic<bool>     failed{false};
+  std::atomic<uint64_t> read_bytes{0};
+  auto                  fail = [&](std::error_code ec) {
+    std::lock_guard lock(error_mutex);
+    if (!error)
+      error = ec;
+    failed.store(true, std::memory_order_relaxed);
+  };
+
+  processing::pipeline<frame> pipeline(jobs, std::max(options.depth, 1u));
+  const size_t                rows = engine::jobs::band_rows(width);
+
+  // The playback decodes into a buffer of its own, so one frame at a time.
+  pipeline.add_stage("read", processing::stage_mode::ordered, [&](frame &f) {
+    if (failed.load(std::memory_order_relaxed))
+      return;
+    ENGINE_PROFILE_SCOPE("read");
+    f.entry = source.entry(f.index);
+    const auto in = source.frame(f.index);
+    if (f.entry.width != width || f.entry.height != height || in.size() < pixels) {
+      fail(in.size() < size_t{f.entry.width} * f.entry.height
+               ? std::make_error_code(std::errc::illegal_byte_sequence)
+               : std::make_error_code(std::errc::invalid_argument));
+      return;
+    }
+    f.pixels.assign(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(pixels));
+    read_bytes.fetch_add(f.entry.bytes, std::memory_order_relaxed);
+  });
+
+  if (correcting)
+    pipeline.add_stage("correct", processing::stage_mode::parallel, [&](frame &f) {
+      if (failed.load(std::memory_order_relaxed))
+        return;
+      ENGINE_PROFILE_SCOPE("correct");
+      // Split as well, so that one frame can use every core while reading
+      // the next holds up the rest.
+      jobs.parallel_for(0, height, rows, [&](size_t begin, size_t end) {
+        const size_t offset = begin * width, n = (end - begin) * width;
+        const auto   view = std::span(f.pixels).subspan(offset, n);
+        processing::offset_gain_correct(view, std::span(dark).subspan(offset, n),
+                                        std::span(gain).subspan(offset, n), view);
+      });
+    });
+
+  // The recorder takes frames from one thread at a time, and in order.
+  pipeline.add_stage("write", processing::stage_mode::ordered, [&](frame &f) {
+    if (failed.load(std::memory_order_relaxed))
+      return;
+    ENGINE_PROFILE_SCOPE("write");
+    const recording::frame_info info{
+        .frame_id = f.entry.frame_id,
+        .device_timestamp = f.entry.device_timestamp,
+        .width = width,
+        .height = height,
+        .pixel_format = f.entry.pixel_format,
+        .complete = !(f.entry.flags & recording::frame_incomplete),
+        .received_ns = std::max<int64_t>(f.entry.received_ns - first_received_ns, 0),
+    };
+    if (!(*recorder)->push(info, std::as_bytes(std::span(f.pixels)))) {
+      const auto ec = (*recorder)->error();
+      fail(ec ? ec : std::make_error_code(std::errc::io_error));
+    }
+  });
+
+  auto snapshot = [&] {
+    const auto recorded = (*recorder)->stats();
+    stats.pipeline = pipeline.stats();
+    stats.frames = stats.pipeline.frames;
+    stats.total = count;
+    stats.read_bytes = read_bytes.load(std::memory_order_relaxed);
+    stats.written_bytes = recorded.bytes;
+    stats.compression_ratio = recorded.compression_ratio;
+    stats.seconds = stats.pipeline.seconds;
+  };
+
+  auto last_report = std::chrono::steady_clock::now();
+  for (size_t f = first; f < first + count && !failed.load(std::memory_order_relaxed);
+       ++f) {
+    pipeline.push([f](frame &slot) { slot.index = f; });
+    if (std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(1)) {
+      last_report = std::chrono::steady_clock::now();
+      snapshot();
+      report(stats);
+    }
+  }
+  pipeline.drain();
+
+  std::error_code ec = error;
+  if (auto finished = (*recorder)->finish(); !ec)
+    ec = finished;
+  snapshot();
+  if (ec) {
+    std::error_code removed;
+    std::filesystem::remove(options.output, removed);
+    auto index = options.output;
+    index += ".idx";
+    std::filesystem::remove(index, removed);
+  }
+  return ec;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#include "processing/pipeline.hpp"
+#include "recording/playback.hpp"
+
+struct reprocess_options {
+  std::filesystem::path                input;
+  std::filesystem::path                output;
+  std::optional<recording::raw_layout> raw; // The input is a raw dump.
+
+  // Dark and flat series (recordings or TIFF stacks), each averaged into
+  // a map; the flat one, less the dark, gives the gain. Without either,
+  // frames are copied through uncorrected.
+  std::filesystem::path dark;
+  std::filesystem::path flat;
+
+  size_t first = 0;
+  size_t count = SIZE_MAX;
+
+  bool compress = true;
+  bool direct = true; // O_DIRECT output where the file system allows it.
+  // Workers shared by decoding, correcting and compressing; 0: all cores
+  // but one.
+  uint32_t threads = 0;
+  // Frames in the pipeline at once, between reading and writing.
+  uint32_t depth = 8;
+};
+
+struct reprocess_stats {
+  uint64_t frames = 0;
+  uint64_t total = 0;
+  uint64_t read_bytes = 0;    // As stored in the input.
+  uint64_t written_bytes = 0; // As stored in the output.
+  double   seconds = 0.0;
+  double   compression_ratio = 1.0;
+
+  // Per stage: read (including decoding and page faults on the input),
+  // correct, and write, which hands frames to the recorder and waits for
+  // the disk once its staging memory is full.
+  processing::pipeline_stats pipeline;
+};
+
+// Streams frames [first, first + count) of a recording, TIFF stack or raw
+// dump through offset/gain correction into a new recording, compressing
+// it on the way if asked. Frames go through a pipeline of reading, in
+// order; correcting, several frames at once; and writing, in order, up to
+// depth frames at a time. The recorder then compresses and writes behind
+// it, so that with enough cores the slowest of the two disks sets the
+// pace.
+//
+// report is called about once a second with the stats so far.
+std::error_code reprocess(const reprocess_options                          &options,
+                          const std::function<void(const reprocess_stats &)> &report,
+                          reprocess_stats                                    &stats);
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <processing/correction.hpp>
+
+#include "frame_sizes.hpp"
+
+namespace {
+
+using benchmarks::frame_sizes;
+
+std::vector<uint16_t> random_frame(size_t pixels, uint32_t seed) {
+  std::mt19937                            rng(seed);
+  std::uniform_int_distribution<uint32_t> dist(0, 0xFFFF);
+
+  std::vector<uint16_t> frame(pixels);
+  for (auto &p : frame)
+    p = static_cast<uint16_t>(dist(rng));
+  return frame;
+}
+
+void bm_offset_gain_correct(benchmark::State &state) {
+  const auto pixels = static_cast<size_t>(state.range(0) * state.range(0));
+
+  const auto            raw = random_frame(pixels, 1);
+  const auto            dark = random_frame(pixels, 2);
+  std::vector<float>    gain(pixels, 1.25f);
+  std::vector<uint16_t> out(pixels);
+
+  for (auto _ : state) {
+    processing::offset_gain_correct(raw, dark, gain, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  // raw + dark + gain in, out written back.
+  state.SetBytesProcessed(state.iterations() * pixels *
+                          (2 * sizeof(uint16_t) + sizeof(float) +
+                           sizeof(uint16_t)));
+}
+
+void bm_build_display_lut(benchmark::State &state) {
+  auto lut = std::make_unique<processing::display_lut>();
+  for (auto _ : state) {
+    processing::build_display_lut({.low = 1000, .high = 40000}, *lut);
+    benchmark::DoNotOptimize(lut->data());
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(processing::display_lut));
+}
+BENCHMARK(bm_build_display_lut);
+
+void bm_apply_display_lut(benchmark::State &state) {
+  const auto pixels = static_cast<size_t>(state.range(0) * state.range(0));
+
+  auto lut = std::make_unique<processing::display_lut>();
+  processing::build_display_lut({.low = 1000, .high = 40000}, *lut);
+
+  const auto            in = random_frame(pixels, 3);
+  std::vector<uint32_t> out(pixels);
+
+  for (auto _ : state) {
+    processing::apply_display_lut(in, *lut, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * pixels *
+                          (sizeof(uint16_t) + sizeof(uint32_t)));
+}
+
+void frame_size_args(benchmark::internal::Benchmark *b) {
+  for (auto size : frame_sizes)
+    b->Arg(size);
+  b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(bm_offset_gain_correct)->Apply(frame_size_args);
+BENCHMARK(bm_apply_display_lut)->Apply(frame_size_args);
+
+} // namespace
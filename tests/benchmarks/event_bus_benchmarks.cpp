@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "event_bus.hpp"
+
+namespace {
+
+struct sample_event {
+  uint64_t value;
+};
+
+void bm_event_bus_publish(benchmark::State &state) {
+  event_bus bus;
+  uint64_t  sink = 0;
+
+  std::vector<subscription_handle> handles;
+  for (int64_t i = 0; i < state.range(0); ++i)
+    handles.push_back(bus.subscribe<sample_event>(
+        [&sink](const sample_event &e) { sink += e.value; }));
+
+  uint64_t n = 0;
+  for (auto _ : state)
+    bus.publish(sample_event{n++});
+  benchmark::DoNotOptimize(sink);
+
+  for (auto h : handles)
+    bus.unsubscribe(h);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_event_bus_publish)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+void bm_event_bus_subscribe_unsubscribe(benchmark::State &state) {
+  event_bus bus;
+
+  // Keep some unrelated subscribers around so the erase has work to do.
+  std::vector<subscription_handle> handles;
+  for (int i = 0; i < 16; ++i)
+    handles.push_back(bus.subscribe<sample_event>([](const sample_event &) {}));
+
+  for (auto _ : state) {
+    auto h = bus.subscribe<sample_event>([](const sample_event &) {});
+    bus.unsubscribe(h);
+  }
+
+  for (auto h : handles)
+    bus.unsubscribe(h);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_event_bus_subscribe_unsubscribe);
+
+} // namespace
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ui/feature_tree.hpp>
+
+namespace {
+
+// Names shaped like a vendor description's: a few stems, many variants.
+std::vector<std::string> feature_names(size_t count) {
+  static constexpr std::string_view stems[] = {
+      "Exposure", "Gain",   "BlackLevel", "Acquisition", "Trigger",
+      "Sensor",   "Binning", "Offset",    "LineSelector", "Counter"};
+  static constexpr std::string_view suffixes[] = {"Time", "Auto", "Mode",
+                                                  "Source", "Value", "Raw"};
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    names.push_back(std::string(stems[i % std::size(stems)]) +
+                    std::string(suffixes[(i / 7) % std::size(suffixes)]) +
+                    std::to_string(i));
+  return names;
+}
+
+feature_search make_search(const std::vector<std::string> &names) {
+  feature_search s;
+  for (const auto &n : names) {
+    const std::string_view texts[] = {n};
+    s.add(texts);
+  }
+  s.build();
+  return s;
+}
+
+void bm_feature_search_build(benchmark::State &state) {
+  const auto names = feature_names(static_cast<size_t>(state.range(0)));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(make_search(names));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_feature_search_build)->Arg(10'000);
+
+// Typing a query one character at a time, then clearing it.
+void bm_feature_search_typing(benchmark::State &state) {
+  const auto names = feature_names(static_cast<size_t>(state.range(0)));
+  auto       search = make_search(names);
+
+  constexpr std::string_view query = "triggersource12";
+  for (auto _ : state)
+    for (size_t n = 1; n <= query.size(); ++n)
+      benchmark::DoNotOptimize(search.find(query.substr(0, n)).size());
+  state.SetItemsProcessed(state.iterations() * query.size());
+}
+BENCHMARK(bm_feature_search_typing)->Arg(10'000);
+
+void bm_feature_search_fresh_query(benchmark::State &state) {
+  const auto names = feature_names(static_cast<size_t>(state.range(0)));
+  auto       search = make_search(names);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(search.find("xyz").size()); // Resets narrowing.
+    benchmark::DoNotOptimize(search.find("gainmode").size());
+  }
+}
+BENCHMARK(bm_feature_search_fresh_query)->Arg(10'000);
+
+void bm_feature_tree_expand(benchmark::State &state) {
+  // Ten categories of range/10 features each.
+  feature_tree t;
+  t.open();
+  for (int c = 0; c < 10; ++c) {
+    t.open();
+    for (int64_t f = 0; f < state.range(0) / 10; ++f) {
+      t.open();
+      t.close();
+    }
+    t.close();
+  }
+  t.close();
+
+  bool expanded = false;
+  for (auto _ : state) {
+    t.expand_all(expanded = !expanded);
+    benchmark::DoNotOptimize(t.visible().size());
+  }
+}
+BENCHMARK(bm_feature_tree_expand)->Arg(10'000);
+
+} // namespace
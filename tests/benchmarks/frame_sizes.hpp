@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace benchmarks {
+
+// Square frame edge lengths matching the detectors we ship with.
+inline constexpr int64_t frame_sizes[] = {1024, 1536, 3072};
+
+} // namespace benchmarks
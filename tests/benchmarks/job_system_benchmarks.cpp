@@ -0,0 +1,251 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <execution>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+#include <processing/correction.hpp>
+
+#include "frame_sizes.hpp"
+
+namespace {
+
+using benchmarks::frame_sizes;
+using engine::jobs::job_system;
+using engine::jobs::task_group;
+using engine::jobs::tile;
+
+// Rows per piece for the row-split runs, and the tile for the 2D one.
+constexpr size_t   band_rows = 16;
+constexpr uint32_t tile_width = 256, tile_height = 64;
+
+// The baseline: one locked queue of std::function, one job per piece, and
+// a latch to join. What a parallel feature would write for itself.
+class naive_pool {
+public:
+  explicit naive_pool(uint32_t threads) {
+    for (uint32_t i = 0; i < threads; ++i)
+      threads_.emplace_back([this](std::stop_token stop) {
+        while (true) {
+          std::function<void()> job;
+          {
+            std::unique_lock lock(mutex_);
+            if (!ready_.wait(lock, stop, [this] { return !queue_.empty(); }))
+              return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+          }
+          job();
+        }
+      });
+  }
+
+  void parallel_for(size_t count, size_t piece,
+                    const std::function<void(size_t, size_t)> &body) {
+    const size_t pieces = (count + piece - 1) / piece;
+    std::latch   done(static_cast<std::ptrdiff_t>(pieces));
+    {
+      std::lock_guard lock(mutex_);
+      for (size_t begin = 0; begin < count; begin += piece)
+        queue_.push_back([&, begin] {
+          body(begin, std::min(count, begin + piece));
+          done.count_down();
+        });
+    }
+    ready_.notify_all();
+    done.wait();
+  }
+
+private:
+  std::mutex                        mutex_;
+  std::condition_variable_any       ready_;
+  std::deque<std::function<void()>> queue_;
+  std::vector<std::jthread>         threads_; // Last: joined first.
+};
+
+uint32_t worker_threads() {
+  return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+job_system &shared_jobs() {
+  static job_system jobs;
+  return jobs;
+}
+
+naive_pool &shared_naive_pool() {
+  static naive_pool pool(worker_threads());
+  return pool;
+}
+
+struct correction_frame {
+  explicit correction_frame(uint32_t edge)
+      : edge(edge), raw(size_t{edge} * edge), dark(raw.size()),
+        gain(raw.size(), 1.25f), out(raw.size()) {
+    std::mt19937                            rng(1);
+    std::uniform_int_distribution<uint32_t> dist(0, 0xFFFF);
+    for (size_t i = 0; i < raw.size(); ++i) {
+      raw[i] = static_cast<uint16_t>(dist(rng));
+      dark[i] = static_cast<uint16_t>(dist(rng) / 16);
+    }
+  }
+
+  void correct_rows(size_t begin, size_t end) {
+    const size_t offset = begin * edge, n = (end - begin) * edge;
+    processing::offset_gain_correct(std::span(raw).subspan(offset, n),
+                                    std::span(dark).subspan(offset, n),
+                                    std::span(gain).subspan(offset, n),
+                                    std::span(out).subspan(offset, n));
+  }
+
+  void correct_tile(const tile &t) {
+    for (uint32_t y = t.y; y < t.y + t.height; ++y) {
+      const size_t offset = size_t{y} * edge + t.x;
+      processing::offset_gain_correct(std::span(raw).subspan(offset, t.width),
+                                      std::span(dark).subspan(offset, t.width),
+                                      std::span(gain).subspan(offset, t.width),
+                                      std::span(out).subspan(offset, t.width));
+    }
+  }
+
+  uint32_t              edge;
+  std::vector<uint16_t> raw;
+  std::vector<uint16_t> dark;
+  std::vector<float>    gain;
+  std::vector<uint16_t> out;
+};
+
+void frame_counters(benchmark::State &state, const correction_frame &frame) {
+  benchmark::DoNotOptimize(frame.out.data());
+  benchmark::ClobberMemory();
+  // raw + dark + gain in, out written back.
+  state.SetBytesProcessed(state.iterations() * frame.raw.size() *
+                          (3 * sizeof(uint16_t) + sizeof(float)));
+}
+
+void bm_frame_serial(benchmark::State &state) {
+  correction_frame frame(static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    frame.correct_rows(0, frame.edge);
+    benchmark::ClobberMemory();
+  }
+  frame_counters(state, frame);
+}
+
+void bm_frame_job_system_rows(benchmark::State &state) {
+  correction_frame frame(static_cast<uint32_t>(state.range(0)));
+  auto            &jobs = shared_jobs();
+  for (auto _ : state) {
+    jobs.parallel_for(0, frame.edge, band_rows,
+                      [&](size_t begin, size_t end) { frame.correct_rows(begin, end); });
+    benchmark::ClobberMemory();
+  }
+  frame_counters(state, frame);
+}
+
+void bm_frame_job_system_tiles(benchmark::State &state) {
+  correction_frame frame(static_cast<uint32_t>(state.range(0)));
+  auto            &jobs = shared_jobs();
+  for (auto _ : state) {
+    jobs.parallel_for(frame.edge, frame.edge, tile_width, tile_height,
+                      [&](const tile &t) { frame.correct_tile(t); });
+    benchmark::ClobberMemory();
+  }
+  frame_counters(state, frame);
+}
+
+// libstdc++ runs the parallel policies on TBB when it is linked, and
+// serially otherwise.
+void bm_frame_std_par(benchmark::State &state) {
+  correction_frame    frame(static_cast<uint32_t>(state.range(0)));
+  std::vector<size_t> bands((frame.edge + band_rows - 1) / band_rows);
+  std::iota(bands.begin(), bands.end(), size_t{0});
+  for (auto _ : state) {
+    std::for_each(std::execution::par, bands.begin(), bands.end(), [&](size_t band) {
+      frame.correct_rows(band * band_rows,
+                         std::min<size_t>(frame.edge, (band + 1) * band_rows));
+    });
+    benchmark::ClobberMemory();
+  }
+  frame_counters(state, frame);
+}
+
+void bm_frame_naive_pool(benchmark::State &state) {
+  correction_frame frame(static_cast<uint32_t>(state.range(0)));
+  auto            &pool = shared_naive_pool();
+  for (auto _ : state) {
+    pool.parallel_for(frame.edge, band_rows,
+                      [&](size_t begin, size_t end) { frame.correct_rows(begin, end); });
+    benchmark::ClobberMemory();
+  }
+  frame_counters(state, frame);
+}
+
+// Scheduling overhead alone: Arg tiny jobs forked and joined per iteration.
+void bm_fork_join_empty_job_system(benchmark::State &state) {
+  auto            &jobs = shared_jobs();
+  std::atomic<int> sink{0};
+  for (auto _ : state) {
+    task_group group(jobs);
+    for (int64_t i = 0; i < state.range(0); ++i)
+      group.run([&sink] { sink.fetch_add(1, std::memory_order_relaxed); });
+    group.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void bm_fork_join_empty_naive_pool(benchmark::State &state) {
+  auto            &pool = shared_naive_pool();
+  std::atomic<int> sink{0};
+  for (auto _ : state)
+    pool.parallel_for(static_cast<size_t>(state.range(0)), 1, [&](size_t, size_t) {
+      sink.fetch_add(1, std::memory_order_relaxed);
+    });
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Recursive fork/join, which a single queue cannot run without deadlock.
+uint64_t fibonacci(job_system &jobs, uint32_t n) {
+  if (n < 16) {
+    uint64_t a = 0, b = 1;
+    for (uint32_t i = 0; i < n; ++i)
+      b = std::exchange(a, b) + b;
+    return a;
+  }
+  uint64_t a = 0, b = 0;
+  jobs.join([&] { a = fibonacci(jobs, n - 1); }, [&] { b = fibonacci(jobs, n - 2); });
+  return a + b;
+}
+
+void bm_fork_join_recursive(benchmark::State &state) {
+  auto &jobs = shared_jobs();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fibonacci(jobs, static_cast<uint32_t>(state.range(0))));
+}
+
+void frame_args(benchmark::internal::Benchmark *b) {
+  for (int64_t edge : frame_sizes)
+    b->Arg(edge);
+  // Wall time: the CPU time of the calling thread misses the workers'.
+  b->UseRealTime();
+}
+
+} // namespace
+
+BENCHMARK(bm_frame_serial)->Apply(frame_args);
+BENCHMARK(bm_frame_job_system_rows)->Apply(frame_args);
+BENCHMARK(bm_frame_job_system_tiles)->Apply(frame_args);
+BENCHMARK(bm_frame_std_par)->Apply(frame_args);
+BENCHMARK(bm_frame_naive_pool)->Apply(frame_args);
+BENCHMARK(bm_fork_join_empty_job_system)->Arg(1000)->UseRealTime();
+BENCHMARK(bm_fork_join_empty_naive_pool)->Arg(1000)->UseRealTime();
+BENCHMARK(bm_fork_join_recursive)->Arg(30)->UseRealTime();
@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <utility/mutex_protected.hpp>
+
+namespace {
+
+void bm_mutex_protected_uncontended(benchmark::State &state) {
+  mutex_protected<uint64_t> counter(0);
+  for (auto _ : state) {
+    auto [value, lock] = counter.lock();
+    benchmark::DoNotOptimize(++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_mutex_protected_uncontended);
+
+mutex_protected<uint64_t> shared_counter(0);
+
+void bm_mutex_protected_contended(benchmark::State &state) {
+  for (auto _ : state) {
+    auto [value, lock] = shared_counter.lock();
+    benchmark::DoNotOptimize(++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_mutex_protected_contended)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace
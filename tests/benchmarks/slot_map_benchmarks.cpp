@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <utility/slot_map.hpp>
+
+namespace {
+
+struct payload {
+  uint64_t a;
+  uint64_t b;
+};
+
+using map_type = slot_map<payload>;
+
+void bm_slot_map_emplace(benchmark::State &state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    map_type map;
+    for (size_t i = 0; i < count; ++i)
+      benchmark::DoNotOptimize(map.emplace(payload{i, i}));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_slot_map_emplace)->Range(1 << 8, 1 << 16);
+
+void bm_slot_map_get(benchmark::State &state) {
+  map_type             map;
+  std::vector<slot_id> ids;
+  for (int64_t i = 0; i < state.range(0); ++i)
+    ids.push_back(map.emplace(payload{}));
+
+  // Random order so the lookups are not just a linear sweep.
+  std::mt19937 rng(1234);
+  std::shuffle(ids.begin(), ids.end(), rng);
+
+  for (auto _ : state)
+    for (auto id : ids)
+      benchmark::DoNotOptimize(map.get(id));
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_slot_map_get)->Range(1 << 8, 1 << 16);
+
+// Steady-state remove + emplace through the free list, as happens when
+// frames are recycled.
+void bm_slot_map_churn(benchmark::State &state) {
+  map_type             map;
+  std::vector<slot_id> ids;
+  for (int64_t i = 0; i < state.range(0); ++i)
+    ids.push_back(map.emplace(payload{}));
+
+  size_t next = 0;
+  for (auto _ : state) {
+    auto &id = ids[next];
+    benchmark::DoNotOptimize(map.remove(id));
+    id = map.emplace(payload{next, next});
+    next = (next + 1) % ids.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_slot_map_churn)->Range(1 << 8, 1 << 16);
+
+// Iteration over a map with every other slot vacant.
+void bm_slot_map_iterate(benchmark::State &state) {
+  map_type             map;
+  std::vector<slot_id> ids;
+  for (int64_t i = 0; i < state.range(0) * 2; ++i)
+    ids.push_back(map.emplace(payload{static_cast<uint64_t>(i), 0}));
+  for (size_t i = 0; i < ids.size(); i += 2)
+    (void)map.remove(ids[i]);
+
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    for (const auto &p : map.values())
+      sum += p.a;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_slot_map_iterate)->Range(1 << 8, 1 << 16);
+
+} // namespace
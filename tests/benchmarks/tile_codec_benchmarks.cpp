@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <recording/tile_codec.hpp>
+
+#include "frame_sizes.hpp"
+
+namespace {
+
+using benchmarks::frame_sizes;
+
+// A smooth phantom under shot noise at the given mean signal: the noise,
+// not the content, sets how far a detector frame compresses.
+std::vector<uint16_t> detector_frame(uint32_t edge, double signal_level) {
+  std::mt19937                     rng(1);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  std::vector<uint16_t> frame(size_t{edge} * edge);
+  for (uint32_t y = 0; y < edge; ++y)
+    for (uint32_t x = 0; x < edge; ++x) {
+      const double signal =
+          signal_level * (1.0 + 0.5 * std::sin(x * 0.01) * std::cos(y * 0.013));
+      frame[size_t{y} * edge + x] = static_cast<uint16_t>(
+          std::clamp(signal + std::sqrt(signal) * noise(rng), 0.0, 65535.0));
+    }
+  return frame;
+}
+
+// Args: frame edge, mean signal.
+void bm_tile_codec_encode(benchmark::State &state) {
+  const auto edge = static_cast<uint32_t>(state.range(0));
+  const auto frame = detector_frame(edge, static_cast<double>(state.range(1)));
+
+  recording::tile_codec  codec;
+  std::vector<std::byte> out(codec.max_encoded_size(edge, edge));
+  size_t                 size = 0;
+  for (auto _ : state) {
+    size = codec.encode(frame, edge, edge, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size() * sizeof(uint16_t));
+  state.counters["ratio"] =
+      static_cast<double>(frame.size() * sizeof(uint16_t)) / size;
+}
+
+void bm_tile_codec_decode(benchmark::State &state) {
+  const auto edge = static_cast<uint32_t>(state.range(0));
+  const auto frame = detector_frame(edge, static_cast<double>(state.range(1)));
+
+  recording::tile_codec  codec;
+  std::vector<std::byte> encoded(codec.max_encoded_size(edge, edge));
+  encoded.resize(codec.encode(frame, edge, edge, encoded));
+
+  std::vector<uint16_t> out(frame.size());
+  for (auto _ : state) {
+    const bool ok = recording::tile_codec::decode(encoded, out);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  // Decoded bytes, so that the rate compares with the raw disk rate.
+  state.SetBytesProcessed(state.iterations() * frame.size() * sizeof(uint16_t));
+}
+
+void codec_args(benchmark::internal::Benchmark *b) {
+  for (int64_t edge : frame_sizes)
+    for (int64_t signal : {100, 4000})
+      b->Args({edge, signal});
+}
+
+} // namespace
+
+BENCHMARK(bm_tile_codec_encode)->Apply(codec_args);
+BENCHMARK(bm_tile_codec_decode)->Apply(codec_args);
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <gev/protocol.hpp>
+
+TEST(block_counter, keeps_rising_across_wraps) {
+  gev::block_counter counter;
+  uint16_t           id = 0xFFF0;
+  uint64_t           expected = id;
+  // Three times round the id range, 0 never among them.
+  for (int i = 0; i < 3 * 0xFFFF; ++i) {
+    ASSERT_EQ(counter.count(id), expected) << "block id " << id;
+    id = gev::next_block_id(id);
+    ++expected;
+  }
+}
+
+TEST(block_counter, counts_lost_frames_and_places_late_ones) {
+  gev::block_counter counter;
+  EXPECT_EQ(counter.count(0xFFFE), 0xFFFEu);
+  // 0xFFFF and 1 lost, across the wrap.
+  EXPECT_EQ(counter.count(2), 0x10001u);
+  // 1 completes late: it keeps its place and does not move the count.
+  EXPECT_EQ(counter.count(1), 0x10000u);
+  EXPECT_EQ(counter.count(3), 0x10002u);
+  // The newest again, as when it is delivered twice.
+  EXPECT_EQ(counter.count(3), 0x10002u);
+  // Just under half the range lost in one go still counts forward.
+  EXPECT_EQ(counter.count(3 + 0x7FFF), 0x10002u + 0x7FFF);
+}
+
+TEST(block_counter, frames_from_before_the_first_count_have_none) {
+  gev::block_counter counter;
+  EXPECT_EQ(counter.count(2), 2u);
+  EXPECT_EQ(counter.count(1), 1u);
+  EXPECT_EQ(counter.count(0xFFFF), 0u);
+  EXPECT_EQ(counter.count(3), 3u);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include <processing/correction.hpp>
+
+TEST(correction, unit_gain_zero_dark_is_identity) {
+  const std::vector<uint16_t> raw{0, 1, 1000, 65535};
+  const std::vector<uint16_t> dark(raw.size(), 0);
+  const std::vector<float>    gain(raw.size(), 1.0f);
+  std::vector<uint16_t>       out(raw.size());
+
+  processing::offset_gain_correct(raw, dark, gain, out);
+  EXPECT_EQ(out, raw);
+}
+
+TEST(correction, result_is_clamped_to_16_bits) {
+  const std::vector<uint16_t> raw{100, 60000};
+  const std::vector<uint16_t> dark{200, 0};
+  const std::vector<float>    gain{1.0f, 2.0f};
+  std::vector<uint16_t>       out(raw.size());
+
+  processing::offset_gain_correct(raw, dark, gain, out);
+  EXPECT_EQ(out[0], 0);
+  EXPECT_EQ(out[1], 65535);
+}
+
+TEST(correction, correction_may_run_in_place) {
+  std::vector<uint16_t>       data{1100, 2100};
+  const std::vector<uint16_t> dark{100, 100};
+  const std::vector<float>    gain{0.5f, 2.0f};
+
+  processing::offset_gain_correct(data, dark, gain, data);
+  EXPECT_EQ(data[0], 500);
+  EXPECT_EQ(data[1], 4000);
+}
+
+TEST(correction, display_lut_maps_window_to_full_grey_range) {
+  auto lut = std::make_unique<processing::display_lut>();
+  processing::build_display_lut({.low = 1000, .high = 2000}, *lut);
+
+  EXPECT_EQ((*lut)[0], 0xFF000000u);
+  EXPECT_EQ((*lut)[1000], 0xFF000000u);
+  EXPECT_EQ((*lut)[2000], 0xFFFFFFFFu);
+  EXPECT_EQ((*lut)[65535], 0xFFFFFFFFu);
+
+  const uint32_t mid = (*lut)[1500] & 0xFF;
+  EXPECT_NEAR(mid, 128, 1);
+
+  const std::vector<uint16_t> in{0, 1500, 5000};
+  std::vector<uint32_t>       out(in.size());
+  processing::apply_display_lut(in, *lut, out);
+  EXPECT_EQ(out[0], (*lut)[0]);
+  EXPECT_EQ(out[1], (*lut)[1500]);
+  EXPECT_EQ(out[2], (*lut)[5000]);
+}
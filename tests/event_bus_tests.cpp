@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include "event_bus.hpp"
+
+namespace {
+
+struct ping {
+  int value;
+};
+
+struct pong {};
+
+} // namespace
+
+TEST(event_bus, publish_reaches_every_subscriber) {
+  event_bus bus;
+  int       sum = 0;
+
+  auto a = bus.subscribe<ping>([&](const ping &p) { sum += p.value; });
+  auto b = bus.subscribe<ping>([&](const ping &p) { sum += p.value * 10; });
+
+  bus.publish(ping{2});
+  EXPECT_EQ(sum, 22);
+
+  bus.unsubscribe(a);
+  bus.unsubscribe(b);
+}
+
+TEST(event_bus, unsubscribe_stops_delivery) {
+  event_bus bus;
+  int       calls = 0;
+
+  auto handle = bus.subscribe<ping>([&](const ping &) { ++calls; });
+  bus.publish(ping{});
+  bus.unsubscribe(handle);
+  bus.publish(ping{});
+
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(event_bus, events_are_routed_by_type) {
+  event_bus bus;
+  int       pings = 0;
+  int       pongs = 0;
+
+  auto a = bus.subscribe<ping>([&](const ping &) { ++pings; });
+  auto b = bus.subscribe<pong>([&](const pong &) { ++pongs; });
+
+  bus.publish(pong{});
+  bus.publish(pong{});
+  bus.publish(ping{});
+
+  EXPECT_EQ(pings, 1);
+  EXPECT_EQ(pongs, 2);
+
+  bus.unsubscribe(a);
+  bus.unsubscribe(b);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include <ui/feature_tree.hpp>
+
+namespace {
+
+// Root
+// ├─ A
+// │  ├─ A1
+// │  └─ A2
+// └─ B
+//    └─ B1
+feature_tree sample_tree() {
+  feature_tree t;
+  t.open(); // 0 Root
+  t.open(); // 1 A
+  t.open(); // 2 A1
+  t.close();
+  t.open(); // 3 A2
+  t.close();
+  t.close();
+  t.open(); // 4 B
+  t.open(); // 5 B1
+  t.close();
+  t.close();
+  t.close();
+  return t;
+}
+
+std::vector<uint32_t> visible(feature_tree &t) {
+  const auto v = t.visible();
+  return {v.begin(), v.end()};
+}
+
+feature_search sample_search() {
+  feature_search s;
+  for (auto [name, display] :
+       std::array<std::array<std::string_view, 2>, 4>{{
+           {"ExposureTime", "Exposure Time"},
+           {"ExposureAuto", "Exposure Auto"},
+           {"Gain", "Gain"},
+           {"AcquisitionFrameRate", "Frame Rate"},
+       }}) {
+    const std::string_view texts[] = {name, display};
+    s.add(texts);
+  }
+  s.build();
+  return s;
+}
+
+std::vector<uint32_t> find(feature_search &s, std::string_view query) {
+  const auto m = s.find(query);
+  return {m.begin(), m.end()};
+}
+
+} // namespace
+
+TEST(feature_tree, rows_record_depth_parent_and_subtree_end) {
+  auto t = sample_tree();
+  const auto rows = t.rows();
+
+  ASSERT_EQ(rows.size(), 6u);
+  EXPECT_EQ(rows[0].end, 6u);
+  EXPECT_EQ(rows[1].end, 4u);
+  EXPECT_EQ(rows[2].depth, 2u);
+  EXPECT_EQ(rows[5].parent, 4u);
+  EXPECT_EQ(rows[0].parent, feature_tree::no_row);
+  EXPECT_TRUE(t.has_children(4));
+  EXPECT_FALSE(t.has_children(3));
+}
+
+TEST(feature_tree, collapsed_subtrees_are_skipped) {
+  auto t = sample_tree();
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0}));
+
+  t.set_expanded(0, true);
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0, 1, 4}));
+
+  t.set_expanded(4, true);
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0, 1, 4, 5}));
+
+  t.expand_all(true);
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+}
+
+TEST(feature_tree, filter_shows_matches_with_their_ancestors) {
+  auto t = sample_tree();
+
+  const uint32_t matches[] = {3, 5};
+  t.set_filter(matches);
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0, 1, 3, 4, 5}));
+
+  // Expand state survives the filter.
+  t.clear_filter();
+  EXPECT_EQ(visible(t), (std::vector<uint32_t>{0}));
+}
+
+TEST(feature_search, matches_substrings_case_insensitively) {
+  auto s = sample_search();
+
+  EXPECT_EQ(find(s, "exposure"), (std::vector<uint32_t>{0, 1}));
+  EXPECT_EQ(find(s, "FRAME"), (std::vector<uint32_t>{3}));
+  EXPECT_EQ(find(s, "me ra"), (std::vector<uint32_t>{3})); // Display name.
+  EXPECT_EQ(find(s, "ai"), (std::vector<uint32_t>{2}));    // Below a trigram.
+  EXPECT_TRUE(find(s, "zzz").empty());
+  EXPECT_TRUE(find(s, "").empty());
+}
+
+TEST(feature_search, does_not_match_across_strings) {
+  auto s = sample_search();
+  EXPECT_TRUE(find(s, "timeexposure").empty());
+}
+
+TEST(feature_search, narrowing_and_widening_agree_with_a_fresh_search) {
+  auto s = sample_search();
+
+  EXPECT_EQ(find(s, "e"), (std::vector<uint32_t>{0, 1, 3}));
+  EXPECT_EQ(find(s, "ex"), (std::vector<uint32_t>{0, 1}));
+  EXPECT_EQ(find(s, "exposuret"), (std::vector<uint32_t>{0}));
+  EXPECT_EQ(find(s, "exposure"), (std::vector<uint32_t>{0, 1}));
+  EXPECT_EQ(find(s, "rate"), (std::vector<uint32_t>{3}));
+}
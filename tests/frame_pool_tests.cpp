@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <processing/frame_pool.hpp>
+
+using processing::frame_metadata;
+using processing::frame_pool;
+using processing::frame_ref;
+
+namespace {
+
+// A ring of buffers and the free list the pool hands them back to, as the
+// GVSP receiver keeps them.
+struct test_ring {
+  explicit test_ring(uint32_t buffers, size_t pixels = 16)
+      : pixels(pixels), data(buffers * pixels), recycled(buffers) {
+    for (uint32_t b = buffers; b-- > 0;)
+      free.push_back(b);
+  }
+
+  std::span<uint16_t> buffer(uint32_t b) {
+    return std::span(data).subspan(b * pixels, pixels);
+  }
+
+  void recycle(uint32_t b) {
+    recycled[b].fetch_add(1);
+    std::lock_guard lock(mutex);
+    free.push_back(b);
+  }
+
+  std::optional<uint32_t> take() {
+    std::lock_guard lock(mutex);
+    if (free.empty())
+      return std::nullopt;
+    const uint32_t b = free.back();
+    free.pop_back();
+    return b;
+  }
+
+  size_t                             pixels;
+  std::vector<uint16_t>              data;
+  std::vector<std::atomic<uint32_t>> recycled;
+  std::mutex                         mutex;
+  std::vector<uint32_t>              free;
+};
+
+frame_ref publish(frame_pool &pool, test_ring &ring, uint32_t b, uint64_t id) {
+  auto pixels = ring.buffer(b);
+  std::ranges::fill(pixels, static_cast<uint16_t>(id));
+  return pool.publish(b, {.frame_id = id, .width = 4, .height = 4}, pixels);
+}
+
+} // namespace
+
+TEST(frame_pool, buffer_returns_once_after_the_last_reference) {
+  test_ring  ring(2);
+  frame_pool pool(2, [&](uint32_t b) { ring.recycle(b); });
+
+  frame_ref first = publish(pool, ring, 1, 7);
+  frame_ref display = first;
+  frame_ref statistics = display;
+  EXPECT_EQ(statistics.metadata().frame_id, 7u);
+  EXPECT_EQ(statistics.pixels().data(), ring.buffer(1).data());
+
+  first.reset();
+  display = frame_ref{};
+  EXPECT_EQ(ring.recycled[1].load(), 0u);
+  EXPECT_EQ(pool.live(), 1u);
+
+  frame_ref moved = std::move(statistics);
+  EXPECT_FALSE(statistics);
+  moved.reset();
+  EXPECT_EQ(ring.recycled[1].load(), 1u);
+  EXPECT_EQ(ring.recycled[0].load(), 0u);
+  EXPECT_EQ(pool.live(), 0u);
+}
+
+TEST(frame_pool, handle_acquires_only_while_the_frame_is_held) {
+  test_ring  ring(1);
+  frame_pool pool(1, [&](uint32_t b) { ring.recycle(b); });
+
+  frame_ref  held = publish(pool, ring, 0, 1);
+  const auto handle = held.handle();
+  auto       again = pool.acquire(handle);
+  ASSERT_TRUE(again);
+  EXPECT_EQ(again->metadata().frame_id, 1u);
+
+  held.reset();
+  again.reset();
+  EXPECT_EQ(ring.recycled[0].load(), 1u);
+  EXPECT_FALSE(pool.acquire(handle));
+
+  // The same buffer, refilled: the old handle must not reach the new frame.
+  frame_ref next = publish(pool, ring, 0, 2);
+  EXPECT_EQ(next.handle().index(), handle.index());
+  EXPECT_FALSE(pool.acquire(handle));
+  ASSERT_TRUE(pool.acquire(next.handle()));
+}
+
+TEST(frame_pool, shared_frames_are_never_refilled_while_read) {
+  constexpr uint32_t buffers = 4;
+  constexpr uint64_t frames = 20000;
+  test_ring          ring(buffers, 256);
+  frame_pool         pool(buffers, [&](uint32_t b) { ring.recycle(b); });
+
+  std::mutex        latest_mutex;
+  frame_ref         latest;
+  std::atomic<bool> running{true};
+  std::atomic<int>  torn{0};
+
+  // Display, statistics and the like: each takes a share of the newest
+  // frame and reads all of it.
+  std::vector<std::jthread> consumers;
+  for (int c = 0; c < 3; ++c)
+    consumers.emplace_back([&] {
+      while (running.load()) {
+        frame_ref frame;
+        {
+          std::lock_guard lock(latest_mutex);
+          frame = latest;
+        }
+        if (!frame)
+          continue;
+        const auto id = static_cast<uint16_t>(frame.metadata().frame_id);
+        for (uint16_t p : frame.pixels())
+          if (p != id)
+            torn.fetch_add(1);
+      }
+    });
+
+  uint64_t published = 0;
+  while (published < frames) {
+    auto b = ring.take();
+    if (!b) {
+      std::this_thread::yield();
+      continue;
+    }
+    frame_ref ref = publish(pool, ring, *b, published++);
+    std::lock_guard lock(latest_mutex);
+    latest.swap(ref);
+  }
+  running.store(false);
+  consumers.clear();
+  latest.reset();
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(pool.live(), 0u);
+  uint64_t recycled = 0;
+  for (auto &r : ring.recycled)
+    recycled += r.load();
+  EXPECT_EQ(recycled, frames);
+}
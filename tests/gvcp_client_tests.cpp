@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <gev/error.hpp>
+#include <gev/gvcp_client.hpp>
+#include <gev/protocol.hpp>
+#include <gev/udp_socket.hpp>
+
+#include "../gev/sim/device_description.hpp"
+#include "../gev/sim/simulated_device.hpp"
+
+using namespace std::chrono_literals;
+
+using gev::endpoint;
+using gev::gvcp_client;
+
+namespace {
+
+// Each test talks to its own loopback address, so that test processes run
+// side by side never share a control port.
+constexpr endpoint device_at(uint8_t host) {
+  return {0x7F000000u | (20u << 8) | host, gev::gvcp_port};
+}
+
+// A device the test answers for itself, one command at a time, to see what
+// the client sends and when. READREG is answered with address + 1.
+class scripted_device {
+public:
+  struct command {
+    gev::gvcp_command_header header;
+    std::vector<std::byte>   payload;
+    endpoint                 from;
+  };
+
+  explicit scripted_device(endpoint at) {
+    auto socket = gev::udp_socket::bind(at);
+    EXPECT_TRUE(socket) << socket.error().message();
+    if (socket)
+      socket_ = std::move(*socket);
+  }
+
+  // The next command to arrive within timeout.
+  std::optional<command> receive(std::chrono::milliseconds timeout) {
+    (void)socket_.set_receive_timeout(timeout);
+    std::array<std::byte, 576> datagram;
+    endpoint                   from;
+    auto                       n = socket_.receive_from(datagram, from);
+    if (!n)
+      return std::nullopt;
+    command c{.from = from};
+    if (!c.header.decode(std::span(datagram.data(), *n)))
+      return std::nullopt;
+    c.payload.assign(datagram.begin() + gev::gvcp_header_size, datagram.begin() + *n);
+    return c;
+  }
+
+  void answer_read(const command &c) {
+    std::array<std::byte, 576> datagram;
+    const size_t               count = c.payload.size() / 4;
+    gev::gvcp_ack_header{.answer = gev::gvcp_command::readreg_ack,
+                         .length = static_cast<uint16_t>(count * 4),
+                         .ack_id = c.header.req_id}
+        .encode(datagram.data());
+    for (size_t i = 0; i < count; ++i)
+      gev::store_be(datagram.data() + gev::gvcp_header_size + i * 4,
+                    gev::load_be<uint32_t>(c.payload.data() + i * 4) + 1);
+    (void)socket_.send_to(std::span(datagram.data(), gev::gvcp_header_size + count * 4),
+                          c.from);
+  }
+
+private:
+  gev::udp_socket socket_;
+};
+
+std::unique_ptr<gvcp_client> connect(endpoint device, gvcp_client::options options) {
+  auto client = gvcp_client::connect(device, options);
+  EXPECT_TRUE(client) << client.error().message();
+  return client ? std::move(*client) : nullptr;
+}
+
+std::vector<uint32_t> register_addresses(size_t count) {
+  std::vector<uint32_t> addresses(count);
+  for (size_t i = 0; i < count; ++i)
+    addresses[i] = static_cast<uint32_t>(i * 4);
+  return addresses;
+}
+
+} // namespace
+
+TEST(gvcp_client, splits_long_register_lists_into_commands) {
+  gev::sim::simulated_device sim({.control = device_at(1)});
+  auto                       client = connect(device_at(1), {.max_outstanding = 4});
+  ASSERT_TRUE(client);
+
+  // The bootstrap block, over several READREG commands.
+  const auto addresses = register_addresses(3 * gev::gvcp_max_read_registers + 7);
+  const auto before = sim.stats().control_commands.load();
+  auto       values = client->read_registers(addresses);
+  ASSERT_TRUE(values) << values.error().message();
+  EXPECT_EQ(sim.stats().control_commands.load() - before, 4u);
+
+  ASSERT_EQ(values->size(), addresses.size());
+  for (size_t i = 0; i < addresses.size(); i += 97) {
+    auto one = client->read_register(addresses[i]);
+    ASSERT_TRUE(one);
+    EXPECT_EQ((*values)[i], *one) << "register " << addresses[i];
+  }
+}
+
+TEST(gvcp_client, keeps_at_most_max_outstanding_reads_in_flight) {
+  scripted_device device(device_at(2));
+  auto            client =
+      connect(device_at(2), {.timeout = 2s, .retries = 0, .max_outstanding = 3});
+  ASSERT_TRUE(client);
+
+  const size_t commands = 5;
+  const auto   addresses = register_addresses(commands * gev::gvcp_max_read_registers);
+  auto         read = std::async(std::launch::async,
+                                 [&] { return client->read_registers(addresses); });
+
+  // Three go out at once, and no more until one is answered.
+  std::deque<scripted_device::command> pending;
+  for (int i = 0; i < 3; ++i) {
+    auto c = device.receive(1s);
+    ASSERT_TRUE(c);
+    pending.push_back(std::move(*c));
+  }
+  EXPECT_FALSE(device.receive(100ms));
+
+  size_t received = pending.size();
+  while (!pending.empty()) {
+    device.answer_read(pending.front());
+    pending.pop_front();
+    if (received < commands) {
+      auto c = device.receive(1s);
+      ASSERT_TRUE(c);
+      pending.push_back(std::move(*c));
+      ++received;
+    }
+    EXPECT_LE(pending.size(), 3u);
+  }
+  EXPECT_EQ(received, commands);
+
+  auto values = read.get();
+  ASSERT_TRUE(values) << values.error().message();
+  for (size_t i = 0; i < addresses.size(); ++i)
+    ASSERT_EQ((*values)[i], addresses[i] + 1) << "register " << addresses[i];
+}
+
+TEST(gvcp_client, pipelined_reads_overlap_round_trips) {
+  gev::sim::simulated_device sim({.control = device_at(3), .control_latency = 20ms});
+
+  // 8 commands: one round trip each in turn, two at a time four deep.
+  const auto addresses = register_addresses(1024);
+  const auto time_read = [&](uint32_t max_outstanding) {
+    auto       client = connect(device_at(3), {.max_outstanding = max_outstanding});
+    const auto start = std::chrono::steady_clock::now();
+    auto       values = client->read_registers(addresses);
+    EXPECT_TRUE(values);
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  EXPECT_GE(time_read(1), 8 * 20ms);
+  const auto pipelined = time_read(4);
+  EXPECT_GE(pipelined, 2 * 20ms);
+  EXPECT_LT(pipelined, 8 * 20ms);
+}
+
+TEST(gvcp_client, retries_a_lost_command_with_the_same_request_id) {
+  scripted_device device(device_at(4));
+  auto client = connect(device_at(4), {.timeout = 50ms, .retries = 2});
+  ASSERT_TRUE(client);
+
+  auto read = std::async(std::launch::async, [&] { return client->read_register(0x40); });
+
+  // The first is lost; the retry is answered.
+  auto first = device.receive(1s);
+  ASSERT_TRUE(first);
+  auto second = device.receive(1s);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(second->header.req_id, first->header.req_id);
+  EXPECT_EQ(second->payload, first->payload);
+  device.answer_read(*second);
+
+  auto value = read.get();
+  ASSERT_TRUE(value) << value.error().message();
+  EXPECT_EQ(*value, 0x41u);
+}
+
+TEST(gvcp_client, times_out_after_the_last_retry) {
+  scripted_device device(device_at(5));
+  auto client = connect(device_at(5), {.timeout = 30ms, .retries = 2});
+  ASSERT_TRUE(client);
+
+  const auto start = std::chrono::steady_clock::now();
+  auto       value = client->read_register(0x40);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_FALSE(value);
+  EXPECT_EQ(value.error(), std::make_error_code(std::errc::timed_out));
+  EXPECT_GE(elapsed, 3 * 30ms);
+
+  // The first attempt and two retries, then nothing.
+  int sent = 0;
+  while (device.receive(50ms))
+    ++sent;
+  EXPECT_EQ(sent, 3);
+}
+
+TEST(gvcp_client, reports_a_refused_register) {
+  gev::sim::simulated_device sim({.control = device_at(6)});
+  auto                       client = connect(device_at(6), {});
+  ASSERT_TRUE(client);
+
+  const uint32_t addresses[] = {gev::sim::device_reg::width, gev::sim::device_reg::end};
+  auto           values = client->read_registers(addresses);
+  ASSERT_FALSE(values);
+  EXPECT_EQ(values.error().category(), gev::gvcp_category());
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <recording/history.hpp>
+#include <recording/playback.hpp>
+
+using namespace std::chrono_literals;
+
+using recording::block_size;
+using recording::frame_info;
+using recording::history;
+using recording::history_options;
+using recording::playback;
+
+namespace {
+
+constexpr uint32_t width = 64, height = 48;
+
+// 6 KiB of pixels, 8 KiB in the ring.
+constexpr size_t frame_length = 2 * block_size;
+
+std::vector<uint16_t> test_frame(uint64_t id) {
+  std::vector<uint16_t> pixels(size_t{width} * height);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    pixels[i] = static_cast<uint16_t>((i * 7 + id * 101) & 0x0FFF);
+  return pixels;
+}
+
+bool push(history &h, uint64_t id) {
+  const auto pixels = test_frame(id);
+  return h.push({.frame_id = id,
+                 .device_timestamp = id * 1000,
+                 .width = width,
+                 .height = height,
+                 .pixel_format = 0x01100007, // Mono16
+                 .complete = true},
+                std::as_bytes(std::span(pixels)));
+}
+
+std::vector<uint64_t> ids_from(uint64_t first, uint64_t last) {
+  std::vector<uint64_t> ids;
+  for (uint64_t id = first; id <= last; ++id)
+    ids.push_back(id);
+  return ids;
+}
+
+// A directory of its own per test for the saves.
+class saved_history : public ::testing::Test {
+protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("history_tests_" + std::to_string(::getpid()) + "_" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = dir_ / "history.vkrec";
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::unique_ptr<history> create(history_options options) {
+    auto h = history::create(std::move(options));
+    EXPECT_TRUE(h) << h.error().message();
+    return h ? std::move(*h) : nullptr;
+  }
+
+  // Saves what h holds and waits for the save to finish.
+  recording::history_stats save(history &h) {
+    EXPECT_FALSE(h.save(path_));
+    return wait_for_save(h);
+  }
+
+  static recording::history_stats wait_for_save(history &h) {
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    auto       stats = h.stats();
+    while (stats.saving && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(1ms);
+      stats = h.stats();
+    }
+    EXPECT_FALSE(stats.saving);
+    EXPECT_FALSE(stats.save_error) << stats.save_error.message();
+    return stats;
+  }
+
+  // The save holds exactly these frames, whole and back to back.
+  void expect_saved(std::span<const uint64_t> ids) {
+    auto p = playback::open(path_);
+    ASSERT_TRUE(p) << p.error().message();
+    ASSERT_EQ((*p)->frame_count(), ids.size());
+    uint64_t offset = block_size;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      EXPECT_EQ((*p)->entry(i).frame_id, ids[i]);
+      EXPECT_EQ((*p)->entry(i).offset, offset) << "frame " << i;
+      offset += frame_length;
+      EXPECT_TRUE(std::ranges::equal((*p)->frame(i), test_frame(ids[i])))
+          << "frame " << i;
+    }
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST_F(saved_history, keeps_the_newest_frames_within_the_byte_budget) {
+  auto h = create({.max_bytes = 8 * frame_length, .max_seconds = 100});
+  ASSERT_TRUE(h);
+  for (uint64_t id = 1; id <= 30; ++id)
+    ASSERT_TRUE(push(*h, id));
+
+  auto stats = h->stats();
+  EXPECT_EQ(stats.frames, 8u);
+  EXPECT_EQ(stats.raw_bytes, 8u * width * height * 2);
+  EXPECT_EQ(stats.memory_bytes, 8 * frame_length);
+  EXPECT_EQ(stats.dropped, 0u);
+
+  stats = save(*h);
+  EXPECT_EQ(stats.saved_frames, 8u);
+  expect_saved(ids_from(23, 30));
+}
+
+TEST_F(saved_history, keeps_the_newest_frames_within_the_time_bound) {
+  auto h = create({.max_bytes = 64 * frame_length, .max_seconds = 0.05});
+  ASSERT_TRUE(h);
+  for (uint64_t id = 1; id <= 5; ++id)
+    ASSERT_TRUE(push(*h, id));
+  EXPECT_EQ(h->stats().frames, 5u);
+
+  // Everything from before the pause is too old once the next frame comes.
+  std::this_thread::sleep_for(100ms);
+  ASSERT_TRUE(push(*h, 6));
+  ASSERT_TRUE(push(*h, 7));
+  const auto stats = h->stats();
+  EXPECT_EQ(stats.frames, 2u);
+  EXPECT_LT(stats.seconds, 0.05);
+
+  save(*h);
+  expect_saved(ids_from(6, 7));
+}
+
+TEST_F(saved_history, write_batches_frames_back_to_back_in_memory) {
+  auto h = create({.max_bytes = 8 * frame_length, .max_seconds = 100});
+  ASSERT_TRUE(h);
+  for (uint64_t id = 1; id <= 8; ++id)
+    ASSERT_TRUE(push(*h, id));
+  auto stats = save(*h);
+  EXPECT_EQ(stats.saved_frames, 8u);
+  EXPECT_EQ(stats.save_writes, 1u);
+  expect_saved(ids_from(1, 8));
+
+  // Frames 9 and 10 wrapped to the start of the ring, so 3..8 and 9..10
+  // are two runs; they still lie back to back in the file.
+  ASSERT_TRUE(push(*h, 9));
+  ASSERT_TRUE(push(*h, 10));
+  stats = save(*h);
+  EXPECT_EQ(stats.saved_frames, 8u);
+  EXPECT_EQ(stats.save_writes, 2u);
+  expect_saved(ids_from(3, 10));
+}
+
+TEST_F(saved_history, a_save_keeps_its_frames_while_push_continues) {
+  auto h = create({.max_bytes = 8 * frame_length, .max_seconds = 100});
+  ASSERT_TRUE(h);
+  for (uint64_t id = 1; id <= 8; ++id)
+    ASSERT_TRUE(push(*h, id));
+
+  // The ring is full of frames the save has yet to write. Pushing on
+  // either takes memory the save has finished with, or drops the frame;
+  // it never overwrites one still to be written.
+  ASSERT_FALSE(h->save(path_));
+  EXPECT_EQ(h->save(dir_ / "other.vkrec"),
+            std::make_error_code(std::errc::device_or_resource_busy));
+  uint64_t kept = 0;
+  for (uint64_t id = 9; id <= 2008; ++id)
+    kept += push(*h, id);
+
+  const auto stats = wait_for_save(*h);
+  EXPECT_EQ(stats.save_frames, 8u);
+  EXPECT_EQ(stats.saved_frames, 8u);
+  EXPECT_EQ(stats.dropped, 2000 - kept);
+  expect_saved(ids_from(1, 8));
+
+  // With the save done, nothing holds the ring.
+  EXPECT_TRUE(push(*h, 2009));
+}
@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <latch>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <jobs/chase_lev_deque.hpp>
+#include <jobs/job_system.hpp>
+
+using namespace engine::jobs;
+
+namespace {
+
+uint64_t fibonacci(job_system &jobs, uint32_t n) {
+  if (n < 2)
+    return n;
+  uint64_t a = 0, b = 0;
+  jobs.join([&] { a = fibonacci(jobs, n - 1); },
+            [&] { b = fibonacci(jobs, n - 2); });
+  return a + b;
+}
+
+} // namespace
+
+TEST(chase_lev_deque, owner_pops_lifo_and_thieves_steal_fifo) {
+  chase_lev_deque<int> deque;
+  for (int i = 0; i < 4; ++i)
+    deque.push(i);
+
+  EXPECT_EQ(deque.steal(), 0);
+  EXPECT_EQ(deque.pop(), 3);
+  EXPECT_EQ(deque.steal(), 1);
+  EXPECT_EQ(deque.pop(), 2);
+  EXPECT_FALSE(deque.pop().has_value());
+  EXPECT_FALSE(deque.steal().has_value());
+}
+
+TEST(chase_lev_deque, grows_past_its_initial_capacity) {
+  chase_lev_deque<int> deque(4);
+  for (int i = 0; i < 1000; ++i)
+    deque.push(i);
+  EXPECT_GE(deque.capacity(), 1000u);
+  EXPECT_EQ(deque.size(), 1000u);
+  for (int i = 999; i >= 0; --i)
+    ASSERT_EQ(deque.pop(), i);
+}
+
+TEST(chase_lev_deque, every_item_is_taken_exactly_once_under_contention) {
+  constexpr int        items = 200000;
+  chase_lev_deque<int> deque(16);
+  std::vector<std::atomic<int>> taken(items);
+  std::atomic<bool>             pushing{true};
+
+  std::vector<std::jthread> thieves;
+  for (int t = 0; t < 3; ++t)
+    thieves.emplace_back([&] {
+      while (pushing.load() || !deque.empty())
+        if (auto v = deque.steal())
+          taken[*v].fetch_add(1);
+    });
+
+  for (int i = 0; i < items; ++i) {
+    deque.push(i);
+    // Pop now and then, so the owner races thieves for the last item.
+    if (i % 3 == 0)
+      if (auto v = deque.pop())
+        taken[*v].fetch_add(1);
+  }
+  while (auto v = deque.pop())
+    taken[*v].fetch_add(1);
+  pushing.store(false);
+  thieves.clear();
+
+  for (int i = 0; i < items; ++i)
+    ASSERT_EQ(taken[i].load(), 1) << "item " << i;
+}
+
+TEST(job_system, parallel_for_visits_every_index_once) {
+  job_system jobs({.threads = 4});
+  for (size_t grain : {size_t{0}, size_t{1}, size_t{7}, size_t{1000}}) {
+    std::vector<std::atomic<int>> visits(10007);
+    jobs.parallel_for(0, visits.size(), grain, [&](size_t begin, size_t end) {
+      EXPECT_LT(begin, end);
+      for (size_t i = begin; i < end; ++i)
+        visits[i].fetch_add(1);
+    });
+    for (size_t i = 0; i < visits.size(); ++i)
+      ASSERT_EQ(visits[i].load(), 1) << "grain " << grain << ", index " << i;
+  }
+}
+
+TEST(job_system, parallel_for_tiles_cover_the_space_once) {
+  job_system jobs({.threads = 4});
+  // Neither dimension a multiple of the tile.
+  constexpr uint32_t            width = 301, height = 77;
+  std::vector<std::atomic<int>> visits(size_t{width} * height);
+  jobs.parallel_for(width, height, 64, 16, [&](const tile &t) {
+    EXPECT_GT(t.width, 0u);
+    EXPECT_GT(t.height, 0u);
+    EXPECT_LE(t.width, 64u);
+    EXPECT_LE(t.height, 16u);
+    for (uint32_t y = t.y; y < t.y + t.height; ++y)
+      for (uint32_t x = t.x; x < t.x + t.width; ++x)
+        visits[size_t{y} * width + x].fetch_add(1);
+  });
+  for (size_t i = 0; i < visits.size(); ++i)
+    ASSERT_EQ(visits[i].load(), 1) << "pixel " << i;
+}
+
+TEST(job_system, nested_fork_join_completes) {
+  job_system jobs({.threads = 4});
+  EXPECT_EQ(fibonacci(jobs, 24), 46368u);
+}
+
+TEST(job_system, groups_waited_from_several_threads_complete) {
+  job_system                jobs({.threads = 2});
+  std::atomic<int>          total{0};
+  std::vector<std::jthread> callers;
+  for (int c = 0; c < 4; ++c)
+    callers.emplace_back([&] {
+      for (int round = 0; round < 50; ++round) {
+        task_group group(jobs);
+        for (int j = 0; j < 20; ++j)
+          group.run([&] { total.fetch_add(1); });
+        group.wait();
+      }
+    });
+  callers.clear();
+  EXPECT_EQ(total.load(), 4 * 50 * 20);
+}
+
+TEST(job_system, higher_priorities_run_first) {
+  job_system jobs({.threads = 1});
+
+  // Keep the only worker busy while the others queue up.
+  std::latch started(1), release(1);
+  task_group blocker(jobs);
+  blocker.run([&] {
+    started.count_down();
+    release.wait();
+  });
+  started.wait();
+
+  std::mutex             mutex;
+  std::vector<priority>  order;
+  task_group             group(jobs);
+  for (priority p : {priority::low, priority::normal, priority::high, priority::low,
+                     priority::high})
+    group.run(
+        [&, p] {
+          std::lock_guard lock(mutex);
+          order.push_back(p);
+        },
+        {.priority = p});
+
+  release.count_down();
+  // Let the worker drain them alone rather than racing it from here.
+  while (!group.done())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  group.wait();
+  blocker.wait();
+
+  EXPECT_EQ(order, (std::vector{priority::high, priority::high, priority::normal,
+                                priority::low, priority::low}));
+}
+
+TEST(job_system, hinted_job_is_not_stranded_behind_a_busy_worker) {
+  job_system jobs({.threads = 1});
+
+  std::latch started(1), release(1);
+  task_group blocker(jobs);
+  blocker.run([&] {
+    started.count_down();
+    release.wait();
+  });
+  started.wait();
+
+  // Worker 0 is stuck, so the waiting thread has to take the job over.
+  bool       ran = false;
+  task_group group(jobs);
+  group.run([&] { ran = true; }, {.worker = 0});
+  group.wait();
+  EXPECT_TRUE(ran);
+
+  release.count_down();
+  blocker.wait();
+}
+
+TEST(job_system, outside_waiter_leaves_less_urgent_jobs_to_the_workers) {
+  job_system jobs({.threads = 1});
+
+  // The only worker runs the group's one job while low jobs queue behind.
+  std::latch started(1);
+  task_group group(jobs);
+  group.run(
+      [&] {
+        started.count_down();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      },
+      {.priority = priority::high});
+  started.wait();
+
+  const auto        waiter = std::this_thread::get_id();
+  std::atomic<bool> waiting{true};
+  std::atomic<int>  ran{0}, ran_by_waiter{0};
+  task_group        background(jobs);
+  for (int j = 0; j < 4; ++j)
+    background.run(
+        [&] {
+          if (std::this_thread::get_id() == waiter && waiting.load())
+            ran_by_waiter.fetch_add(1);
+          ran.fetch_add(1);
+        },
+        {.priority = priority::low});
+
+  group.wait();
+  waiting.store(false);
+  background.wait();
+  EXPECT_EQ(ran_by_waiter.load(), 0);
+  EXPECT_EQ(ran.load(), 4);
+}
+
+TEST(job_system, outside_waiter_runs_its_own_low_jobs) {
+  job_system jobs({.threads = 1});
+
+  std::latch started(1), release(1);
+  task_group blocker(jobs);
+  blocker.run([&] {
+    started.count_down();
+    release.wait();
+  });
+  started.wait();
+
+  // With the worker stuck, only the waiting thread is left to do them.
+  std::atomic<size_t> total{0};
+  jobs.parallel_for(
+      0, 1000, 10, [&](size_t first, size_t last) { total.fetch_add(last - first); },
+      priority::low);
+  EXPECT_EQ(total.load(), 1000u);
+
+  release.count_down();
+  blocker.wait();
+}
+
+TEST(job_system, workers_report_their_index_and_start_hook_runs) {
+  std::mutex         mutex;
+  std::set<uint32_t> started;
+  job_system         jobs({.threads = 3, .on_start = [&](uint32_t worker) {
+                     std::lock_guard lock(mutex);
+                     started.insert(worker);
+                   }});
+
+  EXPECT_EQ(jobs.size(), 3u);
+  EXPECT_EQ(jobs.current_worker(), any_worker);
+
+  std::atomic<bool> in_range{true};
+  jobs.parallel_for(0, 1000, 1, [&](size_t, size_t) {
+    const uint32_t w = jobs.current_worker();
+    if (w != any_worker && w >= jobs.size())
+      in_range.store(false);
+  });
+  EXPECT_TRUE(in_range.load());
+
+  // on_start runs as each thread comes up; give the last one a moment.
+  for (int i = 0; i < 1000; ++i) {
+    {
+      std::lock_guard lock(mutex);
+      if (started.size() == 3)
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::lock_guard lock(mutex);
+  EXPECT_EQ(started, (std::set<uint32_t>{0, 1, 2}));
+}
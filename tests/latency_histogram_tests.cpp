@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <gev/latency_histogram.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(latency_histogram, buckets_are_powers_of_two_microseconds) {
+  using h = gev::latency_histogram;
+
+  EXPECT_EQ(h::bucket_of(0ns), 0u);
+  EXPECT_EQ(h::bucket_of(999ns), 0u);
+  EXPECT_EQ(h::bucket_of(1us), 1u);
+  EXPECT_EQ(h::bucket_of(3us), 2u);
+  EXPECT_EQ(h::bucket_of(4us), 3u);
+  EXPECT_EQ(h::bucket_of(-5us), 0u);
+  EXPECT_EQ(h::bucket_of(1h), h::bucket_count - 1);
+}
+
+TEST(latency_histogram, empty_snapshot_reports_zero) {
+  gev::latency_histogram h;
+
+  const auto s = h.read();
+  EXPECT_EQ(s.count, 0u);
+  EXPECT_EQ(s.mean(), 0ns);
+  EXPECT_EQ(s.quantile(0.99), 0ns);
+}
+
+TEST(latency_histogram, quantiles_bound_the_recorded_samples) {
+  gev::latency_histogram h;
+
+  for (int i = 0; i < 99; ++i)
+    h.record(3us);
+  h.record(700us);
+
+  const auto s = h.read();
+  EXPECT_EQ(s.count, 100u);
+  EXPECT_EQ(s.max, 700us);
+  EXPECT_EQ(s.quantile(0.5), 4us);
+  EXPECT_EQ(s.quantile(0.99), 4us);
+  EXPECT_EQ(s.quantile(1.0), 700us); // Capped at the maximum seen.
+  EXPECT_EQ(s.mean(), std::chrono::nanoseconds(99 * 3us + 700us) / 100);
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <utility/mutex_protected.hpp>
+
+TEST(mutex_protected, lock_exposes_the_protected_object) {
+  mutex_protected<std::vector<int>> v(3, 1);
+
+  auto [values, lock] = v.lock();
+  EXPECT_TRUE(lock.owns_lock());
+  EXPECT_EQ(values.size(), 3u);
+}
+
+TEST(mutex_protected, concurrent_updates_are_serialised) {
+  mutex_protected<long> counter(0);
+
+  constexpr int            threads = 4;
+  constexpr int            iterations = 10000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([&] {
+      for (int i = 0; i < iterations; ++i) {
+        auto [value, lock] = counter.lock();
+        ++value;
+      }
+    });
+  for (auto &w : workers)
+    w.join();
+
+  auto [value, lock] = counter.lock();
+  EXPECT_EQ(value, threads * iterations);
+}
@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+#include <gev/node_map.hpp>
+
+using gev::node_index;
+using gev::node_kind;
+using gev::node_map;
+
+namespace {
+
+// A small description covering what the parser acts on: categories,
+// forward references, register properties, enumerations with entries,
+// entities, CDATA, comments and a reference to nothing.
+constexpr std::string_view description = R"(<?xml version="1.0" encoding="utf-8"?>
+<RegisterDescription ModelName="Test" VendorName="Test">
+  <Category Name="Root">
+    <pFeature>Width</pFeature>
+    <pFeature>PixelFormat</pFeature>
+    <pFeature>Missing</pFeature>
+  </Category>
+  <Integer Name="Width">
+    <ToolTip>Width &lt;in pixels&gt; &amp; more &#x263A; &#65;</ToolTip>
+    <pValue>WidthReg</pValue>
+    <pMax>WidthMax</pMax>
+    <pInvalidator>Binning</pInvalidator>
+  </Integer>
+  <IntReg Name="WidthReg">
+    <Address>0x100</Address>
+    <Address>0x4</Address>
+    <Length>4</Length>
+    <AccessMode>RW</AccessMode>
+    <Cachable>NoCache</Cachable>
+    <Endianess>LittleEndian</Endianess>
+  </IntReg>
+  <Integer Name="WidthMax"><Value>4096</Value></Integer>
+  <Integer Name="Binning"><Value>1</Value></Integer>
+  <Enumeration Name="PixelFormat">
+    <DisplayName><![CDATA[Pixel <Format> & more]]></DisplayName>
+    <Visibility>Expert</Visibility>
+    <EnumEntry Name="Mono8"><Value>0x01080001</Value></EnumEntry>
+    <EnumEntry Name="Mono16"><Value>0x01100007</Value></EnumEntry>
+    <pValue>PixelFormatReg</pValue>
+  </Enumeration>
+  <IntReg Name="PixelFormatReg">
+    <Address>0x200</Address>
+    <Length>4</Length>
+    <AccessMode>RO</AccessMode>
+  </IntReg>
+  <!-- <Integer Name="Ghost"><Value>1</Value></Integer> -->
+  <Port Name="Device"/>
+</RegisterDescription>
+)";
+
+// A directory of its own per test, removed afterwards.
+class node_map_cache : public ::testing::Test {
+protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("node_map_tests_" + std::to_string(::getpid()) + "_" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::filesystem::remove_all(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::filesystem::path dir_;
+};
+
+node_index find(const node_map &map, std::string_view name) {
+  auto i = map.find(name);
+  EXPECT_TRUE(i) << name;
+  return i.value_or(gev::no_node);
+}
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), {}};
+}
+
+void write_file(const std::filesystem::path &path, std::string_view bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Two maps hold the same nodes and links, whatever their string storage.
+void expect_same(const node_map &a, const node_map &b) {
+  ASSERT_EQ(a.size(), b.size());
+  ASSERT_EQ(a.links().size(), b.links().size());
+  EXPECT_EQ(a.root(), b.root());
+  EXPECT_EQ(a.unresolved_references(), b.unresolved_references());
+
+  for (node_index i = 0; i < a.size(); ++i) {
+    const auto &x = a[i], &y = b[i];
+    SCOPED_TRACE(std::string(a.str(x.name)));
+    EXPECT_EQ(a.str(x.name), b.str(y.name));
+    EXPECT_EQ(a.str(x.display_name), b.str(y.display_name));
+    EXPECT_EQ(a.str(x.tooltip), b.str(y.tooltip));
+    EXPECT_EQ(a.str(x.value), b.str(y.value));
+    EXPECT_EQ(x.kind, y.kind);
+    EXPECT_EQ(x.address, y.address);
+    EXPECT_EQ(x.constant, y.constant);
+    EXPECT_EQ(x.length, y.length);
+    EXPECT_EQ(x.value_ref, y.value_ref);
+    EXPECT_EQ(x.max_ref, y.max_ref);
+    EXPECT_EQ(x.access, y.access);
+    EXPECT_EQ(x.cache, y.cache);
+    EXPECT_EQ(x.visibility, y.visibility);
+    EXPECT_EQ(x.little_endian, y.little_endian);
+    for (auto range : {&gev::node::children, &gev::node::invalidators,
+                       &gev::node::selected, &gev::node::variables}) {
+      const auto la = a.links(x.*range), lb = b.links(y.*range);
+      ASSERT_EQ(la.size(), lb.size());
+      for (size_t k = 0; k < la.size(); ++k) {
+        EXPECT_EQ(la[k].target, lb[k].target);
+        EXPECT_EQ(a.str(la[k].label), b.str(lb[k].label));
+      }
+    }
+  }
+
+  for (node_index i = 0; i < a.size(); ++i) {
+    if (!a[i].name.empty()) {
+      EXPECT_EQ(b.find(a.str(a[i].name)), i);
+    }
+  }
+}
+
+} // namespace
+
+TEST(node_map, resolves_references_by_name) {
+  auto map = node_map::parse(std::string(description));
+  ASSERT_TRUE(map) << map.error().message();
+  EXPECT_FALSE(map->from_cache());
+
+  const node_index root = find(*map, "Root");
+  EXPECT_EQ(map->root(), root);
+  EXPECT_FALSE(map->find("Ghost")); // Commented out.
+  EXPECT_FALSE(map->find("Missing"));
+  EXPECT_EQ(map->unresolved_references(), 1u);
+
+  const auto features = map->links((*map)[root].children);
+  ASSERT_EQ(features.size(), 2u);
+  EXPECT_EQ(features[0].target, find(*map, "Width"));
+  EXPECT_EQ(features[1].target, find(*map, "PixelFormat"));
+
+  const auto &width = (*map)[find(*map, "Width")];
+  EXPECT_EQ(width.kind, node_kind::integer);
+  EXPECT_EQ(width.value_ref, find(*map, "WidthReg"));
+  EXPECT_EQ(width.max_ref, find(*map, "WidthMax"));
+  EXPECT_EQ(width.min_ref, gev::no_node);
+  ASSERT_EQ(width.invalidators.count, 1u);
+  EXPECT_EQ(map->links(width.invalidators)[0].target, find(*map, "Binning"));
+
+  const auto &reg = (*map)[find(*map, "WidthReg")];
+  EXPECT_EQ(reg.kind, node_kind::int_reg);
+  EXPECT_EQ(reg.address, 0x104u); // Every <Address> is summed.
+  EXPECT_EQ(reg.length, 4u);
+  EXPECT_EQ(reg.cache, gev::cachable::no_cache);
+  EXPECT_TRUE(reg.little_endian);
+  EXPECT_EQ((*map)[find(*map, "PixelFormatReg")].access, gev::access_mode::ro);
+
+  const auto &format = (*map)[find(*map, "PixelFormat")];
+  EXPECT_EQ(format.kind, node_kind::enumeration);
+  EXPECT_EQ(format.visibility, gev::visibility_level::expert);
+  EXPECT_EQ(format.value_ref, find(*map, "PixelFormatReg"));
+  const auto entries = map->links(format.children);
+  ASSERT_EQ(entries.size(), 2u);
+  EXPECT_EQ(map->str((*map)[entries[0].target].name), "Mono8");
+  EXPECT_EQ((*map)[entries[1].target].kind, node_kind::enum_entry);
+  EXPECT_EQ((*map)[entries[1].target].constant, 0x01100007);
+
+  EXPECT_EQ((*map)[find(*map, "Device")].kind, node_kind::port);
+}
+
+TEST(node_map, decodes_entities_and_cdata) {
+  auto map = node_map::parse(std::string(description));
+  ASSERT_TRUE(map) << map.error().message();
+
+  EXPECT_EQ(map->str((*map)[find(*map, "Width")].tooltip),
+            "Width <in pixels> & more \xE2\x98\xBA A");
+  // CDATA is taken as written.
+  EXPECT_EQ(map->str((*map)[find(*map, "PixelFormat")].display_name),
+            "Pixel <Format> & more");
+}
+
+TEST(node_map, rejects_malformed_xml) {
+  for (std::string_view xml : {
+           "<RegisterDescription><Integer Name=\"A\"></RegisterDescription>",
+           "<RegisterDescription><Integer Name=\"A\">",
+           "<RegisterDescription><Integer Name=\"A></Integer></RegisterDescription>",
+           "<RegisterDescription><Integer Name></Integer></RegisterDescription>",
+       }) {
+    auto map = node_map::parse(std::string(xml));
+    ASSERT_FALSE(map) << xml;
+    EXPECT_EQ(map.error(), std::errc::bad_message) << xml;
+  }
+}
+
+TEST_F(node_map_cache, cache_round_trip_matches_a_fresh_parse) {
+  const std::string xml(description);
+  auto              parsed = node_map::parse(xml);
+  ASSERT_TRUE(parsed);
+
+  const auto path = node_map::cache_file(dir_, node_map::hash(xml));
+  ASSERT_TRUE(parsed->save(path));
+
+  auto loaded = node_map::load(path, node_map::hash(xml), xml.size());
+  ASSERT_TRUE(loaded) << loaded.error().message();
+  EXPECT_TRUE(loaded->from_cache());
+  expect_same(*parsed, *loaded);
+
+  // A mapped cache is not a source to key another cache by.
+  EXPECT_FALSE(loaded->save(dir_ / "again.bin"));
+}
+
+TEST_F(node_map_cache, load_or_compile_writes_then_maps_the_cache) {
+  const std::string xml(description);
+  auto              first = node_map::load_or_compile(xml, dir_);
+  ASSERT_TRUE(first);
+  EXPECT_FALSE(first->from_cache());
+  EXPECT_TRUE(std::filesystem::exists(node_map::cache_file(dir_, node_map::hash(xml))));
+
+  auto second = node_map::load_or_compile(xml, dir_);
+  ASSERT_TRUE(second);
+  EXPECT_TRUE(second->from_cache());
+  expect_same(*first, *second);
+
+  // Another description misses the cache rather than mapping this one.
+  std::string other = xml;
+  other.replace(other.find("4096"), 4, "8192");
+  auto third = node_map::load_or_compile(other, dir_);
+  ASSERT_TRUE(third);
+  EXPECT_FALSE(third->from_cache());
+  EXPECT_EQ(third->str((*third)[find(*third, "WidthMax")].value), "8192");
+}
+
+TEST_F(node_map_cache, rejects_truncated_and_corrupted_caches) {
+  const std::string xml(description);
+  const uint64_t    hash = node_map::hash(xml);
+  auto              parsed = node_map::parse(xml);
+  ASSERT_TRUE(parsed);
+  const auto path = dir_ / "map.bin";
+  ASSERT_TRUE(parsed->save(path));
+  const std::string good = read_file(path);
+
+  const auto expect_rejected = [&](std::string_view bytes, const char *what) {
+    write_file(path, bytes);
+    auto map = node_map::load(path, hash, xml.size());
+    ASSERT_FALSE(map) << what;
+    EXPECT_EQ(map.error(), std::errc::invalid_argument) << what;
+  };
+
+  EXPECT_TRUE(node_map::load(path, hash, xml.size()));
+  EXPECT_FALSE(node_map::load(path, hash + 1, xml.size()));
+  EXPECT_FALSE(node_map::load(path, hash, xml.size() + 1));
+
+  expect_rejected("", "empty");
+  expect_rejected(std::string_view(good).substr(0, 20), "inside the header");
+  expect_rejected(std::string_view(good).substr(0, good.size() - 1), "truncated");
+
+  std::string bad = good;
+  bad[0] ^= 0x20;
+  expect_rejected(bad, "magic");
+
+  // Out-of-range indices in an otherwise well-formed file. The header is
+  // 56 bytes, the nodes follow it and the links follow them.
+  constexpr size_t header_size = 56, root_offset = 48;
+  const uint32_t   huge = static_cast<uint32_t>(parsed->size()) + 5;
+  const auto       field = [&](size_t offset) {
+    uint32_t v;
+    std::memcpy(&v, good.data() + offset, sizeof(v));
+    return v;
+  };
+  ASSERT_EQ(field(root_offset), parsed->root());
+
+  bad = good;
+  std::memcpy(bad.data() + root_offset, &huge, sizeof(huge));
+  expect_rejected(bad, "root");
+
+  const size_t links = (header_size + parsed->size() * sizeof(gev::node) + 7) & ~size_t{7};
+  ASSERT_EQ(field(links), parsed->links()[0].target);
+  bad = good;
+  std::memcpy(bad.data() + links, &huge, sizeof(huge));
+  expect_rejected(bad, "link target");
+
+  // Past the string pool, even for an empty string.
+  bad = good;
+  const uint32_t far = 0x10000;
+  std::memcpy(bad.data() + header_size + offsetof(gev::node, tooltip), &far, sizeof(far));
+  expect_rejected(bad, "string offset");
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <latch>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <processing/pipeline.hpp>
+
+using processing::pipeline;
+using processing::stage_mode;
+
+namespace {
+
+struct test_frame {
+  uint64_t         id = 0;
+  std::vector<int> pixels;
+};
+
+// A few tens of microseconds, differing per frame, so that frames overtake
+// one another in parallel stages.
+void jitter(uint64_t id) {
+  std::this_thread::sleep_for(std::chrono::microseconds((id * 7919) % 61));
+}
+
+} // namespace
+
+TEST(pipeline, ordered_stage_sees_frames_in_push_order) {
+  engine::jobs::job_system jobs({.threads = 4});
+  pipeline<test_frame>     p(jobs, 8);
+  std::vector<uint64_t>    seen;
+  p.add_stage("scatter", stage_mode::parallel, [](test_frame &f) { jitter(f.id); });
+  p.add_stage("gather", stage_mode::ordered, [&](test_frame &f) { seen.push_back(f.id); });
+
+  for (uint64_t i = 0; i < 500; ++i)
+    p.push([i](test_frame &f) { f.id = i; });
+  p.drain();
+
+  ASSERT_EQ(seen.size(), 500u);
+  for (uint64_t i = 0; i < seen.size(); ++i)
+    ASSERT_EQ(seen[i], i);
+}
+
+TEST(pipeline, serial_stages_never_overlap_and_in_flight_is_bounded) {
+  engine::jobs::job_system jobs({.threads = 4});
+  constexpr uint32_t       in_flight = 4;
+  pipeline<test_frame>     p(jobs, in_flight);
+
+  std::atomic<int>      inside{0}, overlapped{0};
+  std::atomic<uint32_t> live{0}, most_live{0};
+  p.add_stage("enter", stage_mode::parallel, [&](test_frame &f) {
+    const uint32_t n = live.fetch_add(1) + 1;
+    if (n > most_live.load())
+      most_live.store(n);
+    jitter(f.id);
+  });
+  p.add_stage("serial", stage_mode::serial, [&](test_frame &f) {
+    if (inside.fetch_add(1) != 0)
+      overlapped.fetch_add(1);
+    jitter(f.id);
+    inside.fetch_sub(1);
+  });
+  p.add_stage("leave", stage_mode::parallel, [&](test_frame &) { live.fetch_sub(1); });
+
+  for (uint64_t i = 0; i < 300; ++i)
+    p.push([i](test_frame &f) { f.id = i; });
+  p.drain();
+
+  EXPECT_EQ(overlapped.load(), 0);
+  EXPECT_LE(most_live.load(), in_flight);
+  EXPECT_EQ(live.load(), 0u);
+}
+
+TEST(pipeline, try_push_fails_while_every_frame_is_in_flight) {
+  engine::jobs::job_system jobs({.threads = 1});
+  pipeline<test_frame>     p(jobs, 2);
+  std::latch               release(1);
+  p.add_stage("hold", stage_mode::parallel, [&](test_frame &) { release.wait(); });
+
+  EXPECT_TRUE(p.try_push([](test_frame &f) { f.id = 0; }));
+  EXPECT_TRUE(p.try_push([](test_frame &f) { f.id = 1; }));
+  bool filled = false;
+  EXPECT_FALSE(p.try_push([&](test_frame &) { filled = true; }));
+  EXPECT_FALSE(filled);
+
+  release.count_down();
+  p.drain();
+  EXPECT_TRUE(p.try_push([](test_frame &f) { f.id = 2; }));
+  p.drain();
+}
+
+TEST(pipeline, frames_are_reused_without_reallocating) {
+  engine::jobs::job_system jobs({.threads = 2});
+  pipeline<test_frame>     p(jobs, 3);
+  std::atomic<int>         reallocated{0};
+  p.add_stage("fill", stage_mode::parallel, [&](test_frame &f) {
+    const auto *before = f.pixels.data();
+    f.pixels.resize(4096);
+    if (f.id >= 3 && f.pixels.data() != before)
+      reallocated.fetch_add(1);
+  });
+
+  for (uint64_t i = 0; i < 3; ++i)
+    p.push([i](test_frame &f) { f.id = i; });
+  p.drain();
+  for (uint64_t i = 3; i < 50; ++i)
+    p.push([i](test_frame &f) { f.id = i; });
+  p.drain();
+
+  EXPECT_EQ(reallocated.load(), 0);
+}
+
+TEST(pipeline, stats_count_every_stage_and_frame) {
+  engine::jobs::job_system jobs({.threads = 2});
+  pipeline<test_frame>     p(jobs, 4);
+  p.add_stage("a", stage_mode::ordered, [](test_frame &f) { jitter(f.id); });
+  p.add_stage("b", stage_mode::parallel, [](test_frame &f) { jitter(f.id); });
+
+  for (uint64_t i = 0; i < 100; ++i)
+    p.push([i](test_frame &f) { f.id = i; });
+  p.drain();
+
+  const auto s = p.stats();
+  EXPECT_EQ(s.frames, 100u);
+  EXPECT_EQ(s.latency.count, 100u);
+  EXPECT_EQ(s.in_flight, 0u);
+  ASSERT_EQ(s.stages.size(), 2u);
+  EXPECT_EQ(s.stages[0].name, "a");
+  EXPECT_EQ(s.stages[0].mode, stage_mode::ordered);
+  for (const auto &st : s.stages) {
+    EXPECT_EQ(st.frames, 100u);
+    EXPECT_EQ(st.wait.count, 100u);
+    EXPECT_EQ(st.queued, 0u);
+    EXPECT_GT(st.occupancy, 0.0);
+  }
+  // One frame at a time: a serial stage cannot be busy for longer than
+  // the pipeline has run.
+  EXPECT_LE(s.stages[0].occupancy, 1.0);
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+#include <recording/playback.hpp>
+#include <recording/recorder.hpp>
+
+using recording::block_size;
+using recording::frame_info;
+using recording::index_entry;
+using recording::playback;
+using recording::recorder;
+using recording::recorder_options;
+
+namespace {
+
+constexpr uint32_t width = 64, height = 48;
+
+// Distinct per frame and smooth enough to compress.
+std::vector<uint16_t> test_frame(uint64_t id) {
+  std::vector<uint16_t> pixels(size_t{width} * height);
+  for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x)
+      pixels[size_t{y} * width + x] =
+          static_cast<uint16_t>((x * 7 + y * 13 + id * 101) & 0x0FFF);
+  return pixels;
+}
+
+frame_info info_for(uint64_t id) {
+  return {.frame_id = id,
+          .device_timestamp = id * 1000,
+          .width = width,
+          .height = height,
+          .pixel_format = 0x01100007, // Mono16
+          .complete = id % 5 != 3};
+}
+
+bool push(recorder &r, uint64_t id) {
+  const auto pixels = test_frame(id);
+  return r.push(info_for(id), std::as_bytes(std::span(pixels)));
+}
+
+constexpr uint64_t align_up(uint64_t n) {
+  return (n + block_size - 1) / block_size * block_size;
+}
+
+// A file of its own per test, removed with its index afterwards.
+class recording_file : public ::testing::Test {
+protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() /
+           ("recorder_tests_" + std::to_string(::getpid()) + "_" +
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+    path_ = dir_ / "frames.vkrec";
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::unique_ptr<recorder> create(recorder_options options) {
+    options.path = path_;
+    auto r = recorder::create(std::move(options));
+    EXPECT_TRUE(r) << r.error().message();
+    return r ? std::move(*r) : nullptr;
+  }
+
+  std::unique_ptr<playback> open() {
+    auto p = playback::open(path_);
+    EXPECT_TRUE(p) << p.error().message();
+    return p ? std::move(*p) : nullptr;
+  }
+
+  // Every frame played back is the one pushed under its id, with its
+  // metadata, at the block-aligned offset after the one before it.
+  void expect_frames(playback &p, std::span<const uint64_t> ids) {
+    ASSERT_EQ(p.frame_count(), ids.size());
+    uint64_t offset = block_size;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      const index_entry &e = p.entry(i);
+      EXPECT_EQ(e.frame_id, ids[i]);
+      EXPECT_EQ(e.device_timestamp, ids[i] * 1000);
+      EXPECT_EQ(e.width, width);
+      EXPECT_EQ(e.height, height);
+      EXPECT_EQ((e.flags & recording::frame_incomplete) != 0, ids[i] % 5 == 3);
+      EXPECT_EQ(e.offset, offset) << "frame " << i;
+      offset += align_up(e.bytes);
+
+      const auto pixels = p.frame(i);
+      const auto expected = test_frame(ids[i]);
+      ASSERT_EQ(pixels.size(), expected.size()) << "frame " << i;
+      EXPECT_TRUE(std::ranges::equal(pixels, expected)) << "frame " << i;
+    }
+    // Truncated to the last frame's block, however far it was preallocated.
+    EXPECT_EQ(std::filesystem::file_size(path_), offset);
+  }
+
+  std::filesystem::path dir_;
+  std::filesystem::path path_;
+};
+
+std::vector<uint64_t> iota(uint64_t count) {
+  std::vector<uint64_t> ids(count);
+  for (uint64_t i = 0; i < count; ++i)
+    ids[i] = i + 1;
+  return ids;
+}
+
+} // namespace
+
+TEST_F(recording_file, frames_play_back_as_pushed) {
+  auto r = create({.preallocate_bytes = 1 << 20});
+  ASSERT_TRUE(r);
+  const auto ids = iota(40);
+  for (uint64_t id : ids)
+    ASSERT_TRUE(push(*r, id));
+  ASSERT_FALSE(r->finish());
+
+  const auto stats = r->stats();
+  EXPECT_EQ(stats.frames, ids.size());
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_EQ(stats.raw_bytes, ids.size() * width * height * 2);
+
+  auto p = open();
+  ASSERT_TRUE(p);
+  expect_frames(*p, ids);
+}
+
+TEST_F(recording_file, thread_pool_writes_the_same_file) {
+  auto r = create({.preallocate_bytes = 1 << 20, .force_thread_pool = true});
+  ASSERT_TRUE(r);
+  EXPECT_EQ(r->backend(), recording::write_backend::thread_pool);
+  const auto ids = iota(40);
+  for (uint64_t id : ids)
+    ASSERT_TRUE(push(*r, id));
+  ASSERT_FALSE(r->finish());
+
+  auto p = open();
+  ASSERT_TRUE(p);
+  expect_frames(*p, ids);
+}
+
+TEST_F(recording_file, finish_writes_the_header_and_index) {
+  auto r = create({.preallocate_bytes = 8 << 20});
+  ASSERT_TRUE(r);
+  const auto ids = iota(7);
+  for (uint64_t id : ids)
+    ASSERT_TRUE(push(*r, id));
+  ASSERT_FALSE(r->finish());
+  // Once finished, frames are refused and finishing again changes nothing.
+  EXPECT_FALSE(push(*r, 100));
+  EXPECT_FALSE(r->finish());
+
+  recording::file_header header{};
+  {
+    std::ifstream file(path_, std::ios::binary);
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    ASSERT_TRUE(file);
+  }
+  EXPECT_EQ(std::memcmp(header.magic, recording::file_magic, sizeof(header.magic)), 0);
+  EXPECT_EQ(header.frame_count, ids.size());
+  EXPECT_EQ(header.data_bytes, std::filesystem::file_size(path_));
+
+  auto index_path = path_;
+  index_path += ".idx";
+  EXPECT_EQ(std::filesystem::file_size(index_path),
+            sizeof(recording::index_header) + ids.size() * sizeof(index_entry));
+
+  auto p = open();
+  ASSERT_TRUE(p);
+  expect_frames(*p, ids);
+}
+
+TEST_F(recording_file, full_staging_drops_frames_without_waiting) {
+  // Room for two frames at a time.
+  auto r = create({.staging_bytes = 2 * align_up(width * height * 2),
+                   .staging_frames = 2,
+                   .preallocate_bytes = 1 << 20});
+  ASSERT_TRUE(r);
+  std::vector<uint64_t> kept;
+  uint64_t              dropped = 0;
+  for (uint64_t id = 1; id <= 500; ++id) {
+    if (push(*r, id))
+      kept.push_back(id);
+    else
+      ++dropped;
+  }
+  ASSERT_FALSE(r->finish());
+
+  // Two slots cannot take 500 frames pushed back to back. Whatever the
+  // disk kept up with, the file holds exactly the frames push() took, in
+  // order, with no gaps left for the rest.
+  EXPECT_GT(dropped, 0u);
+  EXPECT_EQ(r->stats().dropped, dropped);
+  EXPECT_EQ(r->stats().frames, kept.size());
+  auto p = open();
+  ASSERT_TRUE(p);
+  expect_frames(*p, kept);
+}
+
+TEST_F(recording_file, wait_when_full_keeps_every_frame) {
+  auto r = create({.staging_bytes = 2 * align_up(width * height * 2),
+                   .staging_frames = 2,
+                   .preallocate_bytes = 1 << 20,
+                   .wait_when_full = true});
+  ASSERT_TRUE(r);
+  const auto ids = iota(500);
+  for (uint64_t id : ids)
+    ASSERT_TRUE(push(*r, id));
+  ASSERT_FALSE(r->finish());
+  EXPECT_EQ(r->stats().dropped, 0u);
+
+  auto p = open();
+  ASSERT_TRUE(p);
+  expect_frames(*p, ids);
+}
+
+TEST_F(recording_file, compressed_frames_decode_to_the_pixels_pushed) {
+  engine::jobs::job_system jobs({.threads = 2});
+  auto r = create({.preallocate_bytes = 1 << 20, .compress = true, .jobs = &jobs});
+  ASSERT_TRUE(r);
+  const auto ids = iota(20);
+  for (uint64_t id : ids)
+    ASSERT_TRUE(push(*r, id));
+  ASSERT_FALSE(r->finish());
+  EXPECT_GT(r->stats().compression_ratio, 1.0);
+
+  auto p = open();
+  ASSERT_TRUE(p);
+  for (size_t i = 0; i < p->frame_count(); ++i)
+    EXPECT_TRUE(p->entry(i).flags & recording::frame_compressed) << "frame " << i;
+  expect_frames(*p, ids);
+}
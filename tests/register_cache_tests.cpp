@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <gev/gvcp_client.hpp>
+#include <gev/protocol.hpp>
+#include <gev/register_cache.hpp>
+
+#include "../gev/sim/device_description.hpp"
+#include "../gev/sim/simulated_device.hpp"
+
+using gev::cache_policy;
+using gev::register_cache;
+
+namespace device_reg = gev::sim::device_reg;
+
+namespace {
+
+// Each test runs its own simulator on a loopback address of its own, so
+// that test processes run side by side never share a control port.
+struct loopback {
+  explicit loopback(uint8_t host, uint32_t max_outstanding = 1)
+      : sim({.control = {0x7F000000u | (21u << 8) | host, gev::gvcp_port}}) {
+    auto client = gev::gvcp_client::connect(sim.config().control,
+                                            {.max_outstanding = max_outstanding});
+    EXPECT_TRUE(client) << client.error().message();
+    cache = std::make_unique<register_cache>(std::shared_ptr(std::move(*client)));
+  }
+
+  // Commands the device has answered so far.
+  uint64_t commands() const { return sim.stats().control_commands.load(); }
+
+  gev::sim::simulated_device      sim;
+  std::unique_ptr<register_cache> cache;
+};
+
+} // namespace
+
+TEST(register_cache, volatile_registers_are_read_every_time) {
+  loopback device(1);
+  auto    &cache = *device.cache;
+  EXPECT_EQ(cache.policy(device_reg::exposure_us), cache_policy::volatile_);
+
+  const auto before = device.commands();
+  ASSERT_TRUE(cache.read(device_reg::exposure_us));
+  ASSERT_TRUE(cache.read(device_reg::exposure_us));
+  EXPECT_EQ(device.commands() - before, 2u);
+  EXPECT_EQ(cache.stats().hits, 0u);
+  EXPECT_EQ(cache.stats().misses, 0u);
+}
+
+TEST(register_cache, cached_registers_are_read_once_until_written) {
+  loopback device(2);
+  auto    &cache = *device.cache;
+  cache.set_policy(device_reg::exposure_us, cache_policy::cached);
+
+  const auto before = device.commands();
+  auto       first = cache.read(device_reg::exposure_us);
+  ASSERT_TRUE(first);
+  auto second = cache.read(device_reg::exposure_us);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(*second, *first);
+  EXPECT_EQ(device.commands() - before, 1u);
+  EXPECT_EQ(cache.stats().hits, 1u);
+  EXPECT_EQ(cache.stats().misses, 1u);
+
+  // The write drops the cached value; the device's is read back.
+  ASSERT_TRUE(cache.write(device_reg::exposure_us, 2500));
+  const auto written = device.commands();
+  auto       third = cache.read(device_reg::exposure_us);
+  ASSERT_TRUE(third);
+  EXPECT_EQ(*third, 2500u);
+  EXPECT_EQ(device.commands() - written, 1u);
+
+  // So does invalidate().
+  cache.invalidate(device_reg::exposure_us);
+  ASSERT_TRUE(cache.read(device_reg::exposure_us));
+  EXPECT_EQ(device.commands() - written, 2u);
+}
+
+TEST(register_cache, write_through_registers_cache_what_was_written) {
+  loopback device(3);
+  auto    &cache = *device.cache;
+  cache.set_policy(device_reg::frame_rate_mhz, cache_policy::write_through);
+
+  ASSERT_TRUE(cache.write(device_reg::frame_rate_mhz, 25'000));
+  const auto before = device.commands();
+  auto       value = cache.read(device_reg::frame_rate_mhz);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(*value, 25'000u);
+  EXPECT_EQ(device.commands(), before);
+
+  // A refused write may have landed in part, so nothing in it stays cached.
+  const std::pair<uint32_t, uint32_t> writes[] = {
+      {device_reg::frame_rate_mhz, 30'000},
+      {device_reg::end, 1},
+  };
+  EXPECT_FALSE(cache.write(writes));
+  value = cache.read(device_reg::frame_rate_mhz);
+  ASSERT_TRUE(value);
+  EXPECT_EQ(*value, 30'000u);
+  EXPECT_EQ(device.commands() - before, 2u);
+}
+
+TEST(register_cache, batches_misses_and_serves_hits_in_order) {
+  loopback device(4);
+  auto    &cache = *device.cache;
+  cache.set_policy(device_reg::width, cache_policy::cached);
+  cache.set_policy(device_reg::height, cache_policy::cached);
+  ASSERT_TRUE(cache.read(device_reg::height));
+
+  const uint32_t addresses[] = {device_reg::width, device_reg::height,
+                                device_reg::pixel_format};
+  const auto     before = device.commands();
+  auto           values = cache.read(addresses);
+  ASSERT_TRUE(values);
+  EXPECT_EQ(device.commands() - before, 1u);
+  EXPECT_EQ(*values, (std::vector<uint32_t>{device.sim.config().width,
+                                            device.sim.config().height,
+                                            gev::pixel_format_mono16}));
+}
+
+TEST(register_cache, sweep_isolates_refused_registers) {
+  loopback device(5, 4);
+  auto    &cache = *device.cache;
+
+  // The device register block ends part-way through the sweep.
+  const uint32_t count = 16;
+  const uint32_t valid = (device_reg::end - device_reg::width) / 4;
+  auto           values = cache.sweep(device_reg::width, count);
+  ASSERT_TRUE(values) << values.error().message();
+  ASSERT_EQ(values->size(), count);
+  for (uint32_t i = 0; i < count; ++i)
+    EXPECT_EQ((*values)[i].has_value(), i < valid) << "register " << i;
+  EXPECT_EQ((*values)[0], device.sim.config().width);
+  EXPECT_EQ((*values)[1], device.sim.config().height);
+
+  // Halving until each refused register is alone: 1 + 2 + 2 + 2 + 4.
+  EXPECT_EQ(cache.stats().batches, 11u);
+}
+
+TEST(register_cache, sweep_fails_on_timeouts) {
+  // Nobody at this address answers.
+  auto client = gev::gvcp_client::connect(
+      {0x7F000000u | (21u << 8) | 6, gev::gvcp_port},
+      {.timeout = std::chrono::milliseconds(20), .retries = 1});
+  ASSERT_TRUE(client);
+  register_cache cache(std::shared_ptr(std::move(*client)));
+
+  auto values = cache.sweep(0, 8);
+  ASSERT_FALSE(values);
+  EXPECT_EQ(values.error(), std::make_error_code(std::errc::timed_out));
+  EXPECT_EQ(cache.stats().batches, 1u);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <utility/slot_map.hpp>
+
+namespace {
+
+struct payload {
+  int value;
+};
+
+} // namespace
+
+TEST(slot_map, emplace_then_get_returns_value) {
+  slot_map<payload> map;
+  auto              id = map.emplace(payload{42});
+
+  auto got = map.get(id);
+  ASSERT_TRUE(got.has_value());
+  EXPECT_EQ((*got)->value, 42);
+  EXPECT_EQ(map.size(), 1u);
+  EXPECT_FALSE(map.empty());
+}
+
+TEST(slot_map, remove_returns_payload_and_invalidates_handle) {
+  slot_map<payload> map;
+  auto              id = map.emplace(payload{7});
+
+  auto removed = map.remove(id);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->value, 7);
+
+  EXPECT_FALSE(map.get(id).has_value());
+  EXPECT_FALSE(map.remove(id).has_value());
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(slot_map, reused_slot_rejects_stale_handle) {
+  slot_map<payload> map;
+  auto              first = map.emplace(payload{1});
+  (void)map.remove(first);
+
+  auto second = map.emplace(payload{2});
+  EXPECT_EQ(second.index(), first.index());
+  EXPECT_NE(second.generation(), first.generation());
+
+  EXPECT_FALSE(map.get(first).has_value());
+  ASSERT_TRUE(map.get(second).has_value());
+  EXPECT_EQ((*map.get(second))->value, 2);
+}
+
+TEST(slot_map, out_of_range_handle_is_rejected) {
+  slot_map<payload> map;
+  EXPECT_FALSE(map.get(slot_id{5, 0}).has_value());
+}
+
+TEST(slot_map, iteration_visits_only_live_slots) {
+  slot_map<payload>          map;
+  std::vector<slot_map<payload>::id> ids;
+  for (int i = 0; i < 10; ++i)
+    ids.push_back(map.emplace(payload{i}));
+
+  for (int i = 0; i < 10; i += 2)
+    (void)map.remove(ids[i]);
+
+  std::vector<int> seen;
+  for (const auto &p : map.values())
+    seen.push_back(p.value);
+  std::ranges::sort(seen);
+  EXPECT_EQ(seen, (std::vector<int>{1, 3, 5, 7, 9}));
+
+  for (auto [id, p] : map.entries()) {
+    auto got = map.get(id);
+    ASSERT_TRUE(got.has_value());
+    EXPECT_EQ((*got)->value, p.value);
+  }
+}
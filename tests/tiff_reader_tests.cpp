@@ -0,0 +1,549 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include <jobs/job_system.hpp>
+#include <recording/tiff_reader.hpp>
+#include <recording/tiff_writer.hpp>
+
+using recording::decode_page;
+using recording::parse_tiff;
+using recording::tiff_page;
+
+namespace {
+
+using bytes = std::vector<std::byte>;
+
+enum : uint16_t { type_ascii = 2, type_short = 3, type_long = 4, type_long8 = 16 };
+
+// Builds TIFF files field by field, in either byte order and either
+// offset size, for what tiff_writer does not write: big-endian files,
+// other codecs, ImageJ stacks and malformed directories.
+class tiff_builder {
+public:
+  struct entry {
+    uint16_t              tag;
+    uint16_t              type;
+    std::vector<uint64_t> values;
+  };
+
+  tiff_builder(bool big_endian, bool bigtiff)
+      : big_endian_(big_endian), bigtiff_(bigtiff) {
+    put_byte(big_endian ? 'M' : 'I');
+    put_byte(big_endian ? 'M' : 'I');
+    put(bigtiff ? 43 : 42, 2);
+    if (bigtiff) {
+      put(8, 2);
+      put(0, 2);
+    }
+    next_link_ = out_.size();
+    put(0, offset_size());
+  }
+
+  size_t offset_size() const noexcept { return bigtiff_ ? 8 : 4; }
+  bool   big_endian() const noexcept { return big_endian_; }
+
+  // Appends raw data, word aligned; returns its offset.
+  uint64_t append(std::span<const std::byte> data) {
+    if (out_.size() % 2)
+      put_byte(0);
+    const uint64_t at = out_.size();
+    out_.insert(out_.end(), data.begin(), data.end());
+    return at;
+  }
+
+  // Appends a directory and links the previous one (or the header) to it.
+  uint64_t directory(std::vector<entry> entries) {
+    std::ranges::sort(entries, {}, &entry::tag);
+    // Values that do not fit in their entry go first.
+    std::vector<uint64_t> out_of_line(entries.size());
+    for (size_t k = 0; k < entries.size(); ++k) {
+      const auto &e = entries[k];
+      const size_t size = type_size(e.type) * e.values.size();
+      if (size <= offset_size())
+        continue;
+      if (out_.size() % 2)
+        put_byte(0);
+      out_of_line[k] = out_.size();
+      for (uint64_t v : e.values)
+        put(v, type_size(e.type));
+    }
+
+    if (out_.size() % 2)
+      put_byte(0);
+    const uint64_t at = out_.size();
+    put(entries.size(), bigtiff_ ? 8 : 2);
+    for (size_t k = 0; k < entries.size(); ++k) {
+      const auto &e = entries[k];
+      put(e.tag, 2);
+      put(e.type, 2);
+      put(e.values.size(), offset_size());
+      if (out_of_line[k]) {
+        put(out_of_line[k], offset_size());
+      } else {
+        const size_t start = out_.size();
+        for (uint64_t v : e.values)
+          put(v, type_size(e.type));
+        out_.resize(start + offset_size(), std::byte{0});
+      }
+    }
+    link(next_link_, at);
+    next_link_ = out_.size();
+    put(0, offset_size());
+    return at;
+  }
+
+  // Points the next-directory field at `from` to `to`.
+  void link(uint64_t from, uint64_t to) { put_at(from, to, offset_size()); }
+  uint64_t last_link() const noexcept { return next_link_; }
+
+  // Pixels as the file stores them: in its byte order, optionally
+  // horizontally differenced (Predictor 2).
+  bytes encode(std::span<const uint16_t> pixels, uint32_t width, uint16_t bits,
+               bool differenced) const {
+    bytes out;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      uint16_t v = pixels[i];
+      if (differenced && i % width)
+        v = static_cast<uint16_t>(v - pixels[i - 1]);
+      if (bits == 8) {
+        out.push_back(std::byte(v & 0xFF));
+      } else if (big_endian_) {
+        out.push_back(std::byte(v >> 8));
+        out.push_back(std::byte(v & 0xFF));
+      } else {
+        out.push_back(std::byte(v & 0xFF));
+        out.push_back(std::byte(v >> 8));
+      }
+    }
+    return out;
+  }
+
+  // A page whose strips are already encoded.
+  uint64_t page(uint32_t width, uint32_t height, uint16_t bits, uint16_t compression,
+                uint16_t predictor, uint32_t rows_per_strip,
+                const std::vector<bytes> &strips, std::vector<entry> extra = {}) {
+    std::vector<uint64_t> offsets, counts;
+    for (const auto &s : strips) {
+      offsets.push_back(append(s));
+      counts.push_back(s.size());
+    }
+    const uint16_t offset_type = bigtiff_ ? type_long8 : type_long;
+    std::vector<entry> entries{
+        {256, type_long, {width}},
+        {257, type_long, {height}},
+        {258, type_short, {bits}},
+        {259, type_short, {compression}},
+        {262, type_short, {1}},
+        {273, offset_type, offsets},
+        {277, type_short, {1}},
+        {278, type_long, {rows_per_strip}},
+        {279, offset_type, counts},
+        {317, type_short, {predictor}},
+    };
+    for (auto &e : extra) {
+      std::erase_if(entries, [&](const entry &x) { return x.tag == e.tag; });
+      entries.push_back(std::move(e));
+    }
+    return directory(std::move(entries));
+  }
+
+  const bytes &data() const noexcept { return out_; }
+
+private:
+  static size_t type_size(uint16_t type) noexcept {
+    return type == type_ascii ? 1 : type == type_short ? 2 : type == type_long ? 4 : 8;
+  }
+
+  void put_byte(char c) { out_.push_back(std::byte(c)); }
+
+  void put(uint64_t v, size_t size) {
+    out_.resize(out_.size() + size);
+    put_at(out_.size() - size, v, size);
+  }
+
+  void put_at(uint64_t at, uint64_t v, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      const size_t shift = big_endian_ ? (size - 1 - i) * 8 : i * 8;
+      out_[at + i] = std::byte((v >> shift) & 0xFF);
+    }
+  }
+
+  bool     big_endian_;
+  bool     bigtiff_;
+  bytes    out_;
+  uint64_t next_link_ = 0;
+};
+
+std::vector<uint16_t> test_pixels(uint32_t width, uint32_t height, uint32_t seed,
+                                  uint16_t max = 0xFFFF) {
+  std::mt19937                            rng(seed);
+  std::uniform_int_distribution<uint32_t> noise(0, 63);
+  std::vector<uint16_t>                   pixels(size_t{width} * height);
+  for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x)
+      pixels[size_t{y} * width + x] =
+          static_cast<uint16_t>(((x * 97 + y * 31) * 13 + noise(rng)) % (uint32_t{max} + 1));
+  return pixels;
+}
+
+// TIFF LZW: MSB-first codes, widening one code early, as libtiff writes.
+bytes lzw_encode(std::span<const std::byte> in) {
+  bytes    out;
+  uint64_t bits = 0;
+  uint32_t bit_count = 0, width = 9, emitted = 0;
+  const auto emit = [&](uint32_t code) {
+    bits = bits << width | code;
+    bit_count += width;
+    while (bit_count >= 8) {
+      out.push_back(std::byte((bits >> (bit_count - 8)) & 0xFF));
+      bit_count -= 8;
+    }
+    // The reader adds an entry after every code but the first and widens
+    // once its next entry reaches the top code of the current width.
+    if (code != 256 && emitted++ > 0 && 258 + emitted - 1 == (1u << width) - 1 &&
+        width < 12)
+      ++width;
+  };
+
+  std::map<std::pair<uint32_t, uint8_t>, uint32_t> table;
+  uint32_t                                          next = 258;
+  emit(256);
+  emitted = 0;
+  int64_t w = -1;
+  for (std::byte b : in) {
+    const auto c = std::to_integer<uint8_t>(b);
+    if (w < 0) {
+      w = c;
+      continue;
+    }
+    if (auto it = table.find({static_cast<uint32_t>(w), c}); it != table.end()) {
+      w = it->second;
+      continue;
+    }
+    emit(static_cast<uint32_t>(w));
+    table[{static_cast<uint32_t>(w), c}] = next++;
+    w = c;
+    // Start over before the reader's 4096-entry table is full.
+    if (next == 4094) {
+      emit(256);
+      table.clear();
+      next = 258;
+      width = 9;
+      emitted = 0;
+    }
+  }
+  if (w >= 0)
+    emit(static_cast<uint32_t>(w));
+  emit(257);
+  if (bit_count)
+    out.push_back(std::byte((bits << (8 - bit_count)) & 0xFF));
+  return out;
+}
+
+bytes packbits_encode(std::span<const std::byte> in) {
+  bytes  out;
+  size_t i = 0;
+  while (i < in.size()) {
+    size_t run = 1;
+    while (i + run < in.size() && run < 128 && in[i + run] == in[i])
+      ++run;
+    if (run >= 2) {
+      out.push_back(std::byte(static_cast<uint8_t>(1 - static_cast<int>(run))));
+      out.push_back(in[i]);
+      i += run;
+      continue;
+    }
+    size_t literal = 1;
+    while (i + literal < in.size() && literal < 128 &&
+           !(i + literal + 1 < in.size() && in[i + literal] == in[i + literal + 1]))
+      ++literal;
+    out.push_back(std::byte(literal - 1));
+    out.insert(out.end(), in.begin() + i, in.begin() + i + literal);
+    i += literal;
+  }
+  return out;
+}
+
+std::vector<bytes> split_rows(const bytes &image, size_t row_bytes, uint32_t height,
+                              uint32_t rows_per_strip) {
+  std::vector<bytes> strips;
+  for (uint32_t y = 0; y < height; y += rows_per_strip) {
+    const size_t begin = y * row_bytes;
+    const size_t end = std::min<size_t>(height, y + rows_per_strip) * row_bytes;
+    strips.emplace_back(image.begin() + begin, image.begin() + end);
+  }
+  return strips;
+}
+
+std::vector<uint16_t> decode(std::span<const std::byte> file, const tiff_page &page,
+                             engine::jobs::job_system *jobs = nullptr) {
+  std::vector<uint16_t> out(size_t{page.width} * page.height);
+  EXPECT_TRUE(decode_page(file, page, out, jobs));
+  return out;
+}
+
+class tiff_file : public ::testing::Test {
+protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() /
+            ("tiff_reader_tests_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".tif");
+  }
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  bytes read() const {
+    std::ifstream file(path_, std::ios::binary);
+    std::vector<char> chars{std::istreambuf_iterator<char>(file), {}};
+    bytes out(chars.size());
+    std::memcpy(out.data(), chars.data(), chars.size());
+    return out;
+  }
+
+  std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST_F(tiff_file, writer_round_trips_through_the_reader) {
+  constexpr uint32_t       width = 61, height = 37, pages = 3;
+  engine::jobs::job_system jobs({.threads = 2});
+  for (bool bigtiff : {false, true})
+    for (auto compression : {recording::tiff_compression::none,
+                             recording::tiff_compression::deflate}) {
+      SCOPED_TRACE(testing::Message() << "bigtiff " << bigtiff << ", compression "
+                                      << static_cast<int>(compression));
+      {
+        auto writer = recording::tiff_writer::create(
+            path_, {.compression = compression, .bigtiff = bigtiff, .strip_bytes = 1000});
+        ASSERT_TRUE(writer);
+        for (uint32_t p = 0; p < pages; ++p)
+          ASSERT_FALSE((*writer)->write_page(test_pixels(width, height, p), width,
+                                             height, p % 2 ? &jobs : nullptr));
+        ASSERT_FALSE((*writer)->close());
+      }
+
+      const bytes file = read();
+      auto        parsed = parse_tiff(file);
+      ASSERT_TRUE(parsed) << parsed.error().message();
+      ASSERT_EQ(parsed->size(), pages);
+      for (uint32_t p = 0; p < pages; ++p) {
+        const auto &page = (*parsed)[p];
+        EXPECT_EQ(page.width, width);
+        EXPECT_EQ(page.height, height);
+        EXPECT_GT(page.strip_offsets.size(), 1u);
+        EXPECT_EQ(page.predictor,
+                  compression == recording::tiff_compression::deflate ? 2 : 1);
+        EXPECT_EQ(decode(file, page, p % 2 ? nullptr : &jobs), test_pixels(width, height, p));
+      }
+    }
+}
+
+TEST(tiff_reader, reads_both_byte_orders_and_offset_sizes) {
+  constexpr uint32_t width = 19, height = 11, rows = 4;
+  const auto         pixels = test_pixels(width, height, 7);
+  for (bool big_endian : {false, true})
+    for (bool bigtiff : {false, true})
+      for (uint16_t predictor : {1, 2}) {
+        SCOPED_TRACE(testing::Message() << "big endian " << big_endian << ", bigtiff "
+                                        << bigtiff << ", predictor " << predictor);
+        tiff_builder b(big_endian, bigtiff);
+        const bytes  image = b.encode(pixels, width, 16, predictor == 2);
+        b.page(width, height, 16, 1, predictor, rows,
+               split_rows(image, width * 2, height, rows));
+
+        auto parsed = parse_tiff(b.data());
+        ASSERT_TRUE(parsed) << parsed.error().message();
+        ASSERT_EQ(parsed->size(), 1u);
+        EXPECT_EQ((*parsed)[0].big_endian, big_endian);
+        EXPECT_EQ(decode(b.data(), (*parsed)[0]), pixels);
+      }
+}
+
+TEST(tiff_reader, decodes_lzw_packbits_and_8_bit_pages) {
+  // Whole-image strips take LZW through every code width and a reset.
+  constexpr uint32_t width = 64, height = 48;
+  const auto         pixels16 = test_pixels(width, height, 3);
+  const auto         pixels8 = test_pixels(width, height, 4, 0xFF);
+  for (bool big_endian : {false, true})
+    for (uint16_t bits : {8, 16})
+      for (uint16_t compression : {5, 32773}) // LZW, PackBits
+        for (uint16_t predictor : {1, 2})
+          for (uint32_t rows : {5u, height}) {
+            SCOPED_TRACE(testing::Message() << "big endian " << big_endian << ", bits "
+                                            << bits << ", compression " << compression
+                                            << ", predictor " << predictor << ", rows "
+                                            << rows);
+            const auto  &pixels = bits == 8 ? pixels8 : pixels16;
+            tiff_builder b(big_endian, false);
+            const bytes  image = b.encode(pixels, width, bits, predictor == 2);
+            std::vector<bytes> strips;
+            for (const auto &s : split_rows(image, width * bits / 8, height, rows))
+              strips.push_back(compression == 5 ? lzw_encode(s) : packbits_encode(s));
+            b.page(width, height, bits, compression, predictor, rows, strips);
+
+            auto parsed = parse_tiff(b.data());
+            ASSERT_TRUE(parsed) << parsed.error().message();
+            EXPECT_EQ(decode(b.data(), (*parsed)[0]), pixels);
+          }
+}
+
+TEST(tiff_reader, splits_an_imagej_stack_into_its_images) {
+  constexpr uint32_t width = 16, height = 8, images = 3;
+  tiff_builder       b(false, false);
+  bytes              stack;
+  for (uint32_t i = 0; i < images; ++i) {
+    const auto image = b.encode(test_pixels(width, height, 10 + i), width, 16, false);
+    stack.insert(stack.end(), image.begin(), image.end());
+  }
+
+  // One directory for the whole stack, describing only the first image.
+  // The description claims more images than the file holds; only those
+  // that fit come back.
+  const std::string description = "ImageJ=1.54f\nimages=5\nslices=5\n";
+  std::vector<uint64_t> text(description.begin(), description.end());
+  text.push_back(0);
+  const uint64_t at = b.append(stack);
+  const uint64_t image_bytes = uint64_t{width} * height * 2;
+  b.directory({
+      {256, type_long, {width}},
+      {257, type_long, {height}},
+      {258, type_short, {16}},
+      {270, type_ascii, text},
+      {273, type_long, {at}},
+      {278, type_long, {height}},
+      {279, type_long, {image_bytes}},
+  });
+  // The directory follows the pixels here; it must not count as an image.
+  ASSERT_LT(b.data().size() - at - images * image_bytes, image_bytes);
+
+  auto parsed = parse_tiff(b.data());
+  ASSERT_TRUE(parsed) << parsed.error().message();
+  ASSERT_EQ(parsed->size(), images);
+  for (uint32_t i = 0; i < images; ++i) {
+    EXPECT_EQ((*parsed)[i].strip_offsets[0], at + i * image_bytes);
+    EXPECT_TRUE((*parsed)[i].direct());
+    EXPECT_EQ(decode(b.data(), (*parsed)[i]), test_pixels(width, height, 10 + i));
+  }
+}
+
+TEST_F(tiff_file, truncated_files_fail_cleanly) {
+  constexpr uint32_t width = 33, height = 21;
+  {
+    auto writer = recording::tiff_writer::create(
+        path_, {.compression = recording::tiff_compression::deflate, .strip_bytes = 400});
+    ASSERT_TRUE(writer);
+    for (uint32_t p = 0; p < 2; ++p)
+      ASSERT_FALSE((*writer)->write_page(test_pixels(width, height, p), width, height,
+                                         nullptr));
+  }
+  const bytes file = read();
+  ASSERT_TRUE(parse_tiff(file));
+
+  // The last directory is at the end, so every cut loses part of it.
+  for (size_t size = 0; size < file.size(); ++size) {
+    auto parsed = parse_tiff(std::span(file).first(size));
+    ASSERT_FALSE(parsed) << size;
+    EXPECT_EQ(parsed.error(), std::errc::illegal_byte_sequence) << size;
+  }
+
+  // Damaged strips fail the decode rather than reading past them.
+  auto pages = parse_tiff(file);
+  bytes damaged = file;
+  const auto &page = (*pages)[1];
+  for (size_t s = 0; s < page.strip_offsets.size(); ++s)
+    for (uint64_t k = 0; k < page.strip_bytes[s]; k += 3)
+      damaged[page.strip_offsets[s] + k] ^= std::byte{0x5A};
+  std::vector<uint16_t> out(size_t{width} * height);
+  EXPECT_FALSE(decode_page(damaged, page, out, nullptr));
+}
+
+TEST(tiff_reader, rejects_looping_directory_chains) {
+  constexpr uint32_t width = 4, height = 4;
+  for (bool to_self : {true, false}) {
+    tiff_builder b(false, false);
+    const auto   image = b.encode(test_pixels(width, height, 1), width, 16, false);
+    const auto   first = b.page(width, height, 16, 1, 1, height, {image});
+    if (to_self) {
+      b.link(b.last_link(), first);
+    } else {
+      b.page(width, height, 16, 1, 1, height, {image});
+      b.link(b.last_link(), first);
+    }
+    auto parsed = parse_tiff(b.data());
+    ASSERT_FALSE(parsed) << to_self;
+    EXPECT_EQ(parsed.error(), std::errc::illegal_byte_sequence);
+  }
+}
+
+TEST(tiff_reader, rejects_strips_outside_the_file) {
+  constexpr uint32_t width = 8, height = 8;
+  const auto         pixels = test_pixels(width, height, 2);
+
+  const auto parse_with = [&](std::vector<tiff_builder::entry> extra, uint16_t compression = 1) {
+    tiff_builder b(false, false);
+    const auto   image = b.encode(pixels, width, 16, false);
+    b.page(width, height, 16, compression, 1, height, {image}, std::move(extra));
+    return parse_tiff(b.data());
+  };
+  const auto expect_invalid = [](const auto &parsed, const char *what) {
+    ASSERT_FALSE(parsed) << what;
+    EXPECT_EQ(parsed.error(), std::errc::illegal_byte_sequence) << what;
+  };
+
+  ASSERT_TRUE(parse_with({}));
+  expect_invalid(parse_with({{279, type_long, {uint64_t{1} << 31}}}), "byte count");
+  expect_invalid(parse_with({{273, type_long, {uint64_t{1} << 31}}}), "offset");
+  expect_invalid(parse_with({{279, type_long, {width * height}}}), "short strip");
+  // More strips than the page has rows for, and a count far past the
+  // file that the reader must not allocate for.
+  expect_invalid(parse_with({{279, type_long, {64, 64}}}), "strip count");
+  expect_invalid(parse_with({{278, type_long, {1}}}), "rows per strip");
+
+  tiff_builder b(false, false);
+  b.page(width, height, 16, 1, 1, height, {b.encode(pixels, width, 16, false)});
+  bytes huge_count = b.data();
+  // The last entry before the next-directory link is Predictor; the one
+  // before it StripByteCounts. Give it a count of a billion.
+  const size_t entry = b.last_link() - 2 * 12;
+  const uint32_t billion = 1'000'000'000;
+  std::memcpy(huge_count.data() + entry + 4, &billion, 4);
+  expect_invalid(parse_tiff(huge_count), "huge count");
+
+  // A tiny compressed strip cannot hold a huge image.
+  expect_invalid(parse_with({{256, type_long, {1u << 20}}, {257, type_long, {1u << 20}},
+                             {278, type_long, {1u << 20}}},
+                            8),
+                 "expansion");
+}
+
+TEST(tiff_reader, refuses_forms_it_cannot_decode) {
+  constexpr uint32_t width = 4, height = 4;
+  for (auto extra : std::vector<tiff_builder::entry>{
+           {322, type_long, {16}},    // Tiles.
+           {258, type_short, {32}},   // 32-bit samples.
+           {277, type_short, {3}},    // RGB.
+           {339, type_short, {3}},    // Floating point.
+           {259, type_short, {7}},    // JPEG.
+       }) {
+    tiff_builder b(false, false);
+    b.page(width, height, 16, 1, 1, height,
+           {b.encode(test_pixels(width, height, 1), width, 16, false)}, {extra});
+    auto parsed = parse_tiff(b.data());
+    ASSERT_FALSE(parsed) << extra.tag;
+    EXPECT_EQ(parsed.error(), std::errc::not_supported) << extra.tag;
+  }
+}
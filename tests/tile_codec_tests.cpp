@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <recording/tile_codec.hpp>
+
+namespace {
+
+// A smooth phantom under Poisson-like noise, as a detector sees it.
+std::vector<uint16_t> detector_frame(uint32_t width, uint32_t height,
+                                     uint32_t seed) {
+  std::mt19937                     rng(seed);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  std::vector<uint16_t> frame(size_t{width} * height);
+  for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x) {
+      const double signal =
+          8000.0 + 6000.0 * std::sin(x * 0.01) * std::cos(y * 0.013);
+      frame[size_t{y} * width + x] = static_cast<uint16_t>(
+          std::clamp(signal + std::sqrt(signal) * noise(rng), 0.0, 65535.0));
+    }
+  return frame;
+}
+
+std::vector<uint16_t> round_trip(const recording::tile_codec &codec_settings,
+                                 const std::vector<uint16_t> &frame,
+                                 uint32_t width, uint32_t height,
+                                 size_t *encoded_size = nullptr) {
+  recording::tile_codec  codec = codec_settings;
+  std::vector<std::byte> encoded(codec.max_encoded_size(width, height));
+  const size_t           size = codec.encode(frame, width, height, encoded);
+  encoded.resize(size);
+  if (encoded_size)
+    *encoded_size = size;
+
+  std::vector<uint16_t> decoded(frame.size(), 0xDEAD);
+  EXPECT_TRUE(recording::tile_codec::decode(encoded, decoded));
+  return decoded;
+}
+
+} // namespace
+
+TEST(tile_codec, detector_frames_round_trip_and_shrink) {
+  const auto frame = detector_frame(512, 384, 1);
+  size_t     size = 0;
+  EXPECT_EQ(round_trip(recording::tile_codec{}, frame, 512, 384, &size), frame);
+  EXPECT_LT(size, frame.size() * 2 * 2 / 3);
+}
+
+TEST(tile_codec, partial_edge_tiles_round_trip) {
+  // Neither dimension a multiple of the tile or of the 32-pixel block.
+  const auto frame = detector_frame(301, 77, 2);
+  EXPECT_EQ(round_trip(recording::tile_codec(64, 32), frame, 301, 77), frame);
+}
+
+TEST(tile_codec, full_scale_noise_is_stored_not_expanded) {
+  std::mt19937          rng(3);
+  std::vector<uint16_t> frame(256 * 128);
+  for (auto &p : frame)
+    p = static_cast<uint16_t>(rng());
+
+  size_t size = 0;
+  EXPECT_EQ(round_trip(recording::tile_codec{}, frame, 256, 128, &size), frame);
+  EXPECT_LE(size, frame.size() * 2 + 64);
+}
+
+TEST(tile_codec, extremes_and_wraparound_round_trip) {
+  // Residuals that wrap: 0 next to 65535 in every direction.
+  std::vector<uint16_t> frame(160 * 70);
+  for (size_t i = 0; i < frame.size(); ++i)
+    frame[i] = (i / 3 + i / 160) % 2 ? 0xFFFF : 0;
+  EXPECT_EQ(round_trip(recording::tile_codec{}, frame, 160, 70), frame);
+
+  const std::vector<uint16_t> flat(128 * 64, 1234);
+  size_t                      size = 0;
+  EXPECT_EQ(round_trip(recording::tile_codec{}, flat, 128, 64, &size), flat);
+  EXPECT_LT(size, 400u); // One tile of zero-width blocks but its corner.
+}
+
+TEST(tile_codec, tiles_decode_on_their_own) {
+  const uint32_t        width = 300, height = 200;
+  const auto            frame = detector_frame(width, height, 4);
+  recording::tile_codec codec(128, 64);
+
+  std::vector<std::byte> encoded(codec.max_encoded_size(width, height));
+  encoded.resize(codec.encode(frame, width, height, encoded));
+
+  const auto header = recording::tile_codec::header(encoded);
+  ASSERT_TRUE(header);
+  ASSERT_EQ(header->tile_count, 3u * 4u);
+
+  // Only tile 7 (second column, third row): nothing else is written.
+  std::vector<uint16_t> out(frame.size(), 0);
+  ASSERT_TRUE(recording::tile_codec::decode_tile(encoded, *header, 7, out));
+  for (uint32_t y = 0; y < height; ++y)
+    for (uint32_t x = 0; x < width; ++x) {
+      const bool inside = x >= 128 && x < 256 && y >= 128 && y < 192;
+      const size_t i = size_t{y} * width + x;
+      ASSERT_EQ(out[i], inside ? frame[i] : 0) << x << "," << y;
+    }
+}
+
+TEST(tile_codec, malformed_input_is_rejected) {
+  const auto             frame = detector_frame(128, 128, 5);
+  recording::tile_codec  codec;
+  std::vector<std::byte> encoded(codec.max_encoded_size(128, 128));
+  encoded.resize(codec.encode(frame, 128, 128, encoded));
+
+  std::vector<uint16_t> out(frame.size());
+  auto                  truncated = encoded;
+  truncated.resize(truncated.size() - 5);
+  EXPECT_FALSE(recording::tile_codec::decode(truncated, out));
+
+  auto bad_magic = encoded;
+  bad_magic[0] = std::byte{'X'};
+  EXPECT_FALSE(recording::tile_codec::decode(bad_magic, out));
+
+  std::vector<uint16_t> small(10);
+  EXPECT_FALSE(recording::tile_codec::decode(encoded, small));
+}